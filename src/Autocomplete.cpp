@@ -107,28 +107,36 @@ void AutoComplete::ClearDemofileList() {
 }
 
 void AutoComplete::AddSymbols(wxString xml) {
-  if(m_addSymbols_backgroundThread.joinable())
-    m_addSymbols_backgroundThread.join();
+  m_addSymbols_backgroundTask.Wait();
 
   if((m_configuration->UseThreads() && xml.Length() > 300))
-    m_addSymbols_backgroundThread = jthread(&AutoComplete::AddSymbols_Backgroundtask_string,
-                                                this, std::move(xml));
+    m_addSymbols_backgroundTask =
+      TaskPool::Get().Submit(TaskPool::AUTOCOMPLETE, TaskPool::NORMAL,
+                             [this, xml]() { AddSymbols_Backgroundtask_string(xml); });
   else
     AddSymbols_Backgroundtask_string(std::move(xml));
 }
 
 void AutoComplete::AddSymbols(wxXmlDocument xml) {
-  if(m_addSymbols_backgroundThread.joinable())
+  if(!m_addSymbols_backgroundTask.IsDone())
     {
-      wxLogMessage(_("Waiting for m_addSymbols_backgroundThread to finish"));
-      m_addSymbols_backgroundThread.join();
+      wxLogMessage(_("Waiting for m_addSymbols_backgroundTask to finish"));
+      m_addSymbols_backgroundTask.Wait();
     }
   wxLogMessage(_("Scheduling a background task that compiles a new list "
                  "of autocompletable maxima commands."));
 
   if(m_configuration->UseThreads())
-    m_addSymbols_backgroundThread = jthread(&AutoComplete::AddSymbols_Backgroundtask,
-                                                this, std::move(xml));
+    {
+      // std::function needs a copyable function => share the document instead
+      // of copying it
+      auto document = std::make_shared<wxXmlDocument>(std::move(xml));
+      m_addSymbols_backgroundTask =
+        TaskPool::Get().Submit(TaskPool::AUTOCOMPLETE, TaskPool::NORMAL,
+                               [this, document]() {
+                                 AddSymbols_Backgroundtask(std::move(*document));
+                               });
+    }
   else
     AddSymbols_Backgroundtask(std::move(xml));
 
@@ -218,10 +226,8 @@ void AutoComplete::AddWorksheetWords(const WordList &words) {
 }
 
 AutoComplete::~AutoComplete() {
-   if (m_addSymbols_backgroundThread.joinable())
-     m_addSymbols_backgroundThread.join();
-   if(m_addFiles_backgroundThread.joinable())
-     m_addFiles_backgroundThread.join();
+   m_addSymbols_backgroundTask.Wait();
+   m_addFiles_backgroundTask.Wait();
 }
 
 void AutoComplete::LoadSymbols() {
@@ -231,22 +237,28 @@ void AutoComplete::LoadSymbols() {
   wxString demodir = m_configuration->MaximaDemoDir();
   demodir.Replace("\n", "");
   demodir.Replace("\r", "");
-  if(m_addFiles_backgroundThread.joinable())
+  if(!m_addFiles_backgroundTask.IsDone())
     {
-      wxLogMessage(_("Waiting for m_addFiles_backgroundThread to finish"));
-      m_addFiles_backgroundThread.join();
+      wxLogMessage(_("Waiting for m_addFiles_backgroundTask to finish"));
+      m_addFiles_backgroundTask.Wait();
     }
-  if(m_addSymbols_backgroundThread.joinable())
+  if(!m_addSymbols_backgroundTask.IsDone())
     {
-      wxLogMessage(_("Waiting for m_addSymbols_backgroundThread to finish"));
-      m_addSymbols_backgroundThread.join();
+      wxLogMessage(_("Waiting for m_addSymbols_backgroundTask to finish"));
+      m_addSymbols_backgroundTask.Wait();
     }
   if(m_configuration->UseThreads())
     {
-      m_addSymbols_backgroundThread = jthread(&AutoComplete::BuiltinSymbols_BackgroundTask,
-                                              this);
-      m_addFiles_backgroundThread = jthread(&AutoComplete::LoadableFiles_BackgroundTask,
-                                            this, sharedir, demodir);
+      m_addSymbols_backgroundTask =
+        TaskPool::Get().Submit(TaskPool::AUTOCOMPLETE, TaskPool::NORMAL,
+                               [this]() { BuiltinSymbols_BackgroundTask(); });
+      // Searching the disk for loadable files takes long and is only needed
+      // when the user asks for a file name
+      m_addFiles_backgroundTask =
+        TaskPool::Get().Submit(TaskPool::AUTOCOMPLETE, TaskPool::LOW,
+                               [this, sharedir, demodir]() {
+                                 LoadableFiles_BackgroundTask(sharedir, demodir);
+                               });
     }
   else
     {
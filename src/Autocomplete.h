@@ -44,6 +44,7 @@
 #include <wx/filename.h>
 #include <wx/hashmap.h>
 #include "Configuration.h"
+#include "TaskPool.h"
 #include "precomp.h"
 #include "Version.h"
 #include <unordered_map>
@@ -324,8 +325,8 @@ private:
       }
   };
  
-  jthread m_addSymbols_backgroundThread;
-  jthread m_addFiles_backgroundThread;
+  TaskPool::Task m_addSymbols_backgroundTask;
+  TaskPool::Task m_addFiles_backgroundTask;
   //! Is locked when someone accesses a keyword list
   std::mutex m_keywordsLock;
   //! The lists of autocompletable symbols for the classes defined in autoCompletionType
@@ -0,0 +1,200 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class AutosaveJournal.
+*/
+
+#include "AutosaveJournal.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+//! The first line of every journal
+const char journalMagic[] = "wxMaxima autosave journal 1\n";
+}
+
+std::string AutosaveJournal::Begin(const std::string &snapshot, const std::vector<CellId> &cells)
+{
+  std::string payload = snapshot + "\n";
+  AppendIds(payload, cells);
+  std::string journal = journalMagic;
+  AppendRecord(journal, "base", payload);
+  return journal;
+}
+
+void AutosaveJournal::AddCell(CellId cell, const std::string &xml)
+{
+  AppendRecord(m_pending, "cell", std::to_string(cell) + "\n" + xml);
+}
+
+void AutosaveJournal::AddFile(const std::string &name, const char *data, std::size_t length)
+{
+  std::string payload = name + "\n";
+  payload.append(data, length);
+  AppendRecord(m_pending, "file", payload);
+}
+
+std::string AutosaveJournal::Commit(const std::vector<CellId> &cells, const std::string &header)
+{
+  std::string payload;
+  AppendIds(payload, cells);
+  payload += "\n";
+  payload += header;
+  std::string records;
+  records.swap(m_pending);
+  AppendRecord(records, "commit", payload);
+  return records;
+}
+
+unsigned long AutosaveJournal::Checksum(const char *data, std::size_t length)
+{
+  // 32-bit FNV-1a
+  std::uint_fast32_t hash = 2166136261u;
+  for(std::size_t i = 0; i < length; i++)
+    {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash = (hash * 16777619u) & 0xFFFFFFFFu;
+    }
+  return static_cast<unsigned long>(hash);
+}
+
+void AutosaveJournal::AppendRecord(std::string &out, const char *type, const std::string &payload)
+{
+  char line[64];
+  std::snprintf(line, sizeof(line), "%s %lu %08lx\n", type,
+                static_cast<unsigned long>(payload.size()),
+                Checksum(payload.data(), payload.size()));
+  out += line;
+  out += payload;
+  out += '\n';
+}
+
+void AutosaveJournal::AppendIds(std::string &out, const std::vector<CellId> &cells)
+{
+  for(std::size_t i = 0; i < cells.size(); i++)
+    {
+      if(i > 0)
+        out += ' ';
+      out += std::to_string(cells[i]);
+    }
+}
+
+bool AutosaveJournal::ReadIds(const std::string &text, std::vector<CellId> &cells)
+{
+  cells.clear();
+  const char *pos = text.c_str();
+  while(*pos != '\0')
+    {
+      if(*pos == ' ')
+        {
+          ++pos;
+          continue;
+        }
+      char *end = NULL;
+      unsigned long long id = std::strtoull(pos, &end, 10);
+      if(end == pos)
+        return false;
+      cells.push_back(static_cast<CellId>(id));
+      pos = end;
+    }
+  return true;
+}
+
+bool AutosaveJournal::Read(const char *data, std::size_t length, Contents &contents)
+{
+  contents = Contents();
+  const std::size_t magicLength = std::strlen(journalMagic);
+  if((length < magicLength) || (std::memcmp(data, journalMagic, magicLength) != 0))
+    return false;
+
+  // The changes that take effect with the next commit
+  std::unordered_map<CellId, std::string> pendingCells;
+  std::map<std::string, std::string> pendingFiles;
+  bool haveBase = false;
+  std::size_t pos = magicLength;
+  while(pos < length)
+    {
+      // The line that introduces the record
+      const char *lineEnd = static_cast<const char *>(
+        std::memchr(data + pos, '\n', length - pos));
+      if(lineEnd == NULL)
+        break;
+      const std::string line(data + pos, lineEnd);
+      char type[16];
+      unsigned long payloadLength;
+      unsigned long checksum;
+      if(std::sscanf(line.c_str(), "%15s %lu %lx", type, &payloadLength, &checksum) != 3)
+        break;
+      const std::size_t payloadStart = lineEnd + 1 - data;
+      if((payloadLength > length - payloadStart) ||
+         (length - payloadStart - payloadLength < 1) ||
+         (data[payloadStart + payloadLength] != '\n'))
+        break;
+      const char *payloadData = data + payloadStart;
+      if(Checksum(payloadData, payloadLength) != checksum)
+        break;
+      pos = payloadStart + payloadLength + 1;
+
+      // All payloads start with a line that tells what they are about
+      const char *firstLineEnd = static_cast<const char *>(
+        std::memchr(payloadData, '\n', payloadLength));
+      if(firstLineEnd == NULL)
+        break;
+      const std::string firstLine(payloadData, firstLineEnd);
+      std::string rest(firstLineEnd + 1, payloadData + payloadLength);
+
+      if(!haveBase)
+        {
+          if((std::strcmp(type, "base") != 0) || !ReadIds(rest, contents.baseCells))
+            return false;
+          contents.snapshot = firstLine;
+          contents.cells = contents.baseCells;
+          contents.committedBytes = pos;
+          haveBase = true;
+        }
+      else if(std::strcmp(type, "cell") == 0)
+        pendingCells[std::strtoull(firstLine.c_str(), NULL, 10)] = std::move(rest);
+      else if(std::strcmp(type, "file") == 0)
+        pendingFiles[firstLine] = std::move(rest);
+      else if(std::strcmp(type, "commit") == 0)
+        {
+          std::vector<CellId> cells;
+          if(!ReadIds(firstLine, cells))
+            break;
+          contents.cells = std::move(cells);
+          contents.header = std::move(rest);
+          for(auto &cell : pendingCells)
+            contents.changedCells[cell.first] = std::move(cell.second);
+          for(auto &file : pendingFiles)
+            contents.files[file.first] = std::move(file.second);
+          pendingCells.clear();
+          pendingFiles.clear();
+          contents.committedBytes = pos;
+        }
+      else
+        break;
+    }
+  return haveBase;
+}
@@ -0,0 +1,130 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_AUTOSAVEJOURNAL_H
+#define WXMAXIMA_AUTOSAVEJOURNAL_H
+
+/*! \file
+ *
+ * Declares the format of the journal autosaves append the changed cells to.
+ */
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! The journal that records which cells of a worksheet have changed since a snapshot
+
+  Writing the whole worksheet to a .wxmx file on every autosave means
+  converting all cells to XML and writing all images, even if only one
+  character has changed. Instead the autosave writes the whole worksheet only
+  once (the "snapshot") and from then on only appends the cells that have
+  changed, plus the images they contain, to a journal next to the snapshot.
+  Replaying the journal over the snapshot results in the current worksheet,
+  which allows to merge both into a new snapshot in the background and to
+  recover the worksheet after a crash.
+
+  The journal consists of a line identifying the file format followed by
+  records. Each record starts with a line "<type> <length> <checksum>",
+  followed by the payload and a newline. The first record is a "base" record
+  that names the snapshot and lists the ids of the cells it contains. "cell"
+  and "file" records contain the XML of a cell and a file the cells refer to.
+  They take effect only when the "commit" record that follows them has been
+  read, which lists the ids of the cells the worksheet consists of and
+  contains the XML header of the document. This way a journal that has only
+  been partially written when wxMaxima crashed still can be replayed up to
+  the last autosave that was completed.
+
+  This class only generates and interprets the data of the journal: Reading
+  and writing the file is left to the caller.
+*/
+class AutosaveJournal
+{
+public:
+  //! The number that identifies a cell in the journal
+  using CellId = std::size_t;
+
+  //! The state of the worksheet the journal describes
+  struct Contents
+  {
+    //! The name of the .wxmx file the journal records the changes to
+    std::string snapshot;
+    //! The ids of the cells in the snapshot, in the order they appear there
+    std::vector<CellId> baseCells;
+    //! The ids of the cells of the worksheet at the last commit
+    std::vector<CellId> cells;
+    //! The XML header of the document at the last commit. Empty = use the snapshot's.
+    std::string header;
+    //! The newest XML of each cell that has been written to the journal
+    std::unordered_map<CellId, std::string> changedCells;
+    //! The files the journal contains, by name
+    std::map<std::string, std::string> files;
+    //! The number of bytes up to and including the last commit
+    std::size_t committedBytes = 0;
+  };
+
+  /*! Returns the start of a new journal
+
+    \param snapshot The name of the .wxmx file (without the path) the journal belongs to
+    \param cells The ids of the cells in the snapshot, in the order they appear there
+  */
+  static std::string Begin(const std::string &snapshot, const std::vector<CellId> &cells);
+
+  //! Adds the XML of a changed cell to the next commit
+  void AddCell(CellId cell, const std::string &xml);
+  //! Adds a file (an image or gnuplot data) to the next commit
+  void AddFile(const std::string &name, const char *data, std::size_t length);
+  //! Have cells or files been added since the last commit?
+  bool HasPendingRecords() const { return !m_pending.empty(); }
+  /*! Returns the records to append to the journal
+
+    \param cells The ids of all cells of the worksheet, in order
+    \param header The XML header of the document
+    \return The records for the cells and files added since the last commit,
+    followed by the commit record.
+  */
+  std::string Commit(const std::vector<CellId> &cells, const std::string &header);
+
+  /*! Interprets a journal
+
+    Data after the last commit, or after a record that is incomplete or
+    doesn't match its checksum, is ignored.
+    \return false, if the data doesn't start like a journal does.
+  */
+  static bool Read(const char *data, std::size_t length, Contents &contents);
+
+private:
+  //! Appends a record to out
+  static void AppendRecord(std::string &out, const char *type, const std::string &payload);
+  //! The checksum of a record's payload
+  static unsigned long Checksum(const char *data, std::size_t length);
+  //! Appends a space-separated list of cell ids to out
+  static void AppendIds(std::string &out, const std::vector<CellId> &cells);
+  //! Reads a space-separated list of cell ids
+  static bool ReadIds(const std::string &text, std::vector<CellId> &cells);
+
+  //! The records that haven't been committed yet
+  std::string m_pending;
+};
+
+#endif
@@ -25,7 +25,9 @@
 #define WXMAXIMA_CELLPOINTERS_H
 
 #include "cells/Cell.h"
+#include "GroupCellIndex.h"
 #include <wx/string.h>
+#include <deque>
 #include <vector>
 
 class wxWindow;
@@ -58,6 +60,8 @@ public:
   void SetWorkingGroup(GroupCell *group);
 
   void WXMXResetCounter() { m_wxmxImgCounter = 0; }
+  //! Makes the next file name WXMXGetNewFileName() returns start with counter + 1
+  void WXMXSetCounter(std::size_t counter) { m_wxmxImgCounter = counter; }
 
   wxString WXMXGetNewFileName();
 
@@ -174,6 +178,15 @@ public:
 
   wxScrolledCanvas *GetWorksheet() { return m_worksheet; }
 
+  //! Ask the worksheet to convert the XML of an OutputChunkCell to cells
+  void RequestMaterialization(Cell *cell) { m_cellsToMaterialize.emplace_back(cell); }
+  //! The OutputChunkCells that have been scrolled into view and wait for being converted to cells
+  std::vector<CellPtr<Cell>> m_cellsToMaterialize;
+  //! The OutputChunkCells that currently are converted to cells, the oldest first
+  std::deque<CellPtr<Cell>> m_materializedCells;
+  //! The GroupCells of the worksheet, indexed by their vertical position
+  GroupCellIndex m_groupCellIndex;
+
 private:
   struct CellTimerId {
     Cell *cell = NULL;
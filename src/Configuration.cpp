@@ -52,6 +52,15 @@
 #include <algorithm>
 #include <limits>
 
+//! Reads a setting into one of the members the parser thread reads, too
+template <class T>
+static void ReadAtomic(wxConfigBase *config, const wxString &key, std::atomic<T> *value)
+{
+  T tmp;
+  if(config->Read(key, &tmp))
+    *value = tmp;
+}
+
 Configuration::Configuration(wxDC *dc, InitOpt options) :
   m_initOpts(options),
   m_eng{m_rd()},
@@ -64,7 +73,7 @@ Configuration::Configuration(wxDC *dc, InitOpt options) :
     config->Write(wxS("configID"), m_configId);
 
   // We want to read the zoom factor, but don't want it to be updated on each ReadConfig()
-  config->Read(wxS("ZoomFactor"), &m_zoomFactor);
+  ReadAtomic(config, wxS("ZoomFactor"), &m_zoomFactor);
 
   if(m_styleNames.empty())
     {
@@ -257,6 +266,7 @@ void Configuration::ResetAllToDefaults() {
   m_autoSaveMinutes = 3;
   m_numpadEnterEvaluates = true;
   m_saveImgFileName = false;
+  m_compressWxmx = false;
   m_maximaEnvVars.clear();
   // Tell gnuplot not to wait for <enter> every few lines
 #ifndef __WXMSW__
@@ -659,7 +669,7 @@ void Configuration::ReadConfig() {
     config->Read(wxS("Print/Margin/Bot"), &m_printMargin_Bot);
     config->Read(wxS("Print/Margin/Left"), &m_printMargin_Left);
     config->Read(wxS("Print/Margin/Right"), &m_printMargin_Right);
-    config->Read(wxS("showAllDigits"), &m_showAllDigits);
+    ReadAtomic(config, wxS("showAllDigits"), &m_showAllDigits);
     config->Read(wxS("lineBreaksInLongNums"), &m_lineBreaksInLongNums);
     config->Read(wxS("autoSaveMinutes"), &m_autoSaveMinutes);
     config->Read(wxS("wrapLatexMath"), &m_wrapLatexMath);
@@ -768,6 +778,7 @@ void Configuration::ReadConfig() {
   #endif
   config->Read(wxS("numpadEnterEvaluates"), &m_numpadEnterEvaluates);
   config->Read(wxS("saveImgFileName"), &m_saveImgFileName);
+  config->Read(wxS("compressWxmx"), &m_compressWxmx);
   config->Read(wxS("usePartialForDiff"), &m_usePartialForDiff);
   config->Read(wxS("TeXExponentsAfterSubscript"),
                &m_TeXExponentsAfterSubscript);
@@ -797,7 +808,7 @@ void Configuration::ReadConfig() {
   config->Read("offerKnownAnswers", &m_offerKnownAnswers);
   config->Read(wxS("documentclass"), &m_documentclass);
   config->Read(wxS("documentclassoptions"), &m_documentclassOptions);
-  config->Read(wxS("latin2greek"), &m_latin2greek);
+  ReadAtomic(config, wxS("latin2greek"), &m_latin2greek);
   config->Read(wxS("enterEvaluates"), &m_enterEvaluates);
   config->Read(wxS("hidemultiplicationsign"), &m_hidemultiplicationsign);
   config->Read("greekSidebar_ShowLatinLookalikes",
@@ -833,7 +844,7 @@ void Configuration::ReadConfig() {
   config->Read(wxS("abortOnError"), &m_abortOnError);
   config->Read("defaultPort", &m_defaultPort);
   config->Read(wxS("fixReorderedIndices"), &m_fixReorderedIndices);
-  config->Read(wxS("showLength"), &m_showLength);
+  ReadAtomic(config, wxS("showLength"), &m_showLength);
   if(m_showLength < 0)
     m_showLength = 0;
   if(m_showLength > 3)
@@ -868,29 +879,29 @@ void Configuration::ReadConfig() {
   config->Read(wxS("showLabelChoice"), &showLabelChoice);
   m_showLabelChoice = (showLabels)showLabelChoice;
 
-  config->Read(wxS("changeAsterisk"), &m_changeAsterisk);
+  ReadAtomic(config, wxS("changeAsterisk"), &m_changeAsterisk);
 
   config->Read(wxS("notifyIfIdle"), &m_notifyIfIdle);
 
   config->Read(wxS("hideBrackets"), &m_hideBrackets);
 
-  config->Read(wxS("displayedDigits"), &m_displayedDigits);
+  ReadAtomic(config, wxS("displayedDigits"), &m_displayedDigits);
   if (m_displayedDigits <= 20)
     m_displayedDigits = 20;
 
   config->Read(wxS("restartOnReEvaluation"), &m_restartOnReEvaluation);
 
-  config->Read(wxS("matchParens"), &m_matchParens);
+  ReadAtomic(config, wxS("matchParens"), &m_matchParens);
   config->Read(wxS("showMatchingParens"), &m_showMatchingParens);
 
   config->Read(wxS("insertAns"), &m_insertAns);
 
   config->Read(wxS("openHCaret"), &m_openHCaret);
 
-  config->Read(wxS("labelWidth"), &m_labelWidth);
+  ReadAtomic(config, wxS("labelWidth"), &m_labelWidth);
 
   config->Read(wxS("printBrackets"), &m_printBrackets);
-  config->Read(wxS("keepPercent"), &m_keepPercent);
+  ReadAtomic(config, wxS("keepPercent"), &m_keepPercent);
   config->Read(wxS("saveUntitled"), &m_saveUntitled);
   config->Read(wxS("cursorJump"), &m_cursorJump);
 
@@ -920,6 +931,11 @@ bool Configuration::HideMarkerForThisMessage(wxString message) {
     return it->second;
 }
 
+bool Configuration::AddMaximaOperator(const wxString &name) {
+  const std::lock_guard<std::mutex> lock(m_maximaOperatorsMutex);
+  return m_maximaOperators.insert({name, 1}).second;
+}
+
 //TODO: Don't underline the section number of titles
 void Configuration::MakeStylesConsistent()
 {
@@ -1100,8 +1116,8 @@ void Configuration::SetZoomFactor(double newzoom) {
 
   RecalculateForce();
 
-  for (const auto &i: m_styles)
-    i.ClearCache();
+  // The font caches are bounded => No need to clear them here. They will
+  // drop the font sizes of the old zoom factor only if they need the space.
   if (newzoom > GetMaxZoomFactor())
     newzoom = GetMaxZoomFactor();
   if (newzoom < GetMinZoomFactor())
@@ -1110,6 +1126,18 @@ void Configuration::SetZoomFactor(double newzoom) {
   m_zoomFactor = newzoom;
 }
 
+bool Configuration::PrewarmFonts() {
+  // The styles after TS_HEADING6 are colors only
+  if (m_prewarmedFontStyles > TS_HEADING6)
+    return false;
+  const Style &style = m_styles[m_prewarmedFontStyles];
+  // The current zoom factor and the ones from the "Zoom" menu
+  for (double zoom : {GetZoomFactor(), 0.8, 1.0, 1.2, 1.5, 2.0, 3.0})
+    style.GetFont(AFontSize(style.GetFontSize().Get() * zoom));
+  m_prewarmedFontStyles++;
+  return true;
+}
+
 Configuration::~Configuration() {
   if(m_initOpts != temporary)
     {
@@ -1344,10 +1372,10 @@ void Configuration::WriteSettings(const wxString &file) {
   config->Write(wxS("Print/Margin/Bot"), m_printMargin_Bot);
   config->Write(wxS("Print/Margin/Left"), m_printMargin_Left);
   config->Write(wxS("Print/Margin/Right"), m_printMargin_Right);
-  config->Write(wxS("showAllDigits"), m_showAllDigits);
+  config->Write(wxS("showAllDigits"), m_showAllDigits.load());
   config->Write(wxS("lineBreaksInLongNums"), m_lineBreaksInLongNums);
-  config->Write(wxS("keepPercent"), m_keepPercent);
-  config->Write(wxS("labelWidth"), m_labelWidth);
+  config->Write(wxS("keepPercent"), m_keepPercent.load());
+  config->Write(wxS("labelWidth"), m_labelWidth.load());
   config->Write(wxS("saveUntitled"), m_saveUntitled);
   config->Write(wxS("cursorJump"), m_cursorJump);
   config->Write(wxS("autoSaveMinutes"), m_autoSaveMinutes);
@@ -1581,6 +1609,7 @@ void Configuration::WriteStyles(wxConfigBase *config) {
   config->Write(wxS("wizardTab"), m_wizardTab);
   config->Write(wxS("numpadEnterEvaluates"), m_numpadEnterEvaluates);
   config->Write(wxS("saveImgFileName"), m_saveImgFileName);
+  config->Write(wxS("compressWxmx"), m_compressWxmx);
   config->Write(wxS("usePartialForDiff"), m_usePartialForDiff);
   config->Write(wxS("TeXExponentsAfterSubscript"),
                 m_TeXExponentsAfterSubscript);
@@ -1598,17 +1627,17 @@ void Configuration::WriteStyles(wxConfigBase *config) {
   config->Write(wxS("autoWrapMode"), m_autoWrap);
   config->Write(wxS("autoIndent"), m_autoIndent);
   config->Write(wxS("indentMaths"), m_indentMaths);
-  config->Write(wxS("matchParens"), m_matchParens);
+  config->Write(wxS("matchParens"), m_matchParens.load());
   config->Write(wxS("showMatchingParens"), m_showMatchingParens);
-  config->Write(wxS("changeAsterisk"), m_changeAsterisk);
+  config->Write(wxS("changeAsterisk"), m_changeAsterisk.load());
   config->Write(wxS("hidemultiplicationsign"), m_hidemultiplicationsign);
-  config->Write(wxS("latin2greek"), m_latin2greek);
+  config->Write(wxS("latin2greek"), m_latin2greek.load());
   config->Write(wxS("greekSidebar_ShowLatinLookalikes"),
                 m_greekSidebar_ShowLatinLookalikes);
   config->Write(wxS("greekSidebar_Show_mu"), m_greekSidebar_Show_mu);
   config->Write(wxS("symbolPaneAdditionalChars"), m_symbolPaneAdditionalChars);
   config->Write(wxS("notifyIfIdle"), m_notifyIfIdle);
-  config->Write(wxS("displayedDigits"), m_displayedDigits);
+  config->Write(wxS("displayedDigits"), m_displayedDigits.load());
   config->Write(wxS("insertAns"), m_insertAns);
   config->Write(wxS("openHCaret"), m_openHCaret);
   config->Write(wxS("restartOnReEvaluation"), m_restartOnReEvaluation);
@@ -1636,7 +1665,7 @@ void Configuration::WriteStyles(wxConfigBase *config) {
   config->Write(wxS("copySVG"), m_copySVG);
   config->Write(wxS("copyEMF"), m_copyEMF);
   config->Write(wxS("useSVG"), m_useSVG);
-  config->Write(wxS("showLength"), m_showLength);
+  config->Write(wxS("showLength"), m_showLength.load());
   config->Write(wxS("TOCshowsSectionNumbers"), m_TOCshowsSectionNumbers);
   config->Write(wxS("useUnicodeMaths"), m_useUnicodeMaths);
   config->Write("defaultPort", m_defaultPort);
@@ -1648,7 +1677,7 @@ void Configuration::WriteStyles(wxConfigBase *config) {
   config->Write("documentclassoptions", m_documentclassOptions);
   config->Write("HTMLequationFormat", static_cast<int>(m_htmlEquationFormat));
   config->Write("autosubscript", m_autoSubscript);
-  config->Write(wxS("ZoomFactor"), m_zoomFactor);
+  config->Write(wxS("ZoomFactor"), m_zoomFactor.load());
   // Fonts
   m_styles[TS_MATH].Write(config, "Style/Math/");
   m_styles[TS_TEXT].Write(config, "Style/Text/");
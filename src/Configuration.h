@@ -30,6 +30,7 @@
 #include <wx/hashmap.h>
 #include "dialogs/LoggingMessageDialog.h"
 #include "cells/TextStyle.h"
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -90,6 +91,15 @@ class Cell;
   similar: Configuration::Get() will always return the last Configuration that was
   created and therefore as long as the new configuration object exist will return
   a pointer to this object if configuration is needed.
+
+  The configuration belongs to the main thread. The only exception is that
+  Maxima's parser thread creates cells for maxima's output, which read the
+  following settings while they are being created: IsOperator(), ShowLength(),
+  Latin2Greek(), CheckKeepPercent(), GetChangeAsterisk(), GetDisplayedDigits(),
+  ShowAllDigits(), GetMatchParens(), InLispMode(), GetLabelWidth(), the zoom
+  factor and CellCfgCnt(). These settings are therefore atomic or protected
+  by a mutex. Any other setting a cell reads during its construction has to
+  be made thread-safe, too.
 */
 class Configuration
 {
@@ -141,11 +151,16 @@ public:
   typedef std::unordered_map <wxString, bool, wxStringHash> StringBoolHash;
   typedef std::unordered_map <wxString, wxString, wxStringHash> RenderablecharsHash;
   typedef std::unordered_map <wxString, int, wxStringHash> StringHash;
-  /*! All maxima operator names we know
-   */
-  StringHash m_maximaOperators;
   //! Coincides name with a operator known to maxima?
-  bool IsOperator(wxString name){return !(m_maximaOperators.find(name) == m_maximaOperators.end());}
+  bool IsOperator(const wxString &name) const {
+    const std::lock_guard<std::mutex> lock(m_maximaOperatorsMutex);
+    return m_maximaOperators.find(name) != m_maximaOperators.end();
+  }
+  /*! Remember that name is an operator maxima knows about
+
+    \return false, if we knew this operator already.
+   */
+  bool AddMaximaOperator(const wxString &name);
   const wxEnvVariableHashMap& MaximaEnvVars() const {return m_maximaEnvVars;}
   wxEnvVariableHashMap m_maximaEnvVars;
 
@@ -400,9 +415,21 @@ public:
   void FontChanged()
     {
       m_charsInFont.clear();
+      m_prewarmedFontStyles = 0;
       RecalculateForce();
     }
 
+  /*! Creates the fonts the worksheet will likely need at the usual zoom levels
+
+    Creating a font takes long. This function therefore creates the fonts for
+    one text style at the current zoom factor and at the zoom factors the
+    menu offers per call, so it can be called whenever wxMaxima is idle
+    until all of them have been created.
+
+    \return true, if there still are fonts to create.
+  */
+  bool PrewarmFonts();
+
   //! Calculates the default line width for the worksheet
   double GetDefaultLineWidth() const
     {
@@ -445,6 +472,10 @@ public:
   bool SaveImgFileName() const { return m_saveImgFileName;}
   void SaveImgFileName(bool save) { m_saveImgFileName = save;}
 
+  //! Do we want to compress the XML part of .wxmx files?
+  bool CompressWxmx() const { return m_compressWxmx;}
+  void CompressWxmx(bool compress) { m_compressWxmx = compress;}
+
   //! Do we want to have automatic line breaks for text cells?
   bool GetAutoWrap() const
     { return m_autoWrap > 0; }
@@ -1030,6 +1061,8 @@ public:
   wxString GetLispType() const {return m_lispType;}
 
   Style m_styles[NUMBEROFSTYLES];
+  //! The number of text styles PrewarmFonts() has created the fonts for
+  int m_prewarmedFontStyles = 0;
   //! Initialize the text styles on construction.
   void InitStyles();
   //! True if we are confident that the font renders this char
@@ -1176,30 +1209,30 @@ private:
     Normally we ask the parser for this piece of information. But during recalculation
     of widths while selecting text we don't know our parser.
   */
-  bool m_changeAsterisk;
+  std::atomic<bool> m_changeAsterisk;
   //! Notify the user if maxima is idle
   bool m_notifyIfIdle;
   //! How many digits of a number we show by default?
-  long m_displayedDigits;
+  std::atomic<long> m_displayedDigits;
   //! Automatically wrap long lines?
   long m_autoWrap;
   //! Automatically indent long lines?
   bool m_autoIndent;
   //! Always show all digits of all numbers?
-  bool m_showAllDigits;
+  std::atomic<bool> m_showAllDigits;
   //! Allow linebreaks in numbers that are longer than a line?
   bool m_lineBreaksInLongNums;
   //! Do we want to automatically close parenthesis?
-  bool m_matchParens;
+  std::atomic<bool> m_matchParens;
   //! Do we want to automatically insert new cells containing a "%" at the end of every command?
   bool m_insertAns;
   //! Do we want to automatically open a new cell if maxima has finished evaluating its input?
   bool m_openHCaret;
   //! The width of input and output labels [in chars]
-  long m_labelWidth;
+  std::atomic<long> m_labelWidth;
   long m_indent;
-  bool m_latin2greek;
-  double m_zoomFactor;
+  std::atomic<bool> m_latin2greek;
+  std::atomic<double> m_zoomFactor;
   wxDC *m_dc;
   wxString m_maximaShareDir;
   wxString m_maximaDemoDir;
@@ -1207,7 +1240,7 @@ private:
   bool m_clipToDrawRegion = true;
   bool m_outdated;
   wxString m_maximaParameters;
-  bool m_keepPercent;
+  std::atomic<bool> m_keepPercent;
   bool m_restartOnReEvaluation;
   wxString m_fontCMRI, m_fontCMSY, m_fontCMEX, m_fontCMMI, m_fontCMTI;
   bool m_printing;
@@ -1220,9 +1253,9 @@ private:
   bool m_copyBitmap;
   bool m_copyMathML;
   bool m_copyMathMLHTML;
-  long m_showLength;
+  std::atomic<long> m_showLength;
   //!< don't add ; in lisp mode
-  bool m_inLispMode;
+  std::atomic<bool> m_inLispMode;
   bool m_usepngCairo;
   bool m_enterEvaluates;
   bool m_useSVG;
@@ -1245,6 +1278,7 @@ private:
   bool m_cursorJump;
   bool m_numpadEnterEvaluates;
   bool m_saveImgFileName;
+  bool m_compressWxmx;
   /*! A vector containing pointers to all cells the current draw command hit
 
     Only used in debug mode. There it is used in order to determine if any
@@ -1283,7 +1317,15 @@ private:
   wxString m_wxMathML_Filename;
   maximaHelpFormat m_maximaHelpFormat;
   wxTextCtrl *m_lastActiveTextCtrl = NULL;
-  std::int_fast32_t m_cellCfgCnt = 0;
+  std::atomic<std::int_fast32_t> m_cellCfgCnt{0};
+  /*! All maxima operator names we know
+
+    Maxima tells the main thread about new operators while the parser thread
+    might be looking them up => protected by m_maximaOperatorsMutex.
+   */
+  StringHash m_maximaOperators;
+  //! The mutex that protects m_maximaOperators
+  mutable std::mutex m_maximaOperatorsMutex;
   static bool m_use_threads;
 };
 
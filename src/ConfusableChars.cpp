@@ -0,0 +1,132 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+/*! \file
+  This file defines the class ConfusableChars.
+*/
+
+#include "ConfusableChars.h"
+#include <algorithm>
+
+namespace
+{
+//! Pairs of chars that look alike
+const wchar_t LookalikeChars[][2] =
+{
+  {L'\u00B5', L'\u03BC'}, {L'\u2126', L'\u03A9'},  // µμ ΩΩ
+  {L'C', L'\u03F2'}, {L'C', L'\u0421'}, {L'\u03F2', L'\u0421'},  // Cϲ CС ϲС
+  {L'A', L'\u0391'}, {L'A', L'\u0410'}, {L'\u0391', L'\u0410'},  // AΑ AА ΑА
+  {L'B', L'\u0392'}, {L'B', L'\u0412'}, {L'\u0392', L'\u0412'},  // BΒ BВ ΒВ
+  {L'E', L'\u0395'}, {L'E', L'\u0415'}, {L'\u0415', L'\u0395'},  // EΕ EЕ ЕΕ
+  {L'Z', L'\u0396'},  // ZΖ
+  {L'H', L'\u0397'}, {L'H', L'\u041D'}, {L'\u0397', L'\u041D'},  // HΗ HН ΗН
+  {L'I', L'\u0399'}, {L'I', L'\u0406'}, {L'l', L'\u0406'}, {L'l', L'I'},  // IΙ IІ lІ lI
+  {L'K', L'\u039A'}, {L'K', L'\u041A'}, {L'\u039A', L'\u041A'},  // KΚ KК ΚК
+  {L'\u212A', L'\u041A'}, {L'K', L'\u212A'}, {L'\u212A', L'\u039A'},  // KК KK KΚ
+  {L'M', L'\u041C'}, {L'\u039C', L'\u041C'}, {L'M', L'\u039C'},  // MМ ΜМ MΜ
+  {L'N', L'\u039D'},  // NΝ
+  {L'O', L'\u039F'}, {L'O', L'\u041E'}, {L'\u039F', L'\u041E'},  // OΟ OО ΟО
+  {L'P', L'\u03A1'}, {L'P', L'\u0420'}, {L'\u03A1', L'\u0420'},  // PΡ PР ΡР
+  {L'T', L'\u03A4'}, {L'T', L'\u0422'}, {L'\u03A4', L'\u0422'},  // TΤ TТ ΤТ
+  {L'X', L'\u0425'},  // XХ
+  {L'Y', L'\u03A5'}, {L'Y', L'\u0423'},  // YΥ YУ
+  {L'S', L'\u0405'}, {L'J', L'\u0408'},  // SЅ JЈ
+  {L'a', L'\u0430'}, {L'c', L'\u0441'}, {L'e', L'\u0435'},  // aа cс eе
+  {L'o', L'\u03BF'}, {L'o', L'\u043E'}, {L'\u03BF', L'\u043E'},  // oο oо οо
+  {L'p', L'\u0440'}, {L's', L'\u0455'},  // pр sѕ
+  {L'x', L'\u0445'}, {L'x', L'\u03C7'}, {L'y', L'\u0443'},  // xх xχ yу
+  {L't', L'\u03C4'}, {L'u', L'\u03C5'}, {L'\u00FC', L'\u03CB'},  // tτ uυ üϋ
+  {L'\u03A3', L'\u2211'},  // Σ∑
+  {L'\u0460', L'\u03C9'}, {L'\u0461', L'\u03C9'},  // Ѡω ѡω
+  {L'\u0472', L'\u0398'}, {L'\u03B8', L'\u0473'},  // ѲΘ θѳ
+  {L'\u00F8', L'\u2300'}, {L'\u00F8', L'\u2298'}, {L'\u00F8', L'\u2205'},  // ø⌀ ø⊘ ø∅
+  {L'\u2205', L'\u2298'}, {L'\u2205', L'\u2300'}, {L'\u2300', L'\u2298'}  // ∅⊘ ∅⌀ ⌀⊘
+};
+}
+
+const std::unordered_map<wchar_t, wchar_t> &ConfusableChars::Representatives()
+{
+  // Lookalikes of lookalikes look alike, too => Join the pairs to groups of
+  // chars using a union-find structure. The representative of each group is its
+  // smallest char, which makes the skeleton of a latin word the word itself.
+  static const std::unordered_map<wchar_t, wchar_t> representatives = []()
+    {
+      std::unordered_map<wchar_t, wchar_t> parent;
+      auto find = [&parent](wchar_t ch)
+        {
+          while(parent[ch] != ch)
+            ch = parent[ch] = parent[parent[ch]];
+          return ch;
+        };
+      for(const auto &pair : LookalikeChars)
+        for(wchar_t ch : pair)
+          parent.emplace(ch, ch);
+      for(const auto &pair : LookalikeChars)
+        {
+          wchar_t first = find(pair[0]);
+          wchar_t second = find(pair[1]);
+          if(first < second)
+            parent[second] = first;
+          else
+            parent[first] = second;
+        }
+      std::unordered_map<wchar_t, wchar_t> result;
+      for(const auto &entry : parent)
+        result[entry.first] = find(entry.first);
+      return result;
+    }();
+  return representatives;
+}
+
+std::wstring ConfusableChars::Skeleton(const std::wstring &word)
+{
+  const auto &representatives = Representatives();
+  std::wstring skeleton(word);
+  for(wchar_t &ch : skeleton)
+    {
+      auto representative = representatives.find(ch);
+      if(representative != representatives.end())
+        ch = representative->second;
+    }
+  return skeleton;
+}
+
+std::vector<ConfusableChars::Pair> ConfusableChars::Find(std::vector<std::wstring> words)
+{
+  // Sorting makes the result independent from the order the words came in
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+
+  std::vector<Pair> result;
+  // The first word we have seen with each skeleton
+  std::unordered_map<std::wstring, const std::wstring *> firstWithSkeleton;
+  firstWithSkeleton.reserve(words.size());
+  for(const auto &word : words)
+    {
+      auto entry = firstWithSkeleton.emplace(Skeleton(word), &word);
+      if(!entry.second)
+        result.emplace_back(*entry.first->second, word);
+    }
+  std::stable_sort(result.begin(), result.end(),
+                   [](const Pair &a, const Pair &b) { return a.first < b.first; });
+  return result;
+}
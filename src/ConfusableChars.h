@@ -0,0 +1,70 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#ifndef WXMAXIMA_CONFUSABLECHARS_H
+#define WXMAXIMA_CONFUSABLECHARS_H
+
+/*! \file
+ *
+ * Declares the detection of identifiers that look alike, but aren't the same.
+ */
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*! Finds identifiers that only differ by chars that look alike
+
+  Each char that looks like other chars (e.g. the latin A, the greek Alpha
+  and the cyrillic A) is mapped to one representative of all of them. Mapping
+  every char of a word this way results in its "skeleton": Two different words
+  with the same skeleton look alike. This way finding all words that look
+  alike only needs one pass over the words and a hash table, instead of
+  comparing every word with every other word for every pair of lookalike chars.
+
+  Only uses the standard library and therefore can be called from any thread.
+*/
+class ConfusableChars
+{
+public:
+  //! Two different words that look alike
+  using Pair = std::pair<std::wstring, std::wstring>;
+
+  //! Replaces every char of word that has lookalikes by the representative of them
+  static std::wstring Skeleton(const std::wstring &word);
+
+  /*! Finds all words that look like one of the other words
+
+    \param words The words to check. Duplicates are ignored.
+    \return For every word that looks like a different word which sorts before
+    it: the pair of both, the first word of all words with the same skeleton
+    first. Sorted by that first word.
+  */
+  static std::vector<Pair> Find(std::vector<std::wstring> words);
+
+private:
+  //! Maps every char that has lookalikes to the representative of all of them
+  static const std::unordered_map<wchar_t, wchar_t> &Representatives();
+};
+
+#endif
@@ -0,0 +1,132 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class GroupCellIndex.
+*/
+
+#include "GroupCellIndex.h"
+#include <algorithm>
+
+void GroupCellIndex::Clear()
+{
+  m_upToDate = false;
+  m_tree = nullptr;
+  m_groups.clear();
+  m_extents.clear();
+  m_fenwick.assign(1, 0);
+  m_totalExtent = 0;
+  m_widths.clear();
+  m_maxWidth = 0;
+  m_maxWidthValid = true;
+  m_indices.clear();
+}
+
+void GroupCellIndex::Append(GroupCell *group, int extent, int width)
+{
+  extent = std::max(extent, 0);
+  if(m_fenwick.empty())
+    m_fenwick.push_back(0);
+  const std::size_t pos = m_groups.size() + 1;
+  m_indices[group] = m_groups.size();
+  m_groups.push_back(group);
+  m_extents.push_back(extent);
+  m_totalExtent += extent;
+  m_widths.push_back(width);
+  m_maxWidth = std::max(m_maxWidth, width);
+  // The new node covers the range (pos - lowbit(pos), pos]
+  const std::size_t lowbit = pos & (~pos + 1);
+  m_fenwick.push_back(extent + GetOffset(pos - 1) - GetOffset(pos - lowbit));
+}
+
+void GroupCellIndex::SetUpToDate(const GroupCell *tree)
+{
+  m_tree = tree;
+  m_upToDate = true;
+}
+
+std::size_t GroupCellIndex::IndexOf(const GroupCell *group) const
+{
+  auto index = m_indices.find(group);
+  if(index == m_indices.end())
+    return m_groups.size();
+  return index->second;
+}
+
+void GroupCellIndex::SetSize(const GroupCell *group, int extent, int width)
+{
+  const std::size_t index = IndexOf(group);
+  if(index >= m_groups.size())
+    return;
+
+  if(width >= m_maxWidth)
+    m_maxWidth = width;
+  else if(m_widths[index] == m_maxWidth)
+    m_maxWidthValid = false;
+  m_widths[index] = width;
+
+  extent = std::max(extent, 0);
+  const int delta = extent - m_extents[index];
+  if(delta == 0)
+    return;
+  m_extents[index] = extent;
+  m_totalExtent += delta;
+  for(std::size_t pos = index + 1; pos < m_fenwick.size(); pos += pos & (~pos + 1))
+    m_fenwick[pos] += delta;
+}
+
+int GroupCellIndex::GetMaxWidth() const
+{
+  if(!m_maxWidthValid)
+    {
+      m_maxWidth = 0;
+      for(int width : m_widths)
+        m_maxWidth = std::max(m_maxWidth, width);
+      m_maxWidthValid = true;
+    }
+  return m_maxWidth;
+}
+
+int GroupCellIndex::GetOffset(std::size_t index) const
+{
+  int offset = 0;
+  for(std::size_t pos = std::min(index, m_groups.size()); pos > 0; pos -= pos & (~pos + 1))
+    offset += m_fenwick[pos];
+  return offset;
+}
+
+std::size_t GroupCellIndex::Find(int offset) const
+{
+  std::size_t step = 1;
+  while(step * 2 <= m_groups.size())
+    step *= 2;
+  // Descend the tree, collecting all nodes that end before the offset
+  std::size_t pos = 0;
+  for(; step > 0; step /= 2)
+    {
+      if((pos + step <= m_groups.size()) && (m_fenwick[pos + step] <= offset))
+        {
+          pos += step;
+          offset -= m_fenwick[pos];
+        }
+    }
+  return pos;
+}
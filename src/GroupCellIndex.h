@@ -0,0 +1,133 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_GROUPCELLINDEX_H
+#define WXMAXIMA_GROUPCELLINDEX_H
+
+/*! \file
+ *
+ * Declares the index that finds the GroupCell at a given y position.
+ */
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class GroupCell;
+
+/*! An index of the GroupCells of a worksheet by their vertical position
+
+  Drawing the worksheet, finding the cell under the mouse pointer and
+  scrolling to a cell used to walk the whole list of GroupCells, which makes
+  every redraw O(n). This index instead keeps the vertical space every
+  GroupCell occupies (its height plus the gap to the next cell) in a Fenwick
+  tree: The offset of a cell, the cell at an offset and the update of a
+  cell's height all are O(log n). This means that the y positions of the
+  cells don't need to be updated one after another any more if a cell
+  changes its height, and that the height of the worksheet is known in
+  O(1).
+
+  The index doesn't try to follow the changes to the list of GroupCells:
+  Linking a cell to or unlinking it from a GroupCell the index knows calls
+  ListChanged(), which tells the index that it has to be rebuilt before it
+  is used the next time. Changes to other lists of GroupCells, for example
+  the copies made for the undo buffer or the clipboard, don't affect it.
+  Like the worksheet it belongs to the index is only used by the main
+  thread.
+*/
+class GroupCellIndex
+{
+public:
+  //! Tells the index that the list it describes has been changed
+  void ListChanged() { m_upToDate = false; }
+
+  //! Does the index still describe the list that starts with tree?
+  bool IsUpToDate(const GroupCell *tree) const
+    { return (tree == m_tree) && IsUpToDate(); }
+  //! Has the list of GroupCells not been changed since the index was built?
+  bool IsUpToDate() const { return m_upToDate; }
+
+  //! Empties the index. The next call to IsUpToDate() will return false.
+  void Clear();
+  /*! Appends a cell to the index
+
+    Used for rebuilding the index in the order of the list of GroupCells.
+  */
+  void Append(GroupCell *group, int extent, int width);
+  /*! Marks the index as describing the list that starts with tree
+
+    To be called after all cells of the list have been appended.
+  */
+  void SetUpToDate(const GroupCell *tree);
+
+  /*! Updates the size of a cell. Does nothing for unknown cells.
+
+    \param group The cell
+    \param extent The vertical space the cell occupies
+    \param width The width of the cell
+  */
+  void SetSize(const GroupCell *group, int extent, int width);
+
+  //! The number of cells in the index
+  std::size_t Size() const { return m_groups.size(); }
+  //! The index-th cell
+  GroupCell *GetGroup(std::size_t index) const { return m_groups[index]; }
+  //! The vertical space the index-th cell occupies
+  int GetExtent(std::size_t index) const { return m_extents[index]; }
+  //! The position of a cell in the index, or Size() if it isn't in the index
+  std::size_t IndexOf(const GroupCell *group) const;
+  //! The sum of the extents of all cells before the index-th one
+  int GetOffset(std::size_t index) const;
+  //! The sum of the extents of all cells
+  int GetTotalExtent() const { return m_totalExtent; }
+  //! The width of the widest cell
+  int GetMaxWidth() const;
+  /*! The index of the cell that contains the offset
+
+    Returns Size() if the offset lies behind the last cell and 0 if it lies before
+    the first one.
+  */
+  std::size_t Find(int offset) const;
+
+private:
+  //! false = The list has been changed since the index was built
+  bool m_upToDate = false;
+  //! The first cell of the list this index describes
+  const GroupCell *m_tree = nullptr;
+  //! The cells, in the order of the worksheet
+  std::vector<GroupCell *> m_groups;
+  //! The vertical space each cell occupies
+  std::vector<int> m_extents;
+  //! The Fenwick tree of the extents, 1-based
+  std::vector<int> m_fenwick;
+  //! The sum of all extents
+  int m_totalExtent = 0;
+  //! The width of each cell
+  std::vector<int> m_widths;
+  //! The width of the widest cell, if m_maxWidthValid
+  mutable int m_maxWidth = 0;
+  //! false = The widest cell has become narrower => m_maxWidth needs to be searched for
+  mutable bool m_maxWidthValid = true;
+  //! The position of each cell in m_groups
+  std::unordered_map<const GroupCell *, std::size_t> m_indices;
+};
+
+#endif
@@ -29,6 +29,7 @@
 #include "cells/Cell.h"
 #include "Version.h"
 #include "ErrorRedirector.h"
+#include <wx/app.h>
 #include <wx/image.h>
 #include <wx/rawbmp.h>
 
@@ -38,11 +39,16 @@
 #include "nanosvg_private.h"
 #include "nanosvgrast_private.h"
 #include <Image.h>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include "wx/log.h"
 #include "StringUtils.h"
 #include "SvgBitmap.h"
+#include "ImageCache.h"
+#include "ImageHeader.h"
+#include "PixelConversion.h"
+#include "ZipIndex.h"
 #include <wx/mstream.h>
 #include <wx/regex.h>
 #include <wx/stdpaths.h>
@@ -62,15 +68,22 @@ Image::Image(Configuration *config, const wxMemoryBuffer &image, const wxString
   m_extension = type;
 
   wxLogBuffer errorAggregator;
-  wxImage Image;
-  if (m_compressedImage.GetDataLen() > 0) {
+  ImageHeader header;
+  if (header.ReadBitmap(static_cast<unsigned char *>(m_compressedImage.GetData()),
+                        m_compressedImage.GetDataLen())) {
+    // The image is decoded when it is drawn.
+    m_originalWidth = header.GetWidth();
+    m_originalHeight = header.GetHeight();
+  } else if (m_compressedImage.GetDataLen() > 0) {
     wxMemoryInputStream istream(m_compressedImage.GetData(),
                                 m_compressedImage.GetDataLen());
-    Image.LoadFile(istream);
-    if(Image.IsOk())
+    // Only formats ImageHeader doesn't know need to be decoded here
+    wxImage img;
+    img.LoadFile(istream);
+    if(img.IsOk())
     {
-      m_originalWidth = Image.GetWidth();
-      m_originalHeight = Image.GetHeight();
+      m_originalWidth = img.GetWidth();
+      m_originalHeight = img.GetHeight();
     }
     else
     {
@@ -98,6 +111,7 @@ Image::Image(Configuration *config, const wxString &image,
 }
 
 Image::Image(Configuration *config, const Image &image) {
+  image.m_loadImageTask.Wait();
   m_svgImage = NULL;
   m_configuration = config;
   m_scaledBitmap.Create(1, 1);
@@ -108,14 +122,19 @@ Image::Image(Configuration *config, const Image &image) {
   m_compressedImage = image.m_compressedImage;
   m_ppi = image.m_ppi;
   m_extension = image.m_extension;
+  m_isSvg = image.m_isSvg;
+  m_svgPpi = image.m_svgPpi;
 }
 
 Image::~Image() {
   wxLogNull logNull;
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadImageTask.Wait();
+  StopRescaling();
+  ImageCache::Get().Forget(this);
+  // The gnuplot source is only needed if the image is saved => If its task
+  // hasn't been started yet there is no need to run it.
+  m_loadGnuplotSourceTask.Cancel();
+  m_loadGnuplotSourceTask.Wait();
   if (!m_gnuplotSource.IsEmpty()) {
     if (wxFileExists(m_gnuplotSource))
     {
@@ -141,7 +160,7 @@ Image::~Image() {
     }
   }
   if (m_svgImage)
-    free(m_svgImage);
+    wxm_nsvgDelete(m_svgImage);
 }
 
 wxMemoryBuffer Image::ReadCompressedImage(wxInputStream *data) {
@@ -157,11 +176,10 @@ wxMemoryBuffer Image::ReadCompressedImage(wxInputStream *data) {
 }
 
 wxBitmap Image::GetUnscaledBitmap() {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
 
   SuppressErrorDialogs logNull;
-  if (m_svgRast) {
+  if (m_isSvg && ParseSvg()) {
     std::vector<unsigned char> imgdata(m_originalWidth * m_originalHeight * 4);
 
     wxm_nsvgRasterize(m_svgRast.get(), m_svgImage, 0, 0, 1, imgdata.data(),
@@ -180,21 +198,18 @@ wxBitmap Image::GetUnscaledBitmap() {
 }
 
 const wxMemoryBuffer Image::GetCompressedImage() const {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   return m_compressedImage;
 }
 
 std::size_t Image::GetOriginalWidth() const {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
 
   return m_originalWidth;
 }
 
 std::size_t Image::GetOriginalHeight() const {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
 
   return m_originalHeight;
 }
@@ -202,28 +217,27 @@ std::size_t Image::GetOriginalHeight() const {
 void Image::GnuplotSource(wxString gnuplotFilename, wxString dataFilename,
                           const wxString &wxmxFile) {
   SuppressErrorDialogs suppressor;
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   m_gnuplotSource = std::move(gnuplotFilename);
   m_gnuplotData = std::move(dataFilename);
-  std::unique_ptr<ThreadNumberLimiter> limiter(new
-                                               ThreadNumberLimiter(&m_gnuplotDataThreadRunning));
   if(m_configuration->UseThreads())
-    m_loadGnuplotSourceTask = jthread(&Image::LoadGnuplotSource_Backgroundtask,
-                                      this,
-                                      std::move(limiter),
-                                      m_gnuplotSource, m_gnuplotData, wxmxFile);
+    {
+      wxString gnuplotSource = m_gnuplotSource;
+      wxString gnuplotData = m_gnuplotData;
+      m_loadGnuplotSourceTask =
+        TaskPool::Get().Submit(TaskPool::GNUPLOT_SOURCES, TaskPool::LOW,
+                               [this, gnuplotSource, gnuplotData, wxmxFile]() {
+                                 LoadGnuplotSource_Backgroundtask(gnuplotSource, gnuplotData,
+                                                                  wxmxFile);
+                               });
+    }
   else
-    LoadGnuplotSource_Backgroundtask(
-      std::move(limiter),
-      m_gnuplotSource, m_gnuplotData, wxmxFile);
+    LoadGnuplotSource_Backgroundtask(m_gnuplotSource, m_gnuplotData, wxmxFile);
 }
 
 void Image::LoadGnuplotSource_Backgroundtask(
-  std::unique_ptr<ThreadNumberLimiter> limiter,
   wxString gnuplotFile, wxString dataFile, wxString wxmxFile)
 {
-  std::unique_ptr<ThreadNumberLimiter> threadNumLimit = std::move(limiter);
   SuppressErrorDialogs suppressor;
   if(wxmxFile.IsEmpty())
   {
@@ -239,38 +253,40 @@ void Image::LoadGnuplotSource_Backgroundtask(
   else
   {
     {
-      wxFileInputStream wxmx(wxmxFile);
-      WxmxStream source(wxmx, gnuplotFile);
-      LoadGnuplotSource(&source);
+      wxMemoryBuffer sourceData = ReadFromWxmx(wxmxFile, gnuplotFile);
+      wxMemoryInputStream source(sourceData.GetData(), sourceData.GetDataLen());
+      if (sourceData.GetDataLen() > 0)
+        LoadGnuplotSource(&source);
     }
     {
-      wxFileInputStream wxmx(wxmxFile);
-      WxmxStream data(wxmx, dataFile);
-      LoadGnuplotData(&data);
+      wxMemoryBuffer dataData = ReadFromWxmx(wxmxFile, dataFile);
+      wxMemoryInputStream data(dataData.GetData(), dataData.GetDataLen());
+      if (dataData.GetDataLen() > 0)
+        LoadGnuplotData(&data);
     }
   }
 }
 
 void Image::CompressedGnuplotSource(wxString gnuplotFilename, wxString dataFilename,
                                     const wxString &wxmxFile) {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
-  std::unique_ptr<ThreadNumberLimiter> limiter(new
-                                               ThreadNumberLimiter(&m_gnuplotDataThreadRunning));
+  m_loadGnuplotSourceTask.Wait();
 
   m_gnuplotSource = std::move(gnuplotFilename);
   m_gnuplotData = std::move(dataFilename);
   if(m_configuration->UseThreads())
-    m_loadGnuplotSourceTask =
-      jthread(&Image::LoadCompressedGnuplotSource_Backgroundtask,
-              this,
-              std::move(limiter),
-              m_gnuplotSource,
-              m_gnuplotData,
-              wxmxFile);
+    {
+      wxString gnuplotSource = m_gnuplotSource;
+      wxString gnuplotData = m_gnuplotData;
+      m_loadGnuplotSourceTask =
+        TaskPool::Get().Submit(TaskPool::GNUPLOT_SOURCES, TaskPool::LOW,
+                               [this, gnuplotSource, gnuplotData, wxmxFile]() {
+                                 LoadCompressedGnuplotSource_Backgroundtask(gnuplotSource,
+                                                                            gnuplotData,
+                                                                            wxmxFile);
+                               });
+    }
   else
     LoadCompressedGnuplotSource_Backgroundtask(
-      std::move(limiter),
       m_gnuplotSource,
       m_gnuplotData,
       wxmxFile);
@@ -358,43 +374,38 @@ void Image::LoadGnuplotData(
 }
 
 void Image::LoadCompressedGnuplotSource_Backgroundtask(
-  std::unique_ptr<ThreadNumberLimiter> limiter,
   wxString sourcefile,
   wxString datafile,
   wxString wxmxFile
   ) {
-  std::unique_ptr<ThreadNumberLimiter> threadNumLimit = std::move(limiter);
   {
     // Error dialogues need to be created by the foreground thread.
     SuppressErrorDialogs suppressor;
 
     // Read the gnuplot source
     {
-      wxFileInputStream wxmx(wxmxFile);
-      WxmxStream source(wxmx, sourcefile);
-      if (!source.Eof()) {
-        m_gnuplotSource_Compressed.Clear();
-        wxMemoryOutputStream mstream;
-        source.Read(mstream);
-        m_gnuplotSource_Compressed.AppendData(
-          mstream.GetOutputStreamBuffer()->GetBufferStart(),
-          mstream.GetOutputStreamBuffer()->GetBufferSize());
-      }
+      wxMemoryBuffer source = ReadFromWxmx(wxmxFile, sourcefile);
+      if (source.GetDataLen() > 0)
+        m_gnuplotSource_Compressed = source;
     }
     // Read the gnuplot data
-    {
-      m_gnuplotData_Compressed.Clear();
-      wxFileInputStream wxmx(wxmxFile);
-      WxmxStream data(wxmx, datafile);
-      if (!data.Eof()) { // open successful
-        wxMemoryOutputStream mstream;
-        data.Read(mstream);
-        m_gnuplotData_Compressed.AppendData(
-          mstream.GetOutputStreamBuffer()->GetBufferStart(),
-          mstream.GetOutputStreamBuffer()->GetBufferSize());
-      }
-    }
+    m_gnuplotData_Compressed = ReadFromWxmx(wxmxFile, datafile);
+  }
+}
+
+wxMemoryBuffer Image::ReadFromWxmx(const wxString &wxmxFile, const wxString &fileInWxmx) {
+  std::shared_ptr<const ZipIndex> index = ZipIndex::Get(wxmxFile);
+  if (index->IsOk()) {
+    wxMemoryBuffer data;
+    if (!index->Read(fileInWxmx, data))
+      data.Clear();
+    return data;
   }
+  // The central directory of a .wxmx file that wasn't completely written
+  // is missing => search the file from its start.
+  wxFileInputStream wxmx(wxmxFile);
+  WxmxStream data(wxmx, fileInWxmx);
+  return ReadCompressedImage(&data);
 }
 
 Image::WxmxStream::WxmxStream(wxInputStream &wxmxFile, const wxString &fileInWxmx):
@@ -410,8 +421,7 @@ Image::WxmxStream::WxmxStream(wxInputStream &wxmxFile, const wxString &fileInWxm
 }
 
 const wxMemoryBuffer Image::GetGnuplotSource() {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
 
   wxMemoryBuffer retval;
   if ((m_gnuplotSource_Compressed.GetDataLen() < 2) ||
@@ -442,21 +452,18 @@ const wxMemoryBuffer Image::GetGnuplotSource() {
 
 const wxMemoryBuffer Image::GetCompressedGnuplotSource()
 {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   return m_gnuplotSource_Compressed;
 }
 
 const wxMemoryBuffer Image::GetCompressedGnuplotData()
 {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   return m_gnuplotData_Compressed;
 }
 
 const wxMemoryBuffer Image::GetGnuplotData() {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   wxMemoryBuffer retval;
   if ((m_gnuplotSource_Compressed.GetDataLen() < 2) ||
       (m_gnuplotData_Compressed.GetDataLen() < 2)) {
@@ -485,8 +492,7 @@ const wxMemoryBuffer Image::GetGnuplotData() {
 }
 
 wxString Image::GnuplotData() {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   if ((!m_gnuplotData.IsEmpty()) && (!wxFileExists(m_gnuplotData))) {
     // Move the gnuplot data and data file into our temp directory
     wxFileName gnuplotSourceFile(m_gnuplotSource);
@@ -520,8 +526,7 @@ wxString Image::GnuplotData() {
 }
 
 wxString Image::GnuplotSource() {
-  if(m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadGnuplotSourceTask.Wait();
   if ((!m_gnuplotSource.IsEmpty()) && (!wxFileExists(m_gnuplotSource))) {
     // Move the gnuplot source and data file into our temp directory
     wxFileName gnuplotSourceFile(m_gnuplotSource);
@@ -561,8 +566,7 @@ wxString Image::GnuplotSource() {
 }
 
 wxSize Image::ToImageFile(wxString filename) {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   wxFileName fn(filename);
   wxString ext = fn.GetExt();
   if (filename.Lower().EndsWith(GetExtension().Lower())) {
@@ -631,28 +635,67 @@ wxSize Image::ToImageFile(wxString filename) {
 }
 
 wxBitmap Image::GetBitmap(double scale) {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   // Recalculate contains its own WaitForLoad object.
   Recalculate(scale);
 
-  wxLogBuffer errorAggregator;
+  // Make sure we stay within sane defaults
+  if (m_width < 1)
+    m_width = 1;
+  if (m_height < 1)
+    m_height = 1;
+
+  // If a frame of an animation that has been prefetched is due before the
+  // background task has finished, waiting for it is faster than starting over.
+  if (m_rescaleJob && !m_rescaleJob->done && !CanRescaleInBackground() &&
+      (m_rescaleJob->width == m_width) && (m_rescaleJob->height == m_height))
+    m_rescaleTask.Wait();
+
+  // Has a background task scaled the image to the size we need?
+  if (m_rescaleJob && m_rescaleJob->done &&
+      (m_rescaleJob->width == m_width) && (m_rescaleJob->height == m_height)) {
+    m_rescaleTask.Wait();
+    if (m_rescaleJob->result) {
+      if (m_rescaleJob->mipmap.size() > m_mipmap.size())
+        m_mipmap = m_rescaleJob->mipmap;
+      m_scaledBitmap = PixelsToBitmap(*m_rescaleJob->result);
+    } else
+      m_scaledBitmap.Create(1, 1);
+    m_rescaleJob.reset();
+    m_approximateBitmap = wxNullBitmap;
+  }
+
   // Let's see if we have cached the scaled bitmap with the right size
-  if (m_scaledBitmap.GetWidth() == m_width)
+  if ((m_scaledBitmap.GetWidth() == m_width) && (m_scaledBitmap.GetHeight() == m_height)) {
+    UseCache();
     return m_scaledBitmap;
+  }
+
+  if (CanRescaleInBackground()) {
+    StartRescaleJob();
+    // Until the task has finished we show the bitmap we had, quickly scaled.
+    if ((m_approximateBitmap.GetWidth() != m_width) ||
+        (m_approximateBitmap.GetHeight() != m_height)) {
+      wxImage img = m_scaledBitmap.ConvertToImage();
+      img.Rescale(m_width, m_height, wxIMAGE_QUALITY_NEAREST);
+      m_approximateBitmap = wxBitmap(img);
+    }
+    UseCache();
+    return m_approximateBitmap;
+  }
+  StopRescaling();
 
   // Seems like we need to create a new scaled bitmap.
-  if (m_svgRast) {
-    // First create rgba data
-    std::vector<unsigned char> imgdata(static_cast<std::size_t>(m_width) * m_height * 4);
-
-    wxm_nsvgRasterize(m_svgRast.get(), m_svgImage, 0, 0,
-                      static_cast<double>(m_width) / (static_cast<double>(m_originalWidth)),
-                      imgdata.data(),
-                      m_width, m_height, m_width * 4);
-    return m_scaledBitmap =
-      RGBA2wxBitmap(imgdata.data(), m_width, m_height);
-  } else {
+  wxLogBuffer errorAggregator;
+  if (m_isSvg && ParseSvg()) {
+    m_scaledBitmap = PixelsToBitmap(*RasterizeSvg(m_svgImage, m_svgRast.get(),
+                                                  m_width, m_height, m_originalWidth,
+                                                  m_configuration->UseThreads()));
+    UseCache();
+    return m_scaledBitmap;
+  }
+
+  if (m_mipmap.empty()) {
     wxImage img;
     if (m_compressedImage.GetDataLen() > 0) {
       wxMemoryInputStream istream(m_compressedImage.GetData(),
@@ -662,33 +705,263 @@ wxBitmap Image::GetBitmap(double scale) {
     }
 
     if (img.Ok())
-      m_scaledBitmap = wxBitmap(img);
+      m_mipmap.push_back(ToPixels(img));
     else
     {
       wxString errorMessage = errorAggregator.GetBuffer();
       InvalidBitmap(errorMessage);
       wxLogMessage("GetBitmap(): %s", errorMessage.mb_str());
       Recalculate();
+      if (m_width < 1)
+        m_width = 1;
+      if (m_height < 1)
+        m_height = 1;
+      // Create a scaled bitmap and return it.
+      wxImage errorImage = m_scaledBitmap.ConvertToImage();
+      errorImage.Rescale(m_width, m_height, wxIMAGE_QUALITY_BICUBIC);
+      m_scaledBitmap = wxBitmap(errorImage, 24);
+      UseCache();
+      return m_scaledBitmap;
     }
   }
 
-  // Make sure we stay within sane defaults
-  if (m_width < 1)
-    m_width = 1;
-  if (m_height < 1)
-    m_height = 1;
-
-  // Create a scaled bitmap and return it.
-  if (m_scaledBitmap.IsOk()) {
-    wxImage img = m_scaledBitmap.ConvertToImage();
-    img.Rescale(m_width, m_height, wxIMAGE_QUALITY_BICUBIC);
-    m_scaledBitmap = wxBitmap(img, 24);
-  } else
-    m_scaledBitmap = wxBitmap(1, 1);
+  // Scale the smallest level of the mipmap that is big enough.
+  m_scaledBitmap = PixelsToBitmap(
+    *Rescale(*ImageCache::GetLevel(m_mipmap, m_width, m_height), m_width, m_height));
+  UseCache();
   return m_scaledBitmap;
 }
 
+void Image::Prefetch(double scale) {
+  if (!m_configuration->UseThreads() || m_configuration->GetPrinting() || IsLoading())
+    return;
+  Recalculate(scale);
+  if ((m_width < 1) || (m_height < 1))
+    return;
+  if ((m_scaledBitmap.GetWidth() == m_width) && (m_scaledBitmap.GetHeight() == m_height))
+    return;
+  if (m_isSvg) {
+    if (!ParseSvg())
+      return;
+  } else if (m_mipmap.empty() && (m_compressedImage.GetDataLen() == 0))
+    return;
+  StartRescaleJob();
+}
+
+bool Image::IsBitmapReady(double scale) {
+  if (IsLoading())
+    return false;
+  Recalculate(scale);
+  if (m_rescaleJob && m_rescaleJob->done &&
+      (m_rescaleJob->width == m_width) && (m_rescaleJob->height == m_height))
+    return true;
+  return (m_scaledBitmap.GetWidth() == m_width) && (m_scaledBitmap.GetHeight() == m_height);
+}
+
+bool Image::CanRescaleInBackground() const {
+  // When exporting or printing we want the real image, not an approximation.
+  if (!m_configuration->UseThreads() || !m_configuration->ClipToDrawRegion() ||
+      m_configuration->GetPrinting())
+    return false;
+  // We need something to show until the task has finished
+  if ((m_scaledBitmap.GetWidth() <= 1) && (m_scaledBitmap.GetHeight() <= 1))
+    return false;
+  if (m_isSvg)
+    return m_svgImage != NULL;
+  return !m_mipmap.empty();
+}
+
+void Image::StartRescaleJob() {
+  if (m_rescaleJob && (m_rescaleJob->width == m_width) &&
+      (m_rescaleJob->height == m_height))
+    return;
+  // We no more need the size the old task is creating
+  StopRescaling();
+
+  auto job = std::make_shared<RescaleJob>();
+  job->width = m_width;
+  job->height = m_height;
+  m_rescaleJob = job;
+  if (m_isSvg) {
+    // The svg image isn't freed before StopRescaling() has waited for the task
+    wxm_NSVGimage *svgImage = m_svgImage;
+    std::size_t originalWidth = m_originalWidth;
+    m_rescaleTask =
+      TaskPool::Get().Submit(TaskPool::IMAGES, TaskPool::HIGH,
+                             [job, svgImage, originalWidth]() {
+                               // The rasterizer isn't thread-safe => Use one of our own
+                               std::unique_ptr<wxm_NSVGrasterizer, rasterizer_deleter>
+                                 rasterizer(wxm_nsvgCreateRasterizer());
+                               if (rasterizer)
+                                 job->result = RasterizeSvg(svgImage, rasterizer.get(),
+                                                            job->width, job->height,
+                                                            originalWidth, true);
+                               job->done = true;
+                               ImageCache::Get().RescaleFinished();
+                               wxWakeUpIdle();
+                             });
+  } else {
+    job->mipmap = m_mipmap;
+    // wxMemoryBuffer isn't thread-safe => the task gets a copy of the data
+    if (job->mipmap.empty()) {
+      const char *data = static_cast<const char *>(m_compressedImage.GetData());
+      job->compressed.assign(data, data + m_compressedImage.GetDataLen());
+    }
+    m_rescaleTask =
+      TaskPool::Get().Submit(TaskPool::IMAGES, TaskPool::HIGH,
+                             [job]() {
+                               if (job->mipmap.empty()) {
+                                 wxLogNull suppressDecodingErrors;
+                                 wxMemoryInputStream istream(job->compressed.data(),
+                                                             job->compressed.size());
+                                 wxImage img(istream, wxBITMAP_TYPE_ANY);
+                                 job->compressed.clear();
+                                 if (!img.Ok()) {
+                                   // GetBitmap() will find the error itself
+                                   job->done = true;
+                                   return;
+                                 }
+                                 job->mipmap.push_back(ToPixels(img));
+                               }
+                               job->result =
+                                 Rescale(*ImageCache::GetLevel(job->mipmap, job->width,
+                                                               job->height),
+                                         job->width, job->height);
+                               job->done = true;
+                               ImageCache::Get().RescaleFinished();
+                               wxWakeUpIdle();
+                             });
+  }
+}
+
+void Image::StopRescaling() {
+  m_rescaleTask.Cancel();
+  m_rescaleTask.Wait();
+  m_rescaleJob.reset();
+  m_approximateBitmap = wxNullBitmap;
+}
+
+void Image::UseCache() {
+  std::size_t bytes = ImageCache::GetBytes(m_mipmap) +
+    static_cast<std::size_t>(m_scaledBitmap.GetWidth()) * m_scaledBitmap.GetHeight() * 4;
+  if (m_approximateBitmap.IsOk())
+    bytes += static_cast<std::size_t>(m_approximateBitmap.GetWidth()) *
+      m_approximateBitmap.GetHeight() * 4;
+  ImageCache::Get().Use(this, bytes, [this]() { DropDecodedPixels(); });
+}
+
+void Image::DropDecodedPixels() {
+  // A running background task keeps the levels it needs alive
+  m_mipmap.clear();
+  m_scaledBitmap.Create(1, 1);
+  m_approximateBitmap = wxNullBitmap;
+}
+
+std::shared_ptr<const ImageCache::Pixels> Image::ToPixels(const wxImage &image) {
+  auto pixels = std::make_shared<ImageCache::Pixels>();
+  pixels->width = image.GetWidth();
+  pixels->height = image.GetHeight();
+  const std::size_t count = static_cast<std::size_t>(pixels->width) * pixels->height;
+  pixels->rgba.resize(count * 4);
+  const unsigned char *rgb = image.GetData();
+  const unsigned char *alpha = image.HasAlpha() ? image.GetAlpha() : NULL;
+  unsigned char *dst = pixels->rgba.data();
+  for (std::size_t i = 0; i < count; i++) {
+    *dst++ = *rgb++;
+    *dst++ = *rgb++;
+    *dst++ = *rgb++;
+    *dst++ = alpha ? alpha[i] : 255;
+  }
+  return pixels;
+}
+
+wxImage Image::ToImage(const ImageCache::Pixels &pixels) {
+  wxImage image(pixels.width, pixels.height, false);
+  const std::size_t count = static_cast<std::size_t>(pixels.width) * pixels.height;
+  unsigned char *rgb = image.GetData();
+  const unsigned char *src = pixels.rgba.data();
+  bool opaque = true;
+  for (std::size_t i = 0; i < count; i++) {
+    *rgb++ = src[4 * i];
+    *rgb++ = src[4 * i + 1];
+    *rgb++ = src[4 * i + 2];
+    if (src[4 * i + 3] != 255)
+      opaque = false;
+  }
+  if (!opaque) {
+    image.SetAlpha();
+    unsigned char *alpha = image.GetAlpha();
+    for (std::size_t i = 0; i < count; i++)
+      alpha[i] = src[4 * i + 3];
+  }
+  return image;
+}
+
+std::shared_ptr<const ImageCache::Pixels> Image::Rescale(const ImageCache::Pixels &pixels,
+                                                         int width, int height) {
+  wxImage image = ToImage(pixels);
+  image.Rescale(width, height, wxIMAGE_QUALITY_BICUBIC);
+  return ToPixels(image);
+}
+
+std::shared_ptr<const ImageCache::Pixels> Image::RasterizeSvg(wxm_NSVGimage *svgImage,
+                                                              wxm_NSVGrasterizer *rasterizer,
+                                                              int width, int height,
+                                                              std::size_t originalWidth,
+                                                              bool parallel) {
+  auto pixels = std::make_shared<ImageCache::Pixels>();
+  pixels->width = width;
+  pixels->height = height;
+  pixels->rgba.resize(static_cast<std::size_t>(width) * height * 4);
+  const float scale =
+    static_cast<double>(width) / (static_cast<double>(originalWidth));
+
+  // Each band is rasterized as if it was an image of its own, shifted up by
+  // the position of its first line. The rasterizer only looks at the lines of
+  // the bitmap it has been given, so the bands don't interfere. Splitting
+  // small images isn't worth the effort: each band has to flatten all paths
+  // of the image again.
+  const int minBandHeight = 64;
+  const std::size_t minParallelPixels = 512 * 512;
+  std::size_t bands = 1;
+  if (parallel && (static_cast<std::size_t>(width) * height >= minParallelPixels))
+    bands = std::max(static_cast<std::size_t>(1),
+                     std::min(TaskPool::Get().GetWorkerCount(),
+                              static_cast<std::size_t>(height / minBandHeight)));
+  std::vector<TaskPool::Task> bandTasks;
+  for (std::size_t band = 1; band < bands; band++) {
+    const int top = static_cast<int>(height * band / bands);
+    const int bottom = static_cast<int>(height * (band + 1) / bands);
+    unsigned char *dst = pixels->rgba.data() + static_cast<std::size_t>(top) * width * 4;
+    bandTasks.push_back(
+      TaskPool::Get().Submit(TaskPool::IMAGES, TaskPool::HIGH,
+                             [svgImage, scale, dst, width, top, bottom]() {
+                               std::unique_ptr<wxm_NSVGrasterizer, rasterizer_deleter>
+                                 bandRasterizer(wxm_nsvgCreateRasterizer());
+                               if (bandRasterizer)
+                                 wxm_nsvgRasterize(bandRasterizer.get(), svgImage, 0,
+                                                   -static_cast<float>(top), scale, dst,
+                                                   width, bottom - top, width * 4);
+                             }));
+  }
+  wxm_nsvgRasterize(rasterizer, svgImage, 0, 0, scale, pixels->rgba.data(),
+                    width, static_cast<int>(height / bands), width * 4);
+  // Waiting for a band that hasn't been started yet rasterizes it on this thread.
+  for (auto &task : bandTasks)
+    task.Wait();
+  return pixels;
+}
+
+wxBitmap Image::PixelsToBitmap(const ImageCache::Pixels &pixels) const {
+  if (m_isSvg)
+    return RGBA2wxBitmap(pixels.rgba.data(), pixels.width, pixels.height);
+  return wxBitmap(ToImage(pixels), 24);
+}
+
 void Image::InvalidBitmap(const wxString &message) {
+  // From now on we display a .png image
+  m_isSvg = false;
+  m_mipmap.clear();
   m_originalWidth = m_width = 1200 * m_ppi / 96;
   m_originalHeight = m_height = 900 * m_ppi / 96;
   // Create a "image not loaded" bitmap.
@@ -741,8 +1014,7 @@ void Image::InvalidBitmap(const wxString &message) {
 }
 
 void Image::LoadImage(const wxBitmap &bitmap) {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   // Convert the bitmap to a png image we can use as m_compressedImage
   wxImage image = bitmap.ConvertToImage();
   wxMemoryOutputStream stream;
@@ -760,47 +1032,38 @@ void Image::LoadImage(const wxBitmap &bitmap) {
 }
 
 wxString Image::GetExtension() const {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   return m_extension;
 }
 
 void Image::LoadImage(wxString image, const wxString &wxmxFile,
                       bool remove) {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
+  m_loadImageTask.Wait();
   m_fromWxFS = !wxmxFile.IsEmpty();
   m_extension = wxFileName(image).GetExt();
   m_extension = m_extension.Lower();
   m_imageName = image;
-  std::unique_ptr<ThreadNumberLimiter> limiter(new ThreadNumberLimiter());
   m_compressedImage.Clear();
   m_scaledBitmap.Create(1, 1);
   if(m_configuration->UseThreads())
-    m_loadImageTask = jthread(&Image::LoadImage_Backgroundtask,
-                              this,
-                              std::move(limiter),
-                              std::move(image), wxmxFile,
-                              remove
-      );
+    m_loadImageTask =
+      TaskPool::Get().Submit(TaskPool::IMAGES, TaskPool::NORMAL,
+                             [this, image, wxmxFile, remove]() {
+                               LoadImage_Backgroundtask(image, wxmxFile, remove);
+                             });
   else
     LoadImage_Backgroundtask(
-      std::move(limiter),
       std::move(image), wxmxFile,
       remove
       );
 }
 
-void Image::LoadImage_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limiter,
-                                     wxString image, wxString wxmxFile,
+void Image::LoadImage_Backgroundtask(wxString image, wxString wxmxFile,
                                      bool remove) {
-  std::unique_ptr<ThreadNumberLimiter> threadNumLimit = std::move(limiter);
   wxLogBuffer errorAggregator;
 
   if (!wxmxFile.IsEmpty()) {
-    wxFileInputStream wxmx(wxmxFile);
-    WxmxStream imgData(wxmx, image);
-    m_compressedImage = ReadCompressedImage(&imgData);
+    m_compressedImage = ReadFromWxmx(wxmxFile, image);
   } else {
     wxFile file;
     // Support relative and absolute paths.
@@ -834,24 +1097,18 @@ void Image::LoadImage_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limite
   }
 
   SuppressErrorDialogs suppressor;
-  wxImage Image;
   if (m_compressedImage.GetDataLen() > 0) {
     if ((m_extension == "svg") || (m_extension == "svgz")) {
-      wxString svgContents_string;
-
-      // Read the svg file's data into the system's memory
+      ImageHeader header;
+      bool sizeKnown;
+      m_svgPpi = m_configuration->GetPPI().x;
       if (m_extension == "svg") {
-        // We can read the file from memory without much ado...
-        svgContents_string =
-          wxString::FromUTF8(static_cast<char *>(m_compressedImage.GetData()),
-                             m_compressedImage.GetDataLen());
-
-        // ...but we want to compress the in-memory image for saving memory
+        sizeKnown = header.ReadSvg(static_cast<char *>(m_compressedImage.GetData()),
+                       m_compressedImage.GetDataLen(), m_svgPpi);
+        // We want to compress the in-memory image for saving memory
         wxMemoryOutputStream mstream;
         wxZlibOutputStream zstream(mstream, wxZ_BEST_COMPRESSION, wxZLIB_GZIP);
-        wxTextOutputStream textOut(zstream);
-        textOut << svgContents_string;
-        textOut.Flush();
+        zstream.Write(m_compressedImage.GetData(), m_compressedImage.GetDataLen());
         zstream.Close();
         m_compressedImage.Clear();
         m_compressedImage.AppendData(
@@ -860,35 +1117,35 @@ void Image::LoadImage_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limite
         m_extension += "z";
         m_imageName += "z";
       } else {
-        // Unzip the .svgz image
-        wxMemoryInputStream istream(m_compressedImage.GetData(),
-                                    m_compressedImage.GetDataLen());
-        wxZlibInputStream zstream(istream);
-        wxTextInputStream textIn(zstream);
-        wxString line;
-        while (!zstream.Eof()) {
-          line = textIn.ReadLine();
-          svgContents_string += line + wxS("\n");
-        }
+        // The root element is found at the start of the file
+        std::string svgStart = UnzipSvg(65536);
+        sizeKnown = header.ReadSvg(svgStart.data(), svgStart.size(), m_svgPpi);
       }
-      // Convert the data we have read to a modifiable char * containing the svg
-      // file's contents.
-      wxCharBuffer svgContents = svgContents_string.ToUTF8();
-
-      // Parse the svg file's contents
-      int ppi = m_configuration->GetPPI().x;
 
-      if (svgContents.data()) {
-        m_svgImage = wxm_nsvgParse(svgContents.data(), "px", ppi);
-      }
-
-      if (m_svgImage) {
-        if (!m_svgRast)
-          m_svgRast.reset(wxm_nsvgCreateRasterizer());
+      if (sizeKnown) {
+        // The image is parsed only when it is drawn for the first time.
+        m_isSvg = true;
+        m_originalWidth = header.GetWidth();
+        m_originalHeight = header.GetHeight();
+      } else if (ParseSvg()) {
+        m_isSvg = true;
         m_originalWidth = m_svgImage->width;
         m_originalHeight = m_svgImage->height;
       }
     } else {
+      // Bitmaps are decoded in GetBitmap(), anyway => if the header tells us
+      // the image's size there is no need to decode it now.
+      ImageHeader header;
+      if (header.ReadBitmap(static_cast<unsigned char *>(m_compressedImage.GetData()),
+                            m_compressedImage.GetDataLen())) {
+        m_originalWidth = header.GetWidth();
+        m_originalHeight = header.GetHeight();
+        if (header.GetResolution() > 10)
+          m_ppi = header.GetResolution();
+        return;
+      }
+
+      wxImage Image;
       wxMemoryInputStream istream(m_compressedImage.GetData(),
                                   m_compressedImage.GetDataLen());
       Image.LoadFile(istream);
@@ -918,13 +1175,51 @@ void Image::LoadImage_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limite
   }
 }
 
+std::string Image::UnzipSvg(std::size_t maxLength) const {
+  std::string svg;
+  wxMemoryInputStream istream(m_compressedImage.GetData(),
+                              m_compressedImage.GetDataLen());
+  wxZlibInputStream zstream(istream);
+  if (!zstream.IsOk())
+    return svg;
+  char buf[16384];
+  while ((svg.size() < maxLength) &&
+         (zstream.Read(buf, sizeof(buf)).LastRead() > 0))
+    svg.append(buf, zstream.LastRead());
+  return svg;
+}
+
+bool Image::ParseSvg() {
+  if (m_svgImage)
+    return true;
+  std::string svg = UnzipSvg();
+  if (svg.empty())
+    return false;
+  m_svgImage = wxm_nsvgParse(&svg[0], "px", m_svgPpi);
+  if (!m_svgImage)
+    return false;
+  if (!m_svgRast)
+    m_svgRast.reset(wxm_nsvgCreateRasterizer());
+  return m_svgRast != nullptr;
+}
+
+void Image::ClearCache() {
+  m_loadImageTask.Wait();
+  StopRescaling();
+  ImageCache::Get().Forget(this);
+  m_mipmap.clear();
+  if ((m_scaledBitmap.GetWidth() > 1) || (m_scaledBitmap.GetHeight() > 1))
+    m_scaledBitmap.Create(1, 1);
+  // The shapes of a big svg image need more memory than its compressed form.
+  if (m_svgImage) {
+    wxm_nsvgDelete(m_svgImage);
+    m_svgImage = NULL;
+  }
+  m_svgRast.reset();
+}
+
 void Image::Recalculate(double scale) {
-  if(m_loadImageTask.joinable())
-    m_loadImageTask.join();
-  // It would better to use a jthread for joining no-more used threads.
-  // But that is C++20, which now (in 2023) is still too early.
-  if((!m_gnuplotDataThreadRunning) && m_loadGnuplotSourceTask.joinable())
-    m_loadGnuplotSourceTask.join();
+  m_loadImageTask.Wait();
   wxCoord width = m_originalWidth;
   wxCoord height = m_originalHeight;
 
@@ -983,10 +1278,8 @@ void Image::Recalculate(double scale) {
     m_height = 1;
     m_width = 1;
   }
-  // Clear this cell's image cache if it doesn't contain an image of the size
-  // we need right now.
-  if (m_scaledBitmap.GetWidth() != m_width)
-    ClearCache();
+  // We keep the scaled bitmap even if it has the wrong size now: GetBitmap()
+  // can show it until the image has been scaled to the new size.
 }
 
 const wxString Image::GetBadImageToolTip() {
@@ -1021,15 +1314,11 @@ wxBitmap Image::RGBA2wxBitmap(const unsigned char imgdata[],
   wxAlphaPixelData::Iterator dst(bmpdata);
   for (int y = 0; y < height; y++) {
     dst.MoveTo(bmpdata, 0, y);
-    for (int x = 0; x < width; x++) {
-      unsigned char a = rgba[3];
-      dst.Red() = rgba[0] * a / 255;
-      dst.Green() = rgba[1] * a / 255;
-      dst.Blue() = rgba[2] * a / 255;
-      dst.Alpha() = a;
-      dst++;
-      rgba += 4;
-    }
+    PremultiplyRGBA(rgba, dst.m_ptr, width, wxAlphaPixelData::PixelFormat::RED,
+                    wxAlphaPixelData::PixelFormat::GREEN,
+                    wxAlphaPixelData::PixelFormat::BLUE,
+                    wxAlphaPixelData::PixelFormat::ALPHA);
+    rgba += 4 * width;
   }
   return retval;
 }
@@ -29,9 +29,12 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <atomic>
 #include <memory>
-#include <thread>
-#include "ThreadNumberLimiter.h"
+#include <string>
+#include <vector>
+#include "ImageCache.h"
+#include "TaskPool.h"
 #include "precomp.h"
 #include "Version.h"
 #include "Configuration.h"
@@ -105,18 +108,15 @@ public:
                                 const int &scaleFactor = 1);
 
   void SetConfiguration(Configuration *config){
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     m_configuration = config; }
   //! Return the image's resolution
   int GetPPI() const {
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     return m_ppi;}
   //! Set the image's resolution
   void SetPPI(int ppi) {
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     m_ppi = ppi;}
 
   //! Creates a bitmap showing an error message
@@ -167,38 +167,29 @@ public:
 
   /*! Temporarily forget the scaled image in order to save memory
 
-    Will recreate the scaled image as soon as needed.
+    Will recreate the scaled image as soon as needed. For svg images this
+    also drops the parsed image, which is parsed again when it is drawn.
   */
-  void ClearCache()
-    {
-      if(m_loadImageTask.joinable())
-        m_loadImageTask.join();
-      if ((m_scaledBitmap.GetWidth() > 1) || (m_scaledBitmap.GetHeight() > 1))
-        m_scaledBitmap.Create(1, 1);
-    }
+  void ClearCache();
 
   //! Returns the file name extension of the current image
   wxString GetExtension() const;
   //! The maximum width this image shall be displayed with
   double GetMaxWidth() const {
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     return m_maxWidth;}
   //! The maximum height this image shall be displayed with
   double GetHeightList() const {
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     return m_maxHeight;}
   //! Set the maximum width this image shall be displayed with
   void   SetMaxWidth(double width){
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     m_maxWidth = width;
   }
   //! Set the maximum height this image shall be displayed with
   void   SetMaxHeight(double height){
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
+    m_loadImageTask.Wait();
     m_maxHeight = height;
   }
 
@@ -211,6 +202,17 @@ public:
   //! Returns the bitmap being displayed with custom scale
   wxBitmap GetBitmap(double scale = 1.0);
 
+  /*! Starts creating the bitmap GetBitmap(scale) will return in the background
+
+    Used by animations for the frames that will be shown next. Does nothing
+    if threads are disabled or if we are printing.
+  */
+  void Prefetch(double scale = 1.0);
+  //! Can GetBitmap(scale) return the exact bitmap without having to create it?
+  bool IsBitmapReady(double scale = 1.0);
+  //! Is the image still being loaded in the background?
+  bool IsLoading() const { return !m_loadImageTask.IsDone(); }
+
   //! Returns the image in its unscaled form
   wxBitmap GetUnscaledBitmap();
 
@@ -238,23 +240,29 @@ public:
 
   //! Can this image be exported in SVG format?
   bool CanExportSVG() const {
-    if(m_loadImageTask.joinable())
-      m_loadImageTask.join();
-    return m_svgRast != nullptr;}
+    m_loadImageTask.Wait();
+    return m_isSvg;}
 
   //! The tooltip to use wherever an image that's not Ok is shown.
   static const wxString GetBadImageToolTip();
 
+  //! Finds a file in a .wxmx archive by reading the archive from its start
   class WxmxStream: public wxZipInputStream
   {
   public:
     WxmxStream(wxInputStream &wxmxFile, const wxString &fileInWxmx);
   };
 
+  /*! Reads a file from a .wxmx archive
+
+    Uses the ZipIndex all loaders share, so the file is read directly.
+    Returns an empty buffer if the file cannot be found.
+  */
+  static wxMemoryBuffer ReadFromWxmx(const wxString &wxmxFile, const wxString &fileInWxmx);
+
   bool HasGnuplotSource() const {return m_gnuplotSource_Compressed.GetDataLen() > 20;}
 private:
   bool m_fromWxFS = false;
-  bool m_gnuplotDataThreadRunning = false;
   //! A zipped version of the gnuplot commands that produced this image.
   wxMemoryBuffer m_gnuplotSource_Compressed;
   //! A zipped version of the gnuplot data needed in order to create this image.
@@ -265,19 +273,25 @@ private:
   std::size_t m_originalHeight = 480;
   //! The bitmap, scaled down to the screen size
   wxBitmap m_scaledBitmap;
+  /*! A quickly scaled copy of m_scaledBitmap we show while a background task
+    creates the real one
+
+    Never used for the cache, exports or printing.
+  */
+  wxBitmap m_approximateBitmap;
   //! The file extension for the current image type
   wxString m_extension;
   //! The gnuplot source file for this image, if any.
   wxString m_gnuplotSource;
   //! The gnuplot data file for this image, if any.
   wxString m_gnuplotData;
-  mutable jthread m_loadImageTask;
-  void LoadImage_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limiter,
-                                wxString image, wxString wxmxFile,
+  //! The background task that loads the image
+  mutable TaskPool::Task m_loadImageTask;
+  void LoadImage_Backgroundtask(wxString image, wxString wxmxFile,
                                 bool remove);
-  jthread m_loadGnuplotSourceTask;
+  //! The background task that loads the gnuplot source
+  TaskPool::Task m_loadGnuplotSourceTask;
   void LoadGnuplotSource_Backgroundtask(
-    std::unique_ptr<ThreadNumberLimiter> limiter,
     wxString gnuplotFile, wxString dataFile, wxString wxmxFile);
   void LoadGnuplotSource(wxInputStream *source);
   void LoadGnuplotData(wxInputStream *data);
@@ -286,8 +300,7 @@ private:
     wxInputStream *data);
 
 
-  void LoadCompressedGnuplotSource_Backgroundtask(std::unique_ptr<ThreadNumberLimiter> limiter,
-                                                  wxString sourcefile,
+  void LoadCompressedGnuplotSource_Backgroundtask(wxString sourcefile,
                                                   wxString datafile,
                                                   wxString wxmxFile
     );
@@ -295,6 +308,13 @@ private:
   void LoadImage(wxString image, const wxString &wxmxFile, bool remove = true);
   //! Reads the compressed image into a memory buffer
   static wxMemoryBuffer ReadCompressedImage(wxInputStream *data);
+  //! Returns (at least the first maxLength bytes of) our svg image, uncompressed
+  std::string UnzipSvg(std::size_t maxLength = std::string::npos) const;
+  /*! Parses our svg image, if that hasn't happened yet
+
+    \return false, if the image couldn't be parsed.
+  */
+  bool ParseSvg();
   Configuration *m_configuration = NULL;
   /*! The upper width limit for displaying this image
    */
@@ -305,9 +325,67 @@ private:
   wxString m_imageName;
   //! The image resolution
   double m_ppi = 72;
-  struct free_deleter { void operator()(void *p) const { std::free(p); } };
+  //! The resolution our svg image is parsed with
+  double m_svgPpi = 96;
+  //! Is this a svg image whose size is known?
+  bool m_isSvg = false;
+  struct rasterizer_deleter {
+    void operator()(wxm_NSVGrasterizer *p) const { wxm_nsvgDeleteRasterizer(p); } };
   wxm_NSVGimage* m_svgImage = {};
-  std::unique_ptr<struct wxm_NSVGrasterizer, free_deleter> m_svgRast{nullptr};
+  std::unique_ptr<struct wxm_NSVGrasterizer, rasterizer_deleter> m_svgRast{nullptr};
+
+  //! What a background task that scales the image creates
+  struct RescaleJob
+  {
+    //! The size the image is scaled to
+    int width = 1;
+    int height = 1;
+    //! The mipmap of the image, including the levels the task has created
+    ImageCache::Mipmap mipmap;
+    //! If mipmap is empty: The compressed image the task has to decode first
+    std::vector<char> compressed;
+    //! The scaled image. NULL = the task has failed.
+    std::shared_ptr<const ImageCache::Pixels> result;
+    //! true = the task has finished
+    std::atomic<bool> done{false};
+  };
+  //! The decoded bitmap image, in the sizes we have needed so far. Empty for svg images.
+  ImageCache::Mipmap m_mipmap;
+  //! The background task that scales the image to the size we need
+  TaskPool::Task m_rescaleTask;
+  //! What m_rescaleTask creates
+  std::shared_ptr<RescaleJob> m_rescaleJob;
+
+  //! Can we show an approximation while the image is scaled in the background?
+  bool CanRescaleInBackground() const;
+  //! Starts a background task that scales the image to m_width x m_height
+  void StartRescaleJob();
+  //! Cancels m_rescaleTask and waits for it to stop
+  void StopRescaling();
+  //! Tells the ImageCache how much memory our decoded pixels need
+  void UseCache();
+  //! Drops all decoded pixels. Called by the ImageCache if it needs memory.
+  void DropDecodedPixels();
+  //! Converts the image to a bitmap
+  wxBitmap PixelsToBitmap(const ImageCache::Pixels &pixels) const;
+  //! Converts a wxImage to the pixels the ImageCache stores
+  static std::shared_ptr<const ImageCache::Pixels> ToPixels(const wxImage &image);
+  //! Converts pixels to a wxImage that only has an alpha channel if it is needed
+  static wxImage ToImage(const ImageCache::Pixels &pixels);
+  //! Scales pixels to a new size. Can be called from any thread.
+  static std::shared_ptr<const ImageCache::Pixels> Rescale(const ImageCache::Pixels &pixels,
+                                                           int width, int height);
+  /*! Rasterizes an svg image. Can be called from any thread, if each uses its own rasterizer.
+
+    \param parallel true = Split big images into horizontal bands that are
+    rasterized concurrently by the task pool, each with a rasterizer of its own.
+    The calling thread rasterizes the first band using rasterizer.
+  */
+  static std::shared_ptr<const ImageCache::Pixels> RasterizeSvg(wxm_NSVGimage *svgImage,
+                                                                wxm_NSVGrasterizer *rasterizer,
+                                                                int width, int height,
+                                                                std::size_t originalWidth,
+                                                                bool parallel);
 };
 
 #endif // IMAGE_H
@@ -0,0 +1,146 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+/*! \file
+  This file defines the class ImageCache.
+*/
+
+#include "ImageCache.h"
+#include <algorithm>
+
+ImageCache::ImageCache(std::size_t budget) :
+  m_budget(budget)
+{
+}
+
+ImageCache &ImageCache::Get()
+{
+  static ImageCache cache;
+  return cache;
+}
+
+void ImageCache::Use(const void *owner, std::size_t bytes, const std::function<void()> &drop)
+{
+  auto found = m_index.find(owner);
+  if(found == m_index.end())
+    {
+      m_entries.push_front(Entry{owner, bytes, drop});
+      m_index[owner] = m_entries.begin();
+    }
+  else
+    {
+      m_bytes -= found->second->bytes;
+      found->second->bytes = bytes;
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+    }
+  m_bytes += bytes;
+  Evict(owner);
+}
+
+void ImageCache::Forget(const void *owner)
+{
+  auto found = m_index.find(owner);
+  if(found == m_index.end())
+    return;
+  m_bytes -= found->second->bytes;
+  m_entries.erase(found->second);
+  m_index.erase(found);
+}
+
+void ImageCache::SetBudget(std::size_t budget)
+{
+  m_budget = budget;
+  Evict(NULL);
+}
+
+void ImageCache::Evict(const void *keep)
+{
+  while((m_bytes > m_budget) && !m_entries.empty() && (m_entries.back().owner != keep))
+    {
+      // The image may be destroyed by drop() => Forget it first.
+      std::function<void()> drop = std::move(m_entries.back().drop);
+      Forget(m_entries.back().owner);
+      m_evictions++;
+      drop();
+    }
+}
+
+ImageCache::Statistics ImageCache::GetStatistics() const
+{
+  Statistics stats;
+  stats.bytes = m_bytes;
+  stats.images = m_entries.size();
+  stats.evictions = m_evictions;
+  return stats;
+}
+
+std::shared_ptr<const ImageCache::Pixels> ImageCache::HalfSize(const Pixels &pixels)
+{
+  auto half = std::make_shared<Pixels>();
+  half->width = std::max((pixels.width + 1) / 2, 1);
+  half->height = std::max((pixels.height + 1) / 2, 1);
+  half->rgba.resize(static_cast<std::size_t>(half->width) * half->height * 4);
+  unsigned char *dst = half->rgba.data();
+  for(int y = 0; y < half->height; y++)
+    {
+      // At odd sizes the last row and column are averaged with themselves
+      const int y0 = std::min(2 * y, pixels.height - 1);
+      const int y1 = std::min(2 * y + 1, pixels.height - 1);
+      const unsigned char *row0 = pixels.rgba.data() + static_cast<std::size_t>(y0) * pixels.width * 4;
+      const unsigned char *row1 = pixels.rgba.data() + static_cast<std::size_t>(y1) * pixels.width * 4;
+      for(int x = 0; x < half->width; x++)
+        {
+          const int x0 = std::min(2 * x, pixels.width - 1) * 4;
+          const int x1 = std::min(2 * x + 1, pixels.width - 1) * 4;
+          for(int channel = 0; channel < 4; channel++)
+            *dst++ = static_cast<unsigned char>(
+              (row0[x0 + channel] + row0[x1 + channel] +
+               row1[x0 + channel] + row1[x1 + channel] + 2) / 4);
+        }
+    }
+  return half;
+}
+
+std::shared_ptr<const ImageCache::Pixels> ImageCache::GetLevel(Mipmap &mipmap, int width, int height)
+{
+  std::size_t level = 0;
+  for(;;)
+    {
+      const Pixels &current = *mipmap[level];
+      // The next level would be smaller than requested, or can't get smaller
+      if(((current.width + 1) / 2 < width) || ((current.height + 1) / 2 < height) ||
+         ((current.width <= 1) && (current.height <= 1)))
+        return mipmap[level];
+      if(level + 1 >= mipmap.size())
+        mipmap.push_back(HalfSize(current));
+      level++;
+    }
+}
+
+std::size_t ImageCache::GetBytes(const Mipmap &mipmap)
+{
+  std::size_t bytes = 0;
+  for(const auto &level : mipmap)
+    if(level)
+      bytes += level->GetBytes();
+  return bytes;
+}
@@ -0,0 +1,160 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#ifndef WXMAXIMA_IMAGECACHE_H
+#define WXMAXIMA_IMAGECACHE_H
+
+/*! \file
+ *
+ * Declares the memory budget for the decoded images of all worksheets.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*! Keeps track of the memory the decoded images need
+
+  Images are kept in their compressed form. In order to draw them they are
+  decoded and scaled to the size they are displayed in, which for a big plot
+  easily means several megabytes of pixels. Each Image therefore keeps a
+  mipmap of its decoded pixels (the full-size image, half the size, a quarter
+  of the size...) that allows to scale it to a new size starting from a level
+  that is only slightly bigger than the result, plus the scaled bitmap.
+
+  The images tell the cache how much memory they need for this each time
+  they are drawn. If all images together need more memory than the budget
+  allows the cache asks the images that haven't been drawn for the longest
+  time to drop their decoded pixels. They are decoded again when they are
+  drawn the next time.
+
+  Except for RescaleFinished() and GetGeneration() this class must only be
+  used from the GUI thread.
+*/
+class ImageCache final
+{
+  ImageCache(const ImageCache &) = delete;
+  ImageCache &operator=(const ImageCache &) = delete;
+public:
+  //! The decoded pixels of an image: 4 bytes (red, green, blue and alpha) per pixel
+  struct Pixels
+  {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgba;
+    //! The memory this image needs
+    std::size_t GetBytes() const { return rgba.size(); }
+  };
+  /*! The levels of a mipmap: Index 0 is the full-size image.
+
+    Each level is half as wide and high as the one before, rounded up. Once
+    they have been created levels never change, so they may be shared between
+    threads.
+  */
+  using Mipmap = std::vector<std::shared_ptr<const Pixels>>;
+
+  //! What the cache knows about how well it works
+  struct Statistics
+  {
+    std::size_t bytes = 0;
+    std::size_t images = 0;
+    std::uint64_t evictions = 0;
+  };
+
+  /*! Creates a cache
+
+    \param budget The number of bytes all decoded images together may need
+  */
+  explicit ImageCache(std::size_t budget = DefaultBudget());
+  //! The cache all images share
+  static ImageCache &Get();
+  //! The budget the cache Get() returns starts with
+  static constexpr std::size_t DefaultBudget() { return 256 * 1024 * 1024; }
+
+  /*! Tells that an image is drawn and how much memory its decoded pixels need
+
+    If this exceeds the budget the images that haven't been drawn for the
+    longest time are asked to drop their pixels - but never the image that
+    calls this function.
+    \param owner The image
+    \param bytes The memory the image currently needs for decoded pixels
+    \param drop Drops the decoded pixels of the image. Is only stored when
+    the image is new to the cache. Must not call any function of the cache.
+  */
+  void Use(const void *owner, std::size_t bytes, const std::function<void()> &drop);
+  //! Tells that an image has dropped its pixels or is destroyed
+  void Forget(const void *owner);
+
+  //! Sets the number of bytes all decoded images together may need
+  void SetBudget(std::size_t budget);
+  std::size_t GetBudget() const { return m_budget; }
+  //! How well does this cache work?
+  Statistics GetStatistics() const;
+
+  /*! Tells that a background task has scaled an image
+
+    Can be called from any thread. The image will show the result when
+    it is drawn the next time.
+  */
+  void RescaleFinished() { m_generation++; }
+  //! Is increased each time an image has been scaled in the background
+  std::uint32_t GetGeneration() const { return m_generation; }
+
+  //! Scales pixels to half their width and height, averaging 2x2 pixels
+  static std::shared_ptr<const Pixels> HalfSize(const Pixels &pixels);
+  /*! Returns the smallest level of a mipmap that is at least width x height pixels big
+
+    Creates the missing levels on the way. mipmap must contain at least the
+    full-size image.
+  */
+  static std::shared_ptr<const Pixels> GetLevel(Mipmap &mipmap, int width, int height);
+  //! The memory all levels of a mipmap need
+  static std::size_t GetBytes(const Mipmap &mipmap);
+
+private:
+  //! Asks the least recently drawn images to drop their pixels until we are within the budget
+  void Evict(const void *keep);
+
+  struct Entry
+  {
+    const void *owner;
+    std::size_t bytes;
+    std::function<void()> drop;
+  };
+  //! The images, the one that has been drawn last first
+  using Entries = std::list<Entry>;
+  Entries m_entries;
+  //! Where in m_entries to find each image
+  std::unordered_map<const void *, Entries::iterator> m_index;
+  //! The memory all images in m_entries need
+  std::size_t m_bytes = 0;
+  std::size_t m_budget;
+  std::uint64_t m_evictions = 0;
+  std::atomic<std::uint32_t> m_generation{0};
+};
+
+#endif
@@ -0,0 +1,282 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+/*! \file
+  This file defines the class ImageHeader.
+*/
+
+#include "ImageHeader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include "XmlPullParser.h"
+
+namespace {
+//! Reads a big-endian 16-bit number
+inline unsigned long ReadU16(const unsigned char *data)
+{
+  return (static_cast<unsigned long>(data[0]) << 8) | data[1];
+}
+
+//! Reads a big-endian 32-bit number
+inline unsigned long ReadU32(const unsigned char *data)
+{
+  return (ReadU16(data) << 16) | ReadU16(data + 2);
+}
+
+inline bool IsDigit(char ch)
+{
+  return (ch >= '0') && (ch <= '9');
+}
+
+/*! Reads a number the way nanoSVG does
+
+  Doesn't depend on the locale and doesn't skip leading whitespace. An empty
+  number is read as 0.
+*/
+float ParseNumber(const char *&pos)
+{
+  float sign = 1;
+  if((*pos == '-') || (*pos == '+'))
+    {
+      if(*pos == '-')
+        sign = -1;
+      ++pos;
+    }
+  double value = 0;
+  while(IsDigit(*pos))
+    value = value * 10 + (*pos++ - '0');
+  if(*pos == '.')
+    {
+      ++pos;
+      double fraction = 0;
+      int digits = 0;
+      while(IsDigit(*pos))
+        {
+          fraction = fraction * 10 + (*pos++ - '0');
+          digits++;
+        }
+      value += fraction / std::pow(10.0, digits);
+    }
+  // "1em" is a length, not the start of an exponent
+  if(((*pos == 'e') || (*pos == 'E')) && (pos[1] != 'm') && (pos[1] != 'x'))
+    {
+      ++pos;
+      int expSign = 1;
+      if((*pos == '-') || (*pos == '+'))
+        {
+          if(*pos == '-')
+            expSign = -1;
+          ++pos;
+        }
+      int exponent = 0;
+      while(IsDigit(*pos))
+        exponent = std::min(exponent * 10 + (*pos++ - '0'), 1000);
+      value *= std::pow(10.0, expSign * exponent);
+    }
+  return sign * static_cast<float>(value);
+}
+
+/*! Converts the value of a width or height attribute of an svg to pixels
+
+  \return false, if the value is relative to something only parsing the
+  whole image tells.
+*/
+bool SvgLengthToPixels(const std::string &value, float ppi, float &pixels)
+{
+  const char *pos = value.c_str();
+  const float number = ParseNumber(pos);
+  if((pos[0] == 'p') && (pos[1] == 't'))
+    pixels = number / 72.0f * ppi;
+  else if((pos[0] == 'p') && (pos[1] == 'c'))
+    pixels = number / 6.0f * ppi;
+  else if((pos[0] == 'm') && (pos[1] == 'm'))
+    pixels = number / 25.4f * ppi;
+  else if((pos[0] == 'c') && (pos[1] == 'm'))
+    pixels = number / 2.54f * ppi;
+  else if((pos[0] == 'i') && (pos[1] == 'n'))
+    pixels = number * ppi;
+  else if(pos[0] == '%')
+    // nanoSVG doesn't know what the percentage refers to at this point
+    pixels = 0;
+  else if((pos[0] == 'e') && ((pos[1] == 'm') || (pos[1] == 'x')))
+    return false;
+  else
+    pixels = number;
+  return true;
+}
+}
+
+bool ImageHeader::ReadBitmap(const unsigned char *data, std::size_t length)
+{
+  m_width = m_height = 0;
+  m_resolution = 0;
+  if((length >= 8) && (std::memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0))
+    return ReadPng(data, length);
+  if((length >= 3) && (data[0] == 0xFF) && (data[1] == 0xD8) && (data[2] == 0xFF))
+    return ReadJpeg(data, length);
+  return false;
+}
+
+bool ImageHeader::ReadPng(const unsigned char *data, std::size_t length)
+{
+  // The IHDR chunk has to be the first one
+  if((length < 8 + 8 + 13) || (std::memcmp(data + 12, "IHDR", 4) != 0))
+    return false;
+  m_width = ReadU32(data + 16);
+  m_height = ReadU32(data + 20);
+  if((m_width == 0) || (m_height == 0))
+    return false;
+
+  // The pHYs chunk has to come before the image data
+  std::size_t pos = 8;
+  while(pos + 8 <= length)
+    {
+      const unsigned long chunkLength = ReadU32(data + pos);
+      const unsigned char *type = data + pos + 4;
+      if((std::memcmp(type, "IDAT", 4) == 0) || (std::memcmp(type, "IEND", 4) == 0))
+        break;
+      if((std::memcmp(type, "pHYs", 4) == 0) && (chunkLength >= 9) &&
+         (pos + 8 + 9 <= length))
+        {
+          // Unit 1 = pixels per meter. Else only the aspect ratio is known.
+          if(data[pos + 8 + 8] == 1)
+            m_resolution = ReadU32(data + pos + 8) * 0.0254;
+          break;
+        }
+      // Each chunk ends in a 4-byte CRC
+      if(chunkLength > length - pos - 12)
+        break;
+      pos += 12 + chunkLength;
+    }
+  return true;
+}
+
+bool ImageHeader::ReadJpeg(const unsigned char *data, std::size_t length)
+{
+  std::size_t pos = 2;
+  while(pos + 4 <= length)
+    {
+      if(data[pos] != 0xFF)
+        return false;
+      const unsigned char marker = data[pos + 1];
+      // Fill bytes
+      if(marker == 0xFF)
+        {
+          ++pos;
+          continue;
+        }
+      // Markers without a segment
+      if((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7)))
+        {
+          pos += 2;
+          continue;
+        }
+      // The image data starts without us having found its size
+      if((marker == 0xD9) || (marker == 0xDA))
+        return false;
+      const unsigned long segmentLength = ReadU16(data + pos + 2);
+      if((segmentLength < 2) || (pos + 2 + segmentLength > length))
+        return false;
+      const unsigned char *segment = data + pos + 4;
+      if((marker == 0xE0) && (segmentLength >= 2 + 12) &&
+         (std::memcmp(segment, "JFIF\0", 5) == 0))
+        {
+          // Units 1 = dots per inch, 2 = dots per cm. 0 = Only the aspect ratio is known.
+          const unsigned long density = ReadU16(segment + 8);
+          if(segment[7] == 1)
+            m_resolution = density;
+          else if(segment[7] == 2)
+            m_resolution = density * 2.54;
+        }
+      // SOF0...SOF15, except for DHT, JPG and DAC that share the range
+      if((marker >= 0xC0) && (marker <= 0xCF) &&
+         (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC))
+        {
+          if(segmentLength < 2 + 5)
+            return false;
+          m_height = ReadU16(segment + 1);
+          m_width = ReadU16(segment + 3);
+          return (m_width > 0) && (m_height > 0);
+        }
+      pos += 2 + segmentLength;
+    }
+  return false;
+}
+
+bool ImageHeader::ReadSvg(const char *data, std::size_t length, double ppi)
+{
+  m_width = m_height = 0;
+  m_resolution = 0;
+  XmlPullParser parser(data, length);
+  XmlPullParser::TokenType token;
+  while((token = parser.Next()) != XmlPullParser::START_TAG)
+    if((token == XmlPullParser::ERROR) || (token == XmlPullParser::END_OF_DATA))
+      return false;
+  if(parser.Name() != "svg")
+    return false;
+
+  float width = 0;
+  float height = 0;
+  float viewBox[4] = {0, 0, 0, 0};
+  for(const auto &attr : parser.Attributes())
+    {
+      if(attr.first == "width")
+        {
+          if(!SvgLengthToPixels(attr.second, static_cast<float>(ppi), width))
+            return false;
+        }
+      else if(attr.first == "height")
+        {
+          if(!SvgLengthToPixels(attr.second, static_cast<float>(ppi), height))
+            return false;
+        }
+      else if(attr.first == "viewBox")
+        {
+          const char *pos = attr.second.c_str();
+          for(int i = 0; i < 4; i++)
+            {
+              viewBox[i] = ParseNumber(pos);
+              while((*pos == ' ') || (*pos == '\t') || (*pos == '\n') || (*pos == '\r') ||
+                    (*pos == '%') || (*pos == ','))
+                ++pos;
+              if(*pos == '\0')
+                break;
+            }
+        }
+    }
+  // Without a size and a viewBox nanoSVG uses the bounding box of all shapes
+  if(viewBox[2] == 0)
+    viewBox[2] = width;
+  if(viewBox[3] == 0)
+    viewBox[3] = height;
+  if(width == 0)
+    width = viewBox[2];
+  if(height == 0)
+    height = viewBox[3];
+  if((width < 1) || (height < 1))
+    return false;
+  m_width = static_cast<std::size_t>(width);
+  m_height = static_cast<std::size_t>(height);
+  return true;
+}
@@ -0,0 +1,82 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#ifndef WXMAXIMA_IMAGEHEADER_H
+#define WXMAXIMA_IMAGEHEADER_H
+
+/*! \file
+ *
+ * Declares the class that reads the size of an image without decoding it.
+ */
+
+#include <cstddef>
+
+/*! Reads the size and resolution of an image from its header
+
+  In order to lay out a worksheet we only need to know how big its images
+  are. Decoding a .png image or parsing an .svg image only in order to learn
+  that means that opening a document with many plots does most of the work
+  of drawing every one of them - and keeps the result in memory. This class
+  instead reads only the few bytes that tell the size, which allows Image to
+  postpone the decoding until the image is drawn for the first time.
+
+  Only the formats wxMaxima's plots typically come in are supported: For
+  everything else Read...() returns false and the image has to be decoded.
+*/
+class ImageHeader
+{
+public:
+  /*! Reads the IHDR and pHYs chunk of a .png or the SOF and JFIF segment of a .jpeg
+
+    \return false, if the data is in a different format or the header is broken.
+  */
+  bool ReadBitmap(const unsigned char *data, std::size_t length);
+  /*! Reads the size of an svg image from the attributes of its root element
+
+    Computes the size the same way nanoSVG does.
+    \param data The start of the svg file. Only needs to contain its root tag.
+    \param length The number of bytes in data
+    \param ppi The resolution nanoSVG will be asked to parse the image with
+    \return false, if the size can only be known by parsing the whole image,
+    for example as it is given relative to a font size.
+  */
+  bool ReadSvg(const char *data, std::size_t length, double ppi);
+
+  //! The width of the image in pixels
+  std::size_t GetWidth() const { return m_width; }
+  //! The height of the image in pixels
+  std::size_t GetHeight() const { return m_height; }
+  //! The resolution of the image in pixels per inch. 0 = The image doesn't tell.
+  double GetResolution() const { return m_resolution; }
+
+private:
+  //! Reads the header of a .png file
+  bool ReadPng(const unsigned char *data, std::size_t length);
+  //! Reads the header of a .jpeg file
+  bool ReadJpeg(const unsigned char *data, std::size_t length);
+
+  std::size_t m_width = 0;
+  std::size_t m_height = 0;
+  double m_resolution = 0;
+};
+
+#endif
@@ -0,0 +1,109 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+
+/*! \file
+  This file defines the class LineIndex.
+*/
+
+#include "LineIndex.h"
+#include <algorithm>
+
+std::size_t LineIndex::GetLineStart(std::size_t line) const
+{
+  if(line >= m_lineStarts.size())
+    return m_textLength;
+  if(line >= m_shiftFrom)
+    return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(m_lineStarts[line]) + m_shift);
+  return m_lineStarts[line];
+}
+
+std::size_t LineIndex::GetLineEnd(std::size_t line) const
+{
+  if(line + 1 >= m_lineStarts.size())
+    return m_textLength;
+  return GetLineStart(line + 1) - 1;
+}
+
+std::size_t LineIndex::GetLine(std::size_t pos) const
+{
+  // Find the last line that starts at or before pos
+  std::size_t first = 0;
+  std::size_t count = m_lineStarts.size();
+  while(count > 0)
+    {
+      std::size_t step = count / 2;
+      if(GetLineStart(first + step) <= pos)
+        {
+          first += step + 1;
+          count -= step + 1;
+        }
+      else
+        count = step;
+    }
+  return first - 1;
+}
+
+void LineIndex::ApplyShift()
+{
+  if(m_shift != 0)
+    for(std::size_t i = m_shiftFrom; i < m_lineStarts.size(); i++)
+      m_lineStarts[i] = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(m_lineStarts[i]) +
+                                                 m_shift);
+  m_shiftFrom = m_lineStarts.size();
+  m_shift = 0;
+}
+
+void LineIndex::Replace(std::size_t start, std::size_t end, std::size_t length,
+                        const std::vector<std::size_t> &newLineStarts)
+{
+  start = std::min(start, m_textLength);
+  end = std::max(start, std::min(end, m_textLength));
+  const std::ptrdiff_t shift =
+    static_cast<std::ptrdiff_t>(length) - static_cast<std::ptrdiff_t>(end - start);
+  m_textLength = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(m_textLength) + shift);
+
+  // The lines that begin in (start, end] begin behind a line ending that has
+  // been replaced.
+  const std::size_t firstRemoved = GetLine(start) + 1;
+  const std::size_t firstKept = GetLine(end) + 1;
+
+  // Typing within a line only moves the lines behind it.
+  if((firstRemoved == firstKept) && newLineStarts.empty())
+    {
+      if((m_shift != 0) && (m_shiftFrom != firstKept))
+        ApplyShift();
+      m_shiftFrom = firstKept;
+      m_shift += shift;
+      return;
+    }
+
+  ApplyShift();
+  for(std::size_t i = firstKept; i < m_lineStarts.size(); i++)
+    m_lineStarts[i] = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(m_lineStarts[i]) +
+                                               shift);
+  m_lineStarts.erase(m_lineStarts.begin() + static_cast<std::ptrdiff_t>(firstRemoved),
+                     m_lineStarts.begin() + static_cast<std::ptrdiff_t>(firstKept));
+  m_lineStarts.insert(m_lineStarts.begin() + static_cast<std::ptrdiff_t>(firstRemoved),
+                      newLineStarts.begin(), newLineStarts.end());
+  m_shiftFrom = m_lineStarts.size();
+}
@@ -0,0 +1,125 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+
+#ifndef WXMAXIMA_LINEINDEX_H
+#define WXMAXIMA_LINEINDEX_H
+
+/*! \file
+ *
+ * Declares the index of the lines of the text of an EditorCell.
+ */
+
+#include <cstddef>
+#include <vector>
+
+/*! Knows where the lines of a text begin
+
+  Converting between a position in the text and its line and column needs a
+  binary search instead of a scan of the text. Edits only update the part of
+  the index they affect: While the user types within one line, which doesn't
+  add or remove line endings, the line starts behind it are moved by a shift
+  that is only applied to them once an edit elsewhere needs that.
+
+  Both '\n' and '\r' (a soft line break) end a line.
+*/
+class LineIndex
+{
+public:
+  LineIndex() = default;
+
+  //! Indexes the lines of the text [begin, end)
+  template <class Iterator> void Build(Iterator begin, Iterator end)
+    {
+      m_lineStarts.assign(1, 0);
+      m_shiftFrom = 1;
+      m_shift = 0;
+      std::size_t pos = 0;
+      for(Iterator it = begin; it != end; ++it)
+        {
+          ++pos;
+          if(IsLineEnding(*it))
+            m_lineStarts.push_back(pos);
+        }
+      m_textLength = pos;
+    }
+
+  /*! Updates the index after the chars [start, end) have been replaced
+
+    \param start The position of the first replaced char
+    \param end   The position behind the last replaced char, in the old text
+    \param begin, replacementEnd The text that replaces them
+  */
+  template <class Iterator> void Replace(std::size_t start, std::size_t end,
+                                         Iterator begin, Iterator replacementEnd)
+    {
+      std::vector<std::size_t> newLineStarts;
+      std::size_t length = 0;
+      for(Iterator it = begin; it != replacementEnd; ++it)
+        {
+          ++length;
+          if(IsLineEnding(*it))
+            newLineStarts.push_back(start + length);
+        }
+      Replace(start, end, length, newLineStarts);
+    }
+
+  //! The length of the indexed text
+  std::size_t GetTextLength() const {return m_textLength;}
+  //! The number of lines of the text
+  std::size_t GetLines() const {return m_lineStarts.size();}
+  //! The line the char at pos is in
+  std::size_t GetLine(std::size_t pos) const;
+  //! The position of the first char of line
+  std::size_t GetLineStart(std::size_t line) const;
+  //! The position of the line ending of line, or the text length for the last line
+  std::size_t GetLineEnd(std::size_t line) const;
+
+private:
+  //! The chars that end a line
+  template <class Char> static bool IsLineEnding(Char ch)
+    {return (ch == '\n') || (ch == '\r');}
+  /*! Does the work for the template Replace()
+
+    \param newLineStarts The line starts the replacement contains, as positions
+    in the new text
+  */
+  void Replace(std::size_t start, std::size_t end, std::size_t length,
+               const std::vector<std::size_t> &newLineStarts);
+  //! Adds the pending shift to all line starts that need it
+  void ApplyShift();
+
+  /*! Where the lines begin
+
+    The first line always begins at 0. The line starts from m_shiftFrom on
+    still need to be moved by m_shift.
+  */
+  std::vector<std::size_t> m_lineStarts = {0};
+  //! The index of the first line start that still has to be moved by m_shift
+  std::size_t m_shiftFrom = 1;
+  //! How far the line starts from m_shiftFrom on still have to be moved
+  std::ptrdiff_t m_shift = 0;
+  //! The length of the text
+  std::size_t m_textLength = 0;
+};
+
+#endif
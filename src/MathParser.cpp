@@ -31,11 +31,13 @@
 #include <memory>
 #include <wx/config.h>
 #include <wx/intl.h>
-#include <wx/sstream.h>
+#include <wx/thread.h>
 #include <wx/tokenzr.h>
 #include "ErrorRedirector.h"
 
 #include "MathParser.h"
+#include "OutputChunker.h"
+#include "XmlPullParser.h"
 
 #include "cells/AbsCell.h"
 #include "cells/AnimationCell.h"
@@ -55,6 +57,7 @@
 #include "cells/ListCell.h"
 #include "cells/LongNumberCell.h"
 #include "cells/MatrCell.h"
+#include "cells/OutputChunkCell.h"
 #include "cells/ParenCell.h"
 #include "cells/SetCell.h"
 #include "cells/SqrtCell.h"
@@ -1190,9 +1193,11 @@ std::unique_ptr<Cell> MathParser::ParseTag(wxXmlNode *node, bool all) {
       // Parse XML tags. The only other type of element we recognize are text
       // nodes.
 
-      auto function = m_innerTags[tagName];
-      if (function)
-        tree.Append(CALL_MEMBER_FN(*this, function)(node));
+      // Don't use m_innerTags[tagName] here: For unknown tags that would
+      // modify the map, which might be read by a parser in another thread.
+      auto function = m_innerTags.find(tagName);
+      if (function != m_innerTags.end())
+        tree.Append(CALL_MEMBER_FN(*this, function->second)(node));
 
       if (false)
         if (!tree.GetLastAppended() && node->GetChildren())
@@ -1228,7 +1233,8 @@ std::unique_ptr<Cell> MathParser::ParseTag(wxXmlNode *node, bool all) {
       // Tell the user we ran into problems.
       wxString msg;
       msg = tree.GetLastAppended()->ToString();
-      if (!msg.empty()) {
+      // Message boxes can only be shown by the main thread.
+      if (!msg.empty() && wxThread::IsMain()) {
         LoggingMessageBox(msg, _("Warning"), wxOK | wxICON_WARNING);
         gotInvalid = false;
       }
@@ -1266,33 +1272,138 @@ std::unique_ptr<Cell> MathParser::ParseLine(wxString s, CellType style) {
     showLength = 50000;
   }
 
-  m_graphRegex.Replace(&s, wxS("\uFFFD"));
+  const wxScopedCharBuffer utf8 = s.utf8_str();
+  if (((s.Length() < showLength) || (showLength == 0)) &&
+      (utf8.length() <= OutputChunker::MaxUnsplitBytes)) {
+    // Control characters are displayed as U+FFFD, and the tokenizer does
+    // that replacement in the same pass it splits the line into tags.
+    std::unique_ptr<wxXmlNode> doc = ParseXml(utf8.data(), utf8.length(), true, true);
+    if (doc)
+      cell = ParseTag(doc->GetChildren());
+  } else
+    cell = ParseLongLine(utf8.data(), utf8.length(), style);
+  return cell;
+}
 
-  if ((s.Length() < showLength) || (showLength == 0)) {
-    wxXmlDocument xml;
+std::unique_ptr<Cell> MathParser::ParseLine(const char *data, std::size_t length,
+                                            CellType style) {
+  m_ParserStyle = style;
+  m_FracStyle = FracCell::FC_NORMAL;
+  m_highlight = false;
+  std::unique_ptr<Cell> cell;
 
-    wxStringInputStream xmlStream(s);
+  std::unique_ptr<wxXmlNode> doc = ParseXml(data, length, false, false);
+  if (doc)
+    cell = ParseTag(doc->GetChildren());
+  return cell;
+}
 
-    {
-      wxLogNull suppressErrorMessages;
-#if wxCHECK_VERSION(3, 3, 0)
-      xml.Load(xmlStream, wxXMLDOC_KEEP_WHITESPACE_NODES);
-#else
-      xml.Load(xmlStream, wxS("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES);
-#endif
+/*! Converts the UTF-8 string the XmlPullParser returned to a wxString
+
+  Maxima might send us invalid UTF-8 => in this case we fall back to
+  interpreting the data as 8-bit data, so nothing is lost.
+*/
+static wxString XmlString(const std::string &utf8) {
+  if (utf8.empty())
+    return wxEmptyString;
+  wxString retval = wxString::FromUTF8(utf8.data(), utf8.size());
+  if (retval.IsEmpty())
+    retval = wxString::From8BitData(utf8.data(), utf8.size());
+  return retval;
+}
+
+std::unique_ptr<wxXmlNode> MathParser::ParseXml(const char *data, std::size_t length,
+                                                bool scrubControlChars,
+                                                bool keepWhitespace) {
+  XmlPullParser parser(data, length, scrubControlChars);
+  std::unique_ptr<wxXmlNode> root;
+  // The element we currently add nodes to, and the last node we added to it.
+  // wxXmlNode::AddChild() would walk through all siblings for every node we
+  // add, which would make parsing long lists O(n^2).
+  wxXmlNode *parent = NULL;
+  wxXmlNode *lastChild = NULL;
+  auto append = [&parent, &lastChild](wxXmlNode *node) {
+    node->SetParent(parent);
+    if (lastChild)
+      lastChild->SetNext(node);
+    else
+      parent->SetChildren(node);
+    lastChild = node;
+  };
+
+  for (;;) {
+    switch (parser.Next()) {
+    case XmlPullParser::START_TAG: {
+      wxXmlNode *node = new wxXmlNode(wxXML_ELEMENT_NODE, XmlString(parser.Name()));
+      for (const auto &attr : parser.Attributes())
+        node->AddAttribute(XmlString(attr.first), XmlString(attr.second));
+      if (parent)
+        append(node);
+      else
+        root.reset(node);
+      parent = node;
+      lastChild = NULL;
+      break;
+    }
+    case XmlPullParser::END_TAG:
+      lastChild = parent;
+      parent = parent->GetParent();
+      break;
+    case XmlPullParser::TEXT:
+      // wxXmlDocument drops whitespace-only text nodes unless it is told to
+      // keep them
+      if (keepWhitespace || !XmlPullParser::IsWhitespace(parser.Text()))
+        append(new wxXmlNode(wxXML_TEXT_NODE, wxS("text"), XmlString(parser.Text())));
+      break;
+    case XmlPullParser::CDATA:
+      append(new wxXmlNode(wxXML_CDATA_SECTION_NODE, wxS("cdata"),
+                           XmlString(parser.Text())));
+      break;
+    case XmlPullParser::ERROR:
+      return nullptr;
+    case XmlPullParser::END_OF_DATA:
+      return root;
     }
+  }
+}
 
-    wxXmlNode *doc = xml.GetRoot();
+std::unique_ptr<Cell> MathParser::ParseLongLine(const char *data, std::size_t length,
+                                                CellType style) {
+  m_ParserStyle = style;
+  m_FracStyle = FracCell::FC_NORMAL;
+  m_highlight = false;
 
-    if (doc != NULL)
-      cell = ParseTag(doc->GetChildren());
-  } else {
-    cell = std::make_unique<TextCell>(m_group, m_configuration,
-                                      _("(Invalid XML from maxima)"),
-                                      TS_WARNING);
+  OutputChunker chunker;
+  if (!chunker.Split(data, length)) {
+    auto cell = std::make_unique<TextCell>(m_group, m_configuration,
+                                           _("(Invalid XML from maxima)"),
+                                           TS_WARNING);
     cell->ForceBreakLine(true);
+    return cell;
   }
-  return cell;
+
+  CellListBuilder<> tree;
+  // The labels are short => We can convert them to cells right away.
+  for (const auto &label : chunker.GetLabels()) {
+    std::unique_ptr<wxXmlNode> doc =
+      ParseXml(data + label.start, label.end - label.start, false, false);
+    if (doc)
+      tree.Append(ParseTag(doc.get(), false));
+  }
+
+  auto &chunks = chunker.GetChunks();
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+    auto cell = std::make_unique<OutputChunkCell>(m_group, m_configuration,
+                                                  std::move(chunks[i].xml),
+                                                  chunks[i].displayedChars,
+                                                  chunker.GetContainer(),
+                                                  i == 0, i + 1 == chunks.size());
+    cell->SetType(m_ParserStyle);
+    if (i > 0)
+      cell->ForceBreakLine(true);
+    tree.Append(std::move(cell));
+  }
+  return tree;
 }
 
 std::unique_ptr<Cell> MathParser::ParseLine(const wxXmlDocument &xml, CellType style) {
@@ -1310,7 +1421,6 @@ std::unique_ptr<Cell> MathParser::ParseLine(const wxXmlDocument &xml, CellType s
   return cell;
 }
 
-wxRegEx MathParser::m_graphRegex(wxS("[[:cntrl:]]"));
 MathParser::MathCellFunctionHash MathParser::m_innerTags;
 MathParser::GroupCellFunctionHash MathParser::m_groupTags;
 wxString MathParser::m_unknownXMLTagToolTip;
@@ -42,7 +42,9 @@
 #include "cells/EditorCell.h"
 #include "cells/FracCell.h"
 #include "cells/GroupCell.h"
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 /*! This class handles parsing the xml representation of a cell tree.
 
@@ -71,6 +73,24 @@ public:
    */
   std::unique_ptr<Cell> ParseLine(wxString s, CellType style = MC_TYPE_DEFAULT);
   std::unique_ptr<Cell> ParseLine(const wxXmlDocument &xml, CellType style = MC_TYPE_DEFAULT);
+  /*! Parse the UTF-8 XML maxima has sent us
+
+    Unlike the wxString version this doesn't limit the length of the data, and
+    whitespace between the tags is dropped, as wxXmlDocument would do by default.
+  */
+  std::unique_ptr<Cell> ParseLine(const char *data, std::size_t length,
+                                  CellType style = MC_TYPE_DEFAULT);
+  /*! Parse a very long output from maxima lazily
+
+    The labels are converted to cells right away. The elements of the output
+    (or, if the output is a single list or matrix, its elements or rows) are
+    grouped into OutputChunkCells that are converted to cells only when they
+    are scrolled into view.
+
+    \returns The label and the chunks, or a warning if the XML isn't well-formed.
+  */
+  std::unique_ptr<Cell> ParseLongLine(const char *data, std::size_t length,
+                                      CellType style = MC_TYPE_DEFAULT);
   /***
    * Parse the node and return the corresponding tag.
    */
@@ -252,10 +272,25 @@ private:
   //! Parse an Matrix cell tag.
   std::unique_ptr<Cell> ParseMtdTag(wxXmlNode *node);
   // @}
+
+  /*! Converts UTF-8 XML to a tree of wxXmlNodes, without the detour via wxXmlDocument
+
+    This still builds a DOM of the whole XML: The tag handlers in m_innerTags
+    walk wxXmlNode trees, so the tokens of the XmlPullParser aren't dispatched
+    to them directly. What is saved is the regex pass, the conversion of the
+    data for expat and wxXmlDocument's sibling lookups.
+
+    \param data The UTF-8 data
+    \param length The number of bytes in data
+    \param scrubControlChars true = replace control characters by U+FFFD
+    \param keepWhitespace false = drop whitespace-only text nodes
+    \returns the root element or nullptr, if the XML isn't well-formed.
+  */
+  static std::unique_ptr<wxXmlNode> ParseXml(const char *data, std::size_t length,
+                                             bool scrubControlChars, bool keepWhitespace);
+
   //! The last user defined label
   wxString m_userDefinedLabel;
-  //! A RegEx that catches the last graphics placeholder
-  static wxRegEx m_graphRegex;
 
   CellType m_ParserStyle = MC_TYPE_DEFAULT;
   FracCell::FracType m_FracStyle;
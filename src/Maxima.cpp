@@ -22,14 +22,17 @@
 //
 //  SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 #include "Maxima.h"
+#include "MathParser.h"
+#include "OutputChunker.h"
 #include <wx/xml/xml.h>
 #include <iostream>
 #include <wx/app.h>
 #include <wx/debug.h>
 #include <wx/sstream.h>
-#include <wx/tokenzr.h>
 
 //! The time, in ms, we'll wait for an end of string to arrive from maxima after
 //! the input was first read.
@@ -44,30 +47,22 @@ static constexpr int INPUT_RESTART_PERIOD = -1;
 
 wxDEFINE_EVENT(EVT_MAXIMA, wxThreadEvent);
 
-// Attention: 'wxS("\n"), wxConvUTF8' should be the default and one might think, one can omit these
-// parameters, but don't do it. wxWidgets (at least older versions, which are still used in Linux
-// distributions) had a bug, so that without these parameters one get wrong characters.
-// See: https://github.com/wxWidgets/wxWidgets/issues/14720#issuecomment-1010968576
 Maxima::Maxima(wxSocketBase *socket, Configuration *config) :
   m_configuration(config),
   m_socket(socket),
   m_socketInput(*m_socket),
-  m_textInput(m_socketInput, wxS("\n"), wxConvUTF8),
-  m_abortParserThread(false)
+  m_mathParser(std::make_unique<MathParser>(config))
 {
-  if(m_knownTags.empty())
-    {
-      m_knownTags[wxS("PROMPT")] = XML_PROMPT;
-      m_knownTags[wxS("suppressOutput")] = XML_SUPPRESSOUTPUT;
-      m_knownTags[wxS("wxxml-symbols")] = XML_WXXMLSYMBOLS;
-      m_knownTags[wxS("variables")] = XML_VARIABLES;
-      m_knownTags[wxS("watch_variables_add")] = XML_WATCH_VARIABLES_ADD;
-      m_knownTags[wxS("statusbar")] = XML_STATUSBAR;
-      m_knownTags[wxS("html-manual-keywords")] = XML_HTML_MANUAL_KEYWORDS;
-      m_knownTags[wxS("mth")] = XML_MATHS;
-      m_knownTags[wxS("math")] = XML_MATHS;
-      m_knownTags[wxS("wxxml-key")] = XML_WXXML_KEY;
-    }
+  m_tagScanner.AddTag("PROMPT", XML_PROMPT);
+  m_tagScanner.AddTag("suppressOutput", XML_SUPPRESSOUTPUT);
+  m_tagScanner.AddTag("wxxml-symbols", XML_WXXMLSYMBOLS);
+  m_tagScanner.AddTag("variables", XML_VARIABLES);
+  m_tagScanner.AddTag("watch_variables_add", XML_WATCH_VARIABLES_ADD);
+  m_tagScanner.AddTag("statusbar", XML_STATUSBAR);
+  m_tagScanner.AddTag("html-manual-keywords", XML_HTML_MANUAL_KEYWORDS);
+  m_tagScanner.AddTag("mth", XML_MATHS);
+  m_tagScanner.AddTag("math", XML_MATHS);
+  m_tagScanner.AddTag("wxxml-key", XML_WXXML_KEY);
   wxASSERT(socket);
   Bind(wxEVT_TIMER, wxTimerEventHandler(Maxima::TimerEvent), this);
   Bind(wxEVT_SOCKET, wxSocketEventHandler(Maxima::SocketEvent), this);
@@ -85,15 +80,24 @@ Maxima::Maxima(wxSocketBase *socket, Configuration *config) :
   // came.
   if (INPUT_RESTART_PERIOD > 0)
     m_readIdleTimer.Start(INPUT_RESTART_PERIOD);
+
+  // The parser lives as long as the connection does and keeps its position
+  // in the data between the chunks we read from the socket.
+  if(m_configuration->UseThreads())
+    m_parserTask = jthread(&Maxima::ParserThread, this);
 }
 
 Maxima::~Maxima() {
   Disconnect(wxEVT_TIMER);
   Disconnect(wxEVT_SOCKET);
   Disconnect(EVT_MAXIMA);
-  m_abortParserThread = true;
 
   // Exit all threads before the program ends
+  {
+    std::lock_guard<std::mutex> lock(m_parserWakeupMutex);
+    m_exitParserThread = true;
+  }
+  m_parserWakeup.notify_one();
   if(m_parserTask.joinable())
     m_parserTask.join();
   if(IsConnected())
@@ -110,11 +114,16 @@ Maxima::~Maxima() {
       wxCharBuffer buf = closeCommand.ToUTF8();
       m_socket->Write(buf.data(), buf.length());
     }
-  std::lock_guard<std::mutex> lock(m_socketInputMutex);
   m_socket->Close();
   wxEvtHandler::DeletePendingEvents();
 }
 
+void Maxima::SetUserLabel(const wxString &label, long prompt) {
+  const std::lock_guard<std::mutex> lock(m_userLabelMutex);
+  m_userLabel = label;
+  m_userLabelPrompt = prompt;
+}
+
 bool Maxima::Write(const void *buffer, std::size_t length) {
   if(!buffer)
     return false;
@@ -168,190 +177,167 @@ void Maxima::ReadSocket() {
     event->SetInt(READ_PENDING);
     QueueEvent(event);
   }
-  m_abortParserThread = true;
-  wxString line;
-  wxString rawData;
-  wxUniChar ch;
-  wxUniChar lastch = '\0';
   const bool collectRawData = m_xmlInspector || GetPipeToStdErr();
-  if(collectRawData)
-    rawData.Alloc(1000000);
 
+  // Reading the socket is cheap: Everything else is done by the parser.
+  std::size_t bytesRead;
+  do
+    {
+      m_readBuffer.resize(SocketInputBuffer::BlockSize);
+      m_socketInput.Read(m_readBuffer.data(), m_readBuffer.size());
+      bytesRead = m_socketInput.LastRead();
+      if(bytesRead == 0)
+        break;
+      if(collectRawData)
+        m_rawData.append(m_readBuffer.data(), bytesRead);
+      // The chunk only gets the memory the data needs
+      m_socketChunks.Push(std::vector<char>(m_readBuffer.data(),
+                                            m_readBuffer.data() + bytesRead));
+    }  while (bytesRead > 0);
 
-  // We want to modify m_socketInputData, which is the variable we share with the
-  // background thread. In order not to modify it while the background thread
-  // accesses it we wait for the backgroundthread to finish.
-  if(m_parserTask.joinable())
-    m_parserTask.join();
-  
-  {
-    std::lock_guard<std::mutex> lock(m_socketInputMutex);
-    // Try to avoid frequent (slow) reallocs on appending to the string
-    m_socketInputData.Alloc(m_socketInputData.Length() + 1000000);
-    
-    do
-      {
-        ch = m_textInput.GetChar();
-        if(ch == wxS('\0'))
-          continue;
-        if(collectRawData)
-          rawData.Append(ch);
-        if(ch == wxS('\r'))
-          {
-            if(lastch != wxS('\n'))
-              m_socketInputData.Append(wxS('\n'));
-            lastch = ch;
-            continue;
-          }
-        m_socketInputData.Append(ch);
-        lastch = ch;
-      }  while (m_socket->LastReadCount() > 0);
+  if(collectRawData)
+    {
+      std::size_t completeLength =
+        SocketInputBuffer::CompleteUTF8Length(m_rawData.data(), m_rawData.length());
+      wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
+      event->SetInt(STRING_FOR_XMLINSPECTOR);
+      event->SetString(DecodeUTF8(m_rawData.data(), completeLength));
+      QueueEvent(event);
+      m_rawData.erase(0, completeLength);
+    }
 
-    if(collectRawData)
+  if(m_parserTask.joinable())
+    {
+      // Taking the mutex makes sure the parser cannot miss the notification
+      // between testing for new data and going to sleep.
       {
-        wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
-        event->SetInt(STRING_FOR_XMLINSPECTOR);
-        event->SetString(rawData);
-        QueueEvent(event);
+        std::lock_guard<std::mutex> lock(m_parserWakeupMutex);
+        m_newChunksAvailable = true;
       }
-  }
-  // The string we have received now is broken into tags by a background task before sending
-  // it to wxMaxima. As the main task no more accesses the string while that thread is running
-  // we don't need any locks or similar for that.
-  m_abortParserThread = false;
-  if(m_configuration->UseThreads())
-    m_parserTask = jthread(&Maxima::SendToWxMaxima, this);
+      m_parserWakeup.notify_one();
+    }
   else
     SendToWxMaxima();
 }
 
-void Maxima::SendToWxMaxima()
+void Maxima::ParserThread()
 {
-  std::lock_guard<std::mutex> lock(m_socketInputMutex);
-  // This thread shares m_socketInputData with the main thread. But it accesses
-  // that variable only when the main thread doesn't and vice versa, therefore
-  // that doesn't cause a race condition
-  if(m_socketInputData.IsEmpty())
-    return;
-  size_t size_before;
-  do{
-    size_before = m_socketInputData.Length();
-    wxString dataToSend;
-    wxString rest;
-    std::unordered_map<wxString, EventCause, wxStringHash>::const_iterator tag =
-      m_knownTags.end();
-    wxString::const_iterator it;
-    for(it = m_socketInputData.begin(); it < m_socketInputData.end(); ++it)
+  for(;;)
+    {
       {
-        if(*it == wxS('<'))
-          {
-            // Extract the starting tag, if this is one.
-            wxString::const_iterator it2 = it;
-            std::size_t i = 0;
-            wxString tagStart;
-            while((i < 20) && (it2 < m_socketInputData.end()))
-              {
-                tagStart += *it2;
-                i++; ++it2;
-              }
-            for(tag = m_knownTags.begin(); tag != m_knownTags.end(); ++tag)
-              {
-                wxString tagstartname = wxS("<") + tag->first + wxS(">");
-                if(tagStart.StartsWith(tagstartname))
-                  break;
-              }
-            if(tag != m_knownTags.end())
-              break;
-            if(m_abortParserThread)
-              return;
-          }
-        dataToSend += *it;
-        if(*it == wxS('\n'))
-          {
-            wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
-            event->SetInt(READ_MISC_TEXT);
-            event->SetString(dataToSend);
-            QueueEvent(event);
-            dataToSend.Clear();
-          }
+        std::unique_lock<std::mutex> lock(m_parserWakeupMutex);
+        m_parserWakeup.wait(lock, [this]{return m_newChunksAvailable || m_exitParserThread;});
+        if(m_exitParserThread)
+          return;
+        m_newChunksAvailable = false;
       }
-    if(!dataToSend.IsEmpty())
-      {
-        wxStringTokenizer lines(dataToSend, wxS("\n"), wxTOKEN_RET_EMPTY_ALL);
-        while (lines.HasMoreTokens()) {
-          wxString line = lines.GetNextToken();
-          if(lines.HasMoreTokens())
-            line += wxS("\n");
+      SendToWxMaxima();
+    }
+}
+
+wxString Maxima::DecodeUTF8(const char *data, std::size_t length)
+{
+  wxString retval = wxString::FromUTF8(data, length);
+  // wxString::FromUTF8 returns an empty string if the data isn't valid UTF-8.
+  // Let's not lose the data in that case.
+  if(retval.IsEmpty() && (length > 0))
+    retval = wxString::From8BitData(data, length);
+  return retval;
+}
+
+bool Maxima::Contains(const char *data, std::size_t length, const char *what)
+{
+  const char *whatEnd = what + std::strlen(what);
+  return std::search(data, data + length, what, whatEnd) != data + length;
+}
+
+void Maxima::SendToWxMaxima()
+{
+  // m_socketInputBuffer and m_tagScanner are only accessed by the parser => no
+  // locking is needed. As m_tagScanner remembers how far it got in the data
+  // no byte is scanned twice, even if the data arrives in many small chunks.
+  std::vector<char> chunk;
+  while(m_socketChunks.Pop(chunk))
+    m_socketInputBuffer.Append(chunk.data(), chunk.size());
+
+  for(;;)
+    {
+      // A multi-byte character that hasn't fully arrived yet cannot be decoded
+      const char *data = m_socketInputBuffer.Data();
+      MaximaTagScanner::Item item =
+        m_tagScanner.Next(data, m_socketInputBuffer.CompleteLength());
+      if(item.type == MaximaTagScanner::NONE)
+        return;
+
+      if(item.type == MaximaTagScanner::TEXT)
+        {
           wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
           event->SetInt(READ_MISC_TEXT);
-          event->SetString(line);
+          event->SetString(DecodeUTF8(data, item.length));
           QueueEvent(event);
         }
-      }
-    for(; it < m_socketInputData.end(); ++it)
-        rest += *it;
-    m_socketInputData = rest;
-    if(m_abortParserThread)
-      return;
-    
-    if(tag != m_knownTags.end())
-      {
-        // Send the tag we found, but only once it is closed
-        wxString tagEndName = wxS("</") + tag->first + wxS(">");
-        auto end = m_socketInputData.Find(tagEndName);
-        if(end != wxNOT_FOUND)
-          {
-            long charsInTag = tag->first.Length() + 3 + end;
-            dataToSend.Clear();
-            rest.Clear();
-            for(const auto &i : m_socketInputData)
-              {
-                if(charsInTag > 0)
-                  {
-                    --charsInTag;
-                    dataToSend += i;
-                  }
-                else
-                  {
-                    if((charsInTag < 0) || (i != '\n'))
-                      rest += i;
-                    if(charsInTag == 0)
-                      --charsInTag;
-                  }
-                
-              }
 
-            wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
-              event->SetInt(tag->second);
-              // XML_PROMPT contains fake XML and XML_SUPPRESSOUTPUT contains any kind of
-              // text including XML. XML_MATHS should support adding real maths, but
-              // currently still doesn't
-              if((tag->second != XML_PROMPT) && (tag->second != XML_SUPPRESSOUTPUT))
-              {
-                if((tag->second == XML_MATHS) &&
-                   ((m_configuration->ShowLength_Bytes() != 0) && (dataToSend.Length() > m_configuration->ShowLength_Bytes())
-                    ))
-                  {
-                    event->SetInt(XML_TOOLONGMATHS);
-                  }
-                else
-                  {
-                    event->SetInt(tag->second);
-                    wxXmlDocument xmldoc;
-                    wxStringInputStream xmlStream(dataToSend);
-                    wxLogNull suppressErrorDialogs;
-                    xmldoc.Load(xmlStream);
-                    event->SetPayload(xmldoc);
-                  }
-              }
-            else
-              event->SetString(dataToSend);
-            QueueEvent(event);
-            m_socketInputData = rest;
-          }
-      }
-  } while ((m_socketInputData.Length() != size_before) && (!m_socketInputData.IsEmpty()));
+      if(item.type == MaximaTagScanner::TAG)
+        {
+          wxThreadEvent *event = new wxThreadEvent(EVT_MAXIMA);
+          event->SetInt(item.tag);
+          // Tells the main thread which prompt a command it sends answers
+          if(item.tag == XML_PROMPT)
+            event->SetExtraLong(++m_promptsParsed);
+          // XML_PROMPT contains fake XML and XML_SUPPRESSOUTPUT contains any kind of
+          // text including XML. XML_MATHS should support adding real maths, but
+          // currently still doesn't
+          if((item.tag != XML_PROMPT) && (item.tag != XML_SUPPRESSOUTPUT))
+            {
+              if(item.tag == XML_MATHS)
+                {
+                  const std::lock_guard<std::mutex> lock(m_userLabelMutex);
+                  if(m_userLabelPrompt == m_promptsParsed)
+                    m_mathParser->SetUserLabel(m_userLabel);
+                  else
+                    m_mathParser->SetUserLabel(wxEmptyString);
+                }
+              if((item.tag == XML_MATHS) &&
+                 ((item.length > OutputChunker::MaxUnsplitBytes) ||
+                  ((m_configuration->ShowLength_Bytes() != 0) &&
+                   (item.length > m_configuration->ShowLength_Bytes()))))
+                {
+                  // Converting all of this to cells at once would take ages
+                  // => only the parts that are scrolled into view are.
+                  ParsedCells cells = std::make_shared<std::unique_ptr<Cell>>(
+                    m_mathParser->ParseLongLine(data, item.length, MC_TYPE_DEFAULT));
+                  event->SetInt(XML_MATHS_PARSED);
+                  event->SetPayload(cells);
+                }
+              // Images and animations need timers and the worksheet's
+              // file name bookkeeping => only the main thread can create them.
+              else if((item.tag == XML_MATHS) &&
+                      !Contains(data, item.length, "<img") &&
+                      !Contains(data, item.length, "<slide"))
+                {
+                  // The parser reads the bytes directly => neither the data
+                  // nor a wxXmlDocument has to be converted to wxStrings.
+                  ParsedCells cells = std::make_shared<std::unique_ptr<Cell>>(
+                    m_mathParser->ParseLine(data, item.length, MC_TYPE_DEFAULT));
+                  event->SetInt(XML_MATHS_PARSED);
+                  event->SetPayload(cells);
+                }
+              else
+                {
+                  wxXmlDocument xmldoc;
+                  wxStringInputStream xmlStream(DecodeUTF8(data, item.length));
+                  wxLogNull suppressErrorDialogs;
+                  xmldoc.Load(xmlStream);
+                  event->SetPayload(xmldoc);
+                }
+            }
+          else
+            event->SetString(DecodeUTF8(data, item.length));
+          QueueEvent(event);
+        }
+      m_socketInputBuffer.Consume(item.length);
+      m_tagScanner.Consumed(item.length);
+    }
 }
 
-std::unordered_map<wxString, Maxima::EventCause, wxStringHash> Maxima::m_knownTags;
 bool Maxima::m_pipeToStderr = false;
@@ -33,16 +33,24 @@
 #include <wx/buffer.h>
 #include <wx/event.h>
 #include <wx/sckstrm.h>
-#include <wx/txtstrm.h>
 #include <wx/socket.h>
 #include <wx/string.h>
 #include <wx/timer.h>
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <string>
+#include <vector>
 #include "Configuration.h"
+#include "MaximaTagScanner.h"
+#include "SocketInputBuffer.h"
+#include "SpscQueue.h"
 #include "Version.h"
+#include "cells/Cell.h"
+
+class MathParser;
 
 /*! Interface to the Maxima process
  *
@@ -54,10 +62,10 @@
  * decouple the I/O from the front-end. In the future, more of this class
  * could run on a worker thread perhaps.
  *
- * What it already does do is that on incoming data it creates a worker
- * thread that splits the incoming data into known XML tags maxima sends
- * and misc text and sends each of these items in a separate
- * EVT_MAXIMA to the wxMaxima main class
+ * What it already does do is that it passes the incoming data to a worker
+ * thread that splits it into known XML tags maxima sends and misc text and
+ * sends each of these items in a separate EVT_MAXIMA to the wxMaxima main
+ * class
  */
 class Maxima : public wxEvtHandler
 {
@@ -88,6 +96,19 @@ public:
    */
   bool Write(const void *buffer, std::size_t length);
 
+  /*! Sets the label the user has assigned to the command that is sent next
+
+    The parser thread uses it for the output labels of the command's output that
+    don't specify a user-defined label of their own. Called by the main thread.
+
+    \param label The user-defined label
+    \param prompt The GetExtraLong() of the XML_PROMPT event the command
+    answers: Only the maths maxima sends between that prompt and the next one
+    gets the label. The commands wxMaxima sends in the background therefore
+    cannot take it from the command's output.
+  */
+  void SetUserLabel(const wxString &label, long prompt);
+
   //! Read whatever data is in the socket. This is normally handled by the event handler,
   //! but can be called manually to poll for data. Ideally, this should be private.
   void ReadSocket();
@@ -109,7 +130,8 @@ public:
     XML_STATUSBAR,
     XML_HTML_MANUAL_KEYWORDS,
     XML_MATHS,
-    XML_TOOLONGMATHS,
+    //! Maths the parser thread has already converted to cells. The payload is a ParsedCells.
+    XML_MATHS_PARSED,
     XML_WXXML_KEY,
     //! Maxima has disconnected (possibly because the process had died).
     DISCONNECTED,
@@ -119,66 +141,100 @@ public:
     WRITE_ERROR,
     STRING_FOR_XMLINSPECTOR,
   };
+  /*! The payload of a XML_MATHS_PARSED event
+
+    Event payloads need to be copyable, which a std::unique_ptr isn't. The
+    receiver of the event is expected to take ownership of the cells.
+  */
+  using ParsedCells = std::shared_ptr<std::unique_ptr<Cell>>;
+
   void XmlInspectorActive(bool active){m_xmlInspector = active;}
 private:
   //! If this is set to true by XmlInspectorActive we send all data we get to the XML inspector
   bool m_xmlInspector = false;
   //! The configuration of our wxMaxima process
   Configuration *m_configuration;
-  //! The thread handler for SendDataTowxMaxima, the thread that parses the data from maxima.
+  //! The thread that runs ParserThread(), if we use threads.
   jthread m_parserTask;
+  //! The chunks of data the main thread has read from the socket, but the parser hasn't seen, yet
+  SpscQueue<std::vector<char>> m_socketChunks;
+  //! Wakes up the parser thread when there is new data or when it is time to exit
+  std::condition_variable m_parserWakeup;
+  //! The mutex that protects the flags m_parserWakeup signals
+  std::mutex m_parserWakeupMutex;
+  //! true = m_socketChunks has received data since the parser thread last looked
+  bool m_newChunksAvailable = false;
+  //! true = the parser thread is to exit
+  bool m_exitParserThread = false;
   //! Handles events on the open client socket
   void SocketEvent(wxSocketEvent &event);
   //! Handles timer events
   void TimerEvent(wxTimerEvent &event);
   std::unique_ptr<wxSocketBase> m_socket;
-  std::mutex m_socketInputMutex; 
   //! The data we receive from Maxima
   wxSocketInputStream m_socketInput;
-  /*! Splits data we receive from Maxima to UTF-8
+  //! The buffer the main thread reads the socket into, reused for every read
+  std::vector<char> m_readBuffer;
+  /*! The data we received from Maxima, but haven't sent to wxMaxima, yet
 
-    We cannot create this as a local variable in the function that interprets
-    data from Maxima as that data might end in the middle of an Unicode
-    codepoint (which means the next call to SocketEvent() starts in the middle
-    of a Unicode codepoint, as well). Both cases aren't handled well if we abandon
-    our TextInputStream inbetween and create a new one.
-   */
-  wxTextInputStream m_textInput;
+    Only accessed by the parser: The main thread passes the data it reads
+    via m_socketChunks.
 
-  /*! The data we received from Maxima
+    The data is kept as UTF-8 and is only converted to wxStrings once it has
+    been split into the items we send to wxMaxima. As the data might end in
+    the middle of an Unicode codepoint the bytes of an incomplete codepoint
+    stay in the buffer until the rest of it has arrived.
+   */
+  SocketInputBuffer m_socketInputBuffer;
+  //! Splits m_socketInputBuffer into the tags and text we send to wxMaxima
+  MaximaTagScanner m_tagScanner;
+  /*! Converts the maths maxima sends to cells in the parser thread
 
-    Used by the main thread and by the thread SendDataTowxMaxima() runs in.
-    We still don't need a mutex to protect it, though, as the main thread
-    waits for the other to exit before writing new data to this variable.
+    Only accessed by the parser. The cells it creates don't belong to any
+    group cell, yet: the receiver of the event has to call SetGroupList().
    */
-  wxString m_socketInputData;
+  std::unique_ptr<MathParser> m_mathParser;
+  //! The user-defined label of the command maxima is working on, set by the main thread
+  wxString m_userLabel;
+  //! The number of the prompt m_userLabel is meant for
+  long m_userLabelPrompt = -1;
+  //! The mutex that protects m_userLabel and m_userLabelPrompt
+  std::mutex m_userLabelMutex;
+  //! The number of prompts the parser thread has seen. Only accessed by the parser.
+  long m_promptsParsed = 0;
+  //! The raw data for the XML inspector that doesn't end in a complete UTF-8 sequence, yet
+  std::string m_rawData;
+
+  //! Converts UTF-8 data to a wxString
+  static wxString DecodeUTF8(const char *data, std::size_t length);
+  //! Does data contain the string what?
+  static bool Contains(const char *data, std::size_t length, const char *what);
 
   //! true = Maxima still has to send us its first prompt
   bool m_firstPrompt = true;
   //! true = copy all data we receive to StdErr.
   static bool m_pipeToStderr;
 
-  /*! Search m_socketInputData for complete commands and send them to wxMaxima
+  /*! Search m_socketInputBuffer for complete commands and send them to wxMaxima
 
-    This is a restartable process that is meant to be run as a background thread
-    that interprets the data maxima has sent us and sends it to wxMaxima one
-    item at a time.
+    Appends the chunks that are waiting in m_socketChunks to m_socketInputBuffer
+    and sends every complete item it finds there to wxMaxima, one item at a time.
 
-    Items that this task recognizes:
-     - All XML tags registered in m_knownTags are sent as a whole before
-       sending them to wxMaxima and in most cases this background task even
+    Items that this function recognizes:
+     - All XML tags registered in m_tagScanner are sent as a whole before
+       sending them to wxMaxima and in most cases this function even
        parses the XML data beforehand.
      - All text between such commands is left as it is and sent to wxMaxima
        as a string.
      .
 
-    If m_abortParserThread = true this process exits as fast as possible in
-    order to allow the main thread to append data to m_socketInputData, as fast
-    as possible: If maxima hasn't finished sending data it is highly probable
-    that m_socketInputData will contain the beginning of an XML tag, but not
-    its end and therefore cannot do anything, anyway.
+    Incomplete items stay in the buffer, and the work that has been done on
+    them isn't lost: m_tagScanner resumes where it stopped once new data has
+    arrived.
    */
   void SendToWxMaxima();
+  //! The parser thread: Waits for new data and calls SendToWxMaxima() until we exit
+  void ParserThread();
 
   /*! A timer that triggers reading data from maxima
 
@@ -189,14 +245,6 @@ private:
     actual data has arrived until then.
   */
   wxTimer m_readIdleTimer{this};
-  //! The names of maxima tags we want to send to wxMaxima in whole
-  static std::unordered_map<wxString, EventCause, wxStringHash> m_knownTags;
-  /*! True = abort SendToWxMaxima() thread as fast as possible since new data has arrived.
-
-    If new data has arrived the probability is high that m_socketInputData does contain
-    the start of a command, but not its end.
-   */
-  std::atomic_bool m_abortParserThread;
 };
 
 wxDECLARE_EVENT(EVT_MAXIMA, wxThreadEvent);
@@ -532,19 +532,24 @@ void MaximaManual::LoadHelpFileAnchors(const wxString &docdir,
   }
   if (!LoadManualAnchorsFromCache()) {
     if (!m_maximaHtmlDir.IsEmpty()) {
-      if (m_helpfileanchorsThread.joinable()) {
+      if (!m_helpfileanchorsTask.IsDone()) {
         wxLogMessage(_("Waiting for the Manual anchors background task."));
-        m_helpfileanchorsThread.join();
+        m_helpfileanchorsTask.Wait();
       }
       wxLogMessage(_("Background task that compiles the Manual anchors scheduled."));
       m_abortBackgroundTask = false;
       if(m_configuration->UseThreads())
-        m_helpfileanchorsThread = jthread(&MaximaManual::CompileHelpFileAnchors,
-                                          this,
-                                          m_maximaHtmlDir,
-                                          m_maximaVersion,
-                                          Dirstructure::AnchorsCacheFile()
-                                          );
+        {
+          wxString maximaHtmlDir = m_maximaHtmlDir;
+          wxString maximaVersion = m_maximaVersion;
+          wxString anchorsCacheFile = Dirstructure::AnchorsCacheFile();
+          m_helpfileanchorsTask =
+            TaskPool::Get().Submit(TaskPool::MANUAL, TaskPool::LOW,
+                                   [this, maximaHtmlDir, maximaVersion, anchorsCacheFile]() {
+                                     CompileHelpFileAnchors(maximaHtmlDir, maximaVersion,
+                                                            anchorsCacheFile);
+                                   });
+        }
       else
         CompileHelpFileAnchors(
                                m_maximaHtmlDir,
@@ -559,10 +564,11 @@ void MaximaManual::LoadHelpFileAnchors(const wxString &docdir,
 }
 
 MaximaManual::~MaximaManual() {
-  if(m_helpfileanchorsThread.joinable())
+  if(!m_helpfileanchorsTask.IsDone())
     {
       m_abortBackgroundTask = true;
-      wxLogMessage(_("Waiting for the thread that parses the maxima manual to finish"));
-      m_helpfileanchorsThread.join();
+      m_helpfileanchorsTask.Cancel();
+      wxLogMessage(_("Waiting for the task that parses the maxima manual to finish"));
+      m_helpfileanchorsTask.Wait();
     }
 }
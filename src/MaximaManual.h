@@ -43,6 +43,7 @@
 #include <wx/filename.h>
 #include "precomp.h"
 #include "Configuration.h"
+#include "TaskPool.h"
 #include "Version.h"
 #include <unordered_map>
 
@@ -117,7 +118,7 @@ private:
   //    m_configuration.MaximaShareDir(dir);
 
   //! The thread the help file anchors are compiled in
-  jthread m_helpfileanchorsThread;
+  TaskPool::Task m_helpfileanchorsTask;
   std::mutex m_helpFileAnchorsLock;
   //! The configuration storage
   Configuration *m_configuration = NULL;
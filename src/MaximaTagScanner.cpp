@@ -0,0 +1,201 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class MaximaTagScanner.
+*/
+
+#include "MaximaTagScanner.h"
+#include <algorithm>
+#include <cstring>
+
+MaximaTagScanner::MaximaTagScanner() :
+  m_trie(1)
+{
+}
+
+void MaximaTagScanner::AddTag(const std::string &name, int id)
+{
+  int slot = static_cast<int>(m_tagIds.size());
+  m_tagIds.push_back(id);
+  m_closingTags.push_back("</" + name + ">");
+
+  std::size_t node = 0;
+  for(char ch : name + ">")
+    {
+      std::size_t next = 0;
+      for(const auto &child : m_trie[node].children)
+        if(child.first == ch)
+          next = child.second;
+      if(next == 0)
+        {
+          next = m_trie.size();
+          m_trie[node].children.push_back({ch, next});
+          m_trie.emplace_back();
+        }
+      node = next;
+    }
+  m_trie[node].slot = slot;
+}
+
+MaximaTagScanner::MatchResult MaximaTagScanner::MatchOpeningTag(
+  const char *data, std::size_t length, std::size_t pos,
+  int &slot, std::size_t &tagLength) const
+{
+  std::size_t node = 0;
+  for(std::size_t i = pos + 1; i < length; i++)
+    {
+      std::size_t next = 0;
+      for(const auto &child : m_trie[node].children)
+        if(child.first == data[i])
+          {
+            next = child.second;
+            break;
+          }
+      if(next == 0)
+        return NOMATCH;
+      node = next;
+      if(m_trie[node].slot >= 0)
+        {
+          slot = m_trie[node].slot;
+          tagLength = i + 1 - pos;
+          return MATCH;
+        }
+    }
+  return NEED_MORE_DATA;
+}
+
+MaximaTagScanner::Item MaximaTagScanner::Next(const char *data, std::size_t length)
+{
+  Item item;
+  if(length == 0)
+    return item;
+
+  if(m_skipNewline)
+    {
+      m_skipNewline = false;
+      if(data[0] == '\n')
+        {
+          item.type = SKIP;
+          item.length = 1;
+          return item;
+        }
+    }
+
+  if(m_openTag < 0)
+    {
+      std::size_t pos = m_scanPos;
+      while(pos < length)
+        {
+          const char ch = data[pos];
+          if(ch == '\n')
+            {
+              item.type = TEXT;
+              item.length = pos + 1;
+              return item;
+            }
+          if(ch == '<')
+            {
+              int slot = -1;
+              std::size_t tagLength = 0;
+              MatchResult result = MatchOpeningTag(data, length, pos, slot, tagLength);
+              if(result == MATCH)
+                {
+                  m_openTag = slot;
+                  m_closeSearchPos = pos + tagLength;
+                  m_scanPos = pos;
+                  // Send the text before the tag first
+                  if(pos > 0)
+                    {
+                      item.type = TEXT;
+                      item.length = pos;
+                      return item;
+                    }
+                  break;
+                }
+              if(result == NEED_MORE_DATA)
+                {
+                  // This might be the start of a tag => we need to wait for more data
+                  // before we know what to do with it.
+                  m_scanPos = pos;
+                  if(pos > 0)
+                    {
+                      item.type = TEXT;
+                      item.length = pos;
+                    }
+                  return item;
+                }
+            }
+          ++pos;
+        }
+      if(m_openTag < 0)
+        {
+          // Text without a newline: Send it, nonetheless, as it might be a prompt.
+          item.type = TEXT;
+          item.length = length;
+          return item;
+        }
+    }
+
+  // We are inside a tag and are waiting for its end.
+  const std::string &closingTag = m_closingTags[m_openTag];
+  const std::size_t closingLength = closingTag.length();
+  std::size_t pos = m_closeSearchPos;
+  while(pos + closingLength <= length)
+    {
+      const void *found = std::memchr(data + pos, '<', length - pos);
+      if(found == NULL)
+        break;
+      pos = static_cast<const char *>(found) - data;
+      if(pos + closingLength > length)
+        break;
+      if(std::memcmp(data + pos, closingTag.data(), closingLength) == 0)
+        {
+          item.type = TAG;
+          item.tag = m_tagIds[m_openTag];
+          item.length = pos + closingLength;
+          m_openTag = -1;
+          m_scanPos = 0;
+          m_skipNewline = true;
+          return item;
+        }
+      ++pos;
+    }
+  // Not found: Next time we only need to look at the data that might contain
+  // the closing tag and that we haven't looked at, yet.
+  if(length >= closingLength)
+    m_closeSearchPos = std::max(m_closeSearchPos, length - closingLength + 1);
+  return item;
+}
+
+void MaximaTagScanner::Consumed(std::size_t length)
+{
+  m_scanPos = (m_scanPos > length) ? m_scanPos - length : 0;
+  m_closeSearchPos = (m_closeSearchPos > length) ? m_closeSearchPos - length : 0;
+}
+
+void MaximaTagScanner::Reset()
+{
+  m_scanPos = 0;
+  m_openTag = -1;
+  m_closeSearchPos = 0;
+  m_skipNewline = false;
+}
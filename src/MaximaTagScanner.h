@@ -0,0 +1,128 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_MAXIMATAGSCANNER_H
+#define WXMAXIMA_MAXIMATAGSCANNER_H
+
+/*! \file
+ *
+ * Declares the scanner that splits the data maxima sends into XML tags and text.
+ */
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*! Splits the data maxima sends us into known XML tags and lines of text
+
+  The data is scanned only once: The opening tags are recognized by a trie
+  that is walked byte by byte starting at each "<", and the scanner remembers
+  how far it has got, so that when more data arrives the scan is resumed
+  instead of restarted. The scanner doesn't own the data: it returns the
+  length of the next item at the start of the data it is given, and expects
+  to be told via Consumed() when the caller has dropped that item.
+
+  As all tags are ASCII the scanner can work on the raw UTF-8 bytes.
+*/
+class MaximaTagScanner
+{
+public:
+  enum ItemType
+  {
+    //! No complete item is available yet
+    NONE,
+    //! A line of text, or the text before an XML tag
+    TEXT,
+    //! A known XML tag, including its closing tag
+    TAG,
+    //! Bytes that belong to no item and just should be dropped
+    SKIP
+  };
+
+  //! An item the scanner has found at the start of the data
+  struct Item
+  {
+    ItemType type = NONE;
+    //! The id AddTag() assigned to the tag, if type == TAG
+    int tag = -1;
+    //! The number of bytes that belong to this item
+    std::size_t length = 0;
+  };
+
+  MaximaTagScanner();
+
+  //! Register a tag we want to receive in whole, as "<name>...</name>"
+  void AddTag(const std::string &name, int id);
+
+  /*! Find the next item at the start of data
+
+    \param data The data that hasn't been consumed, yet
+    \param length The number of bytes in data. Must not be less than in the
+    last call unless Consumed() has been called inbetween.
+  */
+  Item Next(const char *data, std::size_t length);
+
+  //! Tell the scanner that the first length bytes of the data have been dropped
+  void Consumed(std::size_t length);
+
+  //! Forget everything we know about the data
+  void Reset();
+
+private:
+  //! What we found when trying to match an opening tag
+  enum MatchResult
+  {
+    NOMATCH,
+    MATCH,
+    NEED_MORE_DATA
+  };
+
+  //! Try to match the opening tag that starts at data[pos]
+  MatchResult MatchOpeningTag(const char *data, std::size_t length, std::size_t pos,
+                              int &slot, std::size_t &tagLength) const;
+
+  //! A node of the trie that recognizes the opening tags
+  struct TrieNode
+  {
+    //! The characters that might follow, and the nodes they lead to
+    std::vector<std::pair<char, std::size_t>> children;
+    //! The slot of the tag that ends here, or -1
+    int slot = -1;
+  };
+  //! The trie of all "name>" strings. Node 0 represents the "<".
+  std::vector<TrieNode> m_trie;
+  //! The closing tags, indexed by slot
+  std::vector<std::string> m_closingTags;
+  //! The ids the tags were registered with, indexed by slot
+  std::vector<int> m_tagIds;
+
+  //! Where to resume scanning for a newline or the start of a tag
+  std::size_t m_scanPos = 0;
+  //! The slot of the tag we are waiting for the end of, or -1
+  int m_openTag = -1;
+  //! Where to resume searching for the closing tag
+  std::size_t m_closeSearchPos = 0;
+  //! true = a newline that directly follows the last tag is to be dropped
+  bool m_skipNewline = false;
+};
+
+#endif
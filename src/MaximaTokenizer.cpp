@@ -29,359 +29,367 @@
 
 #include "MaximaTokenizer.h"
 #include "precomp.h"
+#include <algorithm>
 #include <vector>
 #include <wx/string.h>
 #include <wx/wx.h>
 
 MaximaTokenizer::MaximaTokenizer(const wxString &commands,
                                  const Configuration * const configuration)
-  : m_configuration(configuration) {
-  if (m_hardcodedFunctions.empty()) {
-    m_hardcodedFunctions["for"] = 1;
-    m_hardcodedFunctions["in"] = 1;
-    m_hardcodedFunctions["then"] = 1;
-    m_hardcodedFunctions["while"] = 1;
-    m_hardcodedFunctions["do"] = 1;
-    m_hardcodedFunctions["thru"] = 1;
-    m_hardcodedFunctions["next"] = 1;
-    m_hardcodedFunctions["step"] = 1;
-    m_hardcodedFunctions["unless"] = 1;
-    m_hardcodedFunctions["from"] = 1;
-    m_hardcodedFunctions["if"] = 1;
-    m_hardcodedFunctions["else"] = 1;
-    m_hardcodedFunctions["elseif"] = 1;
-    m_hardcodedFunctions["and"] = 1;
-    m_hardcodedFunctions["or"] = 1;
-    m_hardcodedFunctions["not"] = 1;
-    m_hardcodedFunctions["true"] = 1;
-    m_hardcodedFunctions["false"] = 1;
+  : MaximaTokenizer(commands, configuration, 0, {}) {
+}
+
+MaximaTokenizer::MaximaTokenizer(const wxString &commands,
+                                 const Configuration * const configuration,
+                                 std::size_t start, const StopAfterLine &stopAfterLine) {
+  if (configuration) {
+    m_lispMode = configuration->InLispMode();
+    m_changeAsterisk = configuration->GetChangeAsterisk();
+    m_configuration = configuration;
   }
+  m_tokens.m_text = std::make_shared<const std::wstring>(commands.ToStdWstring());
+  Tokenize(start, stopAfterLine);
+}
+
+//! Does the text that ends at end end in a (to-maxima) that doesn't begin before begin?
+static bool EndsWithToMaxima(const wxChar *begin, const wxChar *end) {
+  static const wxChar toMaxima[] = L"(to-maxima)";
+  const std::size_t length = sizeof(toMaxima) / sizeof(toMaxima[0]) - 1;
+  if (static_cast<std::size_t>(end - begin) < length)
+    return false;
+  end -= length;
+  for (std::size_t i = 0; i < length; i++)
+    if ((end[i] != toMaxima[i]) && !((toMaxima[i] == '-') && (end[i] == L'\u2212')))
+      return false;
+  return true;
+}
+
+void MaximaTokenizer::Tokenize(std::size_t start, const StopAfterLine &stopAfterLine) {
+  const wxChar * const begin = m_tokens.m_text->data();
+  const wxChar * const end = begin + m_tokens.m_text->size();
+  const wxChar *it = begin + start;
+  auto &tokens = m_tokens.m_tokens;
+  auto addToken = [&](const wxChar *tokenStart, TextStyle style, bool normalized = false) {
+    tokens.push_back(Token(begin, static_cast<std::size_t>(tokenStart - begin),
+                           static_cast<std::size_t>(it - tokenStart), style, normalized));
+  };
 
   // ----------------------------------------------------------------
   // --------------------- Step one:                -----------------
   // --------------------- Break a line into tokens -----------------
   // ----------------------------------------------------------------
-  wxString::const_iterator it = commands.begin();
-
-  if (configuration->InLispMode()) {
-    wxString token;
-    while ((it < commands.end()) && ((!token.EndsWith("(to-maxima)"))) &&
-           ((!token.EndsWith(wxString("(to") + wxS("\u2212") + "maxima)")))) {
-      token += *it;
+  if ((it == begin) && m_lispMode) {
+    while ((it < end) && !EndsWithToMaxima(begin, it))
       ++it;
-    }
-    token.Trim(true);
-    if (!token.IsEmpty())
-      m_tokens.emplace_back(token, TS_CODE_LISP);
+    const wxChar *tokenEnd = it;
+    while ((tokenEnd > begin) && wxIsspace(*(tokenEnd - 1)))
+      --tokenEnd;
+    if (tokenEnd > begin)
+      tokens.push_back(Token(begin, 0, static_cast<std::size_t>(tokenEnd - begin),
+                             TS_CODE_LISP, false));
   }
-  while (it < commands.end()) {
+  while (it < end) {
     // Determine the current char and the one that will follow it
+    const wxChar * const tokenStart = it;
     wxChar Ch = *it;
-    wxString::const_iterator it2(it);
-    if (it2 < commands.end())
-      ++it2;
-    wxChar nextChar;
-
-    if (it2 < commands.end())
-      nextChar = *it2;
-    else
-      nextChar = wxS(' ');
+    wxChar nextChar = (it + 1 < end) ? *(it + 1) : wxChar(' ');
+    const std::uint8_t chClass = Classify(Ch);
 
     // Handle newline characters (hard+soft line break)
-    if (m_linebreaks.Contains(Ch)) {
-      m_tokens.emplace_back(wxChar(Ch));
+    if (chClass & LINEBREAK) {
       ++it;
+      addToken(tokenStart, TS_CODE_DEFAULT);
+      if (stopAfterLine && stopAfterLine(static_cast<std::size_t>(it - begin)))
+        break;
       continue;
     }
     // Check for comments
     if ((Ch == '/') &&
         ((nextChar == wxS('*')) || (nextChar == L'\u00B7'))) {
-      wxString token;
-      // Add the comment start
-      token += *it;
-      ++it;
-      token += *it;
-      ++it;
+      // Skip the comment start
+      it += 2;
 
       int commentDepth = 0;
-      while (it < commands.end()) {
+      while (it < end) {
         // Handle escaped chars
         if (*it == '\\') {
-          token += *it;
           ++it;
-          if (it < commands.end()) {
-            token += *it;
+          if (it < end)
             ++it;
-          }
           continue;
         }
 
-        wxString::const_iterator it3(it);
-        if (it3 < commands.end())
-          ++it3;
-        wxChar nextCh = ' ';
-        if (it3 < commands.end())
-          nextCh = *it3;
+        wxChar nextCh = (it + 1 < end) ? *(it + 1) : wxChar(' ');
 
         // handle comment begins within comments.
         if ((*it == '/') && ((nextCh == '*') || (nextCh == L'\u00B7'))) {
           commentDepth++;
-          token += *it;
-          ++it;
-          if (it < commands.end()) {
-            token += *it;
-            ++it;
-          }
+          it = std::min(it + 2, end);
           continue;
         }
         // handle comment endings
         if (((*it == '*') || (*it == L'\u00B7')) && (nextCh == '/')) {
           commentDepth--;
-          token += *it;
-          ++it;
-          if (it < commands.end()) {
-            token += *it;
-            ++it;
-          }
+          it = std::min(it + 2, end);
           if (commentDepth < 0)
             break;
           continue;
         }
-        if (it < commands.end()) {
-          token += *it;
-          ++it;
-        }
+        ++it;
       }
-      m_tokens.emplace_back(token, TS_CODE_COMMENT);
+      addToken(tokenStart, TS_CODE_COMMENT);
       continue;
     }
     // Handle operators and :lisp commands
-    if (Operators().Find(Ch) != wxNOT_FOUND) {
+    if (chClass & OPERATOR) {
       if (Ch == ':') {
-        wxString breakCommand;
-        wxString::const_iterator it3(it);
-        int len = 14;
-        while ((len > 0) && (it3 < commands.end())) {
-          len--;
-          breakCommand += wxString(*it3);
-          ++it3;
-        }
+        wxString breakCommand(it, std::min(end - it, static_cast<std::ptrdiff_t>(14)));
         if (breakCommand.StartsWith(":lisp ") ||
             breakCommand.StartsWith(":lisp-quiet ") ||
             breakCommand.StartsWith(":lisp\t") ||
             breakCommand.StartsWith(":lisp-quiet\t")) {
-          wxString token;
-          while ((it < commands.end()) && (*it != '\n')) {
-            token += wxString(*it);
+          while ((it < end) && (*it != '\n'))
             ++it;
-          }
-          m_tokens.emplace_back(token, TS_CODE_LISP);
+          addToken(tokenStart, TS_CODE_LISP);
         } else {
-          m_tokens.emplace_back(wxString(Ch), TS_CODE_OPERATOR);
           ++it;
+          addToken(tokenStart, TS_CODE_OPERATOR);
         }
       } else {
-        wxString token = wxString(Ch);
-        if (configuration->GetChangeAsterisk()) {
-          token.Replace(wxS("*"), L"\u00B7");
-          token.Replace(wxS("-"), wxS("\u2212"));
-        }
-
-        m_tokens.emplace_back(token, TS_CODE_OPERATOR);
         ++it;
+        addToken(tokenStart, TS_CODE_OPERATOR,
+                 m_changeAsterisk && ((Ch == '*') || (Ch == '-')));
       }
       continue;
     }
     // Handle strings
     if (Ch == wxS('\"')) {
-      wxString token;
-      // Add the opening quote
-      token = Ch;
+      // Skip the opening quote
       ++it;
 
-      // Add the string contents
-      while (it < commands.end()) {
+      // Skip the string contents
+      while (it < end) {
         Ch = *it;
-        token += Ch;
         ++it;
         if (Ch == wxS('\\')) {
-          if (it < commands.end()) {
-            token += *it;
+          if (it < end)
             ++it;
-          }
         } else if (Ch == wxS('\"'))
           break;
       }
-      m_tokens.emplace_back(token, TS_CODE_STRING);
+      addToken(tokenStart, TS_CODE_STRING);
       continue;
     }
     // Handle number-like symbols
-    if (UnicodeNumbers().Find(Ch) != wxNOT_FOUND) {
-      wxString token = Ch;
+    if (chClass & UNICODE_NUMBER) {
       ++it;
-      m_tokens.emplace_back(token, TS_CODE_NUMBER);
+      addToken(tokenStart, TS_CODE_NUMBER);
       continue;
     }
     // Handle numbers. Numbers begin with a digit, but can continue with letters
     // and can contain a + or - that follows an e, f, g, h or l.
     if (IsNum(Ch)) {
-      wxString token;
       wxChar lastChar = *it;
-      while (
-             (it < commands.end()) &&
-             ((IsNum(*it) || ((*it >= 'a') && (*it <= 'z')) ||
-               ((*it >= 'A') && (*it <= 'Z'))) ||
-              (((lastChar == 'e') || (lastChar == 'E') || (lastChar == 'f') ||
-                (lastChar == 'F') || (lastChar == 'g') || (lastChar == 'G') ||
-                (lastChar == 'h') || (lastChar == 'H') || (lastChar == 'l') ||
-                (lastChar == 'L')) &&
-               ((m_plusSigns.Contains(*it)) || (m_minusSigns.Contains(*it)))))) {
+      bool normalized = false;
+      while (it < end) {
         wxChar ch = *it;
-        for (wxString::const_iterator it3 = m_plusSigns.begin();
-             it3 != m_plusSigns.end(); ++it3)
-          if (ch == *it3)
-            ch = '+';
-        for (wxString::const_iterator it3 = m_minusSigns.begin();
-             it3 != m_minusSigns.end(); ++it3)
-          if (ch == *it3)
-            ch = '-';
-        token += ch;
-        lastChar = *it;
+        if (!(IsNum(ch) || ((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z')))) {
+          if (!(((lastChar == 'e') || (lastChar == 'E') || (lastChar == 'f') ||
+                 (lastChar == 'F') || (lastChar == 'g') || (lastChar == 'G') ||
+                 (lastChar == 'h') || (lastChar == 'H') || (lastChar == 'l') ||
+                 (lastChar == 'L')) &&
+                (Classify(ch) & (PLUS | MINUS))))
+            break;
+          if ((ch != '+') && (ch != '-'))
+            normalized = true;
+        }
+        lastChar = ch;
         ++it;
       }
-
-      m_tokens.emplace_back(token, TS_CODE_NUMBER);
-      continue;
-    }
-    if (m_plusSigns.Contains(Ch)) {
-      wxString token = "+";
-      m_tokens.emplace_back(token);
+      addToken(tokenStart, TS_CODE_NUMBER, normalized);
       continue;
     }
-    if (m_minusSigns.Contains(Ch)) {
-      wxString token = "-";
-      m_tokens.emplace_back(token);
+    if (chClass & (PLUS | MINUS)) {
+      ++it;
+      addToken(tokenStart, TS_CODE_DEFAULT, true);
       continue;
     }
     // Merge consecutive spaces into one single token
-    if (IsSpace(Ch)) {
-      wxString token;
-      while ((it < commands.end()) && IsSpace(Ch)) {
-        if (Ch == '\t')
-          token += "\t";
-        else
-          token += " ";
-        if (++it < commands.end())
-          Ch = *it;
+    if (chClass & SPACE) {
+      bool normalized = false;
+      while ((it < end) && (Classify(*it) & SPACE)) {
+        if ((*it != ' ') && (*it != '\t'))
+          normalized = true;
+        ++it;
       }
-      m_tokens.emplace_back(token);
+      addToken(tokenStart, TS_CODE_DEFAULT, normalized);
       continue;
     }
     // Handle keywords
-    if (IsAlpha(Ch) || (Ch == '\\') || (Ch == '?')) {
-      wxString token;
-      if (Ch == '?') {
-        token += Ch;
+    if ((chClass & ALPHA) || (Ch == '\\') || (Ch == '?')) {
+      if (Ch == '?')
         ++it;
-      }
 
-      while ((it < commands.end()) && (IsAlphaNum(*it) || (*it == '\\'))) {
-        Ch = *it;
-        token += Ch;
-        if (Ch == wxS('\\')) {
+      bool escapedNewline = false;
+      while ((it < end) && (IsAlphaNum(*it) || (*it == '\\'))) {
+        if (*it == wxS('\\')) {
           ++it;
-          if (it < commands.end()) {
-            Ch = *it;
-            if (Ch != wxS('\n'))
-              token += Ch;
-            else {
-              m_tokens.emplace_back(token);
-              token.Clear();
-
-              break;
-            }
+          if ((it < end) && (*it == wxS('\n'))) {
+            escapedNewline = true;
+            break;
           }
         }
-        if (it < commands.end())
+        if (it < end)
           ++it;
       }
+      if (escapedNewline) {
+        addToken(tokenStart, TS_CODE_DEFAULT);
+        continue;
+      }
+
+      const wxString token(tokenStart, static_cast<std::size_t>(it - tokenStart));
       if (token == ("to_lisp")) {
-        while (
-               (it < commands.end()) && ((!token.EndsWith("(to-maxima)"))) &&
-               ((!token.EndsWith(wxString("(to") + wxS("\u2212") + "maxima)")))) {
-          token += wxString(*it);
+        while ((it < end) && !EndsWithToMaxima(tokenStart, it))
           ++it;
-        }
-        m_tokens.emplace_back(token, TS_CODE_LISP);
+        addToken(tokenStart, TS_CODE_LISP);
       } else {
         if (m_hardcodedFunctions.find(token) != m_hardcodedFunctions.end())
-          m_tokens.emplace_back(token, TS_CODE_FUNCTION);
-        else if (m_configuration->m_maximaOperators.find(token) !=
-                 m_configuration->m_maximaOperators.end())
-          m_tokens.emplace_back(token, TS_CODE_OPERATOR);
+          addToken(tokenStart, TS_CODE_FUNCTION);
+        else if (m_configuration && m_configuration->IsOperator(token))
+          addToken(tokenStart, TS_CODE_OPERATOR);
         else {
           // Let's look what the next char looks like
-          wxString::const_iterator it3(it);
-          while ((it3 < commands.end()) && ((*it3 == ' ') || (*it3 == '\t') ||
-                                            (*it3 == '\n') || (*it3 == '\r')))
+          const wxChar *it3 = it;
+          while ((it3 < end) && ((*it3 == ' ') || (*it3 == '\t') ||
+                                 (*it3 == '\n') || (*it3 == '\r')))
             ++it3;
-          if (it3 >= commands.end())
-            m_tokens.emplace_back(token, TS_CODE_VARIABLE);
-          else {
-            if (*it3 == '(')
-              m_tokens.emplace_back(token, TS_CODE_FUNCTION);
-            else
-              m_tokens.emplace_back(token, TS_CODE_VARIABLE);
-          }
+          if ((it3 < end) && (*it3 == '('))
+            addToken(tokenStart, TS_CODE_FUNCTION);
+          else
+            addToken(tokenStart, TS_CODE_VARIABLE);
         }
       }
       continue;
     }
     if ((Ch == '$') || (Ch == ';')) {
-      m_tokens.emplace_back(wxString(Ch), TS_CODE_ENDOFLINE);
       ++it;
+      addToken(tokenStart, TS_CODE_ENDOFLINE);
       continue;
     }
 
     {
       // Everything that hasn't been handled until now.
-      m_tokens.emplace_back(wxString(Ch));
       ++it;
+      addToken(tokenStart, TS_CODE_DEFAULT);
       continue;
     }
   }
 }
 
-MaximaTokenizer::MaximaTokenizer(const wxString &commands,
-                                 const Configuration * const configuration,
-                                 const TokenList &initialTokens)
-  : MaximaTokenizer(commands, configuration)
-{
-  m_tokens = initialTokens;
+wxString MaximaTokenizer::Token::GetText() const {
+  if (!m_normalized)
+    return wxString(m_source + m_offset, m_length);
+  wxString text;
+  text.reserve(m_length);
+  for (std::size_t i = 0; i < m_length; i++)
+    text += (*this)[i];
+  return text;
 }
 
-bool MaximaTokenizer::IsAlpha(wxChar ch) {
-  if (wxIsalpha(ch))
-    return true;
-
-  if (m_not_alphas.Find(ch) != wxNOT_FOUND)
-    return false;
-
-  if (IsSpace(ch))
-    return false;
-
-  // If it cannot be converted to asciiand we didn't detect it as a char we know
-  // how to deal with it (in maxima's view) is an ordinary letter.
-  if (ch > 127)
-    return true;
+wxChar MaximaTokenizer::Normalize(wxChar ch, TextStyle style) {
+  if (style == TS_CODE_OPERATOR) {
+    if (ch == '*')
+      return L'\u00B7';
+    if (ch == '-')
+      return L'\u2212';
+    return ch;
+  }
+  const std::uint8_t chClass = Classify(ch);
+  if (chClass & PLUS)
+    return '+';
+  if (chClass & MINUS)
+    return '-';
+  if ((chClass & SPACE) && (ch != '\t'))
+    return ' ';
+  return ch;
+}
 
-  return (m_additional_alphas.Find(ch) != wxNOT_FOUND);
+void MaximaTokenizer::TokenList::Replace(std::size_t first, std::size_t last,
+                                         TokenList &&replacement) {
+  const wxChar * const source = replacement.m_text->data();
+  const long shift = static_cast<long>(replacement.m_text->size()) -
+    static_cast<long>(m_text ? m_text->size() : 0);
+  for (std::size_t i = 0; i < m_tokens.size(); i++) {
+    m_tokens[i].m_source = source;
+    if (i >= last)
+      m_tokens[i].m_offset = static_cast<std::uint32_t>(m_tokens[i].m_offset + shift);
+  }
+  m_tokens.erase(m_tokens.begin() + first, m_tokens.begin() + last);
+  m_tokens.insert(m_tokens.begin() + first, replacement.m_tokens.begin(),
+                  replacement.m_tokens.end());
+  m_text = std::move(replacement.m_text);
 }
 
-bool MaximaTokenizer::IsSpace(wxChar ch) {
-  return m_spaces.Find(ch) != wxNOT_FOUND;
+//! Is ch an ASCII char?
+static bool IsAscii(wxChar ch) { return static_cast<std::uint32_t>(ch) < 128; }
+
+std::uint8_t MaximaTokenizer::Classify(wxChar ch) {
+  struct Classes
+  {
+    std::uint8_t ascii[128];
+    std::vector<std::pair<wxChar, std::uint8_t>> others;
+    Classes() : ascii() {
+      auto add = [this](const wxString &chars, std::uint8_t charClass) {
+        for (wxChar ch : chars)
+          if (IsAscii(ch))
+            ascii[ch] |= charClass;
+          else
+            others.emplace_back(ch, charClass);
+      };
+      add(m_linebreaks, LINEBREAK);
+      add(m_spaces, SPACE);
+      add(m_operators, OPERATOR);
+      add(m_plusSigns, PLUS);
+      add(m_minusSigns, MINUS);
+      add(m_unicodeNumbers, UNICODE_NUMBER);
+      add(m_not_alphas, NOT_ALPHA);
+      for (wxChar ch = 0; ch < 128; ch++)
+        if (wxIsalpha(ch) ||
+            (!(ascii[ch] & SPACE) && (m_additional_alphas.Find(ch) != wxNOT_FOUND)))
+          ascii[ch] |= ALPHA;
+
+      // Merge the classes of chars that are in more than one list
+      std::sort(others.begin(), others.end());
+      std::vector<std::pair<wxChar, std::uint8_t>> merged;
+      for (auto const &other : others)
+        if (!merged.empty() && (merged.back().first == other.first))
+          merged.back().second |= other.second;
+        else
+          merged.push_back(other);
+      others = std::move(merged);
+    }
+  };
+  static const Classes classes;
+
+  if (IsAscii(ch))
+    return classes.ascii[ch];
+  auto const other =
+    std::lower_bound(classes.others.begin(), classes.others.end(),
+                     std::make_pair(ch, std::uint8_t(0)));
+  if ((other == classes.others.end()) || (other->first != ch))
+    return ALPHA;
+  std::uint8_t chClass = other->second;
+  // Non-ASCII chars that wxIsalpha() doesn't know about are ordinary letters
+  // in maxima's view, unless we know them as something else.
+  if (!(chClass & (NOT_ALPHA | SPACE)) || wxIsalpha(ch))
+    chClass |= ALPHA;
+  return chClass;
 }
 
+bool MaximaTokenizer::IsAlpha(wxChar ch) { return Classify(ch) & ALPHA; }
+
+bool MaximaTokenizer::IsSpace(wxChar ch) { return Classify(ch) & SPACE; }
+
 bool MaximaTokenizer::IsNum(wxChar ch) { return ch >= '0' && ch <= '9'; }
 
 bool MaximaTokenizer::IsAlphaNum(wxChar ch) { return IsAlpha(ch) || IsNum(ch); }
@@ -423,4 +431,7 @@ const wxString MaximaTokenizer::m_operators =
   wxS("\u221A\u22C0\u22C1\u22BB\u22BC\u22BD\u00AC\u222b\u2264\u2265\u2211"
       "\u2260+-*/^:=#'!()[]{}");
 
-MaximaTokenizer::StringHash MaximaTokenizer::m_hardcodedFunctions;
+const MaximaTokenizer::StringHash MaximaTokenizer::m_hardcodedFunctions = {
+  {"for", 1}, {"in", 1}, {"then", 1}, {"while", 1}, {"do", 1}, {"thru", 1},
+  {"next", 1}, {"step", 1}, {"unless", 1}, {"from", 1}, {"if", 1}, {"else", 1},
+  {"elseif", 1}, {"and", 1}, {"or", 1}, {"not", 1}, {"true", 1}, {"false", 1}};
@@ -23,9 +23,13 @@
 #ifndef MAXIMATOKENIZER_H
 #define MAXIMATOKENIZER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <utility>
 #include <vector>
 #include <memory>
+#include <string>
 #include <wx/wx.h>
 #include <wx/string.h>
 #include <wx/arrstr.h>
@@ -53,30 +57,89 @@ public:
   /*! The constructor
 
     \param commands The maxima commands to tokenize
-    \param configuration A pointer to the configuration object
+    \param configuration A pointer to the configuration object. If it is NULL
+    the commands are tokenized using the default settings.
   */
   MaximaTokenizer(const wxString &commands, const Configuration * const configuration);
 
-  //! A maxima code snippet from this tokenizer
+  /*! A maxima code snippet from this tokenizer
+
+    A token doesn't contain a copy of its text, but points into the copy of the
+    tokenized commands the TokenList it was created in owns. It therefore is only
+    valid as long as that list (or a copy of it) exists.
+  */
   class Token
   {
   public:
     Token() = default;
-    explicit Token(wxString&& text) : m_text(std::move(text)) {}
-    explicit Token(const wxString &text) : m_text(text) {}
-    Token(wxString&& text, TextStyle style) : m_text(std::move(text)), m_style(style) {}
-    Token(const wxString& text, TextStyle style) : m_text(text), m_style(style) {}
-    Token& operator=(Token&& t) noexcept { m_text = std::move(t.m_text); m_style = t.m_style; return *this; }
-    Token& operator=(const Token& t) { m_text = t.m_text; m_style = t.m_style; return *this; }
-    Token(Token&& token) noexcept { *this = std::move(token); }
-    Token(const Token &token) { *this = token ;}
     TextStyle GetTextStyle() const { return m_style; }
-    const wxString &GetText() const { return m_text; }
-    operator const wxString &() const { return m_text; }
+    //! The position of the first char of the token in the tokenized commands
+    std::size_t GetOffset() const { return m_offset; }
+    //! The number of chars of the tokenized commands the token spans
+    std::size_t GetLength() const { return m_length; }
+    //! The n-th char of the text of the token
+    wxChar operator[](std::size_t n) const
+      { return m_normalized ? Normalize(m_source[m_offset + n], m_style) : m_source[m_offset + n]; }
+    //! Does the text of the token start with ch?
+    bool StartsWith(wxChar ch) const { return (m_length > 0) && ((*this)[0] == ch); }
+    //! Creates a copy of the text of the token
+    wxString GetText() const;
   private:
-    wxString m_text;
+    friend class MaximaTokenizer;
+    friend class TokenList;
+    Token(const wxChar *source, std::size_t offset, std::size_t length,
+          TextStyle style, bool normalized) :
+      m_source(source), m_offset(static_cast<std::uint32_t>(offset)),
+      m_length(static_cast<std::uint32_t>(length)), m_style(style),
+      m_normalized(normalized) {}
+    //! The tokenized commands
+    const wxChar *m_source = NULL;
+    std::uint32_t m_offset = 0;
+    std::uint32_t m_length = 0;
     TextStyle m_style = TS_CODE_DEFAULT;
+    /*! Does the text of the token differ from the chars it spans?
+
+      Unicode variants of +, - and of spaces are displayed as their ASCII
+      counterparts and if the configuration wants so operators like * are
+      displayed as nicer unicode symbols.
+    */
+    bool m_normalized = false;
+  };
+
+  /*! The tokens a text is divided into
+
+    All tokens point into one copy of the tokenized text the list shares with its
+    copies.
+  */
+  class TokenList
+  {
+  public:
+    using const_iterator = std::vector<Token>::const_iterator;
+    using const_reverse_iterator = std::vector<Token>::const_reverse_iterator;
+    const_iterator begin() const { return m_tokens.begin(); }
+    const_iterator end() const { return m_tokens.end(); }
+    const_reverse_iterator rbegin() const { return m_tokens.rbegin(); }
+    const_reverse_iterator rend() const { return m_tokens.rend(); }
+    std::size_t size() const { return m_tokens.size(); }
+    bool empty() const { return m_tokens.empty(); }
+    const Token &operator[](std::size_t n) const { return m_tokens[n]; }
+
+    /*! Replaces the tokens [first, last) by the tokens in replacement
+
+      replacement must have been created from the text this list has been
+      created from after a change that only affects these tokens: The tokens
+      before first must still be valid at the same position and the tokens
+      from last on must be valid if they are moved by the change in the length
+      of the text.
+    */
+    void Replace(std::size_t first, std::size_t last, TokenList &&replacement);
+  private:
+    friend class MaximaTokenizer;
+    //! The tokenized text
+    std::shared_ptr<const std::wstring> m_text;
+    std::vector<Token> m_tokens;
   };
+
   static bool IsAlpha(wxChar ch);
   static bool IsNum(wxChar ch);
   static bool IsAlphaNum(wxChar ch);
@@ -84,14 +147,58 @@ public:
   static const wxString &UnicodeNumbers() { return m_unicodeNumbers; }
   static const wxString &Operators() { return m_operators; }
 
-  using TokenList = std::vector<Token>;
   TokenList PopTokens() && { return std::move(m_tokens); }
 
-  //! A constructor that adds additional words to the token list
+  /*! A function that decides if tokenizing can stop after a line
+
+    Is called with the position in the commands behind the newline.
+  */
+  using StopAfterLine = std::function<bool (std::size_t pos)>;
+
+  /*! A constructor that only tokenizes a part of the commands
+
+    Outside of comments and strings the tokenizer doesn't depend on what it has
+    seen before the beginning of a line. This allows to tokenize only the part
+    of a text that has changed.
+
+    \param commands The maxima commands to tokenize
+    \param configuration A pointer to the configuration object
+    \param start The position to start with. Must be the beginning of the
+    commands or of a line outside of comments and strings.
+    \param stopAfterLine Called after every newline that isn't part of a
+    comment or a string. If it returns true the rest of the commands isn't
+    tokenized.
+  */
   MaximaTokenizer(const wxString &commands, const Configuration * const configuration,
-                  const TokenList &initialTokens);
+                  std::size_t start, const StopAfterLine &stopAfterLine);
 
 protected:
+  //! Tokenizes the commands, starting at the position start.
+  void Tokenize(std::size_t start, const StopAfterLine &stopAfterLine);
+
+  //! The char a token with m_normalized set displays instead of ch
+  static wxChar Normalize(wxChar ch, TextStyle style);
+
+  //! The classes a char can belong to
+  enum CharClass : std::uint8_t
+  {
+    LINEBREAK = 1,
+    SPACE = 2,
+    OPERATOR = 4,
+    PLUS = 8,
+    MINUS = 16,
+    UNICODE_NUMBER = 32,
+    NOT_ALPHA = 64,
+    ALPHA = 128
+  };
+  /*! The classes the char ch belongs to
+
+    Looks ASCII chars up in a table and the few special non-ASCII chars
+    by a binary search in a sorted one, which is much faster than searching
+    the strings that define the classes.
+  */
+  static std::uint8_t Classify(wxChar ch);
+
   //! The tokens the string is divided into
   TokenList m_tokens;
   //! ASCII symbols that wxIsalnum() doesn't see as chars, but maxima does.
@@ -111,7 +218,12 @@ protected:
   //! Operators
   static const wxString m_operators;
 
-  const Configuration * const m_configuration = NULL;
+  //! Are we in lisp mode?
+  bool m_lispMode = false;
+  //! Do we want to display * and - as nicer unicode chars?
+  bool m_changeAsterisk = false;
+  //! The configuration that knows the operators maxima has been told about, or NULL
+  const Configuration *m_configuration = NULL;
 
   typedef std::unordered_map <wxString, int, wxStringHash> StringHash;
   /*! Names of functions that don't require parenthesis
@@ -121,7 +233,7 @@ protected:
     are very similar to functions except that they don't require an
     argument. These fake functions are kept in this hash.
   */
-  static StringHash m_hardcodedFunctions;
+  static const StringHash m_hardcodedFunctions;
 };
 
 #endif // MAXIMATOKENIZER_H
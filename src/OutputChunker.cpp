@@ -0,0 +1,216 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class OutputChunker.
+*/
+
+#include "OutputChunker.h"
+#include "XmlPullParser.h"
+#include <utility>
+
+bool OutputChunker::FindChildElements(const char *data, std::size_t length,
+                                      std::vector<Element> &children)
+{
+  XmlPullParser parser(data, length);
+  for(;;)
+    {
+      switch(parser.Next())
+        {
+        case XmlPullParser::START_TAG:
+          if(parser.Depth() == 2)
+            {
+              Element element;
+              element.name = parser.Name();
+              element.start = parser.TokenStart();
+              element.contentStart = parser.TokenEnd();
+              for(const auto &attr : parser.Attributes())
+                if((attr.first == "listdelim") && (attr.second == "true"))
+                  element.listDelimiter = true;
+              children.push_back(std::move(element));
+            }
+          break;
+        case XmlPullParser::END_TAG:
+          if((parser.Depth() == 1) && !children.empty())
+            {
+              children.back().contentEnd = parser.TokenStart();
+              children.back().end = parser.TokenEnd();
+            }
+          break;
+        case XmlPullParser::TEXT:
+        case XmlPullParser::CDATA:
+          if(parser.Depth() == 1)
+            {
+              // Text directly within the root element is parsed into cells,
+              // too => it needs to be part of a chunk.
+              Element text;
+              text.start = text.contentStart = parser.TokenStart();
+              text.end = text.contentEnd = parser.TokenEnd();
+              text.displayedChars = parser.Text().size();
+              children.push_back(std::move(text));
+            }
+          else if((parser.Depth() >= 2) && !children.empty())
+            children.back().displayedChars += parser.Text().size();
+          break;
+        case XmlPullParser::ERROR:
+          return false;
+        case XmlPullParser::END_OF_DATA:
+          return true;
+        }
+    }
+}
+
+bool OutputChunker::Split(const char *data, std::size_t length)
+{
+  m_labels.clear();
+  m_chunks.clear();
+  m_container.reset();
+
+  std::vector<Element> children;
+  if(!FindChildElements(data, length, children))
+    return false;
+
+  // The labels are short => MathParser converts them to cells right away.
+  std::vector<Element> contents;
+  for(const auto &child : children)
+    {
+      if(child.name == "lbl")
+        {
+          Range label;
+          label.start = child.start;
+          label.end = child.end;
+          m_labels.push_back(label);
+        }
+      else
+        contents.push_back(child);
+    }
+
+  // If the output is a single list we split its elements into chunks, if it
+  // is a matrix its rows.
+  std::size_t containerStart = 0;
+  std::size_t containerEnd = 0;
+  std::size_t contentStart = 0;
+  std::size_t contentEnd = 0;
+  bool haveContainer = false;
+  std::string displayStart;
+  std::string displayEnd;
+  while((contents.size() == 1) &&
+        ((contents[0].name == "mrow") || (contents[0].name == "r") ||
+         (contents[0].name == "tb")))
+    {
+      const Element container = contents[0];
+      std::vector<Element> items;
+      if(!FindChildElements(data + container.start, container.end - container.start, items) ||
+         items.empty())
+        break;
+      for(auto &item : items)
+        {
+          item.start += container.start;
+          item.contentStart += container.start;
+          item.contentEnd += container.start;
+          item.end += container.start;
+        }
+      contents = std::move(items);
+      if(!haveContainer)
+        {
+          containerStart = container.start;
+          containerEnd = container.end;
+          haveContainer = true;
+        }
+      contentStart = container.contentStart;
+      contentEnd = container.contentEnd;
+      // Each chunk of rows becomes a matrix of its own
+      if(container.name == "tb")
+        {
+          displayStart.assign(data + container.start, data + container.contentStart);
+          displayEnd.assign(data + container.contentEnd, data + container.end);
+          break;
+        }
+    }
+  if(haveContainer)
+    {
+      auto container = std::make_shared<Container>();
+      container->start.assign(data + containerStart, data + contentStart);
+      container->end.assign(data + contentEnd, data + containerEnd);
+      container->displayStart = std::move(displayStart);
+      container->displayEnd = std::move(displayEnd);
+      m_container = std::move(container);
+    }
+
+  Chunk chunk;
+  for(const auto &item : contents)
+    {
+      chunk.xml.append(data + item.start, item.end - item.start);
+      chunk.displayedChars += item.displayedChars;
+      if((chunk.displayedChars >= CharsPerChunk) || (chunk.xml.size() >= BytesPerChunk))
+        {
+          m_chunks.push_back(std::move(chunk));
+          chunk = Chunk();
+        }
+    }
+  if(!chunk.xml.empty())
+    m_chunks.push_back(std::move(chunk));
+  return true;
+}
+
+std::string OutputChunker::ChunkXml(const std::string &xml, const Container *container,
+                                    bool first, bool last)
+{
+  if(!container)
+    return xml;
+  std::string retval;
+  if(first)
+    retval = container->start;
+  retval += xml;
+  if(last)
+    retval += container->end;
+  return retval;
+}
+
+std::string OutputChunker::DisplayXml(const std::string &xml, const Container *container)
+{
+  std::string retval;
+  if(container)
+    retval = container->displayStart;
+
+  const std::string root = "<c>" + xml + "</c>";
+  std::vector<Element> items;
+  if(FindChildElements(root.data(), root.size(), items))
+    {
+      for(const auto &item : items)
+        {
+          if(item.listDelimiter)
+            {
+              retval += "<t>";
+              retval.append(root, item.contentStart, item.contentEnd - item.contentStart);
+              retval += "</t>";
+            }
+          else
+            retval.append(root, item.start, item.end - item.start);
+        }
+    }
+  else
+    retval += xml;
+
+  if(container)
+    retval += container->displayEnd;
+  return retval;
+}
@@ -0,0 +1,149 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_OUTPUTCHUNKER_H
+#define WXMAXIMA_OUTPUTCHUNKER_H
+
+/*! \file
+ *
+ * Declares the class that splits the XML of very long outputs into chunks.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*! Splits the XML of a very long output into the chunks OutputChunkCells display
+
+  Works on the UTF-8 XML maxima sends, without building a DOM of it: The
+  children of the root element are grouped into chunks of a few elements. If
+  the output is a single list or matrix its elements or rows are, instead.
+  Text that isn't part of any child element is kept as an element of its own.
+
+  The tags of that list or matrix are stored only once, in a Container all of
+  its chunks share. Joining the ChunkXml() of all chunks therefore results in
+  the XML maxima has sent, which is what saving or copying the output needs.
+*/
+class OutputChunker
+{
+public:
+  //! The approximate number of characters one chunk displays
+  static constexpr std::size_t CharsPerChunk = 200;
+  //! The maximum number of bytes of XML in one chunk
+  static constexpr std::size_t BytesPerChunk = 65536;
+  /*! Outputs longer than this are split into chunks even if the user wants to see all of them
+
+    Converting them to cells at once would block wxMaxima for a long time.
+  */
+  static constexpr std::size_t MaxUnsplitBytes = 1000000;
+
+  //! The list or matrix the chunks of an output have been split from
+  struct Container
+  {
+    //! The start tags of the container and of all elements it is nested in
+    std::string start;
+    //! The end tags matching start
+    std::string end;
+    //! The start tag a chunk is displayed in: Each chunk of rows is displayed as a matrix
+    std::string displayStart;
+    //! The end tag matching displayStart
+    std::string displayEnd;
+  };
+
+  //! A few elements of the output
+  struct Chunk
+  {
+    //! The XML of the elements, as maxima has sent it
+    std::string xml;
+    //! The approximate number of characters the elements display
+    std::size_t displayedChars = 0;
+  };
+
+  //! The position of an element in the XML
+  struct Range
+  {
+    std::size_t start = 0;
+    std::size_t end = 0;
+  };
+
+  /*! Splits the children of the root element of data into chunks
+
+    \returns false, if the XML isn't well-formed.
+  */
+  bool Split(const char *data, std::size_t length);
+
+  //! The labels of the output, which aren't part of any chunk
+  const std::vector<Range> &GetLabels() const {return m_labels;}
+  //! The chunks. Non-const, so their XML can be moved to the cells.
+  std::vector<Chunk> &GetChunks() {return m_chunks;}
+  //! The list or matrix the chunks are part of, or nullptr if they are the top-level elements
+  const std::shared_ptr<const Container> &GetContainer() const {return m_container;}
+
+  /*! The XML that a chunk contributes to the XML of the whole output
+
+    \param xml The XML of the chunk's elements
+    \param container The container the chunk is part of, or nullptr
+    \param first true = The chunk is the first one of its container
+    \param last true = The chunk is the last one of its container
+  */
+  static std::string ChunkXml(const std::string &xml, const Container *container,
+                              bool first, bool last);
+
+  /*! The XML a chunk is converted to cells from, without the root element
+
+    A chunk of a list cannot draw the list's brackets => the delimiters of the
+    list become ordinary text.
+  */
+  static std::string DisplayXml(const std::string &xml, const Container *container);
+
+private:
+  //! A child element or text node Split() has found
+  struct Element
+  {
+    //! The tag name, or empty for text
+    std::string name;
+    //! The offset of the start tag
+    std::size_t start = 0;
+    //! The offset of the first byte after the start tag
+    std::size_t contentStart = 0;
+    //! The offset of the end tag
+    std::size_t contentEnd = 0;
+    //! The offset of the first byte after the end tag
+    std::size_t end = 0;
+    //! The number of bytes of text the element contains
+    std::size_t displayedChars = 0;
+    //! Is this a "[", "," or "]" of a list?
+    bool listDelimiter = false;
+  };
+  /*! Find the child elements and text nodes of the root element of data
+
+    \returns false, if the XML isn't well-formed.
+  */
+  static bool FindChildElements(const char *data, std::size_t length,
+                                std::vector<Element> &children);
+
+  std::vector<Range> m_labels;
+  std::vector<Chunk> m_chunks;
+  std::shared_ptr<const Container> m_container;
+};
+
+#endif // WXMAXIMA_OUTPUTCHUNKER_H
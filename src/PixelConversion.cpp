@@ -0,0 +1,110 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+/*! \file
+  This file defines the conversions between pixel formats.
+*/
+
+#include "PixelConversion.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WXM_PIXELCONVERSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+void PremultiplyScalar(const unsigned char *rgba, unsigned char *dst, std::size_t pixels,
+                       int red, int green, int blue, int alpha)
+{
+  for(std::size_t i = 0; i < pixels; i++)
+    {
+      // Read all channels first: dst may be the same as rgba.
+      const unsigned int r = rgba[0];
+      const unsigned int g = rgba[1];
+      const unsigned int b = rgba[2];
+      const unsigned int a = rgba[3];
+      dst[red] = static_cast<unsigned char>(r * a / 255);
+      dst[green] = static_cast<unsigned char>(g * a / 255);
+      dst[blue] = static_cast<unsigned char>(b * a / 255);
+      dst[alpha] = static_cast<unsigned char>(a);
+      rgba += 4;
+      dst += 4;
+    }
+}
+
+#ifdef WXM_PIXELCONVERSION_SSE2
+/*! Premultiplies two pixels with 16-bit channels
+
+  x / 255 == (x + 1 + ((x + 1) >> 8)) >> 8 for all x <= 255 * 255, and
+  255 * alpha / 255 is alpha, which is why the alpha channel is set to 255
+  before multiplying.
+*/
+template <int order> inline __m128i Premultiply2(__m128i pix, __m128i alphaIs255)
+{
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pix, _MM_SHUFFLE(3, 3, 3, 3)),
+                                  _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i x = _mm_add_epi16(_mm_mullo_epi16(_mm_or_si128(pix, alphaIs255), a),
+                            _mm_set1_epi16(1));
+  x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, order), order);
+}
+
+template <int order> void PremultiplySSE2(const unsigned char *rgba, unsigned char *dst,
+                                          std::size_t pixels)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alphaIs255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  std::size_t i = 0;
+  for(; i + 4 <= pixels; i += 4)
+    {
+      __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + 4 * i));
+      __m128i lo = Premultiply2<order>(_mm_unpacklo_epi8(pix, zero), alphaIs255);
+      __m128i hi = Premultiply2<order>(_mm_unpackhi_epi8(pix, zero), alphaIs255);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_packus_epi16(lo, hi));
+    }
+  if(order == _MM_SHUFFLE(3, 2, 1, 0))
+    PremultiplyScalar(rgba + 4 * i, dst + 4 * i, pixels - i, 0, 1, 2, 3);
+  else
+    PremultiplyScalar(rgba + 4 * i, dst + 4 * i, pixels - i, 2, 1, 0, 3);
+}
+#endif
+}
+
+void PremultiplyRGBA(const unsigned char *rgba, unsigned char *dst, std::size_t pixels,
+                     int red, int green, int blue, int alpha)
+{
+#ifdef WXM_PIXELCONVERSION_SSE2
+  if(alpha == 3)
+    {
+      if((red == 0) && (green == 1) && (blue == 2))
+        {
+          PremultiplySSE2<_MM_SHUFFLE(3, 2, 1, 0)>(rgba, dst, pixels);
+          return;
+        }
+      if((red == 2) && (green == 1) && (blue == 0))
+        {
+          PremultiplySSE2<_MM_SHUFFLE(3, 0, 1, 2)>(rgba, dst, pixels);
+          return;
+        }
+    }
+#endif
+  PremultiplyScalar(rgba, dst, pixels, red, green, blue, alpha);
+}
@@ -0,0 +1,50 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#ifndef WXMAXIMA_PIXELCONVERSION_H
+#define WXMAXIMA_PIXELCONVERSION_H
+
+/*! \file
+ *
+ * Declares the conversion of the rasterizer's pixels to the ones of a bitmap.
+ */
+
+#include <cstddef>
+
+/*! Converts RGBA pixels with straight alpha to premultiplied alpha
+
+  This is what converting a rasterized SVG image to a wxBitmap with an alpha
+  channel needs for every single pixel, which is why it has SSE2 versions for
+  the channel orders the bitmaps of the common platforms use.
+
+  \param rgba The source pixels: red, green, blue, alpha, one byte each.
+  \param dst Where to write the pixels to. May be the same as rgba.
+  \param pixels The number of pixels to convert.
+  \param red, green, blue, alpha The byte offset of each channel within a
+  4-byte pixel of dst.
+
+  Each color channel becomes channel * alpha / 255, rounded down.
+*/
+void PremultiplyRGBA(const unsigned char *rgba, unsigned char *dst, std::size_t pixels,
+                     int red, int green, int blue, int alpha);
+
+#endif
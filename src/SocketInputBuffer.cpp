@@ -0,0 +1,134 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class SocketInputBuffer.
+*/
+
+#include "SocketInputBuffer.h"
+#include <cstring>
+
+SocketInputBuffer::SocketInputBuffer()
+{
+  m_data.reserve(BlockSize);
+}
+
+void SocketInputBuffer::Append(const char *data, std::size_t length)
+{
+  if(length == 0)
+    return;
+
+  // Don't let the consumed part of the buffer grow without bounds
+  if((m_start > 0) && (m_start >= m_data.size() / 2))
+    {
+      m_data.erase(m_data.begin(), m_data.begin() + m_start);
+      m_start = 0;
+    }
+
+  // The normalized data is never longer than the raw data => we can reserve
+  // the space beforehand and write to it using a plain pointer.
+  std::size_t oldSize = m_data.size();
+  m_data.resize(oldSize + length);
+  char *out = m_data.data() + oldSize;
+  const char *in = data;
+  const char *end = data + length;
+
+  // A "\n" that follows a "\r" from the last block belongs to a "\r\n"
+  // that has already been converted to a "\n".
+  if(m_lastWasCR && (*in == '\n'))
+    ++in;
+
+  while(in < end)
+    {
+      // Copy the runs of bytes that need no special treatment in one go
+      const char *special = in;
+      while((special < end) && (*special != '\r') && (*special != '\0'))
+        ++special;
+      std::size_t run = special - in;
+      if(run > 0)
+        {
+          std::memcpy(out, in, run);
+          out += run;
+          in = special;
+        }
+      if(in >= end)
+        break;
+      if(*in == '\r')
+        {
+          *out++ = '\n';
+          ++in;
+          if((in < end) && (*in == '\n'))
+            ++in;
+        }
+      else
+        ++in;
+    }
+  m_lastWasCR = (data[length - 1] == '\r');
+  m_data.resize(out - m_data.data());
+}
+
+void SocketInputBuffer::Consume(std::size_t length)
+{
+  if(length >= Length())
+    Clear();
+  else
+    m_start += length;
+}
+
+void SocketInputBuffer::Clear()
+{
+  m_data.clear();
+  m_start = 0;
+}
+
+std::size_t SocketInputBuffer::CompleteUTF8Length(const char *data, std::size_t length)
+{
+  // A UTF-8 sequence is at most 4 bytes long => We only need to look at
+  // the last 3 bytes in order to find out if the last sequence is complete.
+  std::size_t lookback = 0;
+  while((lookback < 4) && (lookback < length))
+    {
+      unsigned char ch = static_cast<unsigned char>(data[length - 1 - lookback]);
+      // A continuation byte: Look further back for the lead byte
+      if((ch & 0xC0) == 0x80)
+        {
+          ++lookback;
+          continue;
+        }
+      std::size_t sequenceLength;
+      if(ch < 0x80)
+        sequenceLength = 1;
+      else if((ch & 0xE0) == 0xC0)
+        sequenceLength = 2;
+      else if((ch & 0xF0) == 0xE0)
+        sequenceLength = 3;
+      else if((ch & 0xF8) == 0xF0)
+        sequenceLength = 4;
+      else
+        // Not valid UTF-8 at all: Waiting for more data won't help.
+        return length;
+      if(sequenceLength > lookback + 1)
+        return length - 1 - lookback;
+      return length;
+    }
+  // Only continuation bytes: Invalid UTF-8 that won't get valid by waiting.
+  return length;
+}
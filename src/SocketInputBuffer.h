@@ -0,0 +1,94 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_SOCKETINPUTBUFFER_H
+#define WXMAXIMA_SOCKETINPUTBUFFER_H
+
+/*! \file
+ *
+ * Declares the byte buffer the data maxima sends us is collected in.
+ */
+
+#include <cstddef>
+#include <vector>
+
+/*! A byte buffer for the UTF-8 data maxima sends us
+
+  Reading the socket one wxUniChar at a time means one virtual call, one
+  UTF-8 decoding step and one string append per character. This buffer
+  instead is filled by block reads from the socket and does all the
+  per-byte work (dropping NULs, converting "\r\n" and lone "\r" to "\n")
+  in one tight loop per block. Converting the data to a wxString is left to
+  the consumer that can do so for whole chunks only.
+
+  The bytes that have been consumed are dropped lazily: The storage is only
+  compacted once the consumed part dominates the buffer, which means that
+  in the steady state no memory is allocated at all.
+*/
+class SocketInputBuffer
+{
+public:
+  //! The size of the blocks we read from the socket
+  static constexpr std::size_t BlockSize = 65536;
+
+  SocketInputBuffer();
+
+  /*! Appends a block of raw bytes received from maxima
+
+    NUL bytes are dropped, "\r\n" and lone "\r" are converted to "\n". A "\r"
+    at the end of a block is remembered so a "\n" that starts the next block
+    isn't converted to a second line ending.
+  */
+  void Append(const char *data, std::size_t length);
+
+  //! The unconsumed data
+  const char *Data() const { return m_data.data() + m_start; }
+  //! The number of unconsumed bytes
+  std::size_t Length() const { return m_data.size() - m_start; }
+  //! Is there any unconsumed data?
+  bool IsEmpty() const { return Length() == 0; }
+
+  /*! The number of unconsumed bytes that end in a complete UTF-8 sequence
+
+    Maxima's output may be split in the middle of a multi-byte character by
+    the network. The bytes of such an incomplete character have to wait for
+    the next block before they can be decoded.
+  */
+  std::size_t CompleteLength() const { return CompleteUTF8Length(Data(), Length()); }
+
+  //! Marks the first length unconsumed bytes as consumed
+  void Consume(std::size_t length);
+  //! Drops all data
+  void Clear();
+
+  //! The length of the longest prefix of data that doesn't end in an incomplete UTF-8 sequence
+  static std::size_t CompleteUTF8Length(const char *data, std::size_t length);
+
+private:
+  //! The bytes we have received. Everything before m_start is already consumed.
+  std::vector<char> m_data;
+  //! The index of the first unconsumed byte in m_data
+  std::size_t m_start = 0;
+  //! true = the last byte we received was a "\r"
+  bool m_lastWasCR = false;
+};
+
+#endif
@@ -0,0 +1,98 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_SPSCQUEUE_H
+#define WXMAXIMA_SPSCQUEUE_H
+
+/*! \file
+ *
+ * Declares a lock-free queue for passing data from one thread to another.
+ */
+
+#include <atomic>
+#include <utility>
+
+/*! A lock-free, unbounded single-producer single-consumer queue
+
+  Push() may only be called by one thread and Pop() by only one other thread.
+  Neither of them ever blocks: The queue is a linked list whose head only the
+  consumer and whose tail only the producer touches, the only shared state
+  being the next pointer of the newest node.
+*/
+template <class T> class SpscQueue
+{
+public:
+  SpscQueue() : m_head(new Node), m_tail(m_head) {}
+  ~SpscQueue()
+    {
+      while(m_head)
+        {
+          Node *next = m_head->next.load(std::memory_order_relaxed);
+          delete m_head;
+          m_head = next;
+        }
+    }
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  //! Append an item to the queue. Called by the producer thread only.
+  void Push(T &&value)
+    {
+      Node *node = new Node;
+      node->value = std::move(value);
+      m_tail->next.store(node, std::memory_order_release);
+      m_tail = node;
+    }
+
+  /*! Remove the oldest item from the queue. Called by the consumer thread only.
+
+    \returns false, if the queue was empty.
+  */
+  bool Pop(T &value)
+    {
+      Node *next = m_head->next.load(std::memory_order_acquire);
+      if(!next)
+        return false;
+      value = std::move(next->value);
+      delete m_head;
+      m_head = next;
+      return true;
+    }
+
+  //! Is the queue empty? Reliable only if called by the consumer thread.
+  bool IsEmpty() const
+    {
+      return m_head->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+  struct Node
+  {
+    std::atomic<Node *> next{nullptr};
+    T value;
+  };
+  //! A node whose value already has been consumed. Owned by the consumer.
+  Node *m_head;
+  //! The newest node. Owned by the producer.
+  Node *m_tail;
+};
+
+#endif
@@ -37,6 +37,7 @@
 #include <wx/zstream.h>
 #include "SvgBitmap.h"
 #include "Image.h"
+#include "PixelConversion.h"
 #include "invalidImage.h"
 
 SvgBitmap::SvgBitmap(wxWindow *window, const unsigned char *data, const std::size_t len,
@@ -117,15 +118,11 @@ const SvgBitmap &SvgBitmap::SetSize(int width, int height) {
   const unsigned char *rgba = imgdata.data();
   for (int y = 0; y < height; y++) {
     dst.MoveTo(bmpdata, 0, y);
-    for (int x = 0; x < width; x++) {
-      unsigned char a = rgba[3];
-      dst.Red() = rgba[0] * a / 255;
-      dst.Green() = rgba[1] * a / 255;
-      dst.Blue() = rgba[2] * a / 255;
-      dst.Alpha() = a;
-      dst++;
-      rgba += 4;
-    }
+    PremultiplyRGBA(rgba, dst.m_ptr, width, wxAlphaPixelData::PixelFormat::RED,
+                    wxAlphaPixelData::PixelFormat::GREEN,
+                    wxAlphaPixelData::PixelFormat::BLUE,
+                    wxAlphaPixelData::PixelFormat::ALPHA);
+    rgba += 4 * width;
   }
   return *this;
 }
@@ -0,0 +1,270 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class TaskPool.
+*/
+
+#include "TaskPool.h"
+#include <algorithm>
+#include <chrono>
+
+//! What the pool knows about a task
+struct TaskPool::State
+{
+  enum Status
+  {
+    QUEUED,
+    RUNNING,
+    DONE
+  };
+  State(TaskPool *pool, Subsystem subsystem, std::function<void()> &&function,
+        CancellationToken &&token) :
+    pool(pool), subsystem(subsystem), function(std::move(function)),
+    token(std::move(token)), submitted(std::chrono::steady_clock::now())
+    {}
+
+  TaskPool *const pool;
+  const Subsystem subsystem;
+  std::function<void()> function;
+  CancellationToken token;
+  const std::chrono::steady_clock::time_point submitted;
+  std::atomic<int> status{QUEUED};
+  //! Protects done
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+};
+
+namespace {
+//! The pool the current thread is a worker of
+thread_local TaskPool *currentPool = NULL;
+//! The index of the worker the current thread is
+thread_local std::size_t currentWorker = 0;
+}
+
+TaskPool::TaskPool(std::size_t workers)
+{
+  if(workers == 0)
+    {
+      workers = std::thread::hardware_concurrency();
+      if(workers < 1)
+        workers = 8;
+      if(workers < 4)
+        workers = 4;
+    }
+  for(std::size_t i = 0; i < workers; i++)
+    m_queues.emplace_back(new Queue);
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stop = true;
+  }
+  m_wakeUp.notify_all();
+  for(auto &worker : m_workers)
+    if(worker.joinable())
+      worker.join();
+}
+
+TaskPool &TaskPool::Get()
+{
+  static TaskPool pool;
+  return pool;
+}
+
+const char *TaskPool::GetSubsystemName(Subsystem subsystem)
+{
+  switch(subsystem)
+    {
+    case IMAGES:
+      return "images";
+    case GNUPLOT_SOURCES:
+      return "gnuplot sources";
+    case AUTOCOMPLETE:
+      return "autocomplete";
+    case MANUAL:
+      return "manual";
+    default:
+      return "other";
+    }
+}
+
+void TaskPool::StartWorkers()
+{
+  std::call_once(m_workersStarted, [this]() {
+    for(std::size_t i = 0; i < m_queues.size(); i++)
+      m_workers.emplace_back(&TaskPool::WorkerLoop, this, i);
+  });
+}
+
+TaskPool::Task TaskPool::Submit(Subsystem subsystem, Priority priority,
+                                std::function<void()> function,
+                                CancellationToken token)
+{
+  auto state = std::make_shared<State>(this, subsystem, std::move(function),
+                                       std::move(token));
+  StartWorkers();
+  std::size_t queue;
+  if(currentPool == this)
+    queue = currentWorker;
+  else
+    queue = m_nextQueue++ % m_queues.size();
+  m_counters[subsystem].queueDepth++;
+  {
+    std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+    m_queues[queue]->tasks[priority].push_back(state);
+  }
+  // Incremented before the workers' mutex is locked: A worker that is about to
+  // go to sleep therefore either sees the new task or gets the notification.
+  m_pending++;
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+  }
+  m_wakeUp.notify_one();
+  return Task(std::move(state));
+}
+
+std::shared_ptr<TaskPool::State> TaskPool::FindTask(std::size_t index)
+{
+  for(int priority = 0; priority < PRIORITY_COUNT; priority++)
+    {
+      // Our own tasks are run in the order they were submitted
+      {
+        Queue &own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        auto &tasks = own.tasks[priority];
+        if(!tasks.empty())
+          {
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+            m_pending--;
+            return task;
+          }
+      }
+      // Steal from the end of the other queues, which are the tasks their
+      // owners will need last
+      for(std::size_t i = 1; i < m_queues.size(); i++)
+        {
+          Queue &victim = *m_queues[(index + i) % m_queues.size()];
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          auto &tasks = victim.tasks[priority];
+          if(!tasks.empty())
+            {
+              auto task = std::move(tasks.back());
+              tasks.pop_back();
+              m_pending--;
+              return task;
+            }
+        }
+    }
+  return NULL;
+}
+
+void TaskPool::WorkerLoop(std::size_t index)
+{
+  currentPool = this;
+  currentWorker = index;
+  for(;;)
+    {
+      auto task = FindTask(index);
+      if(task)
+        {
+          Run(task);
+          continue;
+        }
+      std::unique_lock<std::mutex> lock(m_sleepMutex);
+      m_wakeUp.wait(lock, [this]() { return m_stop || (m_pending > 0); });
+      if(m_stop)
+        return;
+    }
+}
+
+void TaskPool::Run(const std::shared_ptr<State> &task)
+{
+  // The task might already have been run by a thread that waited for it
+  int expected = State::QUEUED;
+  if(!task->status.compare_exchange_strong(expected, State::RUNNING))
+    return;
+
+  Counters &counters = m_counters[task->subsystem];
+  counters.queueDepth--;
+  if(task->token.IsCancelled())
+    counters.cancelled++;
+  else
+    {
+      const std::uint64_t latency =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - task->submitted).count();
+      counters.totalLatency += latency;
+      std::uint64_t maxLatency = counters.maxLatency;
+      while((latency > maxLatency) &&
+            !counters.maxLatency.compare_exchange_weak(maxLatency, latency))
+        {}
+      task->function();
+      counters.completed++;
+    }
+  // Free whatever the function has captured
+  task->function = nullptr;
+
+  task->status = State::DONE;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->done = true;
+  }
+  task->finished.notify_all();
+}
+
+TaskPool::Statistics TaskPool::GetStatistics(Subsystem subsystem) const
+{
+  const Counters &counters = m_counters[subsystem];
+  Statistics statistics;
+  statistics.queueDepth = counters.queueDepth;
+  statistics.completed = counters.completed;
+  statistics.cancelled = counters.cancelled;
+  statistics.totalLatency = counters.totalLatency;
+  statistics.maxLatency = counters.maxLatency;
+  return statistics;
+}
+
+bool TaskPool::Task::IsDone() const
+{
+  if(!m_state)
+    return true;
+  return m_state->status == State::DONE;
+}
+
+void TaskPool::Task::Wait()
+{
+  if(!m_state)
+    return;
+  m_state->pool->Run(m_state);
+  std::unique_lock<std::mutex> lock(m_state->mutex);
+  m_state->finished.wait(lock, [this]() { return m_state->done; });
+}
+
+void TaskPool::Task::Cancel()
+{
+  if(m_state)
+    m_state->token.Cancel();
+}
@@ -0,0 +1,208 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_TASKPOOL_H
+#define WXMAXIMA_TASKPOOL_H
+
+/*! \file
+ *
+ * Declares the pool of threads all background tasks are run on.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! A work-stealing pool of threads for all background tasks
+
+  Opening a notebook with hundreds of plots used to create a thread per image
+  and per gnuplot source, most of which were blocked by a static counter that
+  limited how many of them actually ran. Instead all background tasks now are
+  submitted to this pool, which runs them on a fixed number of threads.
+
+  Every worker has a queue per priority. Tasks submitted from outside the pool
+  are distributed over the queues round robin, tasks a task submits go to the
+  queue of the worker it runs on. A worker that has run out of tasks steals
+  one from the other end of the queue of another worker. Tasks with a higher
+  priority are always started before the ones with a lower priority.
+
+  Waiting for a task that hasn't been started yet runs it on the waiting
+  thread, which means that waiting for a task never has to wait for the
+  pool to find time for it.
+*/
+class TaskPool
+{
+public:
+  //! The priorities of tasks. Lower values are started first.
+  enum Priority
+  {
+    HIGH,
+    NORMAL,
+    LOW,
+    PRIORITY_COUNT
+  };
+
+  //! The parts of wxMaxima that submit tasks. Used for the statistics.
+  enum Subsystem
+  {
+    IMAGES,
+    GNUPLOT_SOURCES,
+    AUTOCOMPLETE,
+    MANUAL,
+    OTHER,
+    SUBSYSTEM_COUNT
+  };
+
+  /*! Allows to tell a task that its result isn't needed any more
+
+    A task whose token has been cancelled before it was started isn't run at
+    all. Long-running tasks can check IsCancelled() in order to abort early.
+    Copies of a token share its state.
+  */
+  class CancellationToken
+  {
+  public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+    void Cancel() { m_cancelled->store(true); }
+    bool IsCancelled() const { return m_cancelled->load(); }
+  private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+  };
+
+  //! What the pool knows about the tasks of a subsystem
+  struct Statistics
+  {
+    //! The number of tasks that wait for being started
+    std::size_t queueDepth = 0;
+    //! The number of tasks that have been run
+    std::uint64_t completed = 0;
+    //! The number of tasks that have been cancelled before they were started
+    std::uint64_t cancelled = 0;
+    //! The sum of the times between the submission and the start of the tasks, in µs
+    std::uint64_t totalLatency = 0;
+    //! The longest time a task had to wait for being started, in µs
+    std::uint64_t maxLatency = 0;
+  };
+
+private:
+  struct State;
+
+public:
+  /*! A handle to a submitted task
+
+    A default-constructed handle refers to no task; Wait() and Cancel()
+    do nothing for it.
+  */
+  class Task
+  {
+  public:
+    Task() = default;
+    //! Does this handle refer to a task?
+    bool IsValid() const { return static_cast<bool>(m_state); }
+    //! Has the task been run or been skipped because it was cancelled? true for no task.
+    bool IsDone() const;
+    //! Waits for the task to finish. Runs it on this thread, if it hasn't been started yet.
+    void Wait();
+    //! Tells the task that its result isn't needed any more
+    void Cancel();
+  private:
+    friend class TaskPool;
+    explicit Task(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+    std::shared_ptr<State> m_state;
+  };
+
+  /*! Creates a pool
+
+    \param workers The number of threads. 0 means: As many as we have
+    processors, but at least 4, as many tasks wait for the disk.
+  */
+  explicit TaskPool(std::size_t workers = 0);
+  //! Waits for the tasks that are running and discards the ones that aren't
+  ~TaskPool();
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  //! The pool all of wxMaxima's background tasks run on
+  static TaskPool &Get();
+
+  /*! Schedules a function to be run in the background
+
+    The threads of the pool are only started when the first task is submitted.
+  */
+  Task Submit(Subsystem subsystem, Priority priority, std::function<void()> function,
+              CancellationToken token = CancellationToken());
+
+  //! The statistics of a subsystem
+  Statistics GetStatistics(Subsystem subsystem) const;
+  //! The name of a subsystem, for logging the statistics
+  static const char *GetSubsystemName(Subsystem subsystem);
+  //! The number of threads of the pool
+  std::size_t GetWorkerCount() const { return m_queues.size(); }
+
+private:
+  //! The tasks of one worker
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<State>> tasks[PRIORITY_COUNT];
+  };
+  //! The statistics of a subsystem, as they are collected
+  struct Counters
+  {
+    std::atomic<std::size_t> queueDepth{0};
+    std::atomic<std::uint64_t> completed{0};
+    std::atomic<std::uint64_t> cancelled{0};
+    std::atomic<std::uint64_t> totalLatency{0};
+    std::atomic<std::uint64_t> maxLatency{0};
+  };
+
+  //! The main loop of a worker thread
+  void WorkerLoop(std::size_t index);
+  //! Removes the next task a worker should run from the queues, or returns NULL
+  std::shared_ptr<State> FindTask(std::size_t index);
+  //! Runs a task, unless it has already been started elsewhere
+  void Run(const std::shared_ptr<State> &task);
+  //! Starts the worker threads, if that hasn't happened yet
+  void StartWorkers();
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  std::once_flag m_workersStarted;
+  //! The queue the next task from outside the pool is added to
+  std::atomic<std::size_t> m_nextQueue{0};
+  //! The number of tasks in all queues
+  std::atomic<std::size_t> m_pending{0};
+  //! Protects the sleep of the workers and m_stop
+  std::mutex m_sleepMutex;
+  //! Wakes up the workers when there are new tasks
+  std::condition_variable m_wakeUp;
+  bool m_stop = false;
+  Counters m_counters[SUBSYSTEM_COUNT];
+};
+
+#endif
@@ -27,24 +27,301 @@
 
 #include <utility>
 #include <algorithm>
+#include <deque>
 #include <memory>
 #include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "WXMXformat.h"
+#include "AutosaveJournal.h"
 #include "CellPointers.h"
 #include "ErrorRedirector.h"
+#include "TaskPool.h"
+#include "XmlPullParser.h"
+#include "ZipIndex.h"
 #include "cells/CellList.h"
 #include "cells/ImgCell.h"
 #include <wx/debug.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
 #include <wx/textbuf.h>
 #include <wx/txtstrm.h>
 #include <wx/tokenzr.h>
-#include <wx/xml/xml.h>
-#include <wx/mstream.h>
 #include <wx/zipstrm.h>
 #include <wx/clipbrd.h>
+
+namespace {
+/*! Writes the XML of a document to a stream in chunks, checking it on the way
+
+  Building the XML of the whole document as one string and loading it into a
+  wxXmlDocument in order to check that it is valid needed several times the
+  memory the XML itself needs. Instead the XML is collected in chunks of about
+  a megabyte. Each chunk is checked for being well-formed by the task pool
+  while the next ones are generated, and is written as soon as it has been
+  found to be OK.
+*/
+class XmlChunkWriter
+{
+public:
+  XmlChunkWriter(wxOutputStream &out, bool useThreads) :
+    m_out(out), m_useThreads(useThreads)
+    {
+      m_chunk = std::make_unique<Chunk>();
+    }
+  ~XmlChunkWriter()
+    {
+      for (auto &chunk : m_chunks)
+        chunk->validation.Wait();
+    }
+  /*! Appends XML to the document. Returns false if invalid XML has been found.
+
+    \param xml The XML to append
+    \param mayEndChunk false = an element is still open after this XML, which
+    means that the chunk cannot end here.
+  */
+  bool Append(const wxString &xml, bool mayEndChunk = true)
+    {
+      const wxScopedCharBuffer utf8 = xml.utf8_str();
+      m_chunk->xml.append(utf8.data(), utf8.length());
+      if ((!mayEndChunk) || (m_chunk->xml.size() < ChunkSize))
+        return true;
+      SubmitChunk();
+      if (m_chunks.size() > MaxChunksInFlight)
+        return WriteOldestChunk();
+      return true;
+    }
+  //! Writes all XML that hasn't been written yet. Returns false if it was invalid.
+  bool Flush()
+    {
+      SubmitChunk();
+      while (!m_chunks.empty())
+        if (!WriteOldestChunk())
+          return false;
+      return true;
+    }
+  //! The XML that has been found to be not well-formed
+  const std::string &GetInvalidXml() const { return m_invalidXml; }
+
+  //! Is this well-formed XML without any control characters XML doesn't allow?
+  static bool IsWellFormed(const std::string &xml)
+    {
+      // XML doesn't allow most control characters, not even as entities.
+      for (char ch : xml)
+        {
+          const unsigned char uch = static_cast<unsigned char>(ch);
+          if ((uch < 0x20) && (uch != '\t') && (uch != '\n') && (uch != '\r'))
+            return false;
+        }
+      XmlPullParser parser(xml.data(), xml.size());
+      XmlPullParser::TokenType token;
+      while ((token = parser.Next()) != XmlPullParser::END_OF_DATA)
+        if (token == XmlPullParser::ERROR)
+          return false;
+      return true;
+    }
+
+private:
+  //! A root element that allows to check a chunk of XML on its own
+  static constexpr const char *ChunkStart = "<chunk>";
+  static constexpr const char *ChunkEnd = "</chunk>";
+  static constexpr std::size_t ChunkStartLength = 7;
+  static constexpr std::size_t ChunkEndLength = 8;
+  //! The size of the chunks, in bytes
+  static constexpr std::size_t ChunkSize = 1024 * 1024;
+  //! The number of chunks we allow to wait for being written
+  static constexpr std::size_t MaxChunksInFlight = 8;
+
+  struct Chunk
+  {
+    Chunk() : xml(ChunkStart) {}
+    std::string xml;
+    bool valid = false;
+    TaskPool::Task validation;
+  };
+
+  void SubmitChunk()
+    {
+      if (m_chunk->xml.size() == ChunkStartLength)
+        return;
+      m_chunk->xml += ChunkEnd;
+      Chunk *chunk = m_chunk.get();
+      if (m_useThreads)
+        chunk->validation =
+          TaskPool::Get().Submit(TaskPool::OTHER, TaskPool::HIGH,
+                                 [chunk]() { chunk->valid = IsWellFormed(chunk->xml); });
+      else
+        chunk->valid = IsWellFormed(chunk->xml);
+      m_chunks.push_back(std::move(m_chunk));
+      m_chunk = std::make_unique<Chunk>();
+    }
+
+  bool WriteOldestChunk()
+    {
+      std::unique_ptr<Chunk> chunk = std::move(m_chunks.front());
+      m_chunks.pop_front();
+      chunk->validation.Wait();
+      const char *xml = chunk->xml.data() + ChunkStartLength;
+      const std::size_t length = chunk->xml.size() - ChunkStartLength - ChunkEndLength;
+      if (!chunk->valid)
+        {
+          m_invalidXml.assign(xml, length);
+          return false;
+        }
+      m_out.Write(xml, length);
+      return m_out.IsOk();
+    }
+
+  wxOutputStream &m_out;
+  const bool m_useThreads;
+  //! The chunk we currently append to
+  std::unique_ptr<Chunk> m_chunk;
+  //! The chunks that wait for being written, oldest first
+  std::deque<std::unique_ptr<Chunk>> m_chunks;
+  std::string m_invalidXml;
+};
+
+/*! Splits the content.xml of a .wxmx file into the header and the cells
+
+  \param xml The contents of content.xml
+  \param header Receives everything up to and including the <wxMaximaDocument> tag
+  \param cells Receives the XML of each cell. Cells that are highlighted are
+  wrapped into their own highlight tag.
+  \return false, if the XML isn't well-formed.
+*/
+bool SplitContentXml(const std::string &xml, std::string &header,
+                     std::vector<std::string> &cells)
+{
+  XmlPullParser parser(xml.data(), xml.size());
+  std::string highlightTag;
+  std::size_t cellStart = 0;
+  std::size_t cellDepth = 0;
+  for (;;)
+    {
+      switch (parser.Next())
+        {
+        case XmlPullParser::START_TAG:
+          if (parser.Depth() == 1)
+            header = xml.substr(0, parser.TokenEnd());
+          else if ((parser.Depth() == 2) && (parser.Name() == "hl"))
+            highlightTag = xml.substr(parser.TokenStart(),
+                                      parser.TokenEnd() - parser.TokenStart());
+          else if ((cellDepth == 0) && (parser.Name() == "cell") &&
+                   (parser.Depth() == (highlightTag.empty() ? 2u : 3u)))
+            {
+              cellStart = parser.TokenStart();
+              cellDepth = parser.Depth();
+            }
+          break;
+        case XmlPullParser::END_TAG:
+          if ((cellDepth > 0) && (parser.Depth() == cellDepth - 1))
+            {
+              std::string cell = xml.substr(cellStart, parser.TokenEnd() - cellStart);
+              if (highlightTag.empty())
+                cells.push_back(std::move(cell));
+              else
+                cells.push_back(highlightTag + cell + "</hl>");
+              cellDepth = 0;
+            }
+          else if ((parser.Depth() == 1) && (parser.Name() == "hl"))
+            highlightTag.clear();
+          break;
+        case XmlPullParser::ERROR:
+          return false;
+        case XmlPullParser::END_OF_DATA:
+          return true;
+        default:
+          break;
+        }
+    }
+}
+
+//! Does the XML of a cell refer to the file with this name?
+bool RefersToFile(const std::string &xml, const std::string &name)
+{
+  // File names appear as the text of a tag, in a list of animation frames
+  // that are separated by semicolons, or as the value of an attribute.
+  static const char before[] = ">;\"";
+  static const char after[] = "<;\"";
+  for (std::size_t pos = xml.find(name); pos != std::string::npos;
+       pos = xml.find(name, pos + 1))
+    {
+      const std::size_t end = pos + name.size();
+      if ((pos > 0) && std::strchr(before, xml[pos - 1]) &&
+          (end < xml.size()) && std::strchr(after, xml[end]))
+        return true;
+    }
+  return false;
+}
+
+//! Reads the current entry of a zip archive
+std::string ReadZipEntry(wxZipInputStream &zip)
+{
+  std::string data;
+  char buf[65536];
+  while (zip.Read(buf, sizeof(buf)).LastRead() > 0)
+    data.append(buf, zip.LastRead());
+  return data;
+}
+}
+
 namespace Format {
 
+  wxString DocumentHeader(GroupCell *cells, Configuration *configuration,
+                          const std::vector<wxString> &variables,
+                          const GroupCell * const cursorCell) {
+  wxString xmlHeader;
+
+  xmlHeader << wxS("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  xmlHeader << wxS("\n<!--   Created using wxMaxima ") << wxS(GITVERSION)
+            << wxS("   -->");
+  xmlHeader << wxS(
+                   "\n<!--https://wxMaxima-developers.github.io/wxmaxima/-->\n");
+
+  // write document
+  xmlHeader << wxS("\n<wxMaximaDocument version=\"");
+  xmlHeader << DOCUMENT_VERSION_MAJOR << wxS(".");
+  xmlHeader << DOCUMENT_VERSION_MINOR << wxS("\" zoom=\"");
+  xmlHeader << int(100.0 * configuration->GetZoomFactor()) << wxS("\"");
+
+  std::size_t ActiveCellNumber = 0;
+
+  // We want to save the information that the cursor is in the nth cell.
+  // Count the cells until then.
+  bool found = false;
+  if (cells)
+    for (const GroupCell &tmp : OnList(cells)) {
+      if (&tmp == cursorCell) {
+        found = true;
+        break;
+      }
+      ActiveCellNumber++;
+    }
+
+  // Paranoia: Test if we did find the cursor
+  if (cells && found)
+    // If we know where the cursor was we save this piece of information.
+    // If not we omit it.
+    xmlHeader << wxString::Format(wxS(" activecell=\"%li\""),
+                                  static_cast<long>(ActiveCellNumber));
+
+  // Save the variables list for the "variables" sidepane.
+  if (variables.size() > 1) {
+    std::size_t varcount = variables.size() - 1;
+    xmlHeader += wxString::Format(" variables_num=\"%li\"", static_cast<long>(varcount));
+    for (std::size_t i = 0; i < variables.size(); i++)
+      xmlHeader +=
+        wxString::Format(" variables_%li=\"%s\"", static_cast<long>(i),
+                         Cell::XMLescape(variables.at(i)).utf8_str());
+  }
+
+  xmlHeader << ">\n";
+  return xmlHeader;
+}
+
   /*
   Save the data as wxmx file
 
@@ -95,8 +372,8 @@ namespace Format {
 
         // Make sure that the mime type is stored as plain text.
         //
-        // We will keep that setting for the rest of the file for the following
-        // reasons:
+        // Unless the user asks us to compress content.xml we will keep that
+        // setting for the rest of the file for the following reasons:
         //  - Compression of the .zip file won't improve compression of the
         //  embedded .png images
         //  - The text part of the file is too small to justify compression
@@ -161,115 +438,80 @@ namespace Format {
         zip.CloseEntry();
 
         // next zip entry is "content.xml", xml of cells
-
+        if (configuration->CompressWxmx())
+          zip.SetLevel(wxZ_DEFAULT_COMPRESSION);
         zip.PutNextEntry(wxS("content.xml"));
-        wxString xmlText;
-
-        xmlText << wxS("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-        xmlText << wxS("\n<!--   Created using wxMaxima ") << wxS(GITVERSION)
-                << wxS("   -->");
-        xmlText << wxS(
-                       "\n<!--https://wxMaxima-developers.github.io/wxmaxima/-->\n");
-
-        // write document
-        xmlText << wxS("\n<wxMaximaDocument version=\"");
-        xmlText << DOCUMENT_VERSION_MAJOR << wxS(".");
-        xmlText << DOCUMENT_VERSION_MINOR << wxS("\" zoom=\"");
-        xmlText << int(100.0 * configuration->GetZoomFactor()) << wxS("\"");
-
-        std::size_t ActiveCellNumber = 0;
-
-        // We want to save the information that the cursor is in the nth cell.
-        // Count the cells until then.
-        bool found = false;
-        if (cells)
-          for (const GroupCell &tmp : OnList(cells)) {
-            if (&tmp == cursorCell) {
-              found = true;
-              break;
-            }
-            ActiveCellNumber++;
-          }
-
-        // Paranoia: Test if we did find the cursor
-        if (cells && found)
-          // If we know where the cursor was we save this piece of information.
-          // If not we omit it.
-          xmlText << wxString::Format(wxS(" activecell=\"%li\""),
-                                      static_cast<long>(ActiveCellNumber));
-
-        // Save the variables list for the "variables" sidepane.
-        if (variables.size() > 1) {
-          std::size_t varcount = variables.size() - 1;
-          xmlText += wxString::Format(" variables_num=\"%li\"", static_cast<long>(varcount));
-          for (std::size_t i = 0; i < variables.size(); i++)
-            xmlText +=
-              wxString::Format(" variables_%li=\"%s\"", static_cast<long>(i),
-                               Cell::XMLescape(variables.at(i)).utf8_str());
-        }
-
-        xmlText << ">\n";
+        const wxString xmlHeader = DocumentHeader(cells, configuration, variables,
+                                                  cursorCell);
 
         // Reset image counter
         cellPointers->WXMXResetCounter();
 
-        if (cells)
-          xmlText += cells->ListToXML();
-
-        // Delete all but one control character from the string: there should be
-        // no way for them to enter this string, anyway. But sometimes they
-        // still do...
-        for (wxString::const_iterator it = xmlText.begin(); it != xmlText.end();
-             ++it) {
-          wxChar c = *it;
-          if ((c < wxS('\t')) || ((c > wxS('\n')) && (c < wxS(' '))) ||
-              (c == wxChar(static_cast<char>(0x7F)))) {
-            // *it = wxS(' ');
-          }
-        }
-
-        xmlText += wxS("\n</wxMaximaDocument>");
-        wxLogMessage(_("Generated the XML representation of the document"));
-
-        {
-          // Let wxWidgets test if the document can be read again by the XML
-          // parser before the user finds out the hard way.
+        // The XML of the cells is generated cell by cell and checked and written
+        // in chunks while the next cells are converted to XML.
+        bool valid = true;
+        wxString invalidXml;
+        if (cells != NULL)
           {
-            wxXmlDocument doc;
+            const wxScopedCharBuffer header = xmlHeader.utf8_str();
             {
-              wxMemoryOutputStream ostream;
-              wxTextOutputStream txtstrm(ostream);
-              txtstrm.WriteString(xmlText);
-              wxMemoryInputStream istream(ostream);
-              wxLogNull suppressErrorMessages;
-              doc.Load(istream);
+              // The header is checked together with the end tag of the document
+              const std::string headerXml = std::string(header.data(), header.length()) +
+                "</wxMaximaDocument>";
+              valid = XmlChunkWriter::IsWellFormed(headerXml);
+              if (!valid)
+                invalidXml = xmlHeader;
             }
-
-            // If we fail to load the document we abort the safe process as it
-            // will only destroy data. But we can still put the erroneous data
-            // into the clipboard for debugging purposes.
-            if (!doc.IsOk()) {
-              if (wxTheClipboard->Open()) {
-                wxDataObjectComposite *data = new wxDataObjectComposite;
-                data->Add(new wxTextDataObject(xmlText));
-                wxTheClipboard->SetData(data);
-                LoggingMessageDialog dialog(NULL, _("Produced invalid XML. The erroneous XML data has "
-                                                    "therefore not been saved but has been put on the "
-                                                    "clipboard in order to allow to debug it."),
-                                            _("Error"), wxCENTER | wxOK);
-                dialog.ShowModal();
-                wxTheClipboard->Close();
+            if (valid)
+              {
+                zip.Write(header.data(), header.length());
+                XmlChunkWriter writer(zip, configuration->UseThreads());
+                bool highlight = false;
+                for (const GroupCell &tmp : OnList(cells)) {
+                  wxString xml;
+                  if ((tmp.GetHighlight()) && (!highlight)) {
+                    xml += wxS("<hl boxname=\"highlight\">\n");
+                    highlight = true;
+                  }
+                  if ((!tmp.GetHighlight()) && (highlight)) {
+                    xml += wxS("</hl>\n");
+                    highlight = false;
+                  }
+                  xml += tmp.ToXML();
+                  if (!(valid = writer.Append(xml, !highlight)))
+                    break;
+                }
+                if (valid && highlight)
+                  valid = writer.Append(wxS("</hl>\n"));
+                if (valid)
+                  valid = writer.Flush();
+                if (!valid)
+                  invalidXml = wxString::FromUTF8(writer.GetInvalidXml().data(),
+                                                  writer.GetInvalidXml().size());
               }
+            if (valid)
+              output << wxS("\n</wxMaximaDocument>");
+          }
 
-              return false;
+        {
+          // If we produced invalid XML we abort the safe process as it
+          // will only destroy data. But we can still put the erroneous data
+          // into the clipboard for debugging purposes.
+          if (!valid) {
+            if (wxTheClipboard->Open()) {
+              wxDataObjectComposite *data = new wxDataObjectComposite;
+              data->Add(new wxTextDataObject(invalidXml));
+              wxTheClipboard->SetData(data);
+              LoggingMessageDialog dialog(NULL, _("Produced invalid XML. The erroneous XML data has "
+                                                  "therefore not been saved but has been put on the "
+                                                  "clipboard in order to allow to debug it."),
+                                          _("Error"), wxCENTER | wxOK);
+              dialog.ShowModal();
+              wxTheClipboard->Close();
             }
-          }
-          wxLogMessage(_("Validated that the XML representation of the document actually is valid XML"));
 
-          // wxWidgets could pretty-print the XML document now. But as no-one
-          // will look at it, anyway, there might be no good reason to do so.
-          if (cells != NULL)
-            output << xmlText;
+            return false;
+          }
           zip.CloseEntry();
           wxLogMessage(_("Wrote the XML representation of the document to the zip archive"));
 
@@ -368,10 +610,161 @@ namespace Format {
           return false;
         }
     }
+    // The images in the file now are at different offsets
+    ZipIndex::Forget(file);
     wxLogMessage(_("wxmx file saved"));
   }
   return true;
 }
 
+wxString AutosaveJournalFile(const wxString &wxmxFile) {
+  return wxmxFile + wxS(".journal");
+}
+
+bool CellToJournalXml(const GroupCell &cell, std::string &xml) {
+  wxString cellXml = cell.ToXML();
+  if (cell.GetHighlight())
+    cellXml = wxS("<hl boxname=\"highlight\">") + cellXml + wxS("</hl>");
+  const wxScopedCharBuffer utf8 = cellXml.utf8_str();
+  xml.assign(utf8.data(), utf8.length());
+  return XmlChunkWriter::IsWellFormed(xml);
+}
+
+bool ReplayAutosaveJournal(const wxString &journalFile, const wxString &file,
+                           std::size_t maxJournalBytes) {
+  // We might run in the background => Errors are reported by our return value
+  // instead of by a dialog.
+  wxLogNull suppressErrorDialogs;
+  std::string journalData;
+  {
+    wxFile journal(journalFile);
+    if (!journal.IsOpened())
+      return false;
+    const wxFileOffset length = journal.Length();
+    if (length < 0)
+      return false;
+    journalData.resize(std::min(static_cast<std::size_t>(length), maxJournalBytes));
+    if (!journalData.empty() &&
+        (journal.Read(&journalData[0], journalData.size()) !=
+         static_cast<ssize_t>(journalData.size())))
+      return false;
+  }
+  AutosaveJournal::Contents contents;
+  if (!AutosaveJournal::Read(journalData.data(), journalData.size(), contents))
+    return false;
+  journalData.clear();
+
+  // Read the snapshot the journal belongs to
+  wxFileName snapshotFile(journalFile);
+  snapshotFile.SetFullName(wxString::FromUTF8(contents.snapshot.data(),
+                                              contents.snapshot.size()));
+  std::string contentXml;
+  std::vector<std::pair<wxString, std::string>> entries;
+  {
+    wxFFileInputStream snapshot(snapshotFile.GetFullPath());
+    if (!snapshot.IsOk())
+      return false;
+    wxZipInputStream zip(snapshot);
+    std::unique_ptr<wxZipEntry> entry;
+    while (entry.reset(zip.GetNextEntry()), entry)
+      {
+        if (entry->GetName() == wxS("content.xml"))
+          contentXml = ReadZipEntry(zip);
+        else
+          entries.emplace_back(entry->GetName(), ReadZipEntry(zip));
+      }
+    if (zip.GetLastError() > wxSTREAM_EOF)
+      return false;
+  }
+  std::string header;
+  std::vector<std::string> snapshotCells;
+  if (!SplitContentXml(contentXml, header, snapshotCells) ||
+      (snapshotCells.size() != contents.baseCells.size()))
+    return false;
+  contentXml.clear();
+  if (!contents.header.empty())
+    header = contents.header;
+
+  std::unordered_map<AutosaveJournal::CellId, const std::string *> cellXml;
+  for (std::size_t i = 0; i < snapshotCells.size(); i++)
+    cellXml[contents.baseCells[i]] = &snapshotCells[i];
+  for (const auto &cell : contents.changedCells)
+    cellXml[cell.first] = &cell.second;
+  std::vector<const std::string *> cells;
+  for (const auto &id : contents.cells)
+    {
+      const auto xml = cellXml.find(id);
+      if (xml == cellXml.end())
+        return false;
+      cells.push_back(xml->second);
+    }
+  if (header.empty() && !cells.empty())
+    return false;
+
+  // Only the files the cells still refer to are worth keeping
+  for (const auto &journalFileEntry : contents.files)
+    entries.emplace_back(wxString::FromUTF8(journalFileEntry.first.data(),
+                                            journalFileEntry.first.size()),
+                         journalFileEntry.second);
+  contents.files.clear();
+
+  const wxString backupfile = file + wxS("~");
+  {
+    wxFFileOutputStream out(backupfile);
+    if (!out.IsOk())
+      return false;
+    wxZipOutputStream zip(out);
+    zip.SetLevel(0);
+    std::vector<bool> written(entries.size(), false);
+    // The mimetype has to stay the first entry of the archive
+    for (std::size_t i = 0; i < entries.size(); i++)
+      if ((entries[i].first == wxS("mimetype")) || (entries[i].first == wxS("format.txt")))
+        {
+          zip.PutNextEntry(entries[i].first);
+          zip.Write(entries[i].second.data(), entries[i].second.size());
+          zip.CloseEntry();
+          written[i] = true;
+        }
+    zip.PutNextEntry(wxS("content.xml"));
+    if (!cells.empty())
+      {
+        zip.Write(header.data(), header.size());
+        for (const auto &cell : cells)
+          {
+            zip.Write("\n", 1);
+            zip.Write(cell->data(), cell->size());
+          }
+        const char documentEnd[] = "\n</wxMaximaDocument>";
+        zip.Write(documentEnd, std::strlen(documentEnd));
+      }
+    zip.CloseEntry();
+    std::unordered_set<std::string> filesWritten;
+    // Newer versions of a file come later in the list
+    for (std::size_t i = entries.size(); i-- > 0;)
+      {
+        const wxScopedCharBuffer name = entries[i].first.utf8_str();
+        const std::string fileName(name.data(), name.length());
+        if (written[i] || (filesWritten.count(fileName) > 0))
+          continue;
+        if (std::none_of(cells.begin(), cells.end(), [&fileName](const std::string *cell) {
+              return RefersToFile(*cell, fileName);
+            }))
+          continue;
+        zip.PutNextEntry(entries[i].first);
+        zip.Write(entries[i].second.data(), entries[i].second.size());
+        zip.CloseEntry();
+        filesWritten.insert(fileName);
+      }
+    if (!zip.Close() || !out.Close())
+      {
+        wxRemoveFile(backupfile);
+        return false;
+      }
+  }
+  if (!wxRenameFile(backupfile, file, true))
+    return false;
+  ZipIndex::Forget(file);
+  return true;
+}
 
 } // namespace Format
@@ -26,7 +26,10 @@
 #ifndef WXMXFORMAT_H
 #define WXMXFORMAT_H
 
+#include <cstddef>
+#include <limits>
 #include <memory>
+#include <string>
 #include "cells/GroupCell.h"
 #include "Configuration.h"
 #include <vector>
@@ -55,6 +58,37 @@ namespace Format
                     Configuration *configuration, CellPointers *cellPointers,
                     const std::vector<wxString> &variables, const GroupCell * const cursorCell = NULL);
 
+  //! The start of content.xml, up to and including the opening <wxMaximaDocument> tag
+  wxString DocumentHeader(GroupCell *cells, Configuration *configuration,
+                          const std::vector<wxString> &variables,
+                          const GroupCell * const cursorCell = NULL);
+
+  //! The name of the autosave journal that belongs to a .wxmx file
+  wxString AutosaveJournalFile(const wxString &wxmxFile);
+
+  /*! Generates the XML the autosave journal stores for a cell
+
+    \param cell The cell
+    \param xml Receives the cell's XML, in UTF-8
+    \return false, if the XML isn't well-formed
+  */
+  bool CellToJournalXml(const GroupCell &cell, std::string &xml);
+
+  /*! Applies an autosave journal to the .wxmx file it belongs to
+
+    Doesn't need the worksheet and therefore can be run in the background.
+    Also used for recovering the worksheet after a crash.
+
+    \param journalFile The journal
+    \param file The .wxmx file to write the result to. Can be the file the
+    journal belongs to.
+    \param maxJournalBytes Ignore everything after the first maxJournalBytes
+    bytes of the journal
+  */
+  bool ReplayAutosaveJournal(const wxString &journalFile, const wxString &file,
+                             std::size_t maxJournalBytes =
+                             std::numeric_limits<std::size_t>::max());
+
 }
 
 #endif // WXMXFORMAT_H
@@ -38,6 +38,7 @@
 #include "graphical_io/EMFout.h"
 #include "ErrorRedirector.h"
 #include "cells/ImgCell.h"
+#include "cells/OutputChunkCell.h"
 #include "MarkDown.h"
 #include "dialogs/MaxSizeChooser.h"
 #include "dialogs/ResolutionChooser.h"
@@ -270,13 +271,9 @@ bool Worksheet::RedrawIfRequested() {
         m_cellPointers.m_groupCellUnderPointer;
 
       // find out which group cell lies under the pointer
-      for (auto &tmp : OnList(GetTree())) {
-        auto rect = tmp.GetRect();
-        if (m_pointer_y <= rect.GetBottom()) {
-          GetTree()->CellUnderPointer(&tmp);
-          break;
-        }
-      }
+      GroupCell *cellUnderPointer = GetGroupCellAt(m_pointer_y);
+      if (cellUnderPointer && GetTree())
+        GetTree()->CellUnderPointer(cellUnderPointer);
 
       // Make the right brackets autohide
       if ((m_configuration->HideBrackets()) &&
@@ -389,6 +386,10 @@ void Worksheet::RequestRedraw(GroupCell *start) {
     m_redrawStart = GetTree();
   else {
     if (m_redrawStart) {
+      // The cells only learn that a cell above them has changed its height
+      // when they ask the index for their position.
+      UpdateGroupCellPosition(start);
+      UpdateGroupCellPosition(m_redrawStart.get());
       // No need to waste time avoiding to waste time in a refresh when we don't
       // know our cell's position.
       if ((start->GetCurrentPoint().y < 0) ||
@@ -463,8 +464,9 @@ void Worksheet::OnPaint(wxPaintEvent &WXUNUSED(event)) {
     return;
 
   // It is possible that the redraw starts before the idle task attempts
-  // to recalculate the worksheet.
-  RecalculateIfNeeded();
+  // to recalculate the worksheet. We only wait for the cells that are
+  // visible, though: The idle task will lay out the rest.
+  RecalculateIfNeeded(true);
 
   // Create a graphics context that supports antialiasing, but on MSW
   // only supports fonts that come in the Right Format.
@@ -524,39 +526,55 @@ void Worksheet::OnPaint(wxPaintEvent &WXUNUSED(event)) {
     // Draw the cell contents
     //
     if (GetTree()) {
-      wxPoint point;
-      point.x = m_configuration->GetIndent();
-      point.y = m_configuration->GetBaseIndent() + GetTree()->GetCenterList();
       dc.SetPen(*(wxThePenList->FindOrCreatePen(
                                                 m_configuration->GetColor(TS_MATH), 1, wxPENSTYLE_SOLID)));
       dc.SetBrush(*(wxTheBrushList->FindOrCreateBrush(
                                                       m_configuration->GetColor(TS_MATH))));
-      bool atStart = true;
-      for (auto &cell : OnList(GetTree())) {
-        if (!atStart) {
-          cell.UpdateYPosition();
-          point = cell.GetCurrentPoint();
-        }
-        atStart = false;
-
-        wxRect cellRect = cell.GetRect();
-
-        // Clear the image cache of all cells above or below the viewport.
-        if (cellRect.GetTop() >= bottom || cellRect.GetBottom() <= top) {
-          // Only actually clear the image cache if there is a screen's height
-          // between us and the image's position: Else the chance is too high
-          // that we will very soon have to generated a scaled image again.
-          if ((cellRect.GetBottom() <= m_lastBottom - 2 * height) ||
-              (cellRect.GetTop() >= m_lastTop + 2 * height)) {
-            if (cell.GetOutput())
-              cell.GetOutput()->ClearCacheList();
-          }
-        }
+      // Only the cells in the region that needs to be redrawn are drawn =>
+      // we look up the first of them in the index of the GroupCells.
+      UpdateGroupCellIndex();
+      const GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+      for (std::size_t i = index.Find(top - m_configuration->GetBaseIndent());
+           i < index.Size(); i++) {
+        GroupCell &cell = *index.GetGroup(i);
+        // A cell that has lost its size without anybody asking for its
+        // recalculation
+        if (cell.ConfigChanged() || !cell.HasValidSize())
+          m_adjustWorksheetSizeNeeded |= cell.Recalculate();
+        if (i > 0)
+          cell.UpdateYPosition(m_configuration->GetBaseIndent() + index.GetOffset(i));
+        if (cell.GetRect().GetTop() > bottom)
+          break;
         //      m_drawThreads.push_back(std::thread(&Worksheet::DrawGroupCell_UsingBitmap,
         //                                  this,
         //                                  &dc, &cell, unscrolledRect));
         DrawGroupCell(dc, antiAliassingDC, cell);
+        if (std::none_of(m_drawnGroupCells.begin(), m_drawnGroupCells.end(),
+                         [&cell](const CellPtr<GroupCell> &drawn)
+                           { return drawn.get() == &cell; }))
+          m_drawnGroupCells.emplace_back(&cell);
+      }
+
+      // Clear the image cache of all cells we have drawn that now are far
+      // above or below the viewport: Else the chance is too high that we will
+      // very soon have to generated a scaled image again.
+      for (auto &drawn : m_drawnGroupCells) {
+        if (!drawn)
+          continue;
+        UpdateGroupCellPosition(drawn.get());
+        wxRect cellRect = drawn->GetRect();
+        if ((cellRect.GetBottom() <= top - 2 * height) ||
+            (cellRect.GetTop() >= bottom + 2 * height)) {
+          if (drawn->GetOutput())
+            drawn->GetOutput()->ClearCacheList();
+          drawn = nullptr;
+        }
       }
+      m_drawnGroupCells.erase(std::remove_if(m_drawnGroupCells.begin(),
+                                             m_drawnGroupCells.end(),
+                                             [](const CellPtr<GroupCell> &drawn)
+                                               { return !drawn; }),
+                              m_drawnGroupCells.end());
     }
 
     {
@@ -605,8 +623,6 @@ void Worksheet::OnPaint(wxPaintEvent &WXUNUSED(event)) {
       }
     }
 
-    m_lastTop = top;
-    m_lastBottom = bottom;
     // for(auto &i:m_drawThreads)
     //   if(i.joinable())
     //     i.join();
@@ -749,10 +765,12 @@ GroupCell *Worksheet::InsertGroupCells(std::unique_ptr<GroupCell> &&cells,
 
   if (!m_tree) {
     m_tree = std::move(cells);
+    m_cellPointers.m_groupCellIndex.ListChanged();
   } else if (!where) {
     CellList::SpliceInAfter(lastOfCellsToInsert, std::move(m_tree));
     RequestRedraw(cells.get());
     m_tree = std::move(cells);
+    m_cellPointers.m_groupCellIndex.ListChanged();
   } else {
     CellList::SpliceInAfter(where, std::move(cells), lastOfCellsToInsert);
     // make sure m_last still points to the last cell of the worksheet!!
@@ -849,7 +867,7 @@ void Worksheet::InsertLine(std::unique_ptr<Cell> &&newCell, bool forceNewLine) {
   newCell->ForceBreakLine(forceNewLine);
   cell->AppendOutput(std::move(newCell));
 
-  Recalculate(cell);
+  Recalculate(cell, true);
   OutputChanged();
   RequestRedraw(cell);
 
@@ -887,15 +905,7 @@ void Worksheet::SetZoomFactor(double newzoom, bool recalc) {
   if (!cellToScrollTo)
     cellToScrollTo = GetWorkingGroup(true);
   if (!cellToScrollTo) {
-    wxPoint topleft;
-    CalcUnscrolledPosition(0, 0, &topleft.x, &topleft.y);
-    cellToScrollTo = GetTree();
-    while (cellToScrollTo != NULL) {
-      wxRect rect = cellToScrollTo->GetRect();
-      if (rect.GetBottom() > topleft.y)
-        break;
-      cellToScrollTo = cellToScrollTo->GetNext();
-    }
+    cellToScrollTo = FirstVisibleGC();
   }
   if (recalc) {
     Recalculate();
@@ -910,58 +920,96 @@ bool Worksheet::RecalculateIfNeeded(bool timeout) {
   if (m_configuration->GetCanvasSize().y < 1)
     return (false);
 
-  if (!m_recalculateStart || !GetTree()) {
+  MaterializeRequestedCells();
+
+  // Rebuilding the index also schedules the recalculation of new cells.
+  UpdateGroupCellIndex();
+
+  if (!GetTree()) {
     m_recalculateStart = {};
+    // The queued cells might still live in the undo buffer
+    for (const auto &group : m_groupsToRecalculate)
+      if (group)
+        group->QueuedForRecalculation(false);
+    m_groupsToRecalculate.clear();
     return false;
   }
 
-  if (!GetTree()->Contains(m_recalculateStart))
+  // If the configuration has changed since the whole worksheet has been
+  // recalculated all cells need to be recalculated.
+  if (!m_recalculateStart && (m_configuration->CellCfgCnt() != m_recalculatedCfgCnt))
     m_recalculateStart = GetTree();
 
-  int width;
-  int height;
-  GetClientSize(&width, &height);
+  if (!m_recalculateStart && m_groupsToRecalculate.empty()) {
+    // Drawing might have recalculated a cell
+    if (m_adjustWorksheetSizeNeeded)
+      AdjustSize();
+    return false;
+  }
+
+  // If only single cells have changed only they need to be recalculated:
+  // The positions of all other cells follow from the index.
+  if (!m_recalculateStart) {
+    RecalculateQueuedGroups();
+    if (m_adjustWorksheetSizeNeeded)
+      AdjustSize();
+    return true;
+  }
+
+  const GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+  if (index.IndexOf(m_recalculateStart) >= index.Size())
+    m_recalculateStart = GetTree();
 
-  wxPoint upperLeftScreenCorner;
-  CalcScrolledPosition(0, 0, &upperLeftScreenCorner.x,
-                       &upperLeftScreenCorner.y);
   m_configuration->SetWorksheetPosition(GetPosition());
 
   if(timeout)
     {
+      // The cells on the screen come first: The user shouldn't have to wait
+      // for the layout of everything above them.
+      const wxRect visibleRegion = m_configuration->GetVisibleRegion();
+      for (std::size_t i = index.Find(visibleRegion.GetTop() - m_configuration->GetBaseIndent());
+           i < index.Size(); i++) {
+        if (m_configuration->GetBaseIndent() + index.GetOffset(i) > visibleRegion.GetBottom())
+          break;
+        m_adjustWorksheetSizeNeeded |= index.GetGroup(i)->Recalculate();
+      }
+
+      // The rest is laid out in slices that are short enough for the GUI to
+      // stay responsive.
       wxStopWatch stopwatch;
-      bool recalculated = false;
-      bool stopwatchStarted = false;
       for (auto &cell : OnList(m_recalculateStart.get())) {
-        recalculated |= cell.Recalculate();
-        if((cell.GetRect().GetTop() > m_configuration->GetVisibleRegion().GetBottom()) &&
-           recalculated)
-          {
-            if(!stopwatchStarted)
-              stopwatch.Start();
-          }
-        if(cell.GetNext() != NULL)
-          m_recalculateStart = cell.GetNext();
-        else
-          {
-            wxLogMessage(_("Recalculation hit the end of the worksheet => Updating its size"));
-            m_recalculateStart = {};
-            AdjustSize();
-          }
+        m_adjustWorksheetSizeNeeded |= cell.Recalculate();
+        m_recalculateStart = cell.GetNext();
         if(stopwatch.Time() > 50)
           break;
       }
+      if (m_recalculateStart) {
+        StatusText(wxString::Format(_("Laying out the worksheet: %li%%"),
+                                    static_cast<long>(100 * index.IndexOf(m_recalculateStart) /
+                                                      std::max(index.Size(),
+                                                               static_cast<std::size_t>(1)))));
+        m_recalculationProgressShown = true;
+        if (m_adjustWorksheetSizeNeeded)
+          AdjustSize();
+        RequestRedraw();
+        return true;
+      }
+      wxLogMessage(_("Recalculation hit the end of the worksheet => Updating its size"));
+      if (m_recalculationProgressShown)
+        UnsetStatusText();
+      m_recalculationProgressShown = false;
+      m_adjustWorksheetSizeNeeded = true;
     }
   else
     {
-      for (auto &cell : OnList(m_recalculateStart.get())) {
+      for (auto &cell : OnList(m_recalculateStart.get()))
         m_adjustWorksheetSizeNeeded |= cell.Recalculate();
-        if(cell.GetNext() == NULL)
-          {
-            wxLogMessage(_("Recalculated the whole worksheet at once => Updating its size"));
-          }
-      }
+      wxLogMessage(_("Recalculated the whole worksheet at once => Updating its size"));
     }
+  m_recalculatedCfgCnt = m_configuration->CellCfgCnt();
+  // Cells that have changed while the worksheet was laid out in slices. The
+  // others return from Recalculate() at once.
+  RecalculateQueuedGroups();
   if (m_adjustWorksheetSizeNeeded)
     AdjustSize();
 
@@ -969,7 +1017,98 @@ bool Worksheet::RecalculateIfNeeded(bool timeout) {
   return true;
 }
 
-void Worksheet::Recalculate(Cell *start) {
+void Worksheet::RecalculateQueuedGroups() {
+  std::vector<CellPtr<GroupCell>> groups;
+  groups.swap(m_groupsToRecalculate);
+  for (const auto &group : groups)
+    if (group) {
+      group->QueuedForRecalculation(false);
+      m_adjustWorksheetSizeNeeded |= group->Recalculate();
+    }
+}
+
+void Worksheet::QueueRecalculation(GroupCell *group) {
+  if (group->IsQueuedForRecalculation())
+    return;
+  group->QueuedForRecalculation(true);
+  m_groupsToRecalculate.emplace_back(group);
+}
+
+void Worksheet::MaterializeRequestedCells() {
+  if (m_cellPointers.m_cellsToMaterialize.empty())
+    return;
+
+  std::vector<CellPtr<Cell>> cells;
+  cells.swap(m_cellPointers.m_cellsToMaterialize);
+  for (const auto &cell : cells) {
+    // The cell might have been deleted in the meantime
+    OutputChunkCell *chunk = dynamic_cast<OutputChunkCell *>(cell.get());
+    if (!chunk || chunk->IsMaterialized())
+      continue;
+    chunk->Materialize();
+    m_cellPointers.m_materializedCells.emplace_back(chunk);
+    Recalculate(chunk);
+  }
+
+  // Convert the chunks that have been converted first back to XML, unless they
+  // are still visible.
+  std::size_t visibleChunks = 0;
+  while (m_cellPointers.m_materializedCells.size() > MaxMaterializedChunks + visibleChunks) {
+    CellPtr<Cell> oldest = std::move(m_cellPointers.m_materializedCells.front());
+    m_cellPointers.m_materializedCells.pop_front();
+    OutputChunkCell *chunk = dynamic_cast<OutputChunkCell *>(oldest.get());
+    if (!chunk)
+      continue;
+    if (chunk->GetRect().Intersects(m_configuration->GetVisibleRegion())) {
+      m_cellPointers.m_materializedCells.emplace_back(std::move(oldest));
+      visibleChunks++;
+      continue;
+    }
+    chunk->Dematerialize();
+  }
+  RequestRedraw();
+}
+
+void Worksheet::UpdateGroupCellIndex() {
+  GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+  if (index.IsUpToDate(GetTree()))
+    return;
+  index.Clear();
+  for (auto &cell : OnList(GetTree())) {
+    index.Append(&cell, cell.GetVerticalExtent(), cell.GetWidth());
+    // Cells that have been added to the worksheet might never have been
+    // recalculated
+    if (cell.ConfigChanged() || !cell.HasValidSize())
+      QueueRecalculation(&cell);
+  }
+  index.SetUpToDate(GetTree());
+}
+
+void Worksheet::UpdateGroupCellPosition(GroupCell *group) {
+  UpdateGroupCellIndex();
+  const GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+  std::size_t i = index.IndexOf(group);
+  // The first cell is positioned by its recalculation
+  if ((i == 0) || (i >= index.Size()))
+    return;
+  group->UpdateYPosition(m_configuration->GetBaseIndent() + index.GetOffset(i));
+}
+
+GroupCell *Worksheet::GetGroupCellAt(wxCoord y) {
+  UpdateGroupCellIndex();
+  const GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+  for (std::size_t i = index.Find(y - m_configuration->GetBaseIndent());
+       i < index.Size(); i++) {
+    GroupCell *group = index.GetGroup(i);
+    UpdateGroupCellPosition(group);
+    // y might point to the space between this cell and the next one
+    if (y <= group->GetRect().GetBottom())
+      return group;
+  }
+  return NULL;
+}
+
+void Worksheet::Recalculate(Cell *start, bool outputAppended) {
   if (!GetTree())
     return;
   wxASSERT(start);
@@ -978,27 +1117,16 @@ void Worksheet::Recalculate(Cell *start) {
 
   GroupCell *group = start->GetGroup();
 
-  if (m_recalculateStart == group)
-    return;
-
-  group->MarkNeedsRecalculate();
-
-  if (!m_recalculateStart)
-    m_recalculateStart = group;
-  else
-    // Move m_recalculateStart backwards to start, if start comes before
-    // m_recalculateStart.
-    for (const GroupCell &cell : OnList(GetTree())) {
-      if (&cell == group) {
-        m_recalculateStart = group;
-        return;
-      }
+  group->MarkNeedsRecalculate(outputAppended);
+  QueueRecalculation(group);
+}
 
-      if (&cell == m_recalculateStart)
-        return;
-    }
-  // If the cells to recalculate neither contain the start nor the tree we
-  // should better recalculate all.
+void Worksheet::Recalculate() {
+  if (!GetTree())
+    return;
+  // Changes that aren't tied to a cell, for example a new canvas width or
+  // a folded cell, need the whole worksheet to be recalculated.
+  GetTree()->MarkNeedsRecalculate();
   m_recalculateStart = GetTree();
 }
 
@@ -1021,14 +1149,7 @@ void Worksheet::OnSize(wxSizeEvent &event) {
     CellToScrollTo = GetWorkingGroup(true);
 
   if (!CellToScrollTo) {
-    wxPoint topleft;
-    CalcUnscrolledPosition(0, 0, &topleft.x, &topleft.y);
-    CellToScrollTo = GetTree();
-    for (; CellToScrollTo; CellToScrollTo = CellToScrollTo->GetNext()) {
-      wxRect rect = CellToScrollTo->GetRect();
-      if (rect.GetBottom() > topleft.y)
-        break;
-    }
+    CellToScrollTo = FirstVisibleGC();
   }
   Recalculate();
 
@@ -2272,16 +2393,14 @@ void Worksheet::OnMouseLeftDown(wxMouseEvent &event) {
   GroupCell *previous = NULL;
   const GroupCell *clickedBeforeGC = NULL;
   GroupCell *clickedInGC = NULL;
-  for (GroupCell &cell : OnList(GetTree())) { // go through all groupcells
-    rect = cell.GetRect();
+  GroupCell *cellAtClick = GetGroupCellAt(m_down.y);
+  if (cellAtClick) {
+    rect = cellAtClick->GetRect();
     if (m_down.y < rect.GetTop()) {
-      clickedBeforeGC = &cell;
-      break;
-    } else if (m_down.y <= rect.GetBottom()) {
-      clickedInGC = &cell;
-      break;
-    }
-    previous = &cell;
+      clickedBeforeGC = cellAtClick;
+      previous = cellAtClick->GetPrevious();
+    } else
+      clickedInGC = cellAtClick;
   }
 
   if (clickedBeforeGC) { // we clicked between groupcells, set hCaret
@@ -2313,13 +2432,11 @@ GroupCell *Worksheet::FirstVisibleGC() {
   wxPoint point;
   CalcUnscrolledPosition(0, 0, &point.x, &point.y);
 
-  for (auto &cell : OnList(GetTree())) { // go through all groupcells
-    wxRect rect = cell.GetRect();
-
-    if (point.y < rect.GetBottom())
-      return &cell;
-  }
-  return {};
+  GroupCell *cell = GetGroupCellAt(point.y);
+  // A cell whose last line is the first one on the screen isn't visible
+  if (cell && (point.y == cell->GetRect().GetBottom()))
+    cell = cell->GetNext();
+  return cell;
 }
 
 void Worksheet::OnMouseLeftUp(wxMouseEvent &event) {
@@ -2402,24 +2519,16 @@ void Worksheet::SelectGroupCells(wxPoint down, wxPoint up) {
   wxRect rect;
 
   // find out the group cell the selection begins in
-  for (auto &cell : OnList(GetTree())) {
-    rect = cell.GetRect();
-    if (ytop <= rect.GetBottom()) {
-      m_cellPointers.m_selectionStart = &cell;
-      break;
-    }
-  }
+  m_cellPointers.m_selectionStart = GetGroupCellAt(ytop);
 
   // find out the group cell the selection ends in
-  for (auto &cell : OnList(GetTree())) {
-    rect = cell.GetRect();
-    if (ybottom < rect.GetTop()) {
-      m_cellPointers.m_selectionEnd = cell.GetPrevious();
-      break;
-    }
-  }
-  if (!m_cellPointers.m_selectionEnd)
+  GroupCell *end = GetGroupCellAt(ybottom);
+  if (!end)
     m_cellPointers.m_selectionEnd = GetLastCellInWorksheet();
+  else if (ybottom < end->GetRect().GetTop())
+    m_cellPointers.m_selectionEnd = end->GetPrevious();
+  else
+    m_cellPointers.m_selectionEnd = end;
 
   if (m_cellPointers.m_selectionStart) {
     if (m_cellPointers.m_selectionEnd->GetNext() ==
@@ -3069,6 +3178,7 @@ void Worksheet::DeleteRegion(GroupCell *start, GroupCell *end,
     wxASSERT(m_tree.get() == tornOut.cell);
     tornOut.cellOwner = std::move(m_tree);
     m_tree = dynamic_unique_ptr_cast<GroupCell>(std::move(tornOut.tailOwner));
+    m_cellPointers.m_groupCellIndex.ListChanged();
   }
 
   // Do we have an undo buffer for this action?
@@ -3084,8 +3194,6 @@ void Worksheet::DeleteRegion(GroupCell *start, GroupCell *end,
     NumberSections();
   UpdateTableOfContents();
   Recalculate();
-  if(GetTree())
-    GetTree()->UpdateYPositionList();
   RequestRedraw();
   SetSaved(false);
 }
@@ -3134,7 +3242,7 @@ void Worksheet::OpenQuestionCaret(const wxString &txt) {
     answerCell->CaretToEnd();
 
     group->AppendOutput(std::move(answerCell));
-    Recalculate(group);
+    Recalculate(group, true);
     // If we filled in an answer and "AutoAnswer" is true we issue an evaluation
     // event here.
     if (autoEvaluate) {
@@ -4162,21 +4270,21 @@ void Worksheet::OnChar(wxKeyEvent &event) {
  * Get maximum x and y in the tree.
  */
 void Worksheet::GetMaxPoint(int *width, int *height) {
-  int currentHeight = m_configuration->GetIndent();
   *width = m_configuration->GetBaseIndent();
 
-  for (Cell const &tmp : OnList(GetTree())) {
-    currentHeight += tmp.GetHeightList();
-    currentHeight += m_configuration->GetGroupSkip();
+  // The index knows the sizes of all cells
+  UpdateGroupCellIndex();
+  const GroupCellIndex &index = m_cellPointers.m_groupCellIndex;
+  if (index.Size() > 0) {
     int currentWidth =
       m_configuration->Scale_Px(m_configuration->GetIndent() +
                                 m_configuration->GetDefaultFontSize()) +
-      tmp.GetWidth() +
+      index.GetMaxWidth() +
       m_configuration->Scale_Px(m_configuration->GetIndent() +
                                 m_configuration->GetDefaultFontSize());
     *width = std::max(currentWidth, *width);
   }
-  *height = currentHeight;
+  *height = m_configuration->GetIndent() + index.GetTotalExtent();
 }
 
 /***
@@ -4389,6 +4497,7 @@ void Worksheet::DestroyTree() {
   TreeUndo_ClearUndoActionList();
   TreeUndo_ClearRedoActionList();
   m_tree.reset();
+  m_cellPointers.m_groupCellIndex.Clear();
   m_last = NULL;
 }
 
@@ -6181,6 +6290,9 @@ void Worksheet::ScrollToCellIfNeeded() {
     return;
   }
 
+  // The cells that haven't been drawn recently might not know their position
+  if (cell->GetGroup())
+    UpdateGroupCellPosition(cell->GetGroup());
   int cellY = cell->GetCurrentY();
 
   if (cellY < 0) {
@@ -6690,6 +6802,7 @@ void Worksheet::PasteFromClipboard() {
         if (!GetTree()) {
           // Empty work sheet => We paste cells as the new cells
           m_tree = std::move(contents);
+          m_cellPointers.m_groupCellIndex.ListChanged();
         } else {
           bool hasHSelection =
             m_cellPointers.m_selectionStart &&
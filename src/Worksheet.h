@@ -210,10 +210,11 @@ private:
 
 //! true, if we have the current focus.
   bool m_hasFocus = true;
-  //! The last beginning for the area being drawn
-  long m_lastTop = 0;
-  //! The last ending for the area being drawn
-  long m_lastBottom = 0;
+  /*! The GroupCells that have been drawn since their image caches were cleared
+
+    The image caches of the cells that have been scrolled far away are cleared.
+  */
+  std::vector<CellPtr<GroupCell>> m_drawnGroupCells;
   /*! \defgroup UndoBufferFill Undo methods for cell additions/deletions:
 
     Each EditorCell has its own private undo buffer Additionally wxMaxima
@@ -882,16 +883,49 @@ public:
 
   /*! Actually recalculate the worksheet.
 
+    \param timeout true = Lay out the cells that are visible and then spend
+    only about 50 milliseconds on the rest, showing the progress in the status
+    bar. The next call continues where this one has stopped.
+    \return false, if there was nothing to recalculate.
+
     \todo We check here if the recalc start is within the worksheet. Would it make
     more sense to store the recalculation start in a CellPointer that automagically
     zeroes itself if that isn't the case?
    */
   bool RecalculateIfNeeded(bool timeout = false);
 
-  //! Schedule a recalculation of the worksheet starting with the cell start.
-  void Recalculate(Cell *start);
+  /*! Converts the chunks of long outputs that have been scrolled into view to cells
+
+    Only MaxMaterializedChunks chunks are kept converted: The ones that have
+    been converted first and that aren't visible any more are converted back.
+  */
+  void MaterializeRequestedCells();
+  //! The maximum number of chunks of long outputs that are kept converted to cells
+  static constexpr std::size_t MaxMaterializedChunks = 500;
+
+  //! Rebuilds the index of the GroupCells by their position, if it is outdated
+  void UpdateGroupCellIndex();
+  //! Sets the position of a GroupCell of the worksheet using the index
+  void UpdateGroupCellPosition(GroupCell *group);
+  /*! The first GroupCell whose bottom is at or below the y coordinate y
+
+    Uses the index of the GroupCells, which means that, unlike a walk over the
+    list of GroupCells, this doesn't slow down in long worksheets. The position
+    of the cell that is returned is updated. NULL if there is no such cell.
+  */
+  GroupCell *GetGroupCellAt(wxCoord y);
+
+  /*! Schedule a recalculation of the GroupCell the cell start belongs to.
+
+    The positions of the cells below it follow from the GroupCellIndex.
+
+    \param outputAppended true = The group start belongs to has changed only
+    by having output appended, so only the new output needs to be laid out.
+  */
+  void Recalculate(Cell *start, bool outputAppended = false);
 
-  void Recalculate() { Recalculate(GetTree()); }
+  //! Schedule a recalculation of the whole worksheet
+  void Recalculate();
 
   /*! Empties the current document
 
@@ -1600,6 +1634,20 @@ protected:
   void UpdateConfigurationClientSize();
   //! Where to start recalculation. NULL = No recalculation needed.
   CellPtr<GroupCell> m_recalculateStart;
+  /*! The cells that need to be recalculated
+
+    If the configuration hasn't changed since the last recalculation of the
+    whole worksheet these are the only cells that need to be recalculated.
+  */
+  std::vector<CellPtr<GroupCell>> m_groupsToRecalculate;
+  //! Adds a cell to m_groupsToRecalculate, unless it already is in there
+  void QueueRecalculation(GroupCell *group);
+  //! Recalculates the cells in m_groupsToRecalculate and empties it
+  void RecalculateQueuedGroups();
+  //! The Configuration::CellCfgCnt() the whole worksheet has been recalculated for
+  std::int_fast32_t m_recalculatedCfgCnt = -1;
+  //! Does the status bar currently show the progress of the recalculation?
+  bool m_recalculationProgressShown = false;
   //! The x position of the mouse pointer
   int m_pointer_x = -1;
   //! The y position of the mouse pointer
@@ -0,0 +1,382 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class XmlPullParser.
+*/
+
+#include "XmlPullParser.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+//! Is ch whitespace in the XML sense?
+inline bool IsXmlSpace(char ch)
+{
+  return (ch == ' ') || (ch == '\t') || (ch == '\n') || (ch == '\r');
+}
+//! The replacement character, in UTF-8
+const char replacementChar[] = "\xEF\xBF\xBD";
+}
+
+XmlPullParser::XmlPullParser(const char *data, std::size_t length, bool scrubControlChars) :
+  m_begin(data),
+  m_end(data + length),
+  m_pos(data),
+  m_tokenStart(data),
+  m_scrubControlChars(scrubControlChars)
+{
+}
+
+bool XmlPullParser::IsWhitespace(const std::string &text)
+{
+  for(char ch : text)
+    if(!IsXmlSpace(ch))
+      return false;
+  return true;
+}
+
+XmlPullParser::TokenType XmlPullParser::Error()
+{
+  m_error = true;
+  m_openTags.clear();
+  return ERROR;
+}
+
+XmlPullParser::TokenType XmlPullParser::Next()
+{
+  if(m_error)
+    return ERROR;
+
+  if(m_pendingEndTag)
+    {
+      m_tokenStart = m_pos;
+      m_pendingEndTag = false;
+      m_attributes.clear();
+      m_openTags.pop_back();
+      return END_TAG;
+    }
+
+  for(;;)
+    {
+      if(m_pos >= m_end)
+        {
+          if(!m_openTags.empty())
+            return Error();
+          return END_OF_DATA;
+        }
+      TokenType token;
+      m_tokenStart = m_pos;
+      if(*m_pos == '<')
+        token = ReadMarkup();
+      else
+        token = ReadText();
+      // Comments, processing instructions and the whitespace outside of the
+      // root element are read without producing a token.
+      if(token != END_OF_DATA)
+        return token;
+    }
+}
+
+XmlPullParser::TokenType XmlPullParser::ReadText()
+{
+  const char *textEnd = static_cast<const char *>(
+    std::memchr(m_pos, '<', m_end - m_pos));
+  if(textEnd == NULL)
+    textEnd = m_end;
+  if(m_openTags.empty())
+    {
+      // Outside the root element only whitespace is allowed
+      for(const char *ch = m_pos; ch < textEnd; ++ch)
+        if(!IsXmlSpace(*ch))
+          return Error();
+      m_pos = textEnd;
+      return END_OF_DATA;
+    }
+  m_text.clear();
+  if(!AppendDecoded(m_text, m_pos, textEnd))
+    return Error();
+  m_pos = textEnd;
+  return TEXT;
+}
+
+const char *XmlPullParser::Find(const char *what) const
+{
+  const std::size_t whatLength = std::strlen(what);
+  const char *pos = m_pos;
+  while(pos + whatLength <= m_end)
+    {
+      const char *found = static_cast<const char *>(
+        std::memchr(pos, what[0], m_end - pos));
+      if((found == NULL) || (found + whatLength > m_end))
+        return NULL;
+      if(std::memcmp(found, what, whatLength) == 0)
+        return found;
+      pos = found + 1;
+    }
+  return NULL;
+}
+
+void XmlPullParser::SkipWhitespace()
+{
+  while((m_pos < m_end) && IsXmlSpace(*m_pos))
+    ++m_pos;
+}
+
+bool XmlPullParser::ReadName(std::string &name)
+{
+  const char *start = m_pos;
+  while((m_pos < m_end) && !IsXmlSpace(*m_pos) &&
+        (*m_pos != '>') && (*m_pos != '/') && (*m_pos != '=') &&
+        (*m_pos != '<') && (*m_pos != '"') && (*m_pos != '\''))
+    ++m_pos;
+  name.assign(start, m_pos);
+  return !name.empty();
+}
+
+XmlPullParser::TokenType XmlPullParser::ReadMarkup()
+{
+  const std::size_t remaining = m_end - m_pos;
+  // Comments
+  if((remaining >= 4) && (std::memcmp(m_pos, "<!--", 4) == 0))
+    {
+      m_pos += 4;
+      const char *end = Find("-->");
+      if(end == NULL)
+        return Error();
+      m_pos = end + 3;
+      return END_OF_DATA;
+    }
+  // CDATA sections
+  if((remaining >= 9) && (std::memcmp(m_pos, "<![CDATA[", 9) == 0))
+    {
+      if(m_openTags.empty())
+        return Error();
+      m_pos += 9;
+      const char *end = Find("]]>");
+      if(end == NULL)
+        return Error();
+      m_text.clear();
+      m_text.reserve(end - m_pos);
+      for(const char *ch = m_pos; ch < end; ++ch)
+        {
+          const unsigned char uch = static_cast<unsigned char>(*ch);
+          if(m_scrubControlChars && ((uch < 0x20) || (uch == 0x7F)))
+            m_text += replacementChar;
+          else
+            m_text += *ch;
+        }
+      m_pos = end + 3;
+      return CDATA;
+    }
+  // Processing instructions like the <?xml ...?> header
+  if((remaining >= 2) && (m_pos[1] == '?'))
+    {
+      m_pos += 2;
+      const char *end = Find("?>");
+      if(end == NULL)
+        return Error();
+      m_pos = end + 2;
+      return END_OF_DATA;
+    }
+  // A DOCTYPE. We don't support internal subsets.
+  if((remaining >= 2) && (m_pos[1] == '!'))
+    {
+      const char *end = static_cast<const char *>(std::memchr(m_pos, '>', remaining));
+      if(end == NULL)
+        return Error();
+      if(std::memchr(m_pos, '[', end - m_pos) != NULL)
+        return Error();
+      m_pos = end + 1;
+      return END_OF_DATA;
+    }
+
+  m_attributes.clear();
+  // Closing tags
+  if((remaining >= 2) && (m_pos[1] == '/'))
+    {
+      m_pos += 2;
+      if(!ReadName(m_name))
+        return Error();
+      SkipWhitespace();
+      if((m_pos >= m_end) || (*m_pos != '>'))
+        return Error();
+      ++m_pos;
+      if(m_openTags.empty() || (m_openTags.back() != m_name))
+        return Error();
+      m_openTags.pop_back();
+      return END_TAG;
+    }
+
+  // Opening tags
+  ++m_pos;
+  if(!ReadName(m_name))
+    return Error();
+  // XML allows only one root element
+  if(m_openTags.empty() && m_hadRoot)
+    return Error();
+  for(;;)
+    {
+      const char *beforeWhitespace = m_pos;
+      SkipWhitespace();
+      if(m_pos >= m_end)
+        return Error();
+      if(*m_pos == '>')
+        {
+          ++m_pos;
+          m_openTags.push_back(m_name);
+          m_hadRoot = true;
+          return START_TAG;
+        }
+      if(*m_pos == '/')
+        {
+          ++m_pos;
+          if((m_pos >= m_end) || (*m_pos != '>'))
+            return Error();
+          ++m_pos;
+          m_openTags.push_back(m_name);
+          m_hadRoot = true;
+          m_pendingEndTag = true;
+          return START_TAG;
+        }
+      // Attributes have to be separated from the tag name and from each other
+      if(beforeWhitespace == m_pos)
+        return Error();
+      std::string attrName;
+      if(!ReadName(attrName))
+        return Error();
+      SkipWhitespace();
+      if((m_pos >= m_end) || (*m_pos != '='))
+        return Error();
+      ++m_pos;
+      SkipWhitespace();
+      if((m_pos >= m_end) || ((*m_pos != '"') && (*m_pos != '\'')))
+        return Error();
+      const char quote = *m_pos++;
+      const char *valueEnd = static_cast<const char *>(
+        std::memchr(m_pos, quote, m_end - m_pos));
+      if(valueEnd == NULL)
+        return Error();
+      std::string value;
+      if(!AppendDecoded(value, m_pos, valueEnd))
+        return Error();
+      m_pos = valueEnd + 1;
+      m_attributes.emplace_back(std::move(attrName), std::move(value));
+    }
+}
+
+void XmlPullParser::AppendUTF8(std::string &out, unsigned long codepoint)
+{
+  if(codepoint < 0x80)
+    out += static_cast<char>(codepoint);
+  else if(codepoint < 0x800)
+    {
+      out += static_cast<char>(0xC0 | (codepoint >> 6));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+  else if(codepoint < 0x10000)
+    {
+      out += static_cast<char>(0xE0 | (codepoint >> 12));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+  else
+    {
+      out += static_cast<char>(0xF0 | (codepoint >> 18));
+      out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+bool XmlPullParser::AppendDecoded(std::string &out, const char *begin, const char *end) const
+{
+  out.reserve(out.size() + (end - begin));
+  const char *pos = begin;
+  while(pos < end)
+    {
+      // Copy the runs of characters that need no special treatment in one go
+      const char *run = pos;
+      while(run < end)
+        {
+          const unsigned char uch = static_cast<unsigned char>(*run);
+          if(uch == '&')
+            break;
+          if(m_scrubControlChars &&
+             ((uch < 0x20) || (uch == 0x7F) ||
+              // U+0080...U+009F
+              ((uch == 0xC2) && (run + 1 < end) &&
+               (static_cast<unsigned char>(run[1]) < 0xA0))))
+            break;
+          ++run;
+        }
+      out.append(pos, run);
+      pos = run;
+      if(pos >= end)
+        break;
+
+      if(*pos != '&')
+        {
+          // A control character
+          out += replacementChar;
+          pos += (static_cast<unsigned char>(*pos) == 0xC2) ? 2 : 1;
+          continue;
+        }
+
+      const char *semicolon = static_cast<const char *>(
+        std::memchr(pos, ';', end - pos));
+      if(semicolon == NULL)
+        return false;
+      const std::string entity(pos + 1, semicolon);
+      if(entity == "lt")
+        out += '<';
+      else if(entity == "gt")
+        out += '>';
+      else if(entity == "amp")
+        out += '&';
+      else if(entity == "quot")
+        out += '"';
+      else if(entity == "apos")
+        out += '\'';
+      else if((entity.size() > 1) && (entity[0] == '#'))
+        {
+          char *numEnd = NULL;
+          unsigned long codepoint;
+          if((entity[1] == 'x') || (entity[1] == 'X'))
+            codepoint = std::strtoul(entity.c_str() + 2, &numEnd, 16);
+          else
+            codepoint = std::strtoul(entity.c_str() + 1, &numEnd, 10);
+          if((numEnd == NULL) || (*numEnd != '\0') ||
+             (numEnd == entity.c_str() + 1) || (codepoint == 0) ||
+             (codepoint > 0x10FFFF))
+            return false;
+          if(m_scrubControlChars &&
+             ((codepoint < 0x20) || ((codepoint >= 0x7F) && (codepoint < 0xA0))))
+            out += replacementChar;
+          else
+            AppendUTF8(out, codepoint);
+        }
+      else
+        return false;
+      pos = semicolon + 1;
+    }
+  return true;
+}
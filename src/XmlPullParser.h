@@ -0,0 +1,139 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_XMLPULLPARSER_H
+#define WXMAXIMA_XMLPULLPARSER_H
+
+/*! \file
+ *
+ * Declares a minimal pull parser for the XML maxima and the .wxmx files speak.
+ */
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*! A minimal XML pull parser that works on UTF-8 bytes
+
+  Loading a wxXmlDocument means converting the whole string to UTF-8 for
+  expat, converting every name and text back to a wxString, and (if we want
+  to get rid of control characters) a regex pass over the whole input
+  beforehand. This parser instead walks over the bytes once and returns one
+  token per call to Next(), which allows the caller to build exactly the
+  data structure it needs.
+
+  It understands elements, attributes, the predefined and numeric character
+  entities, CDATA sections, comments, processing instructions and a DOCTYPE
+  without internal subset. Everything else is considered an error. Empty
+  elements ("<a/>") are returned as a START_TAG followed by an END_TAG.
+*/
+class XmlPullParser
+{
+public:
+  enum TokenType
+  {
+    //! All data has been read and every element has been closed
+    END_OF_DATA,
+    //! An opening tag. Name() and Attributes() tell what it was.
+    START_TAG,
+    //! A closing tag. Name() tells which element it closes.
+    END_TAG,
+    //! The text between two tags, with all entities resolved
+    TEXT,
+    //! The contents of a CDATA section
+    CDATA,
+    //! The data isn't well-formed XML. Next() will return ERROR from now on.
+    ERROR
+  };
+
+  //! An attribute of a START_TAG
+  using Attribute = std::pair<std::string, std::string>;
+
+  /*! Constructor
+
+    \param data The UTF-8 data to parse. Must live as long as the parser.
+    \param length The number of bytes in data.
+    \param scrubControlChars true = replace all control characters in texts and
+    attribute values by U+FFFD, which is what the worksheet displays for them.
+  */
+  XmlPullParser(const char *data, std::size_t length, bool scrubControlChars = false);
+
+  //! Read the next token
+  TokenType Next();
+
+  //! The name of the tag of the current START_TAG or END_TAG token
+  const std::string &Name() const { return m_name; }
+  //! The text of the current TEXT or CDATA token
+  const std::string &Text() const { return m_text; }
+  //! The attributes of the current START_TAG token
+  const std::vector<Attribute> &Attributes() const { return m_attributes; }
+  //! The number of elements that currently are open
+  std::size_t Depth() const { return m_openTags.size(); }
+  //! The offset of the first byte of the current token in the data
+  std::size_t TokenStart() const { return m_tokenStart - m_begin; }
+  //! The offset of the first byte after the current token
+  std::size_t TokenEnd() const { return m_pos - m_begin; }
+
+  //! Is this text empty or does it only contain whitespace?
+  static bool IsWhitespace(const std::string &text);
+
+private:
+  //! Sets the parser to the error state
+  TokenType Error();
+  //! Reads a "<...>" construct that starts at m_pos
+  TokenType ReadMarkup();
+  //! Reads the text that starts at m_pos
+  TokenType ReadText();
+  /*! Appends the characters in [begin, end) to out, resolving entities
+
+    \returns false, if an entity couldn't be resolved
+  */
+  bool AppendDecoded(std::string &out, const char *begin, const char *end) const;
+  //! Appends the unicode code point to out, as UTF-8
+  static void AppendUTF8(std::string &out, unsigned long codepoint);
+  //! Skips over whitespace
+  void SkipWhitespace();
+  //! Reads a tag or attribute name
+  bool ReadName(std::string &name);
+  //! Searches for the string what, starting at m_pos
+  const char *Find(const char *what) const;
+
+  const char *m_begin;
+  const char *m_end;
+  const char *m_pos;
+  //! Where the current token starts
+  const char *m_tokenStart;
+  bool m_scrubControlChars;
+  //! true = The last START_TAG was an empty element, so an END_TAG is due
+  bool m_pendingEndTag = false;
+  //! true = The data was found not to be well-formed
+  bool m_error = false;
+  //! true = The root element has been opened
+  bool m_hadRoot = false;
+  std::string m_name;
+  std::string m_text;
+  std::vector<Attribute> m_attributes;
+  //! The names of all open elements
+  std::vector<std::string> m_openTags;
+};
+
+#endif
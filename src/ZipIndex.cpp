@@ -0,0 +1,303 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class ZipIndex.
+*/
+
+#include "ZipIndex.h"
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <wx/filefn.h>
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+
+namespace {
+//! Reads a little-endian number of the given number of bytes
+std::uint64_t ReadLE(const unsigned char *data, std::size_t bytes)
+{
+  std::uint64_t value = 0;
+  for(std::size_t i = bytes; i-- > 0;)
+    value = (value << 8) | data[i];
+  return value;
+}
+
+//! Reads a number of bytes from a position in a file
+bool ReadAt(wxFile &file, wxFileOffset offset, void *buffer, std::size_t length)
+{
+  if(file.Seek(offset) != offset)
+    return false;
+  return file.Read(buffer, length) == static_cast<ssize_t>(length);
+}
+
+const std::uint32_t localHeaderSignature = 0x04034b50;
+const std::uint32_t centralHeaderSignature = 0x02014b50;
+const std::uint32_t endOfCentralDirSignature = 0x06054b50;
+const std::uint32_t zip64EndOfCentralDirSignature = 0x06064b50;
+const std::uint32_t zip64LocatorSignature = 0x07064b50;
+const std::size_t localHeaderSize = 30;
+const std::size_t centralHeaderSize = 46;
+const std::size_t endOfCentralDirSize = 22;
+const std::size_t zip64EndOfCentralDirSize = 56;
+const std::size_t zip64LocatorSize = 20;
+//! Deflate cannot compress data by more than this factor
+const std::uint64_t maxDeflateRatio = 1032;
+
+//! The indices we know, the one used last at the front
+std::list<std::shared_ptr<const ZipIndex>> indexCache;
+//! The maximum number of indices we keep
+const std::size_t indexCacheSize = 8;
+std::mutex indexCacheMutex;
+}
+
+ZipIndex::ZipIndex(const wxString &zipFile) :
+  m_zipFile(zipFile)
+{
+  m_modificationTime = wxFileModificationTime(zipFile);
+  wxFile file(zipFile);
+  if(!file.IsOpened())
+    return;
+  m_fileSize = file.Length();
+  m_ok = ReadCentralDirectory(file);
+  if(!m_ok)
+    m_entries.clear();
+}
+
+bool ZipIndex::ReadCentralDirectory(wxFile &file)
+{
+  if(m_fileSize < static_cast<wxFileOffset>(endOfCentralDirSize))
+    return false;
+
+  // The end of central directory record is followed only by a comment of at
+  // most 65535 bytes.
+  const std::size_t tailSize =
+    static_cast<std::size_t>(std::min<wxFileOffset>(m_fileSize, endOfCentralDirSize + 65535));
+  const wxFileOffset tailStart = m_fileSize - static_cast<wxFileOffset>(tailSize);
+  std::vector<unsigned char> tail(tailSize);
+  if(!ReadAt(file, tailStart, tail.data(), tailSize))
+    return false;
+  std::size_t endRecord = tailSize - endOfCentralDirSize + 1;
+  while(endRecord-- > 0)
+    if((ReadLE(&tail[endRecord], 4) == endOfCentralDirSignature) &&
+       (endRecord + endOfCentralDirSize + ReadLE(&tail[endRecord + 20], 2) <= tailSize))
+      break;
+  if(endRecord >= tailSize)
+    return false;
+
+  std::uint64_t entries = ReadLE(&tail[endRecord + 10], 2);
+  std::uint64_t directorySize = ReadLE(&tail[endRecord + 12], 4);
+  std::uint64_t directoryOffset = ReadLE(&tail[endRecord + 16], 4);
+  if((entries == 0xFFFF) || (directorySize == 0xFFFFFFFF) || (directoryOffset == 0xFFFFFFFF))
+    {
+      // A ZIP64 archive: The real values are found in the ZIP64 end of
+      // central directory record, whose position the locator in front of
+      // the end of central directory record tells.
+      const wxFileOffset locatorStart =
+        tailStart + static_cast<wxFileOffset>(endRecord) - static_cast<wxFileOffset>(zip64LocatorSize);
+      unsigned char locator[zip64LocatorSize];
+      if((locatorStart < 0) || !ReadAt(file, locatorStart, locator, sizeof(locator)) ||
+         (ReadLE(locator, 4) != zip64LocatorSignature))
+        return false;
+      unsigned char record[zip64EndOfCentralDirSize];
+      const std::uint64_t recordStart = ReadLE(locator + 8, 8);
+      if((recordStart > static_cast<std::uint64_t>(m_fileSize)) ||
+         !ReadAt(file, static_cast<wxFileOffset>(recordStart), record, sizeof(record)) ||
+         (ReadLE(record, 4) != zip64EndOfCentralDirSignature))
+        return false;
+      entries = ReadLE(record + 32, 8);
+      directorySize = ReadLE(record + 40, 8);
+      directoryOffset = ReadLE(record + 48, 8);
+    }
+  if((directoryOffset > static_cast<std::uint64_t>(m_fileSize)) ||
+     (directorySize > static_cast<std::uint64_t>(m_fileSize) - directoryOffset))
+    return false;
+  m_directoryOffset = static_cast<wxFileOffset>(directoryOffset);
+
+  std::vector<unsigned char> directory(static_cast<std::size_t>(directorySize));
+  if(!directory.empty() &&
+     !ReadAt(file, static_cast<wxFileOffset>(directoryOffset), directory.data(), directory.size()))
+    return false;
+  m_entries.reserve(static_cast<std::size_t>(entries));
+  std::size_t pos = 0;
+  for(std::uint64_t i = 0; i < entries; i++)
+    {
+      if((directory.size() - pos < centralHeaderSize) ||
+         (ReadLE(&directory[pos], 4) != centralHeaderSignature))
+        return false;
+      const unsigned char *header = &directory[pos];
+      const std::size_t nameLength = ReadLE(header + 28, 2);
+      const std::size_t extraLength = ReadLE(header + 30, 2);
+      const std::size_t commentLength = ReadLE(header + 32, 2);
+      if(directory.size() - pos - centralHeaderSize < nameLength + extraLength + commentLength)
+        return false;
+      std::uint64_t size = ReadLE(header + 24, 4);
+      std::uint64_t compressedSize = ReadLE(header + 20, 4);
+      std::uint64_t headerOffset = ReadLE(header + 42, 4);
+
+      // Values that don't fit into 32 bits are found in the ZIP64 extra field
+      const unsigned char *extra = header + centralHeaderSize + nameLength;
+      const unsigned char *extraEnd = extra + extraLength;
+      while(extraEnd - extra >= 4)
+        {
+          const std::size_t fieldLength = ReadLE(extra + 2, 2);
+          const unsigned char *field = extra + 4;
+          if(static_cast<std::size_t>(extraEnd - field) < fieldLength)
+            break;
+          if(ReadLE(extra, 2) == 0x0001)
+            {
+              const unsigned char *fieldEnd = field + fieldLength;
+              for(std::uint64_t *value : {&size, &compressedSize, &headerOffset})
+                if((*value == 0xFFFFFFFF) && (fieldEnd - field >= 8))
+                  {
+                    *value = ReadLE(field, 8);
+                    field += 8;
+                  }
+            }
+          extra += 4 + fieldLength;
+        }
+
+      // The data of every file lies in front of the central directory.
+      // Read() allocates the sizes we store => they must be plausible.
+      if((headerOffset > directoryOffset) ||
+         (compressedSize > directoryOffset - headerOffset) ||
+         (size > std::max<std::uint64_t>(compressedSize, 1) * maxDeflateRatio))
+        return false;
+
+      Entry entry;
+      entry.method = static_cast<unsigned int>(ReadLE(header + 10, 2));
+      entry.size = static_cast<wxFileOffset>(size);
+      entry.compressedSize = static_cast<wxFileOffset>(compressedSize);
+      entry.headerOffset = static_cast<wxFileOffset>(headerOffset);
+      // Like wxZipInputStream we find the first of several files of the same name
+      m_entries.emplace(std::string(reinterpret_cast<const char *>(header + centralHeaderSize),
+                                    nameLength), entry);
+      pos += centralHeaderSize + nameLength + extraLength + commentLength;
+    }
+  return true;
+}
+
+const ZipIndex::Entry *ZipIndex::Find(const wxString &name) const
+{
+  const wxScopedCharBuffer utf8 = name.utf8_str();
+  auto entry = m_entries.find(std::string(utf8.data(), utf8.length()));
+  if(entry == m_entries.end())
+    return NULL;
+  return &entry->second;
+}
+
+bool ZipIndex::Read(const wxString &name, wxMemoryBuffer &data) const
+{
+  const Entry *entry = Find(name);
+  if((entry == NULL) || ((entry->method != 0) && (entry->method != 8)) ||
+     (entry->size < 0) || (entry->compressedSize < 0))
+    return false;
+
+  wxFile file(m_zipFile);
+  if(!file.IsOpened())
+    return false;
+  // The local header can contain an extra field of a different length than
+  // the central directory does => we need to read it.
+  unsigned char header[localHeaderSize];
+  if(!ReadAt(file, entry->headerOffset, header, sizeof(header)) ||
+     (ReadLE(header, 4) != localHeaderSignature))
+    return false;
+  const wxFileOffset dataStart = entry->headerOffset + static_cast<wxFileOffset>(
+    localHeaderSize + ReadLE(header + 26, 2) + ReadLE(header + 28, 2));
+  if(dataStart + entry->compressedSize > m_directoryOffset)
+    return false;
+  // Unless they follow the data the local header contains the sizes, too. If
+  // they contradict the central directory the archive is damaged.
+  const bool sizesFollowData = (ReadLE(header + 6, 2) & 0x0008) != 0;
+  const std::uint64_t localCompressedSize = ReadLE(header + 18, 4);
+  const std::uint64_t localSize = ReadLE(header + 22, 4);
+  if(!sizesFollowData &&
+     (((localCompressedSize != 0xFFFFFFFF) &&
+       (localCompressedSize != static_cast<std::uint64_t>(entry->compressedSize))) ||
+      ((localSize != 0xFFFFFFFF) &&
+       (localSize != static_cast<std::uint64_t>(entry->size)))))
+    return false;
+
+  const std::size_t size = static_cast<std::size_t>(entry->size);
+  data.Clear();
+  if(entry->method == 0)
+    {
+      if(entry->compressedSize != entry->size)
+        return false;
+      void *buffer = data.GetWriteBuf(size);
+      const bool ok = ReadAt(file, dataStart, buffer, size);
+      data.UngetWriteBuf(ok ? size : 0);
+      return ok;
+    }
+
+  std::vector<char> compressed(static_cast<std::size_t>(entry->compressedSize));
+  if(!ReadAt(file, dataStart, compressed.data(), compressed.size()))
+    return false;
+  wxMemoryInputStream compressedStream(compressed.data(), compressed.size());
+  wxZlibInputStream inflater(compressedStream, wxZLIB_NO_HEADER);
+  void *buffer = data.GetWriteBuf(size);
+  inflater.Read(buffer, size);
+  const std::size_t read = inflater.LastRead();
+  data.UngetWriteBuf(read);
+  return read == size;
+}
+
+std::shared_ptr<const ZipIndex> ZipIndex::Get(const wxString &zipFile)
+{
+  const time_t modificationTime = wxFileModificationTime(zipFile);
+  wxFileOffset fileSize = -1;
+  {
+    wxFile file(zipFile);
+    if(file.IsOpened())
+      fileSize = file.Length();
+  }
+
+  // If several threads ask for the same archive at once only the first one
+  // reads it, the others wait for it.
+  std::lock_guard<std::mutex> lock(indexCacheMutex);
+  for(auto index = indexCache.begin(); index != indexCache.end(); ++index)
+    if((*index)->m_zipFile == zipFile)
+      {
+        if(((*index)->m_modificationTime == modificationTime) &&
+           ((*index)->m_fileSize == fileSize))
+          {
+            indexCache.splice(indexCache.begin(), indexCache, index);
+            return indexCache.front();
+          }
+        indexCache.erase(index);
+        break;
+      }
+  indexCache.push_front(std::make_shared<const ZipIndex>(zipFile));
+  if(indexCache.size() > indexCacheSize)
+    indexCache.pop_back();
+  return indexCache.front();
+}
+
+void ZipIndex::Forget(const wxString &zipFile)
+{
+  std::lock_guard<std::mutex> lock(indexCacheMutex);
+  indexCache.remove_if([&zipFile](const std::shared_ptr<const ZipIndex> &index) {
+      return index->m_zipFile == zipFile;
+    });
+}
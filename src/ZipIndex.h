@@ -0,0 +1,108 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef WXMAXIMA_ZIPINDEX_H
+#define WXMAXIMA_ZIPINDEX_H
+
+/*! \file
+ *
+ * Declares the index of the files in a .zip archive (like a .wxmx file).
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <wx/buffer.h>
+#include <wx/file.h>
+#include <wx/string.h>
+
+/*! An index of the files in a .zip archive, read from its central directory
+
+  wxZipInputStream can only find a file in an archive by reading the headers
+  of all files in front of it. As every image of a .wxmx file is loaded on
+  its own this meant reading O(n²) headers for opening a document with n
+  images. This index instead reads the central directory at the end of the
+  archive once and then knows where each file is, which allows to read a
+  file by seeking to it directly.
+
+  Get() returns the index of an archive, which is shared by all loaders and
+  threads as long as the file doesn't change.
+*/
+class ZipIndex
+{
+public:
+  //! What the central directory tells about a file in the archive
+  struct Entry
+  {
+    //! Where the local header of the file starts
+    wxFileOffset headerOffset = 0;
+    //! The size of the file's data in the archive
+    wxFileOffset compressedSize = 0;
+    //! The size of the file after decompressing it
+    wxFileOffset size = 0;
+    //! The compression method: 0 = stored, 8 = deflated
+    unsigned int method = 0;
+  };
+
+  //! Reads the central directory of a .zip archive
+  explicit ZipIndex(const wxString &zipFile);
+
+  //! Could the central directory be read?
+  bool IsOk() const { return m_ok; }
+  //! The number of files in the archive
+  std::size_t GetEntryCount() const { return m_entries.size(); }
+  //! Finds a file in the archive. NULL = not found.
+  const Entry *Find(const wxString &name) const;
+  /*! Reads a file from the archive, decompressing it if necessary
+
+    Can be called from several threads at once.
+    \return false, if the file wasn't found or couldn't be read.
+  */
+  bool Read(const wxString &name, wxMemoryBuffer &data) const;
+
+  /*! The index of a .zip archive
+
+    Reads the central directory only if it isn't known yet or if the file
+    has changed since.
+  */
+  static std::shared_ptr<const ZipIndex> Get(const wxString &zipFile);
+  //! Tells that we have written to an archive, so its index is outdated
+  static void Forget(const wxString &zipFile);
+
+private:
+  //! Fills m_entries from the central directory. Returns false if it couldn't be read.
+  bool ReadCentralDirectory(wxFile &file);
+
+  //! The archive
+  wxString m_zipFile;
+  //! The entries, by their UTF-8 name
+  std::unordered_map<std::string, Entry> m_entries;
+  //! The size of the archive when the index was read
+  wxFileOffset m_fileSize = -1;
+  //! Where the central directory starts: The files' data lies in front of it
+  wxFileOffset m_directoryOffset = 0;
+  //! The modification time of the archive when the index was read
+  time_t m_modificationTime = 0;
+  bool m_ok = false;
+};
+
+#endif
@@ -37,6 +37,7 @@
 #include "ImgCell.h"
 #include "StringUtils.h"
 
+#include <algorithm>
 #include <memory>
 #include <wx/anidecod.h>
 #include <wx/clipbrd.h>
@@ -223,11 +224,53 @@ void AnimationCell::LoadImages(wxArrayString images, bool deleteRead) {
 }
 
 void AnimationCell::SetDisplayedIndex(int ind) {
+  // Report the frames we couldn't show in time once per loop. That is only
+  // interesting when debugging, so it mustn't clutter up the log window.
+  if ((ind < m_displayed) && (m_framesShown > 0)) {
+    if (m_framesDropped > 0)
+      wxLogDebug("Animation: %i of %i frames weren't ready when they were due",
+                 m_framesDropped, m_framesShown);
+    m_framesShown = 0;
+    m_framesDropped = 0;
+  }
   m_displayed = ind;
-  if (m_displayed > Length())
+  if (m_displayed >= Length())
     m_displayed = Length() - 1;
   if (m_displayed < 0)
     m_displayed = 0;
+  UpdateFrameWindow(false);
+}
+
+int AnimationCell::GetFramesAhead() const {
+  // Half a second of the animation, but not too much memory
+  return std::min(std::max(GetFrameRate() / 2, 2), 8);
+}
+
+void AnimationCell::UpdateFrameWindow(bool prefetch) {
+  const int length = Length();
+  if (length < 2)
+    return;
+  const int ahead = std::min(GetFramesAhead(), length - 1);
+  // We keep the frame before the displayed one for stepping back and forth
+  const int behind = 1;
+  for (int i = 0; i < length; i++) {
+    const auto &image = m_images[i];
+    if (!image)
+      continue;
+    // How many frames the animation has to advance until frame i is shown.
+    // The animation starts over after the last frame.
+    const int distance = (i - m_displayed + length) % length;
+    if (distance == 0)
+      continue;
+    if (distance <= ahead) {
+      if (prefetch)
+        image->Prefetch();
+    } else if (distance < length - behind) {
+      // Waiting for a frame that is still loading would block the GUI
+      if (!image->IsLoading())
+        image->ClearCache();
+    }
+  }
 }
 
 wxCoord AnimationCell::GetMaxWidth() const {
@@ -308,6 +351,14 @@ void AnimationCell::Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) {
       dc->SetPen(*wxRED_PEN);
     dc->DrawRectangle(wxRect(point.x, point.y - m_center, m_width, m_height));
 
+    if (m_animationRunning && !m_configuration->GetPrinting() &&
+        (m_displayed != m_lastCountedFrame)) {
+      m_lastCountedFrame = m_displayed;
+      m_framesShown++;
+      if (!m_images.at(m_displayed)->IsBitmapReady())
+        m_framesDropped++;
+    }
+
     wxBitmap bitmap =
       (m_configuration->GetPrinting()
        ? m_images.at(m_displayed)->GetBitmap(
@@ -327,6 +378,10 @@ void AnimationCell::Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) {
              m_width - 2 * imageBorderWidth, m_height - 2 * imageBorderWidth,
              &bitmapDC, imageBorderWidth - m_imageBorderWidth,
              imageBorderWidth - m_imageBorderWidth);
+
+    // Prepare the frames that will be shown next while this one is visible
+    if (!m_configuration->GetPrinting())
+      UpdateFrameWindow(true);
   } else
     {
       // The cell isn't drawn => No need to keep it's image cache for now.
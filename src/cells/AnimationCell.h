@@ -119,8 +119,20 @@ public:
   wxImage GetBitmap(int n) const
     { return m_images[n]->GetUnscaledBitmap().ConvertToImage(); }
 
+  /*! Sets the frame to display
+
+    Frames that are far away from the new frame drop their decoded pixels.
+  */
   void SetDisplayedIndex(int ind);
 
+  /*! The number of frames that weren't ready when they were due in this loop
+
+    A frame is dropped if it hasn't been scaled to its size in the background
+    yet when the timer wants to display it; The animation then has to wait for
+    it.
+  */
+  int GetDroppedFrames() const { return m_framesDropped; }
+
   //! Exports the image the animation currently displays
   wxSize ToImageFile(wxString file) override;
 
@@ -194,6 +206,21 @@ private:
   int m_framerate = -1;
   int m_displayed = 0;
   int m_imageBorderWidth = 0;
+  //! The number of frames that have been drawn while the animation was running in this loop
+  int m_framesShown = 0;
+  //! The number of frames that weren't ready in time in this loop
+  int m_framesDropped = 0;
+  //! The frame that has been counted in m_framesShown last
+  int m_lastCountedFrame = -1;
+
+  /*! Keeps only the frames around the displayed one decoded
+
+    Frames that have been displayed a while ago drop their decoded pixels.
+    \param prefetch true = Start scaling the next frames in the background
+  */
+  void UpdateFrameWindow(bool prefetch);
+  //! How many frames we prefetch, depending on the frame rate
+  int GetFramesAhead() const;
 
 //** Bitfield objects (1 bytes)
 //**
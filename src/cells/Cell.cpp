@@ -239,6 +239,17 @@ GroupCell *Cell::GetGroup() const {
   return group;
 }
 
+void Cell::SetGroup(GroupCell *group) {
+  m_group = group;
+  for (Cell &cell : OnInner(this))
+    cell.SetGroupList(group);
+}
+
+void Cell::SetGroupList(GroupCell *group) {
+  for (Cell &tmp : OnList(this))
+    tmp.SetGroup(group);
+}
+
 bool Cell::NeedsRecalculation(AFontSize fontSize) const {
   if (!HasValidSize())
     return true;
@@ -471,6 +482,13 @@ int Cell::GetLineIndent() const {
 }
 
 void Cell::BreakLines_List()
+{
+  wxCoord lineWidth = GetLineIndent();
+  bool lineBroken = false;
+  BreakLines_List(lineWidth, lineBroken);
+}
+
+void Cell::BreakLines_List(wxCoord &lineWidth, bool &lineBroken)
 {
   // 1st step: Tell all cells to display as beautiful 2d object, if that is
   // possible.
@@ -484,7 +502,6 @@ void Cell::BreakLines_List()
 
   // 3rd step: Determine a sane maximum line width
   int fullWidth = m_configuration->GetCanvasSize().x - m_configuration->GetIndent();
-  int currentWidth = GetLineIndent();
   //  if ((this->GetTextStyle() != TS_LABEL) && (this->GetTextStyle() != TS_USERLABEL))
   //  fullWidth -= m_configuration->GetIndent();
 
@@ -497,20 +514,19 @@ void Cell::BreakLines_List()
 
   // 4th step: break the output into lines.
   if (!IsHidden()) {
-    bool prevBroken = false;
     for (Cell &tmp : OnDrawList(this)) {
-      if (prevBroken) {
-        currentWidth += tmp.GetLineIndent();
-        prevBroken = false;
+      if (lineBroken) {
+        lineWidth += tmp.GetLineIndent();
+        lineBroken = false;
       }
       wxCoord const cellWidth = tmp.GetWidth();
       tmp.SoftLineBreak(false);
-      if (tmp.HasHardLineBreak() || (currentWidth + cellWidth >= fullWidth)) {
+      if (tmp.HasHardLineBreak() || (lineWidth + cellWidth >= fullWidth)) {
         tmp.SoftLineBreak(true);
-        currentWidth = tmp.GetLineIndent();
-        prevBroken = true;
+        lineWidth = tmp.GetLineIndent();
+        lineBroken = true;
       }
-      currentWidth += cellWidth;
+      lineWidth += cellWidth;
     }
   }
   ResetSize_RecursivelyList();
@@ -242,6 +242,15 @@ public:
    */
   void BreakLines_List();
 
+  /*! Break lines in this list of cells that continues an already broken line
+
+    \param lineWidth The width of the line the first cell of this list is appended
+    to. Is updated to the width of the last line of this list.
+    \param lineBroken true = The line before this list ended in a line break
+    that hasn't been followed by a cell yet. Updated for the end of this list.
+   */
+  void BreakLines_List(wxCoord &lineWidth, bool &lineBroken);
+
   /*! If this were the beginning of a line: How far do we need to indent it? */
   int GetLineIndent() const;
 
@@ -593,6 +602,16 @@ public:
   //! Returns the group cell this cell belongs to
   GroupCell *GetGroup() const;
 
+  /*! Moves this cell and all cells it owns to a new group cell
+
+    Used for cells that have been created without a group, for example by
+    a MathParser that runs in a background thread: The group cell's
+    CellPtr bookkeeping may only be touched by the main thread.
+  */
+  virtual void SetGroup(GroupCell *group);
+  //! Moves a whole list of cells and all cells they own to a new group cell
+  void SetGroupList(GroupCell *group);
+
   //! For the bitmap export we sometimes want to know how big the result will be...
   struct SizeInMillimeters
   {
@@ -21,7 +21,9 @@
 //  SPDX-License-Identifier: GPL-2.0+
 
 #include "CellList.h"
+#include "CellPointers.h"
 #include "GroupCell.h"
+#include "GroupCellIndex.h"
 #include <utility>
 void CellListBuilderBase::base_Append(std::unique_ptr<Cell> &&cells) {
   m_lastAppended = cells.get();
@@ -74,6 +76,12 @@ std::unique_ptr<Cell> CellList::SetNext(Cell *cell, std::unique_ptr<Cell> &&next
   if (cell->m_next)
     cell->m_next->m_previous = cell;
   cell->SetNextToDraw(cell->m_next);
+  if (cell->GetType() == MC_TYPE_GROUP) {
+    // Only changes to the worksheet's list of GroupCells outdate its index.
+    GroupCellIndex &index = cell->GetCellPointers()->m_groupCellIndex;
+    if (index.IndexOf(static_cast<GroupCell *>(cell)) < index.Size())
+      index.ListChanged();
+  }
 
   Check(cell);
   Check(next.get());
@@ -89,11 +97,12 @@ void CellList::DeleteList(Cell *afterMe) {
   }
 }
 
-void CellList::AppendCell(Cell *cell, std::unique_ptr<Cell> &&tail) {
+void CellList::AppendCell(Cell *cell, std::unique_ptr<Cell> &&tail,
+                          bool resetGroupSize) {
   Check(cell);
   if (!tail)
     return;
-  if (cell->m_group)
+  if (resetGroupSize && cell->m_group)
     // Note: The above cannot be m_group or an assert will trigger!
     // We do not *expect* all cells here to have groups, so GetGroup()
     // above would be inappropriate.
@@ -173,12 +173,16 @@ public:
    *
    * \param cell is the cell list to append to.
    * \param tail is the cell to append. It can be a list, a single cell, or null.
+   * \param resetGroupSize false = The caller takes care of the layout of the
+   * group the cells belong to, so the sizes of its cells can be kept.
    */
-  static void AppendCell(Cell *cell, std::unique_ptr<Cell> &&tail);
+  static void AppendCell(Cell *cell, std::unique_ptr<Cell> &&tail,
+                         bool resetGroupSize = true);
 
   template <typename T>
-  static void AppendCell(const std::unique_ptr<T> &cell, std::unique_ptr<Cell> &&tail)
-    { AppendCell(cell.get(), std::move(tail)); }
+  static void AppendCell(const std::unique_ptr<T> &cell, std::unique_ptr<Cell> &&tail,
+                         bool resetGroupSize = true)
+    { AppendCell(cell.get(), std::move(tail), resetGroupSize); }
 
   struct SplicedIn
   {
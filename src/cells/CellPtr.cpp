@@ -25,9 +25,9 @@
 
 #define CELL_PRIXPTR "010" PRIXPTR
 
-size_t Observed::m_instanceCount;
-size_t Observed::ControlBlock::m_instanceCount;
-size_t CellPtrBase::m_instanceCount;
+std::atomic<size_t> Observed::m_instanceCount{0};
+std::atomic<size_t> Observed::ControlBlock::m_instanceCount{0};
+std::atomic<size_t> CellPtrBase::m_instanceCount{0};
 
 void Observed::OnEndOfLife() const noexcept {
   // TODO Both cases are equivalent: we're resetting
@@ -187,12 +187,12 @@ void Observed::ControlBlock::LogConstruct(const Observed *p) const {
 }
 
 void Observed::ControlBlock::LogRef(const CellPtrBase *cellptr) const {
-  CELLPTR_LOG_METHOD(wxS("%p CB::Ref (%d->%d) cb=%p obj=%p"), cellptr, m_refCount,
+  CELLPTR_LOG_METHOD(wxS("%p CB::Ref (%d->%d) cb=%p obj=%p"), cellptr, m_refCount.load(),
                      m_refCount + 1, this, m_object);
 }
 
 void Observed::ControlBlock::LogDeref(const CellPtrBase *cellptr) const {
-  CELLPTR_LOG_METHOD(wxS("%p CB::Deref (%d->%d) cb=%p obj=%p"), cellptr, m_refCount,
+  CELLPTR_LOG_METHOD(wxS("%p CB::Deref (%d->%d) cb=%p obj=%p"), cellptr, m_refCount.load(),
                      m_refCount - 1, this, m_object);
 }
 
@@ -49,6 +49,7 @@
 #include <wx/debug.h>
 #include <wx/log.h>
 #include <utility>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cinttypes>
@@ -91,9 +92,9 @@ class Observed
     //! Pointer to the object this control block tracks.
     Observed *m_object = {};
     //! Number of observers for this object
-    unsigned int m_refCount = 0;
+    std::atomic<unsigned int> m_refCount{0};
     //! The global number of instances of ControlBlock
-    static size_t m_instanceCount;
+    static std::atomic<size_t> m_instanceCount;
 
 #if CELLPTR_LOG_REFS
     void LogConstruct(const Observed *) const;
@@ -209,7 +210,8 @@ class Observed
 
   friend void swap(CellPtrImplPointer &a, CellPtrImplPointer &b) noexcept;
   friend class CellPtrBase;
-  static size_t m_instanceCount;
+  //! The global number of instances of Observed. Cells are created by the parser thread, too.
+  static std::atomic<size_t> m_instanceCount;
 
   /*! Pointer to null, CellPtrBase, or ControlBlock.
    *
@@ -277,7 +279,7 @@ class CellPtrBase
 {
   using CellPtrImplPointer = Observed::CellPtrImplPointer;
   using ControlBlock = Observed::ControlBlock;
-  static size_t m_instanceCount;
+  static std::atomic<size_t> m_instanceCount;
 
   /*! Pointer to null, the object itself, or to the control block.
    *
@@ -37,6 +37,7 @@
 #include "wxMaxima.h"
 #include "wxMaximaFrame.h"
 #include <algorithm>
+#include <iterator>
 #include <wx/clipbrd.h>
 #include <wx/regex.h>
 #include <wx/tokenzr.h>
@@ -147,8 +148,9 @@ void EditorCell::AddDrawParameter(wxString param) {
     m_text.Right(m_text.Length() - CursorPosition());
   m_text = m_text.Left(CursorPosition());
   m_text.Trim();
+  m_lineIndexValid = false;
   if (commaNeededBefore) {
-    m_text += wxS(",");
+    ReplaceText(m_text.Length(), m_text.Length(), wxS(","));
     CursorMove(1);
   }
 
@@ -158,10 +160,10 @@ void EditorCell::AddDrawParameter(wxString param) {
     ProcessNewline(false);
     wxString line = lines.GetNextToken();
     line.Trim(false);
-    m_text += line;
+    ReplaceText(m_text.Length(), m_text.Length(), line);
     CursorMove(line.Length());
   }
-  m_text += textAfterParameter;
+  ReplaceText(m_text.Length(), m_text.Length(), textAfterParameter);
   StyleText();
   ContainsChanges(true);
 }
@@ -560,8 +562,7 @@ void EditorCell::ConvertNumToUNicodeChar() {
     wxLogNull suppressConversationErrors;
     newChar = wxChar(number);
   }
-  m_text = m_text.Left(CursorPosition()) + newChar +
-    m_text.Right(m_text.Length() - CursorPosition() - numLen);
+  ReplaceText(CursorPosition(), CursorPosition() + numLen, newChar);
   CursorMove(newChar.Length());
 }
 
@@ -572,6 +573,14 @@ bool EditorCell::NeedsRecalculation(AFontSize fontSize) const {
 void EditorCell::Recalculate(AFontSize fontsize) {
   if(NeedsRecalculation(fontsize))
     {
+      // If the fonts might have changed all text snippets need to be created and
+      // measured from scratch. Else only the ones for text that has changed.
+      if ((m_configuration->CellCfgCnt() != m_measuredCfgCnt) ||
+          (Scale_Px(fontsize) != m_measuredFontSize)) {
+        m_styledCodeValid = false;
+        m_measuredCfgCnt = m_configuration->CellCfgCnt();
+        m_measuredFontSize = Scale_Px(fontsize);
+      }
       // Needs to be before the StyleText() as it sets m_fontsize_scaled
       Cell::Recalculate(fontsize);
       // Perhaps we should test if the fons have actually changed here.
@@ -599,10 +608,12 @@ void EditorCell::Recalculate(AFontSize fontsize) {
           m_numberOfLines++;
           linewidth = textSnippet.GetIndentPixels();
         } else {
-          m_configuration->GetRecalcDC()->GetTextExtent(textSnippet.GetText(),
-                                                        &tokenwidth, &tokenheight);
-          textSnippet.SetWidth(tokenwidth);
-          linewidth += tokenwidth;
+          if (!textSnippet.SizeKnown()) {
+            m_configuration->GetRecalcDC()->GetTextExtent(textSnippet.GetText(),
+                                                          &tokenwidth, &tokenheight);
+            textSnippet.SetWidth(tokenwidth);
+          }
+          linewidth += textSnippet.GetWidth();
           width = std::max(width, linewidth);
         }
 
@@ -909,11 +920,13 @@ void EditorCell::Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) {
 
 void EditorCell::SetType(CellType type) {
   m_widths.clear();
+  m_styledCodeValid = false;
   Cell::SetType(type);
 }
 
 void EditorCell::SetStyle(TextStyle style) {
   m_widths.clear();
+  m_styledCodeValid = false;
   Cell::SetStyle(style);
 }
 
@@ -1096,8 +1109,7 @@ bool EditorCell::HandleCtrlCommand(wxKeyEvent &ev) {
     size_t end = EndOfLine(CursorPosition());
     if (end == CursorPosition())
       end++;
-    m_text = m_text.SubString(0, CursorPosition() - 1) +
-      m_text.SubString(end, m_text.length());
+    ReplaceText(CursorPosition(), end, wxEmptyString);
     m_isDirty = true;
     break;
   }
@@ -1308,8 +1320,7 @@ void EditorCell::ProcessNewline(bool keepCursorAtStartOfLine) {
       SaveValue();
       auto start = SelectionLeft();
       auto end =   SelectionRight();
-      m_text =
-        m_text.SubString(0, start - 1) + m_text.SubString(end, m_text.Length());
+      ReplaceText(start, end, wxEmptyString);
       CursorPosition(start);
       ClearSelection();
     }
@@ -1342,21 +1353,13 @@ void EditorCell::ProcessNewline(bool keepCursorAtStartOfLine) {
       for (size_t i = 0; i < indentChars; i++)
         indentString += wxS(" ");
 
-    wxString newLines = m_text.SubString(CursorPosition(), m_text.Length());
-    if (autoIndent) {
-      // Remove leading spaces from the text that follows the cursor
-      wxString newLines_noleadingSpaces;
-      newLines_noleadingSpaces.reserve(newLines.Length());
-      wxString::const_iterator it = newLines.begin();
-      for (; (it != newLines.end()) && (*it == ' '); ++it) {
-      }
-
-      for (; it != newLines.end(); ++it)
-        newLines_noleadingSpaces += *it;
-      newLines = newLines_noleadingSpaces;
-    }
-    m_text = m_text.SubString(0, CursorPosition() - 1) + wxS("\n") +
-      indentString + newLines;
+    // Remove leading spaces from the text that follows the cursor
+    size_t leadingSpacesEnd = CursorPosition();
+    if (autoIndent)
+      while ((leadingSpacesEnd < m_text.Length()) &&
+             (m_text.at(leadingSpacesEnd) == wxS(' ')))
+        ++leadingSpacesEnd;
+    ReplaceText(CursorPosition(), leadingSpacesEnd, wxS("\n") + indentString);
     CursorMove(1);
     if ((indentChars > 0) && (autoIndent)) {
       CursorPosition(BeginningOfLine(CursorPosition()));
@@ -1641,8 +1644,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
         if (CursorPosition() < m_text.Length()) {
           m_isDirty = true;
           m_containsChanges = true;
-          m_text = m_text.SubString(0, CursorPosition() - 1) +
-            m_text.SubString(CursorPosition() + 1, m_text.Length());
+          ReplaceText(CursorPosition(), CursorPosition() + 1, wxEmptyString);
         }
       } else {
         m_isDirty = true;
@@ -1650,8 +1652,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
         SaveValue();
         auto start = SelectionLeft();
         auto end   = SelectionRight();
-        m_text = m_text.SubString(0, start - 1) +
-          m_text.SubString(end, m_text.Length());
+        ReplaceText(start, end, wxEmptyString);
         CursorPosition(start);
       }
     } else {
@@ -1665,22 +1666,19 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
       while (pos > 0 &&
              wxIsalnum(m_text.at(pos - 1))) {
         pos--;
-        m_text = m_text.SubString(0, pos - 1) +
-          m_text.SubString(pos + 1, m_text.Length());
+        ReplaceText(pos, pos + 1, wxEmptyString);
       }
       // Delete Spaces, Tabs and Newlines until the next printable character
       while (pos > 0 &&
              wxIsspace(m_text.at(pos - 1))) {
         pos--;
-        m_text = m_text.SubString(0, pos - 1) +
-          m_text.SubString(pos + 1, m_text.Length());
+        ReplaceText(pos, pos + 1, wxEmptyString);
       }
 
       // If we didn't delete anything till now delete one single character.
       if (CursorPosition() == pos) {
         pos--;
-        m_text = m_text.SubString(0, pos - 1) +
-          m_text.SubString(pos + 1, m_text.Length());
+        ReplaceText(pos, pos + 1, wxEmptyString);
       }
       CursorPosition(pos);
     }
@@ -1696,8 +1694,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
         m_isDirty = true;
         auto start = SelectionLeft();
         auto end   = SelectionRight();
-        m_text = m_text.SubString(0, start - 1) +
-          m_text.SubString(end, m_text.Length());
+        ReplaceText(start, end, wxEmptyString);
         CursorPosition(start);
         StyleText();
         break;
@@ -1711,8 +1708,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
 
             if (m_text.SubString(0, pos - 1).Right(4) ==
                 wxS("    ")) {
-              m_text = m_text.SubString(0, pos - 5) +
-                m_text.SubString(pos, m_text.Length());
+              ReplaceText(pos - 4, pos, wxEmptyString);
               pos -= 4;
             } else {
               /// If deleting ( in () then delete both.
@@ -1728,8 +1724,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
                    (m_text.GetChar(pos - 1) == '"' &&
                     m_text.GetChar(pos) == '"')))
                 right++;
-              m_text = m_text.SubString(0, pos - 2) +
-                m_text.SubString(right, m_text.Length());
+              ReplaceText(pos - 1, right, wxEmptyString);
               pos--;
             }
           }
@@ -1745,22 +1740,19 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
           while (pos > 0 &&
                  wxIsalnum(m_text.at(pos - 1))) {
             pos--;
-            m_text = m_text.SubString(0, pos - 1) +
-              m_text.SubString(pos + 1, m_text.Length());
+            ReplaceText(pos, pos + 1, wxEmptyString);
           }
           // Delete Spaces, Tabs and Newlines until the next printable character
           while (pos > 0 &&
                  wxIsspace(m_text.at(pos - 1))) {
             pos--;
-            m_text = m_text.SubString(0, pos - 1) +
-              m_text.SubString(pos + 1, m_text.Length());
+            ReplaceText(pos, pos + 1, wxEmptyString);
           }
 
           // If we didn't delete anything till now delete one single character.
           if (lastpos == pos) {
             pos--;
-            m_text = m_text.SubString(0, pos - 1) +
-              m_text.SubString(pos + 1, m_text.Length());
+            ReplaceText(pos, pos + 1, wxEmptyString);
           }
         }
       }
@@ -1801,14 +1793,12 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
                 if (event.ShiftDown()) {
                   for (int i = 0; i < 4; i++)
                     if (m_text.at(p) == wxS(' ')) {
-                      m_text = m_text.SubString(0, p - 1) +
-                        m_text.SubString(p + 1, m_text.Length());
+                      ReplaceText(p, p + 1, wxEmptyString);
                       if (end > 0)
                         end--;
                     }
                 } else {
-                  m_text = m_text.SubString(0, p - 1) + wxS("    ") +
-                    m_text.SubString(p, m_text.Length());
+                  ReplaceText(p, p, wxS("    "));
                   end += 4;
                   p += 4;
                 }
@@ -1821,8 +1811,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
               }
               SetSelection(start, end);
             } else {
-              m_text = m_text.SubString(0, start - 1) +
-                m_text.SubString(end, m_text.Length());
+              ReplaceText(start, end, wxEmptyString);
             }
             CursorPosition(start);
             StyleText();
@@ -1838,15 +1827,13 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event) {
                 ins += wxS(" ");
               } while (col % 4 != 0);
 
-              m_text = m_text.SubString(0, pos - 1) + ins +
-                m_text.SubString(pos, m_text.Length());
+              ReplaceText(pos, pos, ins);
               pos += ins.Length();
             } else {
               // Selection active and Shift+Tab
               size_t start = BeginningOfLine(pos);
               if (m_text.SubString(start, start + 3) == wxS("    ")) {
-                m_text = m_text.SubString(0, start - 1) +
-                  m_text.SubString(start + 4, m_text.Length());
+                ReplaceText(start, start + 4, wxEmptyString);
                 if (pos > start) {
                   pos = start;
                   while ((pos < m_text.Length()) &&
@@ -1916,57 +1903,49 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event) {
 
     switch (keyCode) {
     case '(':
-      m_text = m_text.SubString(0, start - 1) + wxS("(") +
-        m_text.SubString(start, end - 1) + wxS(")") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS(")"));
+      ReplaceText(start, start, wxS("("));
       CursorPosition(start);
       insertLetter = false;
       break;
     case '\"':
-      m_text = m_text.SubString(0, start - 1) + wxS("\"") +
-        m_text.SubString(start, end - 1) + wxS("\"") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS("\""));
+      ReplaceText(start, start, wxS("\""));
       CursorPosition(start);
       insertLetter = false;
       break;
     case '{':
-      m_text = m_text.SubString(0, start - 1) + wxS("{") +
-        m_text.SubString(start, end - 1) + wxS("}") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS("}"));
+      ReplaceText(start, start, wxS("{"));
       CursorPosition(start);
       insertLetter = false;
       break;
     case '[':
-      m_text = m_text.SubString(0, start - 1) + wxS("[") +
-        m_text.SubString(start, end - 1) + wxS("]") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS("]"));
+      ReplaceText(start, start, wxS("["));
       CursorPosition(start);
       insertLetter = false;
       break;
     case ')':
-      m_text = m_text.SubString(0, start - 1) + wxS("(") +
-        m_text.SubString(start, end - 1) + wxS(")") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS(")"));
+      ReplaceText(start, start, wxS("("));
       CursorPosition(end + 2);
       insertLetter = false;
       break;
     case '}':
-      m_text = m_text.SubString(0, start - 1) + wxS("{") +
-        m_text.SubString(start, end - 1) + wxS("}") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS("}"));
+      ReplaceText(start, start, wxS("{"));
       CursorPosition(end + 2);
       insertLetter = false;
       break;
     case ']':
-      m_text = m_text.SubString(0, start - 1) + wxS("[") +
-        m_text.SubString(start, end - 1) + wxS("]") +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(end, end, wxS("]"));
+      ReplaceText(start, start, wxS("["));
       CursorPosition(end + 2);
       insertLetter = false;
       break;
     default: // delete selection
-      m_text = m_text.SubString(0, start - 1) +
-        m_text.SubString(end, m_text.Length());
+      ReplaceText(start, end, wxEmptyString);
       CursorPosition(start);
       break;
     }
@@ -1983,51 +1962,42 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event) {
     if (event.ShiftDown())
       chr.Replace(wxS(" "), wxS("\u00a0"));
 
-    m_text = m_text.SubString(0, CursorPosition() - 1) + chr +
-      m_text.SubString(CursorPosition(), m_text.Length());
+    ReplaceText(CursorPosition(), CursorPosition(), chr);
 
     CursorMove(1);
 
     if (m_configuration->GetMatchParens()) {
       switch (keyCode) {
       case '(':
-        m_text = m_text.SubString(0, CursorPosition() - 1) + wxS(")") +
-          m_text.SubString(CursorPosition(), m_text.Length());
+        ReplaceText(CursorPosition(), CursorPosition(), wxS(")"));
         break;
       case '[':
-        m_text = m_text.SubString(0, CursorPosition() - 1) + wxS("]") +
-          m_text.SubString(CursorPosition(), m_text.Length());
+        ReplaceText(CursorPosition(), CursorPosition(), wxS("]"));
         break;
       case '{':
-        m_text = m_text.SubString(0, CursorPosition() - 1) + wxS("}") +
-          m_text.SubString(CursorPosition(), m_text.Length());
+        ReplaceText(CursorPosition(), CursorPosition(), wxS("}"));
         break;
       case '"':
         if (CursorPosition() < m_text.Length() &&
             m_text.GetChar(CursorPosition()) == '"')
-          m_text = m_text.SubString(0, CursorPosition() - 2) +
-            m_text.SubString(CursorPosition(), m_text.Length());
+          ReplaceText(CursorPosition() - 1, CursorPosition(), wxEmptyString);
         else
-          m_text = m_text.SubString(0, CursorPosition() - 1) + wxS("\"") +
-            m_text.SubString(CursorPosition(), m_text.Length());
+          ReplaceText(CursorPosition(), CursorPosition(), wxS("\""));
         break;
       case ')': // jump over ')'
         if (CursorPosition() < m_text.Length() &&
             m_text.GetChar(CursorPosition()) == ')')
-          m_text = m_text.SubString(0, CursorPosition() - 2) +
-            m_text.SubString(CursorPosition(), m_text.Length());
+          ReplaceText(CursorPosition() - 1, CursorPosition(), wxEmptyString);
         break;
       case ']': // jump over ']'
         if (CursorPosition() < m_text.Length() &&
             m_text.GetChar(CursorPosition()) == ']')
-          m_text = m_text.SubString(0, CursorPosition() - 2) +
-            m_text.SubString(CursorPosition(), m_text.Length());
+          ReplaceText(CursorPosition() - 1, CursorPosition(), wxEmptyString);
         break;
       case '}': // jump over '}'
         if (CursorPosition() < m_text.Length() &&
             m_text.GetChar(CursorPosition()) == '}')
-          m_text = m_text.SubString(0, CursorPosition() - 2) +
-            m_text.SubString(CursorPosition(), m_text.Length());
+          ReplaceText(CursorPosition() - 1, CursorPosition(), wxEmptyString);
         break;
       case '+':
         // case '-': // this could mean negative.
@@ -2040,8 +2010,7 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event) {
         if (m_configuration->GetInsertAns()) {
           // Insert an "%" before an operator that begins this cell
           if (len == 1 && CursorPosition() == 1) {
-            m_text = m_text.SubString(0, CursorPosition() - 2) + wxS("%") +
-              m_text.SubString(CursorPosition() - 1, m_text.Length());
+            ReplaceText(CursorPosition() - 1, CursorPosition() - 1, wxS("%"));
             CursorMove(1);
           }
 
@@ -2050,7 +2019,7 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event) {
           // with a comment in the obvious way tends to surprise users.
           if ((len == 3) && (CursorPosition() == 3) &&
               (m_text.StartsWith(wxS("%/*")))) {
-            m_text = m_text.SubString(CursorPosition() - 2, m_text.Length());
+            ReplaceText(0, CursorPosition() - 2, wxEmptyString);
             CursorMove(-1);
           }
         }
@@ -2074,9 +2043,9 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event) {
 bool EditorCell::FindMatchingQuotes() {
   size_t pos = 0;
   for (auto const &tok : m_tokens) {
-    if ((tok.GetText().StartsWith(wxS("\""))) &&
-        (tok.GetText().EndsWith(wxS("\"")))) {
-      size_t tokenEnd = pos + tok.GetText().Length() - 1;
+    if ((tok.StartsWith(wxS('\"'))) &&
+        (tok[tok.GetLength() - 1] == wxS('\"'))) {
+      size_t tokenEnd = pos + tok.GetLength() - 1;
       if ((CursorPosition() == tokenEnd) ||
           (CursorPosition() == pos)) {
         m_paren1 = pos;
@@ -2086,7 +2055,7 @@ bool EditorCell::FindMatchingQuotes() {
     }
     if (pos > CursorPosition())
       return false;
-    pos += tok.GetText().Length();
+    pos += tok.GetLength();
   }
   return false;
 }
@@ -2107,14 +2076,14 @@ void EditorCell::FindMatchingParens() {
     size_t pos = 0;
     for (auto const &tok : m_tokens) {
       if (pos >= CursorPosition()) {
-        if ((tok.GetText().StartsWith(wxS("("))) ||
-            (tok.GetText().StartsWith(wxS("["))) ||
-            (tok.GetText().StartsWith(wxS("{"))))
+        if ((tok.StartsWith(wxS('('))) ||
+            (tok.StartsWith(wxS('['))) ||
+            (tok.StartsWith(wxS('{'))))
           parenLevel++;
         else {
-          if ((tok.GetText().StartsWith(wxS(")"))) ||
-              (tok.GetText().StartsWith(wxS("]"))) ||
-              (tok.GetText().StartsWith(wxS("}")))) {
+          if ((tok.StartsWith(wxS(')'))) ||
+              (tok.StartsWith(wxS(']'))) ||
+              (tok.StartsWith(wxS('}')))) {
             parenLevel--;
             if (parenLevel == 0) {
               m_paren1 = CursorPosition();
@@ -2124,7 +2093,7 @@ void EditorCell::FindMatchingParens() {
           }
         }
       }
-      pos += tok.GetText().Length();
+      pos += tok.GetLength();
     }
     return;
   }
@@ -2136,12 +2105,12 @@ void EditorCell::FindMatchingParens() {
       pos = 0;
     else
       pos = m_text.Length() - 1;
-    auto const tokens = MaximaTokenizer(m_text, m_configuration).PopTokens();
+    auto const &tokens = GetAllTokens();
     for (auto tok = tokens.rbegin(); tok != tokens.rend(); ++tok) {
       if (pos <= CursorPosition()) {
-        if ((tok->GetText().StartsWith(wxS("("))) ||
-            (tok->GetText().StartsWith(wxS("["))) ||
-            (tok->GetText().StartsWith(wxS("{")))) {
+        if ((tok->StartsWith(wxS('('))) ||
+            (tok->StartsWith(wxS('['))) ||
+            (tok->StartsWith(wxS('{')))) {
           parenLevel--;
           if (parenLevel == 0) {
             m_paren1 = pos;
@@ -2149,14 +2118,14 @@ void EditorCell::FindMatchingParens() {
             return;
           }
         } else {
-          if ((tok->GetText().StartsWith(wxS(")"))) ||
-              (tok->GetText().StartsWith(wxS("]"))) ||
-              (tok->GetText().StartsWith(wxS("}")))) {
+          if ((tok->StartsWith(wxS(')'))) ||
+              (tok->StartsWith(wxS(']'))) ||
+              (tok->StartsWith(wxS('}')))) {
             parenLevel++;
           }
         }
       }
-      pos -= tok->GetText().Length();
+      pos -= tok->GetLength();
     }
   }
 }
@@ -2225,17 +2194,17 @@ bool EditorCell::AddEnding() {
     if ((itemStyle == TS_CODE_ENDOFLINE) || (itemStyle == TS_CODE_LISP)) {
       endingNeeded = false;
     } else {
-      if ((!tok.GetText().StartsWith(" ")) &&
-          (!tok.GetText().StartsWith("\t")) &&
-          (!tok.GetText().StartsWith("\n")) &&
-          (!tok.GetText().StartsWith("\r")) &&
+      if ((!tok.StartsWith(' ')) &&
+          (!tok.StartsWith('\t')) &&
+          (!tok.StartsWith('\n')) &&
+          (!tok.StartsWith('\r')) &&
           (!(itemStyle == TS_CODE_COMMENT)))
         endingNeeded = true;
     }
   }
 
   if (endingNeeded) {
-    m_text += wxS(";");
+    ReplaceText(m_text.Length(), m_text.Length(), wxS(";"));
     m_paren1 = m_paren2 = m_width = -1;
     StyleText();
     return true;
@@ -2249,46 +2218,34 @@ bool EditorCell::AddEnding() {
 //   at position pos in m_text.
 //
 void EditorCell::PositionToXY(size_t position, size_t *x, size_t *y) {
-  size_t col = 0, lin = 0;
-  size_t pos = 0;
-
-  wxString::const_iterator it = m_text.begin();
-  while ((pos < position) && (it < m_text.end())) {
-    if ((*it == '\n') || (*it == '\r')) {
-      col = 0;
-      lin++;
-    } else
-      col++;
-
-    ++it;
-    ++pos;
-  }
-
-  *x = col;
-  *y = lin;
+  const LineIndex &lines = GetLineIndex();
+  position = wxMin(position, m_text.Length());
+  *y = lines.GetLine(position);
+  *x = position - lines.GetLineStart(*y);
 }
 
 size_t EditorCell::XYToPosition(size_t x, size_t y) {
-  size_t col = 0, lin = 0, pos = 0;
-
-  wxString::const_iterator it = m_text.begin();
-  while ((it < m_text.end()) && (lin < y)) {
-    if ((*it == '\n') || (*it == '\r'))
-      lin++;
+  const LineIndex &lines = GetLineIndex();
+  if (y >= lines.GetLines())
+    return m_text.Length();
+  return wxMin(lines.GetLineStart(y) + x, lines.GetLineEnd(y));
+}
 
-    ++it;
-    ++pos;
-  }
+void EditorCell::ReplaceText(size_t start, size_t end,
+                             const wxString &replacement) {
+  start = wxMin(start, m_text.Length());
+  end = wxMax(start, wxMin(end, m_text.Length()));
+  if (m_lineIndexValid)
+    m_lineIndex.Replace(start, end, replacement.begin(), replacement.end());
+  m_text.replace(start, end - start, replacement);
+}
 
-  while ((it < m_text.end()) && (pos < m_text.Length()) && (col < x)) {
-    if ((*it == '\n') || (*it == '\r'))
-      break;
-    ++pos;
-    ++col;
-    ++it;
+const LineIndex &EditorCell::GetLineIndex() {
+  if ((!m_lineIndexValid) || (m_lineIndex.GetTextLength() != m_text.Length())) {
+    m_lineIndex.Build(m_text.begin(), m_text.end());
+    m_lineIndexValid = true;
   }
-
-  return pos;
+  return m_lineIndex;
 }
 
 wxPoint EditorCell::PositionToPoint(size_t pos) {
@@ -2658,8 +2615,7 @@ bool EditorCell::CutToClipboard() {
   CursorPosition(start);
 
   // We cannot use SetValue() here, since SetValue() tends to move the cursor.
-  m_text =
-    m_text.SubString(0, start - 1) + m_text.SubString(end, m_text.Length());
+  ReplaceText(start, end, wxEmptyString);
   StyleText();
 
   ClearSelection();
@@ -2681,8 +2637,10 @@ void EditorCell::InsertText(wxString text) {
   if (GetType() == MC_TYPE_INPUT)
     FindMatchingParens();
 
-  m_text.Replace(wxS("\u2028"), "\n");
-  m_text.Replace(wxS("\u2029"), "\n");
+  size_t unicodeLineBreaks = m_text.Replace(wxS("\u2028"), "\n");
+  unicodeLineBreaks += m_text.Replace(wxS("\u2029"), "\n");
+  if (unicodeLineBreaks > 0)
+    m_lineIndexValid = false;
 
   //  m_width = m_height = m_center = -1;
   //  InvalidateMaxDrop();
@@ -2838,6 +2796,7 @@ void EditorCell::History::ClearUndoBuffer() {
 
 void EditorCell::SetState(const EditorCell::History::HistoryEntry &state) {
   m_text = state.GetText();
+  m_lineIndexValid = false;
   StyleText();
   m_paren1 = m_paren2 = -1;
   m_isDirty = true;
@@ -2906,6 +2865,7 @@ void EditorCell::HandleSoftLineBreaks_Code(
     lastSpace->SetText("\r");
     lastSpace->SetIndentation(indentationPixels);
     text.at(lastSpacePos) = '\r';
+    m_lineIndexValid = false;
     lastSpace = NULL;
   }
 }
@@ -2937,8 +2897,26 @@ void EditorCell::StyleTextCode() {
     }
   }
 
+  // Soft line breaks depend on everything before them and hidden lines
+  // leave the tokens incomplete => Only restyle the lines that have changed
+  // if there is none of both.
+  if (suppressedLinesInfo.IsEmpty() && !m_configuration->GetAutoWrapCode() &&
+      !m_configuration->InLispMode()) {
+    if (StyleTextCodeIncrementally(textToStyle))
+      return;
+    m_styledCode = textToStyle;
+    m_styledCodeValid = true;
+  }
+  else
+    m_styledCodeValid = false;
+
+  m_wordList.clear();
+  m_styledText.clear();
+  m_tokenSnippets.clear();
+
   // Split the line into commands, numbers etc.
   m_tokens = MaximaTokenizer(textToStyle, m_configuration).PopTokens();
+  m_tokenSnippets.reserve(m_tokens.size() + 1);
 
   // Now handle the text pieces one by one
   wxString lastTokenWithText;
@@ -2946,57 +2924,203 @@ void EditorCell::StyleTextCode() {
   wxCoord lineWidth = 0;
 
   for (auto const &token : m_tokens) {
-    pos += token.GetText().Length();
-    auto &tokenString = token.GetText();
+    m_tokenSnippets.push_back(m_styledText.size());
+    pos += token.GetLength();
+    const wxString tokenString = token.GetText();
     if (tokenString.IsEmpty())
       continue;
     wxChar Ch = tokenString.at(0);
 
+    AppendCodeSnippets(token, m_styledText);
+
     // Handle Spaces
     if (Ch == wxS(' ')) {
-      // All spaces except the last one (that could cause a line break)
-      // share the same token
-      if (tokenString.Length() > 1)
-        m_styledText.push_back(StyledText(tokenString.Right(tokenString.Length() - 1)));
-
-      // Now we push the last space to the list of tokens and remember this
-      // space as the space that potentially serves as the next point to
-      // introduce a soft line break.
-      m_styledText.push_back(StyledText(wxS(" ")));
+      // Remember the last space as the space that potentially serves as the
+      // next point to introduce a soft line break.
       lastSpace = &m_styledText.back();
       lastSpacePos = pos + tokenString.Length() - 1;
       continue;
     }
 
-    // Most of the other item types can contain Newlines - that we want as
-    // separate tokens
-    wxString txt = tokenString;
-    wxString line;
-    for (wxString::const_iterator it2 = txt.begin(); it2 < txt.end(); ++it2) {
-      if (*it2 != '\n')
-        line += wxString(*it2);
-      else {
-        if (line != wxEmptyString)
-          m_styledText.push_back(StyledText(token.GetTextStyle(), line));
-        m_styledText.push_back(StyledText(token.GetTextStyle(), "\n"));
-        line.Clear();
-      }
-    }
-    if (line != wxEmptyString)
-      m_styledText.push_back(StyledText(token.GetTextStyle(), line));
-    HandleSoftLineBreaks_Code(lastSpace, lineWidth, token, pos, m_text,
+    HandleSoftLineBreaks_Code(lastSpace, lineWidth, tokenString, pos, m_text,
                               lastSpacePos, indentationPixels);
     if ((token.GetTextStyle() == TS_CODE_VARIABLE) ||
         (token.GetTextStyle() == TS_CODE_FUNCTION)) {
-      m_wordList.push_back(token);
+      m_wordList.push_back(tokenString);
       continue;
     }
   }
+  m_tokenSnippets.push_back(m_styledText.size());
   std::sort(m_wordList.begin(), m_wordList.end());
   if(!suppressedLinesInfo.IsEmpty())
     m_styledText.push_back(StyledText(TS_CODE_COMMENT, suppressedLinesInfo));
 }
 
+void EditorCell::AppendCodeSnippets(const MaximaTokenizer::Token &token,
+                                    std::vector<StyledText> &styledText) {
+  const wxString tokenString = token.GetText();
+  if (tokenString.IsEmpty())
+    return;
+
+  // Handle Spaces
+  if (tokenString.at(0) == wxS(' ')) {
+    // All spaces except the last one (that could cause a line break)
+    // share the same token
+    if (tokenString.Length() > 1)
+      styledText.push_back(StyledText(tokenString.Right(tokenString.Length() - 1)));
+
+    // Now we push the last space to the list of tokens.
+    styledText.push_back(StyledText(wxS(" ")));
+    return;
+  }
+
+  // Most of the other item types can contain Newlines - that we want as
+  // separate tokens
+  wxString line;
+  for (wxString::const_iterator it = tokenString.begin(); it < tokenString.end(); ++it) {
+    if (*it != '\n')
+      line += wxString(*it);
+    else {
+      if (line != wxEmptyString)
+        styledText.push_back(StyledText(token.GetTextStyle(), line));
+      styledText.push_back(StyledText(token.GetTextStyle(), "\n"));
+      line.Clear();
+    }
+  }
+  if (line != wxEmptyString)
+    styledText.push_back(StyledText(token.GetTextStyle(), line));
+}
+
+//! Is this token a newline that isn't part of a comment or a string?
+static bool IsLineEnding(const MaximaTokenizer::Token &token) {
+  return (token.GetLength() == 1) &&
+    ((token[0] == wxS('\n')) || (token[0] == L'\u2028') || (token[0] == L'\u2029'));
+}
+
+//! Is this token something autocompletion should know about?
+static bool IsWord(const MaximaTokenizer::Token &token) {
+  return (token.GetTextStyle() == TS_CODE_VARIABLE) ||
+    (token.GetTextStyle() == TS_CODE_FUNCTION);
+}
+
+bool EditorCell::StyleTextCodeIncrementally(const wxString &text) {
+  if (!m_styledCodeValid)
+    return false;
+  if (text == m_styledCode)
+    return true;
+
+  // Where does each of the old tokens begin?
+  auto const tokenStart = [this](std::size_t token) {
+    return (token < m_tokens.size()) ? m_tokens[token].GetOffset() : m_styledCode.Length();
+  };
+  auto const startsAfter = [](std::size_t pos, const MaximaTokenizer::Token &token) {
+    return pos < token.GetOffset();
+  };
+  auto const startsBefore = [](const MaximaTokenizer::Token &token, std::size_t pos) {
+    return token.GetOffset() < pos;
+  };
+  if (m_tokenSnippets.size() != m_tokens.size() + 1)
+    return false;
+
+  // Which part of the text has changed?
+  std::size_t const oldLength = m_styledCode.Length();
+  std::size_t const newLength = text.Length();
+  std::size_t prefix = 0;
+  wxString::const_iterator oldIt = m_styledCode.begin();
+  wxString::const_iterator newIt = text.begin();
+  while ((prefix < oldLength) && (prefix < newLength) && (*oldIt == *newIt)) {
+    ++prefix;
+    ++oldIt;
+    ++newIt;
+  }
+  std::size_t suffix = 0;
+  wxString::const_iterator oldEnd = m_styledCode.end();
+  wxString::const_iterator newEnd = text.end();
+  while ((prefix + suffix < oldLength) && (prefix + suffix < newLength) &&
+         (*(--oldEnd) == *(--newEnd)))
+    ++suffix;
+
+  // A name followed only by whitespace is a function if the next char after the
+  // whitespace is a "(". The changed text therefore can change the tokens of the
+  // line that contains the last char before it that isn't whitespace.
+  std::size_t restart = prefix;
+  oldIt = m_styledCode.begin() + prefix;
+  while ((restart > 0) && ((*(--oldIt) == wxS(' ')) || (*oldIt == wxS('\t')) ||
+                           (*oldIt == wxS('\n')) || (*oldIt == wxS('\r'))))
+    --restart;
+  std::size_t firstToken = 0;
+  if (restart > 0) {
+    firstToken = static_cast<std::size_t>(
+      std::upper_bound(m_tokens.begin(), m_tokens.end(), restart - 1, startsAfter) -
+      m_tokens.begin()) - 1;
+    while ((firstToken > 0) && !IsLineEnding(m_tokens[firstToken - 1]))
+      --firstToken;
+  }
+
+  // Tokenize until the new tokens end in a newline the old tokens end in, too:
+  // Behind it both token lists are the same.
+  std::size_t const changeEnd = newLength - suffix;
+  std::size_t lastToken = m_tokens.size();
+  auto newTokens =
+    MaximaTokenizer(text, m_configuration, tokenStart(firstToken),
+                    [&](std::size_t lineEnd) {
+                      if (lineEnd < changeEnd)
+                        return false;
+                      std::size_t const oldLineEnd = lineEnd + oldLength - newLength;
+                      std::size_t const index = static_cast<std::size_t>(
+                        std::lower_bound(m_tokens.begin(), m_tokens.end(), oldLineEnd,
+                                         startsBefore) - m_tokens.begin());
+                      if (tokenStart(index) != oldLineEnd)
+                        return false;
+                      if ((index <= firstToken) || !IsLineEnding(m_tokens[index - 1]))
+                        return false;
+                      lastToken = index;
+                      return true;
+                    }).PopTokens();
+
+  // Forget the words of the tokens we replace and learn the new ones
+  for (std::size_t i = firstToken; i < lastToken; i++)
+    if (IsWord(m_tokens[i])) {
+      wxString const name = m_tokens[i].GetText();
+      auto word = std::lower_bound(m_wordList.begin(), m_wordList.end(), name);
+      if ((word != m_wordList.end()) && (*word == name))
+        m_wordList.erase(word);
+    }
+  for (auto const &token : newTokens)
+    if (IsWord(token)) {
+      wxString const name = token.GetText();
+      m_wordList.insert(std::upper_bound(m_wordList.begin(), m_wordList.end(), name), name);
+    }
+
+  // Replace the text snippets of the tokens. The ones we keep keep their widths.
+  std::vector<StyledText> newSnippets;
+  std::vector<std::size_t> newTokenSnippets;
+  newTokenSnippets.reserve(newTokens.size());
+  std::size_t const firstSnippet = m_tokenSnippets[firstToken];
+  for (auto const &token : newTokens) {
+    newTokenSnippets.push_back(firstSnippet + newSnippets.size());
+    AppendCodeSnippets(token, newSnippets);
+  }
+  std::size_t const lastSnippet = m_tokenSnippets[lastToken];
+  long const snippetShift =
+    static_cast<long>(newSnippets.size()) - static_cast<long>(lastSnippet - firstSnippet);
+  for (std::size_t i = lastToken; i < m_tokenSnippets.size(); i++)
+    m_tokenSnippets[i] = static_cast<std::size_t>(static_cast<long>(m_tokenSnippets[i]) +
+                                                  snippetShift);
+  m_styledText.erase(m_styledText.begin() + firstSnippet,
+                     m_styledText.begin() + lastSnippet);
+  m_styledText.insert(m_styledText.begin() + firstSnippet,
+                      std::make_move_iterator(newSnippets.begin()),
+                      std::make_move_iterator(newSnippets.end()));
+  m_tokenSnippets.erase(m_tokenSnippets.begin() + firstToken,
+                        m_tokenSnippets.begin() + lastToken);
+  m_tokenSnippets.insert(m_tokenSnippets.begin() + firstToken,
+                         newTokenSnippets.begin(), newTokenSnippets.end());
+  m_tokens.Replace(firstToken, lastToken, std::move(newTokens));
+  m_styledCode = text;
+  return true;
+}
+
 void EditorCell::StyleTextTexts() {
   // Remove all bullets of item lists as we will introduce them again in the
   // next step, as well.
@@ -3005,6 +3129,8 @@ void EditorCell::StyleTextTexts() {
   // Insert new soft line breaks where we hit the right border of the worksheet,
   // if this has been requested in the config dialogue
   if (m_configuration->GetAutoWrap()) {
+    // The soft line breaks we add split the lines of m_text
+    m_lineIndexValid = false;
     SetFont(m_configuration->GetRecalcDC());
     wxString line;
     size_t lastSpacePos = 0;
@@ -3273,20 +3399,26 @@ void EditorCell::StyleText() {
   // the font type and size.
   SetFont(m_configuration->GetRecalcDC());
 
-  m_wordList.clear();
-  m_styledText.clear();
-
-  if (m_text == wxEmptyString)
+  if (m_text == wxEmptyString) {
+    m_wordList.clear();
+    m_styledText.clear();
+    m_styledCodeValid = false;
     return;
+  }
 
   // Remove all soft line breaks. They will be re-added in the right places
   // in the next step
-  m_text.Replace(wxS("\r"), wxS(" "));
+  if (m_text.Replace(wxS("\r"), wxS(" ")) > 0)
+    m_lineIndexValid = false;
   // Do we need to style code or text?
   if (m_type == MC_TYPE_INPUT)
     StyleTextCode();
-  else
+  else {
+    m_wordList.clear();
+    m_styledText.clear();
+    m_styledCodeValid = false;
     StyleTextTexts();
+  }
   m_tokens_valid = true;
 }
 
@@ -3331,6 +3463,7 @@ void EditorCell::SetValue(const wxString &text) {
 
   m_text.Replace(wxS("\u2028"), "\n");
   m_text.Replace(wxS("\u2029"), "\n");
+  m_lineIndexValid = false;
 
   // Style the text.
   StyleText();
@@ -3377,6 +3510,7 @@ size_t EditorCell::ReplaceAll(wxString oldString, const wxString &newString,
   }
   if (count > 0) {
     m_text = newText;
+    m_lineIndexValid = false;
     m_containsChanges = true;
     ClearSelection();
     StyleText();
@@ -3385,8 +3519,10 @@ size_t EditorCell::ReplaceAll(wxString oldString, const wxString &newString,
   // If text is selected setting the selection again updates m_selectionString
   SetSelection(SelectionStart(), SelectionEnd());
 
-  m_text.Replace(wxS("\u2028"), "\n");
-  m_text.Replace(wxS("\u2029"), "\n");
+  size_t unicodeLineBreaks = m_text.Replace(wxS("\u2028"), "\n");
+  unicodeLineBreaks += m_text.Replace(wxS("\u2029"), "\n");
+  if (unicodeLineBreaks > 0)
+    m_lineIndexValid = false;
 
   return count;
 }
@@ -3405,11 +3541,13 @@ size_t EditorCell::ReplaceAll_RegEx(const wxString &oldString, const wxString &n
   count = regexsearch.ReplaceAll(&newText, newString);
   if(count > 0) {
     m_text = newText;
+    m_lineIndexValid = false;
     m_containsChanges = true;
     ClearSelection();
     StyleText();
     SetSelection(SelectionStart(), SelectionEnd());
     m_text = newText;
+    m_lineIndexValid = false;
     m_containsChanges = true;
     ClearSelection();
     StyleText();
@@ -3418,8 +3556,10 @@ size_t EditorCell::ReplaceAll_RegEx(const wxString &oldString, const wxString &n
   // If text is selected setting the selection again updates m_selectionString
   SetSelection(SelectionStart(), SelectionEnd());
 
-  m_text.Replace(wxS("\u2028"), "\n");
-  m_text.Replace(wxS("\u2029"), "\n");
+  size_t unicodeLineBreaks = m_text.Replace(wxS("\u2028"), "\n");
+  unicodeLineBreaks += m_text.Replace(wxS("\u2029"), "\n");
+  if (unicodeLineBreaks > 0)
+    m_lineIndexValid = false;
   return count;
 }
 
@@ -3598,51 +3738,38 @@ bool EditorCell::FindNext_RegEx(wxString str, const bool &down) {
 bool EditorCell::ReplaceSelection(const wxString &oldStr,
                                   const wxString &newString, bool keepSelected,
                                   bool ignoreCase, bool replaceMaximaString) {
-  wxString text(m_text);
-  text.Replace(wxS("\r"), wxS(" "));
-
   auto start = SelectionLeft();
   auto end = SelectionRight();
   if (!SelectionActive()) {
     SaveValue();
-    wxString left;
-    wxString right;
-    if(CursorPosition() < m_text.length())
-      {
-        left = m_text.Left(CursorPosition());
-        right = m_text.Right(m_text.Length() - CursorPosition());
-      }
-    else
-      {
-        left = m_text;
-      }
-    m_text = left + newString + right;
+    ReplaceText(CursorPosition(), CursorPosition(), newString);
     CursorPosition(CursorPosition() + newString.Length());
     StyleText();
     return true;
   }
 
+  wxString selection = m_text.SubString(start, end - 1);
+  selection.Replace(wxS("\r"), wxS(" "));
   if (ignoreCase) {
-    if (text.SubString(start, end - 1).Upper() != wxString(oldStr).Upper())
+    if (selection.Upper() != wxString(oldStr).Upper())
       return false;
   } else {
-    if (text.SubString(start, end - 1) != oldStr)
+    if (selection != oldStr)
       return false;
   }
 
   // We cannot use SetValue() here, since SetValue() tends to move the cursor.
-  wxString text_left = text.SubString(0, start - 1);
-  wxString text_right = text.SubString(end, text.Length());
+  bool textRightStartsWithQuote = (end < m_text.Length()) && (m_text.GetChar(end) == wxS('"'));
   SaveValue();
-  m_text = text_left + newString + text_right;
+  ReplaceText(start, end, newString);
   StyleText();
 
   m_containsChanges = true;
   CursorPosition(start + newString.Length());
 
   if (replaceMaximaString) {
-    if ((newString.EndsWith("\"") || (text_right.StartsWith("\"")))) {
-      if (!((newString.EndsWith("\"") && (text_right.StartsWith("\"")))))
+    if ((newString.EndsWith("\"") || textRightStartsWithQuote)) {
+      if (!((newString.EndsWith("\"") && textRightStartsWithQuote)))
         CursorMove(-1);
     }
   }
@@ -3680,6 +3807,7 @@ bool EditorCell::ReplaceSelection_RegEx(const wxString &oldStr,
   if(!match.Found())
     return false;
   m_text = text;
+  m_lineIndexValid = false;
   CursorPosition(match.GetEnd());
 
   if (GetType() == MC_TYPE_INPUT)
@@ -26,6 +26,7 @@
 
 #include "Cell.h"
 #include "FontAttribs.h"
+#include "LineIndex.h"
 #include "MaximaTokenizer.h"
 #include <vector>
 #include <list>
@@ -165,7 +166,7 @@ public:
   wxString ToXML() const override;
 
   //! Get the font that matches this cell's formatting
-  const wxFont &GetFont() const {
+  wxFont GetFont() const {
     return m_configuration->GetStyle(GetTextStyle())->GetFont(m_fontSize_Scaled);
   }
   //! Set the currently used font to the one that matches this cell's formatting
@@ -596,6 +597,23 @@ private:
   void HandleSoftLineBreaks_Code(StyledText *&lastSpace, wxCoord &lineWidth, const wxString &token, size_t charInCell,
                                  wxString &text, const size_t &lastSpacePos, wxCoord &indentationPixels);
 
+  //! Appends the text snippets a token of code is displayed as to styledText
+  static void AppendCodeSnippets(const MaximaTokenizer::Token &token,
+                                 std::vector<StyledText> &styledText);
+
+  /*! Re-tokenizes and re-styles only the lines of code that have changed
+
+    Starts at the beginning of the line that contains the last char that could
+    influence the tokens of the changed text, and stops at the first newline
+    behind the change at which the new tokens meet the old ones again. The
+    text snippets of the unchanged tokens keep their widths, which means that
+    Recalculate() only needs to measure the new ones.
+
+    \return false, if m_tokens and m_styledText cannot be updated incrementally
+    and therefore need to be created from scratch.
+  */
+  bool StyleTextCodeIncrementally(const wxString &text);
+
   /*! How many chars do we need to indent text at the position the caret is currently at?
 
     \todo We should provide an alternative function that allows to resume the calculation
@@ -617,6 +635,16 @@ private:
   //! Determines the size of a text snippet
   wxSize GetTextSize(const wxString &text);
 
+  /*! Replaces the chars [start, end) of m_text and updates m_lineIndex
+
+    Every change to m_text that doesn't use this function has to set
+    m_lineIndexValid to false.
+  */
+  void ReplaceText(size_t start, size_t end, const wxString &replacement);
+
+  //! The index of the lines of m_text, rebuilt if it is outdated
+  const LineIndex &GetLineIndex();
+
   //! The memory for the undo history
   History m_history;  
   //! Set the editor's state from a history entry
@@ -641,8 +669,15 @@ private:
   /*! The text this Editor contains
    */
   wxString m_text;
+  //! Where the lines of m_text begin. Only up-to-date if m_lineIndexValid
+  LineIndex m_lineIndex;
   std::vector<StyledText> m_styledText;
 
+  //! The code m_tokens and m_styledText have been created from. See StyleTextCodeIncrementally().
+  wxString m_styledCode;
+  //! For each of m_tokens: The index of the first of m_styledText it is displayed as
+  std::vector<std::size_t> m_tokenSnippets;
+
 //** 8/4 bytes
 //**
   CellPointers *const m_cellPointers = GetCellPointers();
@@ -664,6 +699,15 @@ private:
   bool m_tokens_including_hidden_valid = false;
   //! Does the list of displayed tokens need to be recalculated?
   bool m_tokens_valid = false;
+  //! Can StyleTextCodeIncrementally() update m_tokens and m_styledText?
+  bool m_styledCodeValid = false;
+  //! Does m_lineIndex describe m_text?
+  bool m_lineIndexValid = false;
+
+  //! The Configuration::CellCfgCnt() the widths of m_styledText have been measured for
+  std::int_fast32_t m_measuredCfgCnt = -1;
+  //! The font size the widths of m_styledText have been measured for
+  AFontSize m_measuredFontSize;
 
 
 //** Bitfield objects (2 bytes)
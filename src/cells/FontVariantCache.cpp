@@ -22,25 +22,35 @@
 #include "FontVariantCache.h"
 #include <wx/intl.h>
 #include <wx/log.h>
-#include <iostream>
-FontVariantCache::FontVariantCache(const wxString &fontName):
-  m_fontName(fontName)
+#include <algorithm>
+#include <cmath>
+
+std::atomic<std::uint32_t> FontVariantCache::m_numberOfCaches(0);
+
+FontVariantCache::FontVariantCache(const wxString &fontName, std::size_t maxFonts):
+  m_maxFonts(std::max(maxFonts, static_cast<std::size_t>(1))),
+  m_fontName(fontName),
+  m_id(m_numberOfCaches++)
 {
 }
 
 
 void FontVariantCache::ClearCache() const {
-  bool cleared = false;
-  for (auto &i: m_fontCaches)
+  if(!m_fonts.empty())
   {
-    if(!i.empty())
-    {
-      cleared = true;
-      i.clear();
-    }
-  }
-  if(cleared)
+    m_fontIndex.clear();
+    m_fonts.clear();
     wxLogMessage(_("Cleared font cache for font %s"), m_fontName.mb_str());
+  }
+}
+
+FontVariantCache::Statistics FontVariantCache::GetStatistics() const {
+  Statistics statistics;
+  statistics.hits = m_hits;
+  statistics.misses = m_misses;
+  statistics.evictions = m_evictions;
+  statistics.fonts = m_fonts.size();
+  return statistics;
 }
 
 std::shared_ptr<wxFont> FontVariantCache::GetFont (double size,
@@ -56,43 +66,57 @@ std::shared_ptr<wxFont> FontVariantCache::GetFont (double size,
                        isUnderlined,
                        isSlanted,
                        isStrikeThrough);
-  auto cachedFont = m_fontCaches[index].find(size);
-  if(cachedFont == m_fontCaches[index].end())
+  long quantizedSize = std::max(std::lround(size / SizeQuantum()), 1L);
+  Key key = GetKey(quantizedSize, index);
+  auto cachedFont = m_fontIndex.find(key);
+  if(cachedFont != m_fontIndex.end())
   {
-    wxFontStyle style;
-    style = wxFONTSTYLE_NORMAL;
-    if(isItalic)
-      style = wxFONTSTYLE_ITALIC;
-    if(isSlanted)
-      style = wxFONTSTYLE_SLANT;
-    wxFontWeight weight;
-    if(isBold)
-      weight = wxFONTWEIGHT_BOLD;
-    else
-      weight = wxFONTWEIGHT_NORMAL;
-    auto font = std::shared_ptr<wxFont>(
-      new
-      wxFont (
-        size,
-        wxFONTFAMILY_DEFAULT,
-        style,
-        weight, isUnderlined,
-        m_fontName));
-    if(!font->IsOk())
-    {
-      wxLogMessage(_("Cannot create a font based on %s. Falling back to a default font."), m_fontName.mb_str());
-      font = std::shared_ptr<wxFont>(new wxFont(*wxNORMAL_FONT));
-    }
-    if(isStrikeThrough)
-      font->MakeStrikethrough();
+    m_hits++;
+    m_fonts.splice(m_fonts.begin(), m_fonts, cachedFont->second);
+    return cachedFont->second->second;
+  }
+
+  m_misses++;
+  size = quantizedSize * SizeQuantum();
+  wxFontStyle style;
+  style = wxFONTSTYLE_NORMAL;
+  if(isItalic)
+    style = wxFONTSTYLE_ITALIC;
+  if(isSlanted)
+    style = wxFONTSTYLE_SLANT;
+  wxFontWeight weight;
+  if(isBold)
+    weight = wxFONTWEIGHT_BOLD;
+  else
+    weight = wxFONTWEIGHT_NORMAL;
+  auto font = std::shared_ptr<wxFont>(
+    new
+    wxFont (
+      size,
+      wxFONTFAMILY_DEFAULT,
+      style,
+      weight, isUnderlined,
+      m_fontName));
+  if(!font->IsOk())
+  {
+    wxLogMessage(_("Cannot create a font based on %s. Falling back to a default font."), m_fontName.mb_str());
+    font = std::shared_ptr<wxFont>(new wxFont(*wxNORMAL_FONT));
+  }
+  if(isStrikeThrough)
+    font->MakeStrikethrough();
 #if wxCHECK_VERSION(3, 1, 2)
-    font->SetFractionalPointSize(size);
+  font->SetFractionalPointSize(size);
 #else
-    font->SetPointSize(size);
+  font->SetPointSize(size);
 #endif
-    m_fontCaches[index][size] = font;
-    wxLogMessage(_("Caching font variant: %s"), font->GetNativeFontInfoDesc().mb_str());
-    return font;
+  m_fonts.emplace_front(key, font);
+  m_fontIndex[key] = m_fonts.begin();
+  // The fonts that are still in use are kept alive by their shared_ptrs
+  while(m_fonts.size() > m_maxFonts)
+  {
+    m_fontIndex.erase(m_fonts.back().first);
+    m_fonts.pop_back();
+    m_evictions++;
   }
-  return cachedFont->second;
+  return font;
 }
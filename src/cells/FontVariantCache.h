@@ -23,6 +23,9 @@
 #define FONTVARIANTCACHE_H
 
 #include "precomp.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <wx/font.h>
 #include <functional>
@@ -36,22 +39,38 @@
  This system is necessary since creating a wxFont object costs loads of
  CPU cycles costs.
 
- Each font gets its own FontVariantCache that caches all sizes of each
- style of that font that we ever generated a wxFont object for.
+ Each font gets its own FontVariantCache that caches the sizes of each
+ style of that font that we have generated a wxFont object for recently.
 */
 class FontVariantCache final
 {
   FontVariantCache(const FontVariantCache &) = delete;
   FontVariantCache &operator=(const FontVariantCache &) = delete;
 public:
-  //! Creates a font variant cache for the font named fontName.
-  explicit FontVariantCache(const wxString &fontName);
+  //! What a font variant cache knows about how well it works
+  struct Statistics
+  {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t fonts = 0;
+  };
+
+  /*! Creates a font variant cache for the font named fontName.
+
+    \param fontName The name of the font
+    \param maxFonts The maximum number of wxFont objects to keep.
+  */
+  explicit FontVariantCache(const wxString &fontName, std::size_t maxFonts = 128);
   ~FontVariantCache(){}
   //! Clear this font variant cache
   void ClearCache() const;
   /*! Returns a font with the requested attributes
 
-    This font can be either cached or newly created.*/
+    This font can be either cached or newly created. The size is rounded to
+    the next multiple of SizeQuantum() so zooming in small steps doesn't create
+    a new font for every step.
+  */
   std::shared_ptr<wxFont> GetFont (double size,
                                    bool isItalic,
                                    bool isBold,
@@ -61,6 +80,27 @@ public:
     );
   //! Get the name of the fonts this font variant cache is responsible for
   const wxString& GetFaceName() const {return m_fontName;}
+  /*! A number that identifies the font with the requested attributes
+
+    All fonts GetFont() returns for the same id and size look the same, even
+    if the cache has been cleared in the meantime. This allows to cache
+    information about the font, for example the sizes of texts.
+  */
+  std::uint32_t GetFontId(bool isItalic,
+                          bool isBold,
+                          bool isUnderlined,
+                          bool isSlanted,
+                          bool isStrikeThrough
+    ) const
+    {
+      return m_id * 32 + GetIndex(isItalic, isBold, isUnderlined, isSlanted,
+                                  isStrikeThrough);
+    }
+  //! The font sizes GetFont() distinguishes between, in points
+  static constexpr double SizeQuantum() { return 0.25; }
+  //! How well does this cache work?
+  Statistics GetStatistics() const;
+
 private:
   //! Get the number of the internal cache hashmap
   static int GetIndex (
@@ -85,10 +125,27 @@ private:
       return result;
     }
 
-  //! One hashmap for each value GetIndex() can return.
-  mutable std::unordered_map<double, std::shared_ptr<wxFont>> m_fontCaches[32];
+  //! Identifies a font: The size in multiples of SizeQuantum() and the GetIndex()
+  using Key = std::uint32_t;
+  static Key GetKey(long quantizedSize, int index)
+    { return static_cast<Key>(quantizedSize) * 32 + static_cast<Key>(index); }
+  //! The fonts, the one that has been used last first
+  using Fonts = std::list<std::pair<Key, std::shared_ptr<wxFont>>>;
+
+  mutable Fonts m_fonts;
+  //! Where in m_fonts to find each font
+  mutable std::unordered_map<Key, Fonts::iterator> m_fontIndex;
+  //! The maximum number of fonts to keep
+  std::size_t m_maxFonts;
+  std::uint64_t m_hits = 0;
+  std::uint64_t m_misses = 0;
+  std::uint64_t m_evictions = 0;
   //! The name our font cache
   wxString m_fontName;
+  //! The number of this font cache, unique for the whole run of the program
+  const std::uint32_t m_id;
+  //! The number of font caches that have been created
+  static std::atomic<std::uint32_t> m_numberOfCaches;
 };
 
 #endif  // FONTVARIANTCACHE_H
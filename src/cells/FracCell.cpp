@@ -334,3 +334,13 @@ void FracCell::SetNextToDraw(Cell *next) {
   else
     m_nextToDraw = next;
 }
+
+void FracCell::SetGroup(GroupCell *group) {
+  Cell::SetGroup(group);
+  // The parenthesis and the "/" sign aren't always part of the inner cells
+  // that are displayed
+  m_numParenthesis->SetGroupList(group);
+  m_denomParenthesis->SetGroupList(group);
+  if (m_divideOwner)
+    m_divideOwner->SetGroupList(group);
+}
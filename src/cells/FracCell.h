@@ -87,6 +87,8 @@ public:
 
   void SetNextToDraw(Cell *next) override;
 
+  void SetGroup(GroupCell *group) override;
+
 private:
   //! Makes the division sign cell, used in linear form - whether when broken
   //! into lines, or when the exponent flag is set.
@@ -31,6 +31,7 @@
 */
 
 #include "../precomp.h"
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <utility>
@@ -39,6 +40,7 @@
 #include "CellImpl.h"
 #include "CellList.h"
 #include "CellPointers.h"
+#include "GroupCellIndex.h"
 #include "ImgCell.h"
 #include "LabelCell.h"
 #include "MarkDown.h"
@@ -208,6 +210,7 @@ void GroupCell::SetGroupType(GroupType groupType) {
       GetPrompt()->SetType(type);
   }
   m_groupType = groupType;
+  ContentsChanged();
   ResetSize();
 }
 
@@ -249,7 +252,30 @@ bool GroupCell::IsFoldable() const {
           (m_groupType == GC_TYPE_HEADING6));
 }
 
-GroupCell::~GroupCell() {}
+GroupCell::~GroupCell() {
+  // The task only shares m_confusablesJob with us, but its result won't be needed
+  m_confusablesTask.Cancel();
+}
+
+std::atomic<std::size_t> GroupCell::m_lastAutosaveId{0};
+std::atomic<std::uint32_t> GroupCell::m_confusablesGeneration{0};
+
+void GroupCell::ContentsChanged() {
+  m_contentsGeneration++;
+  // A folded cell saves the cells that are hidden in it
+  if (m_hiddenTreeParent)
+    m_hiddenTreeParent->ContentsChanged();
+}
+
+GroupCell::ContentsState GroupCell::GetContentsState() const {
+  ContentsState state;
+  state.generation = m_contentsGeneration;
+  if (GetEditable())
+    state.input = GetEditable()->GetValue();
+  state.highlight = GetHighlight();
+  state.suppressTooltipMarker = GetSuppressTooltipMarker();
+  return state;
+}
 
 const wxString &GroupCell::GetAnswer(size_t answer) const {
   if ((!m_autoAnswer) && (!m_configuration->OfferKnownAnswers()))
@@ -273,11 +299,14 @@ void GroupCell::SetAutoAnswer(bool autoAnswer) {
   m_autoAnswer = autoAnswer;
   if (GetEditable())
     GetEditable()->AutoAnswer(autoAnswer);
+  ContentsChanged();
 }
 
 void GroupCell::SetAnswer(const wxString &question, const wxString &answer) {
-  if (!answer.empty())
+  if (!answer.empty()) {
     m_knownAnswers[question] = answer;
+    ContentsChanged();
+  }
 }
 
 GroupCell *GroupCell::GetLastWorkingGroup() const {
@@ -295,6 +324,7 @@ void GroupCell::SetInput(std::unique_ptr<Cell> &&input) {
     return;
   m_inputLabel = std::move(input);
   m_updateConfusableCharWarnings = true;
+  ContentsChanged();
   InputHeightChanged();
 }
 
@@ -317,6 +347,7 @@ void GroupCell::AppendInput(std::unique_ptr<Cell> &&cell) {
     }
   }
   m_updateConfusableCharWarnings = true;
+  ContentsChanged();
   InputHeightChanged();
 }
 
@@ -341,6 +372,7 @@ void GroupCell::RemoveOutput() {
 
   if (GetGroupType() != GC_TYPE_IMAGE)
     m_output.reset();
+  m_layoutLastCell = NULL;
 
   m_cellPointers->m_errorList.Remove(this);
   // Calculate the new cell height.
@@ -356,6 +388,7 @@ void GroupCell::RemoveOutput() {
   UpdateCellsInGroup();
 
   m_updateConfusableCharWarnings = true;
+  ContentsChanged();
   ResetSize_Recursively();
 }
 
@@ -369,16 +402,22 @@ void GroupCell::AppendOutput(std::unique_ptr<Cell> &&cell) {
     auto *input = GetEditable();
     if (m_groupType == GC_TYPE_CODE && input)
       input->ContainsChanges(false);
-  } else
-    CellList::AppendCell(m_output, std::move(cell));
+    m_layoutLastCell = NULL;
+    UpdateCellsInGroup();
+  } else {
+    // Only count the new cells and keep the sizes of the old ones: This way
+    // RecalculateOutput() only needs to lay out what has been appended.
+    m_cellsInGroup += cell->CellsInListRecursive();
+    CellList::AppendCell(m_output, std::move(cell), false);
+  }
 
-  UpdateCellsInGroup();
   m_updateConfusableCharWarnings = true;
+  ContentsChanged();
   m_cellsAppended = true;
 }
 
 void GroupCell::UpdateConfusableCharWarnings() {
-  ClearToolTip();
+  m_updateConfusableCharWarnings = false;
 
   wxString output;
   if (GetOutput())
@@ -387,46 +426,57 @@ void GroupCell::UpdateConfusableCharWarnings() {
   // output
   CmdsAndVariables cmdsAndVariables;
 
-  if (GetEditable())
-    for (auto const &tok :
-           MaximaTokenizer(output, m_configuration, GetEditable()->GetAllTokens())
-           .PopTokens())
+  auto const addNames = [&cmdsAndVariables](const MaximaTokenizer::TokenList &tokens) {
+    for (auto const &tok : tokens)
       if ((tok.GetTextStyle() == TS_CODE_VARIABLE) ||
           (tok.GetTextStyle() == TS_CODE_FUNCTION))
         cmdsAndVariables[tok.GetText()] = 1;
+  };
+  if (GetEditable()) {
+    addNames(GetEditable()->GetAllTokens());
+    addNames(MaximaTokenizer(output, m_configuration).PopTokens());
+  }
 
-  // Now we step through all the words we found
-  while (!cmdsAndVariables.empty()) {
-    CmdsAndVariables::iterator cmp = cmdsAndVariables.begin();
-    wxString word;
-    word = cmp->first;
-    cmdsAndVariables.erase(cmp);
-    // Now iterate through all remaining words
-    cmp = cmdsAndVariables.begin();
-    while (cmp != cmdsAndVariables.end()) {
-      // iterate through all lookalike chars
-      for (wxString::const_iterator it = m_lookalikeChars.begin();
-           it != m_lookalikeChars.end(); ++it) {
-        wxUniChar ch1 = *it++;
-        wxASSERT(it != m_lookalikeChars.end());
-        wxUniChar ch2 = *it;
-        wxString word_subst = word;
-        if (word_subst.Replace(ch1, ch2)) {
-          if (cmp->first == word_subst)
-            AddToolTip(_("Warning: Lookalike chars: ") + cmp->first.utf8_str() +
-                       wxS("\u2260") + word.utf8_str());
-        }
-        word_subst = word;
-        if (word_subst.Replace(ch2, ch1)) {
-          if (cmp->first == word_subst)
-            AddToolTip(_("Warning: Lookalike chars: ") + cmp->first +
-                       wxS(" \u2260 ") + word);
-        }
-      }
-      ++cmp;
-    }
+  std::vector<std::wstring> words;
+  words.reserve(cmdsAndVariables.size());
+  for (auto const &word : cmdsAndVariables)
+    words.push_back(word.first.ToStdWstring());
+
+  // Most changes to a cell don't change the names it contains. In this case
+  // the warnings we already have are still valid.
+  std::sort(words.begin(), words.end());
+  if (words == m_identifiers)
+    return;
+  m_identifiers = words;
+
+  m_confusablesTask.Cancel();
+  auto job = std::make_shared<ConfusablesJob>();
+  m_confusablesJob = job;
+  if (!m_configuration->UseThreads()) {
+    job->pairs = ConfusableChars::Find(std::move(words));
+    job->done = true;
+    ShowConfusableCharWarnings();
+    return;
   }
-  m_updateConfusableCharWarnings = false;
+  m_confusablesTask =
+    TaskPool::Get().Submit(TaskPool::OTHER, TaskPool::LOW,
+                           [job, words = std::move(words)]() mutable {
+                             job->pairs = ConfusableChars::Find(std::move(words));
+                             job->done = true;
+                             m_confusablesGeneration++;
+                             wxWakeUpIdle();
+                           });
+}
+
+void GroupCell::ShowConfusableCharWarnings() {
+  if (!m_confusablesJob || !m_confusablesJob->done)
+    return;
+
+  ClearToolTip();
+  for (auto const &pair : m_confusablesJob->pairs)
+    AddToolTip(_("Warning: Lookalike chars: ") + wxString(pair.first) +
+               wxS(" \u2260 ") + wxString(pair.second));
+  m_confusablesJob.reset();
 }
 
 bool GroupCell::Recalculate() {
@@ -470,7 +520,9 @@ void GroupCell::InputHeightChanged() {
     m_outputRect.y = m_currentPoint.y + m_center;
     m_width = std::max(m_width, m_output->GetLineWidth());
   }
-  UpdateYPositionList();
+  // Only our own size changes in the index: The cells below us ask the index
+  // for their position when they are drawn or looked up.
+  UpdateYPosition();
 }
 
 // Called on resize events
@@ -535,43 +587,71 @@ void GroupCell::RecalculateInput() {
 
 void GroupCell::RecalculateOutput() {
   m_outputRect = wxRect(m_currentPoint.x, m_currentPoint.y + m_center, 0, 0);
-  if (IsHidden())
+  if (IsHidden()) {
+    m_layoutLastCell = NULL;
     return;
+  }
 
-  if (m_output == NULL)
+  if (m_output == NULL) {
+    m_layoutLastCell = NULL;
     return;
+  }
 
   m_mathFontSize = m_configuration->GetMathFontSize();
 
-  // The following line is a hack, kind of: Without it the first
-  // (and only) line of an image that was included using the gui, not maxima
-  // (and that therefore doesn't start in a label that per definition breaks
-  // a line) later will not trigger the
-  //  if (tmp.BreakLineHere())
-  // that causes its height to be calculated.
-  m_output->ForceBreakLine();
-
-  m_mathFontSize = m_configuration->GetMathFontSize(); //-V519
-
-  // Recalculate size of all output cells
-  for (Cell &tmp : OnList(m_output.get())) {
-    tmp.Recalculate(tmp.IsMath() ? m_configuration->GetMathFontSize()
-                    : m_configuration->GetDefaultFontSize());
+  // The cells we need to lay out. If output has only been appended since the
+  // last time we did so these are only the new cells, and the lines before the
+  // last one of the old output keep their layout.
+  Cell *start = m_output.get();
+  if (CanLayoutIncrementally()) {
+    start = m_layoutLastCell->GetNext();
+    m_outputRect.height = m_layoutHeight;
+    m_outputRect.width = std::max(m_width, m_layoutWidth);
+    m_width = m_outputRect.width;
+  } else {
+    // The following line is a hack, kind of: Without it the first
+    // (and only) line of an image that was included using the gui, not maxima
+    // (and that therefore doesn't start in a label that per definition breaks
+    // a line) later will not trigger the
+    //  if (tmp.BreakLineHere())
+    // that causes its height to be calculated.
+    m_output->ForceBreakLine();
+    m_layoutLastLineStart = m_output.get();
+    m_layoutLineWidth = m_output->GetLineIndent();
+    m_layoutLineBroken = false;
+    m_layoutHeight = 0;
+    m_layoutWidth = 0;
   }
 
-  // Breakup cells and break lines
-  BreakLines();
+  if (start) {
+    // Recalculate size of all output cells
+    for (Cell &tmp : OnList(start)) {
+      tmp.Recalculate(tmp.IsMath() ? m_configuration->GetMathFontSize()
+                      : m_configuration->GetDefaultFontSize());
+    }
 
-  // Recalculate size of cells again: Their size might have changed during
-  // breaking lines
-  for (Cell &tmp : OnList(m_output.get())) {
-    tmp.Recalculate(tmp.IsMath() ? m_configuration->GetMathFontSize()
-                    : m_configuration->GetDefaultFontSize());
+    // Breakup cells and break lines
+    start->RecalculateList(m_configuration->GetMathFontSize());
+    bool lineBroken = m_layoutLineBroken;
+    start->BreakLines_List(m_layoutLineWidth, lineBroken);
+    m_layoutLineBroken = lineBroken;
+
+    // Recalculate size of cells again: Their size might have changed during
+    // breaking lines
+    for (Cell &tmp : OnList(start)) {
+      tmp.Recalculate(tmp.IsMath() ? m_configuration->GetMathFontSize()
+                      : m_configuration->GetDefaultFontSize());
+    }
   }
 
-  // Calculate the height of the output
-  for (const Cell &tmp : OnDrawList(m_output.get())) {
+  // Calculate the height of the output, starting with the line the new cells
+  // might have been appended to.
+  for (const Cell &tmp : OnDrawList(m_layoutLastLineStart.get())) {
     if (tmp.BreakLineHere()) {
+      m_layoutLastLineStart = const_cast<Cell *>(&tmp);
+      m_layoutHeight = m_outputRect.height;
+      m_layoutWidth = m_outputRect.width;
+
       int height_Delta = tmp.GetHeightList();
       m_width = std::max(m_width, tmp.GetLineWidth());
       m_outputRect.width = std::max(m_outputRect.width, m_width);
@@ -585,6 +665,24 @@ void GroupCell::RecalculateOutput() {
         m_outputRect.height += MC_LINE_SKIP;
     }
   }
+
+  if (start)
+    m_layoutLastCell = start->last();
+  m_layoutCanvasWidth = m_configuration->GetCanvasSize().x;
+  m_layoutMathFontSize = m_configuration->GetMathFontSize();
+}
+
+bool GroupCell::CanLayoutIncrementally() const {
+  if (!m_layoutLastCell || !m_layoutLastLineStart || m_output->IsHidden())
+    return false;
+  // Has anything that influences the size of the old output changed?
+  if (Cell::NeedsRecalculation(m_configuration->GetDefaultFontSize()))
+    return false;
+  if ((m_layoutCanvasWidth != m_configuration->GetCanvasSize().x) ||
+      (m_layoutMathFontSize != m_configuration->GetMathFontSize()))
+    return false;
+  // Is the last cell we have laid out still part of our output?
+  return m_layoutLastCell->GetGroup() == this;
 }
 
 bool GroupCell::NeedsRecalculation(AFontSize fontSize) const {
@@ -599,21 +697,43 @@ void GroupCell::UpdateYPositionList() {
 void GroupCell::UpdateYPosition() {
   const Cell *const previous = GetPrevious();
 
-  wxPoint point(m_configuration->GetIndent(), GetCenter());
+  // If the worksheet's index knows us it knows where we are without the
+  // position of the previous cell having to be up to date.
+  const GroupCellIndex &index = m_cellPointers->m_groupCellIndex;
+  if (previous && index.IsUpToDate()) {
+    const std::size_t i = index.IndexOf(this);
+    if (i < index.Size()) {
+      UpdateYPosition(m_configuration->GetBaseIndent() + index.GetOffset(i));
+      return;
+    }
+  }
+
   if (!previous) {
-    point.y += m_configuration->GetBaseIndent();
+    UpdateYPosition(m_configuration->GetBaseIndent());
     if (m_inputLabel)
-      m_inputLabel->SetCurrentPoint(point);
+      m_inputLabel->SetCurrentPoint(m_currentPoint);
   } else {
-    point.y += m_configuration->GetGroupSkip();
+    wxCoord top = m_configuration->GetGroupSkip();
     if (previous->GetCurrentPoint().y > 0)
-      point.y += previous->GetCurrentPoint().y + previous->GetMaxDrop();
+      top += previous->GetCurrentPoint().y + previous->GetMaxDrop();
+    UpdateYPosition(top);
   }
-  m_currentPoint = point;
+}
+
+void GroupCell::UpdateYPosition(wxCoord top) {
+  m_currentPoint = wxPoint(m_configuration->GetIndent(), top + GetCenter());
 
   EditorCell *editor = GetEditable();
   if (editor)
     editor->SetCurrentPoint(CalculateInputPosition());
+
+  // We are called every time our size might have changed.
+  m_cellPointers->m_groupCellIndex.SetSize(this, GetVerticalExtent(), GetWidth());
+}
+
+wxCoord GroupCell::GetVerticalExtent() const {
+  return std::max(GetCenter(), 0) + std::max(GetHeight() - GetCenter(), 0) +
+    m_configuration->GetGroupSkip();
 }
 
 wxPoint GroupCell::CalculateInputPosition() {
@@ -674,6 +794,7 @@ void GroupCell::Draw(wxPoint const point, wxDC *dc, wxDC *antialiassingDC) {
 
   if (m_updateConfusableCharWarnings)
     UpdateConfusableCharWarnings();
+  ShowConfusableCharWarnings();
 
   // draw a thick line for 'page break'
   // and return
@@ -1438,6 +1559,7 @@ void GroupCell::BreakLines() {
   m_output->RecalculateList(m_configuration->GetMathFontSize());
 
   m_output->BreakLines_List();
+  m_layoutLastCell = NULL;
 }
 
 Cell::Range GroupCell::GetCellsInOutput() const {
@@ -1482,6 +1604,7 @@ void GroupCell::Hide(bool hide) {
     GetLabel()->ClearCacheList();
 
   m_cellsAppended = true;
+  ContentsChanged();
   ResetSize();
   GetEditable()->ResetSize();
 }
@@ -1505,6 +1628,7 @@ bool GroupCell::HideTree(std::unique_ptr<GroupCell> &&tree) {
     }
 
     m_cellsAppended = true;
+    ContentsChanged();
     return true;
   }
   else
@@ -1515,6 +1639,7 @@ std::unique_ptr<GroupCell> GroupCell::UnhideTree() {
   if (m_hiddenTree)
     {
       m_cellsAppended = true;
+      ContentsChanged();
       m_hiddenTree->SetHiddenTreeParent(m_hiddenTreeParent);
     }
   return std::move(m_hiddenTree);
@@ -1575,6 +1700,7 @@ GroupCell *GroupCell::Fold() {
     static_unique_ptr_cast<GroupCell>(std::move(tornOut.cellOwner));
   m_hiddenTree->SetHiddenTreeParent(this);
   m_cellsAppended = true;
+  ContentsChanged();
   return this;
 }
 
@@ -1585,6 +1711,7 @@ GroupCell *GroupCell::Unfold() {
     return NULL;
 
   m_cellsAppended = true;
+  ContentsChanged();
   auto splicedIn = CellList::SpliceInAfter(this, std::move(m_hiddenTree));
   GetNext()->SetHiddenTreeParent(m_hiddenTreeParent);
   return dynamic_cast<GroupCell *>(splicedIn.lastSpliced);
@@ -1833,47 +1960,6 @@ void CellList::Check(const GroupCell *c) {
   CellList::Check(static_cast<const Cell *>(c));
 }
 
-wxString GroupCell::m_lookalikeChars(wxS("µ") wxS("\u03bc") wxS("\u2126") wxS("\u03a9") wxS("C") wxS(
-                                                                                                     "\u03F2") wxS("C") wxS("\u0421") wxS("\u03F2") wxS("\u0421") wxS("A")
-                                     wxS("\u0391") wxS("A") wxS("\u0410") wxS("\u0391") wxS("\u0410") wxS(
-                                                                                                          "M") wxS("\u0392") wxS("E") wxS("\u0395") wxS("E") wxS("\u0415")
-                                     wxS("\u0415") wxS("\u0395") wxS("Z") wxS("\u0396") wxS("H") wxS(
-                                                                                                     "\u0397") wxS("H") wxS("\u041D") wxS("\u0397") wxS("\u041D")
-                                     wxS("I") wxS("\u0399") wxS("I") wxS("\u0406") wxS("l") wxS(
-                                                                                                "\u0406") wxS("K") wxS("\u039A")
-                                     wxS("K") wxS("\u041A") wxS("\u039A") wxS("\u041A") wxS("\u212a") wxS(
-                                                                                                          "\u041A") wxS("K") wxS("\u212A") wxS("M") wxS("\u041c") wxS("\u039C")
-                                     wxS("\u041c") wxS("M") wxS("\u039C") wxS("N") wxS("\u039D") wxS("O") wxS(
-                                                                                                              "\u039F") wxS("O") wxS("\u041E") wxS("\u039F") wxS("\u041E") wxS("\u039F")
-                                     wxS("\u041E") wxS("P") wxS("\u03A1") wxS("X") wxS("\u0425") wxS("e") wxS(
-                                                                                                              "\u0435") wxS("p") wxS("\u0440") wxS("x") wxS("\u0445") wxS("y")
-                                     wxS("\u0443") wxS("P") wxS("\u0420") wxS("\u03A1") wxS(
-                                                                                            "\u0420") wxS("T") wxS("\u03A4") wxS("T") wxS("\u0422") wxS("\u03A4")
-                                     wxS("\u0422") wxS("Y") wxS("\u03A5") wxS("\u212a") wxS(
-                                                                                            "\u039A") wxS("l") wxS("I") wxS("B")
-                                     wxS("\u0392") wxS("S") wxS("\u0405") wxS("\u0392") wxS(
-                                                                                            "\u0412") wxS("B") wxS("\u0412") wxS("J")
-                                     wxS("\u0408") wxS("a") wxS("\u0430") wxS(
-                                                                              "o") wxS("\u03bf") wxS("\u03a3") wxS("\u2211")
-                                     wxS("o") wxS("\u043e") wxS("\u03bf") wxS(
-                                                                              "\u043e") wxS("c") wxS("\u0441") wxS("s")
-                                     wxS("\u0455") wxS("t") wxS("\u03c4") wxS(
-                                                                              "u") wxS("\u03c5") wxS("x") wxS("\u03c7")
-                                     wxS("ü") wxS("\u03cb") wxS("\u0460") wxS(
-                                                                              "\u03c9") wxS("\u0472") wxS("\u0398")
-                                     wxS("У") wxS("Y") wxS("У") wxS(
-                                                                    "y") wxS("ѡ") wxS("ω")
-                                     wxS("Ѳ") wxS("Θ") wxS(
-                                                           "θ") wxS("ѳ") wxS("ø")
-                                     wxS("⌀") wxS("∅") wxS(
-                                                           "⊘") wxS("∅")
-                                     wxS("⌀") wxS(
-                                                  "ø") wxS("⊘")
-                                     wxS("ø") wxS(
-                                                  "∅")
-                                     wxS("⌀") wxS(
-                                                  "⊘"));
-
 std::ostream& operator<<(std::ostream& out, const GroupType grouptype){
   std::string result;
   switch(grouptype){
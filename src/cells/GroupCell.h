@@ -30,10 +30,17 @@
 #ifndef GROUPCELL_H
 #define GROUPCELL_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <memory>
+#include <string>
+#include <vector>
 #include "Cell.h"
+#include "ConfusableChars.h"
 #include "EditorCell.h"
+#include "TaskPool.h"
 #include <unordered_map>
 
 //! All types a GroupCell can be of
@@ -94,7 +101,22 @@ public:
   //! Does this GroupCell save the answer to a question?
   bool AutoAnswer() const { return m_autoAnswer; }
   void SetAutoAnswer(bool autoAnswer);
-  void MarkNeedsRecalculate(){m_cellsAppended = true;}
+  /*! Tell this cell it needs to be recalculated
+
+    \param outputAppended true = The only change since the last recalculation
+    is that AppendOutput() has added output, so only the new output needs to be
+    laid out.
+  */
+  void MarkNeedsRecalculate(bool outputAppended = false)
+    {
+      m_cellsAppended = true;
+      if (!outputAppended)
+        m_layoutLastCell = NULL;
+    }
+  //! Is this cell in the list of cells the worksheet has to recalculate?
+  bool IsQueuedForRecalculation() const { return m_queuedForRecalculation; }
+  //! Tells this cell if it is in the list of cells the worksheet has to recalculate
+  void QueuedForRecalculation(bool queued) { m_queuedForRecalculation = queued; }
   //! Add a new answer to the cell
   void SetAnswer(const wxString &question, const wxString &answer);
 
@@ -150,9 +172,23 @@ public:
 
   AFontSize EditorFontSize() const;
 
-  //! GroupCells warn if they contain both greek and latin lookalike chars.
+  /*! GroupCells warn if they contain both greek and latin lookalike chars.
+
+    Collects the identifiers of the cell and, if they have changed since the
+    last time, looks for lookalikes in the background.
+    ShowConfusableCharWarnings() turns the result into the cell's tooltip.
+  */
   void UpdateConfusableCharWarnings();
 
+  //! Shows the result of UpdateConfusableCharWarnings(), if it is ready
+  void ShowConfusableCharWarnings();
+
+  /*! Changes every time a background search for lookalike chars has finished
+
+    Lets the idle loop know that the worksheet needs to be redrawn.
+  */
+  static std::uint32_t GetConfusablesGeneration() { return m_confusablesGeneration; }
+
   /*! Convert the cell to TeX code
 
     \param imgDir The directory eventual images should be stored in
@@ -241,6 +277,13 @@ public:
   //! Break this cell into lines
   void BreakLines();
 
+  /*! Can RecalculateOutput() keep the layout of the output it has already seen?
+
+    True if the output has only been appended to since the last layout and
+    nothing that affects the size of the output cells has changed.
+  */
+  bool CanLayoutIncrementally() const;
+
   /*! Reset the input label of the current cell.
 
     Won't do nothing if the cell isn't a code cell and therefore isn't equipped
@@ -374,8 +417,16 @@ public:
   wxAccStatus GetLocation (wxRect &rect, int elementId) override;
 #endif
 
-  //! Recalculate the cell's y position using the position and height of the last one.
+  /*! Recalculate the cell's y position
+
+    Uses the worksheet's GroupCellIndex, if that knows this cell, else the
+    position and height of the last cell.
+  */
   void UpdateYPosition();
+  //! Set the cell's y position from the y coordinate of its top
+  void UpdateYPosition(wxCoord top);
+  //! The vertical space this cell occupies, including the gap to the next cell
+  wxCoord GetVerticalExtent() const;
 
   void UpdateOutputPositions();
 
@@ -384,6 +435,35 @@ public:
   bool GetSuppressTooltipMarker() const { return m_suppressTooltipMarker; }
   void SetSuppressTooltipMarker(bool suppress) { m_suppressTooltipMarker = suppress; }
 
+  //! The number that identifies this cell in the autosave journal
+  std::size_t GetAutosaveId() const { return m_autosaveId; }
+  /*! Everything ToXML() saves, in a form that is cheap to compare
+
+    Autosaving compares it in order to find out which cells have changed.
+  */
+  struct ContentsState
+  {
+    //! Incremented whenever the output or the properties of the cell change
+    std::size_t generation = 0;
+    //! The text of the input, which the EditorCell changes without telling us
+    wxString input;
+    //! The value GetHighlight() returns
+    bool highlight = false;
+    //! The value GetSuppressTooltipMarker() returns
+    bool suppressTooltipMarker = false;
+
+    bool operator==(const ContentsState &o) const
+      {
+        return (generation == o.generation) && (highlight == o.highlight) &&
+          (suppressTooltipMarker == o.suppressTooltipMarker) && (input == o.input);
+      }
+    bool operator!=(const ContentsState &o) const { return !(*this == o); }
+  };
+  //! Much cheaper than ToXML(): Doesn't need to convert the output to XML
+  ContentsState GetContentsState() const;
+  //! Tells this cell (and the cell it is folded into) that its contents have changed
+  void ContentsChanged();
+
 protected:
   wxCoord GetInputIndent();
   bool NeedsRecalculation(AFontSize fontSize) const override;
@@ -393,6 +473,25 @@ protected:
 //**
   wxRect m_outputRect{-1, -1, 0, 0};
 
+//** The search for lookalike chars
+//**
+  //! What the background search for lookalike identifiers creates
+  struct ConfusablesJob
+  {
+    //! The identifiers that look alike
+    std::vector<ConfusableChars::Pair> pairs;
+    //! true = the task has finished
+    std::atomic<bool> done{false};
+  };
+  //! The search UpdateConfusableCharWarnings() has started last
+  std::shared_ptr<ConfusablesJob> m_confusablesJob;
+  //! The task that runs m_confusablesJob
+  TaskPool::Task m_confusablesTask;
+  //! The sorted identifiers m_confusablesJob has been started for
+  std::vector<std::wstring> m_identifiers;
+  //! The value GetConfusablesGeneration() returns
+  static std::atomic<std::uint32_t> m_confusablesGeneration;
+
 //** 8/4 byte objects (40 bytes)
 //**
   CellPointers *const m_cellPointers = GetCellPointers();
@@ -400,6 +499,13 @@ protected:
   std::unique_ptr<GroupCell> m_hiddenTree; //!< here hidden (folded) tree of GCs is stored
   GroupCell *m_hiddenTreeParent = {}; //!< store linkage to the parent of the fold
 
+  //! The last id GetAutosaveId() has handed out
+  static std::atomic<std::size_t> m_lastAutosaveId;
+  //! The number that identifies this cell in the autosave journal
+  const std::size_t m_autosaveId = ++m_lastAutosaveId;
+  //! Incremented every time the contents ToXML() saves change
+  std::size_t m_contentsGeneration = 0;
+
   // The pointers below point to inner cells and must be kept contiguous.
   // ** All pointers must be the same: either Cell * or std::unique_ptr<Cell>.
   // ** NO OTHER TYPES are allowed.
@@ -422,6 +528,26 @@ protected:
 
   AFontSize m_mathFontSize;
 
+//** The state of the last layout of the output
+//**
+  // Lets RecalculateOutput() lay out only the cells AppendOutput() has added
+  // since the last layout, instead of the whole output.
+
+  //! The last output cell that has been laid out. NULL = Needs a full layout.
+  CellPtr<Cell> m_layoutLastCell;
+  //! The first cell of the last line of the output
+  CellPtr<Cell> m_layoutLastLineStart;
+  //! The height of all lines of the output before the last one
+  wxCoord m_layoutHeight = 0;
+  //! The width of the widest line of the output before the last one
+  wxCoord m_layoutWidth = 0;
+  //! The width of the last line, as tracked by Cell::BreakLines_List()
+  wxCoord m_layoutLineWidth = 0;
+  //! The canvas width the output has been laid out for
+  wxCoord m_layoutCanvasWidth = -1;
+  //! The math font size the output has been laid out for
+  AFontSize m_layoutMathFontSize;
+
 //** 1-byte objects (1 byte)
 //**
   //! Which type this cell is of?
@@ -438,6 +564,8 @@ protected:
       m_updateConfusableCharWarnings = true;
       m_suppressTooltipMarker = false;
       m_cellsAppended = false;
+      m_layoutLineBroken = false;
+      m_queuedForRecalculation = false;
     }
 
   //! Does this GroupCell automatically fill in the answer to questions?
@@ -448,8 +576,10 @@ protected:
   //! Suppress the yellow ToolTip marker?
   bool m_suppressTooltipMarker : 1 /* InitBitFields_GroupCell */;
   bool m_cellsAppended : 1; /* InitBitFields_GroupCell */
-
-  static wxString m_lookalikeChars;
+  //! Did the last line of the output end in a line break?
+  bool m_layoutLineBroken : 1; /* InitBitFields_GroupCell */
+  //! Is this cell in the worksheet's list of cells to recalculate?
+  bool m_queuedForRecalculation : 1; /* InitBitFields_GroupCell */
 };
 
 #endif /* GROUPCELL_H */
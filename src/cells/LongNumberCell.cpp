@@ -59,7 +59,6 @@ void LongNumberCell::UpdateDisplayedText() {
     m_numStart.clear();
     m_ellipsis.clear();
   }
-  m_sizeCache.clear();
 }
 
 Cell *LongNumberCell::GetInnerCell(size_t index) const
@@ -88,9 +87,8 @@ void LongNumberCell::Recalculate(AFontSize fontsize) {
         TextCell::Recalculate(fontsize);
       else {
         wxDC *dc = m_configuration->GetRecalcDC();
-        SetFont(dc, m_fontSize_Scaled);
-        auto numStartSize = CalculateTextSize(dc, m_numStart, numberStart);
-        auto ellipsisSize = CalculateTextSize(dc, m_ellipsis, ellipsis);
+        auto numStartSize = CalculateTextSize(dc, m_numStart, Scale_Px(fontsize));
+        auto ellipsisSize = CalculateTextSize(dc, m_ellipsis, Scale_Px(fontsize));
         m_numStartWidth = numStartSize.GetWidth();
         m_ellipsisWidth = ellipsisSize.GetWidth();
         m_width = m_numStartWidth + m_ellipsisWidth;
@@ -0,0 +1,214 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class OutputChunkCell
+
+  OutputChunkCell is a part of a very long output that is converted to cells
+  only when it is scrolled into view.
+*/
+
+#include <algorithm>
+#include <utility>
+#include "OutputChunkCell.h"
+#include "CellImpl.h"
+#include "CellPointers.h"
+#include "MathParser.h"
+
+OutputChunkCell::OutputChunkCell(GroupCell *group, Configuration *config,
+                                 std::string &&xml, std::size_t displayedChars,
+                                 std::shared_ptr<const OutputChunker::Container> container,
+                                 bool first, bool last)
+  : TextCell(group, config, wxS("\u2026"), TS_MATH),
+    m_xml(std::move(xml)),
+    m_container(std::move(container)),
+    m_displayedChars(displayedChars) {
+  InitBitFields_OutputChunkCell();
+  m_firstOfContainer = first;
+  m_lastOfContainer = last;
+}
+
+OutputChunkCell::OutputChunkCell(GroupCell *group, const OutputChunkCell &cell)
+  : OutputChunkCell(group, cell.m_configuration, std::string(cell.m_xml),
+                    cell.m_displayedChars, cell.m_container,
+                    cell.m_firstOfContainer, cell.m_lastOfContainer) {
+  CopyCommonData(cell);
+}
+
+DEFINE_CELL(OutputChunkCell)
+
+Cell *OutputChunkCell::GetInnerCell(size_t index) const
+{
+  if(index != 0)
+    return NULL;
+  else
+    return m_innerCell.get();
+}
+
+std::unique_ptr<Cell> OutputChunkCell::Parse(const std::string &xml) const {
+  MathParser parser(m_configuration);
+  parser.SetGroup(GetGroup());
+  std::string root = "<mth>" + xml + "</mth>";
+  auto cell = parser.ParseLine(root.data(), root.size(), GetType());
+  if (!cell)
+    cell = std::make_unique<TextCell>(GetGroup(), m_configuration,
+                                      _("(Invalid XML from maxima)"),
+                                      TS_WARNING);
+  return cell;
+}
+
+std::unique_ptr<Cell> OutputChunkCell::Parse() const {
+  return Parse(OutputChunker::DisplayXml(m_xml, m_container.get()));
+}
+
+std::unique_ptr<Cell> OutputChunkCell::ParseForExport() const {
+  if (!m_container)
+    return Parse();
+  if (!m_firstOfContainer)
+    return nullptr;
+
+  // Our list or matrix is only complete if the XML of all its chunks is
+  // joined.
+  std::string xml;
+  bool complete = false;
+  for (const Cell *cell = this; cell && !complete; cell = cell->GetNext()) {
+    auto *chunk = dynamic_cast<const OutputChunkCell *>(cell);
+    if (!chunk || (chunk->m_container != m_container))
+      break;
+    complete = chunk->m_lastOfContainer;
+    xml += OutputChunker::ChunkXml(chunk->m_xml, m_container.get(),
+                                   chunk->m_firstOfContainer, complete);
+  }
+  if (!complete)
+    xml += m_container->end;
+  return Parse(xml);
+}
+
+void OutputChunkCell::Materialize() {
+  m_materializationRequested = false;
+  if (m_innerCell)
+    return;
+  m_innerCell = Parse();
+  ResetSize();
+}
+
+void OutputChunkCell::Dematerialize() {
+  // We keep our size: Else the layout of the worksheet would change and
+  // the chunk would need to be converted to cells again as soon as it is
+  // visible, anyway.
+  m_innerCell.reset();
+  m_materializationRequested = false;
+}
+
+void OutputChunkCell::Recalculate(AFontSize fontsize) {
+  if (NeedsRecalculation(fontsize)) {
+    if (m_innerCell) {
+      m_innerCell->RecalculateList(fontsize);
+      m_width = m_innerCell->GetFullWidth();
+      m_height = m_innerCell->GetHeightList();
+      m_center = m_innerCell->GetCenterList();
+      Cell::Recalculate(fontsize);
+    } else {
+      // We don't know our real size before we are converted to cells =>
+      // estimate it from the number of characters we display.
+      TextCell::Recalculate(fontsize);
+      wxDC *dc = m_configuration->GetRecalcDC();
+      SetFont(dc, m_fontSize_Scaled);
+      wxCoord charWidth = std::max(dc->GetTextExtent(wxS("0")).GetWidth(), 1);
+      wxCoord lineWidth = std::max(static_cast<wxCoord>(m_configuration->GetLineWidth()),
+                                   charWidth);
+      wxCoord width = charWidth * static_cast<wxCoord>(m_displayedChars);
+      wxCoord lines = std::max((width + lineWidth - 1) / lineWidth, 1);
+      m_width = std::max(m_width, std::min(width, lineWidth));
+      m_height *= lines;
+    }
+  }
+}
+
+void OutputChunkCell::Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) {
+  if (m_innerCell) {
+    Cell::Draw(point, dc, antialiassingDC);
+    if (DrawThisCell(point))
+      m_innerCell->DrawList(point, dc, antialiassingDC);
+  } else {
+    TextCell::Draw(point, dc, antialiassingDC);
+    // We are visible => It is time to show what we contain.
+    if (DrawThisCell(point) && !m_materializationRequested) {
+      m_materializationRequested = true;
+      GetCellPointers()->RequestMaterialization(this);
+    }
+  }
+}
+
+wxString OutputChunkCell::ToMathML() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToMathML();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToMathML() : wxString();
+}
+
+wxString OutputChunkCell::ToMatlab() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToMatlab();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToMatlab() : wxString();
+}
+
+wxString OutputChunkCell::ToOMML() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToOMML();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToOMML() : wxString();
+}
+
+wxString OutputChunkCell::ToRTF() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToRTF();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToRTF() : wxString();
+}
+
+wxString OutputChunkCell::ToString() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToString();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToString() : wxString();
+}
+
+wxString OutputChunkCell::ToTeX() const {
+  if (m_innerCell && !m_container)
+    return m_innerCell->ListToTeX();
+  auto cell = ParseForExport();
+  return cell ? cell->ListToTeX() : wxString();
+}
+
+wxString OutputChunkCell::ToXML() const {
+  // We write the XML maxima has sent, not the XML our cells would generate.
+  // The tags of our list or matrix are written only once, around all of its
+  // chunks.
+  const std::string xml = OutputChunker::ChunkXml(m_xml, m_container.get(),
+                                                  m_firstOfContainer,
+                                                  m_lastOfContainer);
+  wxString retval = wxString::FromUTF8(xml.data(), xml.size());
+  if (retval.IsEmpty())
+    retval = wxString::From8BitData(xml.data(), xml.size());
+  return retval;
+}
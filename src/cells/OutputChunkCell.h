@@ -0,0 +1,139 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef OUTPUTCHUNKCELL_H
+#define OUTPUTCHUNKCELL_H
+
+#include <memory>
+#include <string>
+#include "OutputChunker.h"
+#include "TextCell.h"
+
+/*! \file
+
+  This file defines the class for the cells very long outputs are split into.
+*/
+
+/*! A chunk of a very long output that is converted to cells only on demand
+
+  Converting an output of several megabytes to cells takes long and needs a
+  lot of memory. Instead MathParser splits such outputs into chunks of a few
+  elements of the top-level list or matrix, each of which only keeps the XML
+  it was created from. Only when a chunk is drawn, which means that it has been
+  scrolled into view, it asks the worksheet to convert its XML to cells. The
+  worksheet keeps only a limited number of chunks converted and converts the
+  ones that have been scrolled away back to XML, keeping their size so the
+  layout doesn't change.
+
+  Until the chunk has been converted it is displayed as an ellipsis whose size
+  is estimated from the number of characters the chunk contains.
+
+  If the output is a single list or matrix the chunks share the tags of that
+  container: The first chunk exports the whole container, so saving or
+  copying the output results in one list or matrix, not in one per chunk.
+*/
+class OutputChunkCell final : public TextCell
+{
+public:
+  /*! The constructor
+
+    \param group The group this cell belongs to
+    \param config The configuration
+    \param xml The UTF-8 XML of the elements in this chunk, without a root element
+    \param displayedChars The approximate number of characters the chunk displays
+    \param container The list or matrix the chunk is part of, or nullptr
+    \param first true = This is the first chunk of the container
+    \param last true = This is the last chunk of the container
+  */
+  OutputChunkCell(GroupCell *group, Configuration *config, std::string &&xml,
+                  std::size_t displayedChars,
+                  std::shared_ptr<const OutputChunker::Container> container = {},
+                  bool first = true, bool last = true);
+  OutputChunkCell(GroupCell *group, const OutputChunkCell &cell);
+  std::unique_ptr<Cell> Copy(GroupCell *group) const override;
+  const CellTypeInfo &GetInfo() override;
+
+  size_t GetInnerCellCount() const override { if(m_innerCell) return 1; else return 0; }
+  // cppcheck-suppress objectIndex
+  Cell *GetInnerCell(size_t index) const override;
+
+  void Recalculate(AFontSize fontsize) override;
+  void Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) override;
+
+  //! Has our XML been converted to cells?
+  bool IsMaterialized() const { return static_cast<bool>(m_innerCell); }
+  //! Convert our XML to cells
+  void Materialize();
+  //! Drop our cells, but keep the size they had
+  void Dematerialize();
+
+  wxString ToMathML() const override;
+  wxString ToMatlab() const override;
+  wxString ToOMML() const override;
+  wxString ToRTF() const override;
+  wxString ToString() const override;
+  wxString ToTeX() const override;
+  wxString ToXML() const override;
+
+private:
+  //! Converts our XML to cells without storing them
+  std::unique_ptr<Cell> Parse() const;
+  /*! Converts the XML of the whole output to cells, if we are to export it
+
+    \returns the cells of the whole list or matrix if we are its first chunk,
+    our own cells if we aren't part of a container and nullptr otherwise.
+  */
+  std::unique_ptr<Cell> ParseForExport() const;
+  //! Converts UTF-8 XML to cells
+  std::unique_ptr<Cell> Parse(const std::string &xml) const;
+
+  //** Large objects
+  //**
+  //! The XML of our elements
+  std::string m_xml;
+  //! Our elements, if they have been converted to cells
+  std::unique_ptr<Cell> m_innerCell;
+  //! The list or matrix we are part of, shared by all of its chunks
+  std::shared_ptr<const OutputChunker::Container> m_container;
+
+  //** 8-byte objects
+  //**
+  //! The approximate number of characters we display
+  std::size_t m_displayedChars = 0;
+
+  //** Bitfield objects (1 bytes)
+  //**
+  void InitBitFields_OutputChunkCell()
+    { // Keep the initialization order below same as the order
+      // of bit fields in this class!
+      m_materializationRequested = false;
+      m_firstOfContainer = true;
+      m_lastOfContainer = true;
+    }
+  //! true = We already have asked the worksheet to convert us to cells
+  bool m_materializationRequested : 1 /* InitBitFields_OutputChunkCell */;
+  //! true = We are the first chunk of m_container
+  bool m_firstOfContainer : 1 /* InitBitFields_OutputChunkCell */;
+  //! true = We are the last chunk of m_container
+  bool m_lastOfContainer : 1 /* InitBitFields_OutputChunkCell */;
+};
+
+#endif // OUTPUTCHUNKCELL_H
@@ -103,6 +103,10 @@ void ParenCell::Recalculate(AFontSize fontsize) {
     m_height = std::max(m_signHeight, innerCellHeight) + Scale_Px(2);
     m_center = m_height / 2;
 
+    // The text extent cache only selects a font if it has to measure a text
+    // => the dc might still contain the font of any other cell.
+    auto &open = static_cast<TextCell &>(*m_open);
+    open.SetFont(dc, open.GetScaledTextSize());
     dc->GetTextExtent(wxS("("), &m_charWidth1, &m_charHeight1);
     if (m_charHeight1 < 2)
       m_charHeight1 = 2;
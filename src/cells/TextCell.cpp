@@ -32,6 +32,7 @@
 #include "TextCell.h"
 #include "CellImpl.h"
 #include "StringUtils.h"
+#include "TextExtentCache.h"
 #include <wx/config.h>
 
 TextCell::TextCell(GroupCell *group, Configuration *config,
@@ -134,7 +135,6 @@ TextCell::TextCell(GroupCell *group, const TextCell &cell)
 DEFINE_CELL(TextCell)
 
 void TextCell::SetStyle(TextStyle style) {
-  m_sizeCache.clear();
   Cell::SetStyle(style);
   if ((m_text == wxS("gamma")) && (GetTextStyle() == TS_FUNCTION))
     m_displayedText = wxS("\u0393");
@@ -146,7 +146,6 @@ void TextCell::SetStyle(TextStyle style) {
 }
 
 void TextCell::SetType(CellType type) {
-  m_sizeCache.clear();
   Cell::SetType(type);
 }
 
@@ -358,7 +357,6 @@ void TextCell::UpdateToolTip() {
 }
 
 void TextCell::SetValue(const wxString &text) {
-  m_sizeCache.clear();
   m_text = text;
   ResetSize();
   UpdateDisplayedText();
@@ -368,14 +366,13 @@ void TextCell::SetValue(const wxString &text) {
 AFontSize TextCell::GetScaledTextSize() const { return m_fontSize_Scaled; }
 
 wxSize TextCell::CalculateTextSize(wxDC *const dc, const wxString &text,
-                                   TextCell::TextIndex const index) {
-  AFontSize const fontSize = GetScaledTextSize();
+                                   AFontSize const fontSize) {
   if (text.empty())
     return {};
 
-  auto const size = dc->GetTextExtent(text);
-  m_sizeCache.emplace_back(size, fontSize, index);
-  return size;
+  return TextExtentCache::Get().GetTextExtent(
+    dc, m_configuration->GetStyle(GetTextStyle())->GetFontId(), fontSize, text,
+    [this, dc, fontSize]() { SetFont(dc, fontSize); });
 }
 
 void TextCell::UpdateDisplayedText() {
@@ -428,10 +425,9 @@ void TextCell::Recalculate(AFontSize fontsize) {
       ForceBreakLine(true);
     if (ConfigChanged())
         UpdateDisplayedText();
-    SetFont(m_configuration->GetRecalcDC(), Scale_Px(fontsize));
-
     wxSize sz =
-      CalculateTextSize(m_configuration->GetRecalcDC(), m_displayedText, cellText);
+      CalculateTextSize(m_configuration->GetRecalcDC(), m_displayedText,
+                        Scale_Px(fontsize));
     m_width = sz.GetWidth();
     m_height = sz.GetHeight();
 
@@ -53,7 +53,7 @@ public:
   virtual void Recalculate(AFontSize fontsize) override;
 
   void Draw(wxPoint point, wxDC *dc, wxDC *antialiassingDC) override;
-  const wxFont &GetFont(AFontSize fontsize) const {
+  wxFont GetFont(AFontSize fontsize) const {
     return m_configuration->GetStyle(GetTextStyle())->GetFont(fontsize);
   }
   //cppcheck-suppress functionConst
@@ -104,31 +104,12 @@ protected:
   void UpdateToolTip();
   const wxString &GetAltCopyText() const override { return m_altCopyText; }
 
-  void FontsChanged() override
-    {
-      m_sizeCache.clear();
-    }
+  /*! Returns the size of a text in our font
 
-  enum TextIndex : int8_t
-  {
-    noText,
-    cellText,
-    userLabelText,
-    numberStart,
-    ellipsis,
-    numberEnd
-  };
-
-  struct SizeEntry {
-    wxSize textSize;
-    AFontSize fontSize;
-    TextIndex index = cellText;
-    SizeEntry(wxSize textSize, AFontSize fontSize, TextIndex index) :
-      textSize(textSize), fontSize(fontSize), index(index) {}
-    SizeEntry() = default;
-  };
-
-  wxSize CalculateTextSize(wxDC *dc, const wxString &text, TextCell::TextIndex const index);
+    The sizes are cached by TextExtentCache. The font is only set on the dc if
+    the text actually has to be measured.
+  */
+  wxSize CalculateTextSize(wxDC *dc, const wxString &text, AFontSize fontSize);
 
   static wxRegEx m_unescapeRegEx;
   static wxRegEx m_roundingErrorRegEx1;
@@ -142,7 +123,6 @@ protected:
   wxString m_text;
   //! The text we display: We might want to convert some characters or do similar things
   wxString m_displayedText;
-  std::vector<SizeEntry> m_sizeCache;
 
 //** Bitfield objects (1 bytes)
 //**
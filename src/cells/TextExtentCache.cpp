@@ -0,0 +1,106 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+/*! \file
+  This file defines the class TextExtentCache.
+*/
+
+#include "TextExtentCache.h"
+#include <algorithm>
+#include <functional>
+#include <wx/hashmap.h>
+
+TextExtentCache::TextExtentCache(std::size_t maxEntries) :
+  m_maxEntries(std::max(maxEntries, static_cast<std::size_t>(1)))
+{
+}
+
+TextExtentCache &TextExtentCache::Get()
+{
+  static TextExtentCache cache;
+  return cache;
+}
+
+std::size_t TextExtentCache::KeyHash::operator()(const Key &key) const
+{
+  std::size_t hash = wxStringHash()(key.text);
+  hash = hash * 31 + std::hash<std::uint32_t>()(key.fontId);
+  hash = hash * 31 + std::hash<float>()(key.fontSize.Get());
+  hash = hash * 31 + std::hash<int>()(key.ppi);
+  return hash;
+}
+
+bool TextExtentCache::Lookup(std::uint32_t fontId, AFontSize fontSize, int ppi,
+                             const wxString &text, wxSize &size)
+{
+  const Key key{fontId, fontSize, ppi, text};
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_index.find(key);
+  if (entry == m_index.end())
+  {
+    m_misses++;
+    return false;
+  }
+  m_hits++;
+  m_entries.splice(m_entries.begin(), m_entries, entry->second);
+  size = entry->second->second;
+  return true;
+}
+
+void TextExtentCache::Store(std::uint32_t fontId, AFontSize fontSize, int ppi,
+                            const wxString &text, wxSize size)
+{
+  Key key{fontId, fontSize, ppi, text};
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_index.find(key);
+  if (entry != m_index.end())
+  {
+    entry->second->second = size;
+    m_entries.splice(m_entries.begin(), m_entries, entry->second);
+    return;
+  }
+  m_entries.emplace_front(std::move(key), size);
+  m_index.emplace(m_entries.front().first, m_entries.begin());
+  while (m_entries.size() > m_maxEntries)
+  {
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+    m_evictions++;
+  }
+}
+
+void TextExtentCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_index.clear();
+  m_entries.clear();
+}
+
+TextExtentCache::Statistics TextExtentCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Statistics statistics;
+  statistics.hits = m_hits;
+  statistics.misses = m_misses;
+  statistics.evictions = m_evictions;
+  statistics.entries = m_entries.size();
+  return statistics;
+}
@@ -0,0 +1,138 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#ifndef TEXTEXTENTCACHE_H
+#define TEXTEXTENTCACHE_H
+
+#include "precomp.h"
+#include "FontAttribs.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <wx/dc.h>
+#include <wx/gdicmn.h>
+#include <wx/string.h>
+
+/*! \file
+ * This file declares the cache for the sizes of texts.
+ */
+
+/*! A cache for the sizes of texts that is shared by all cells
+
+  Asking the toolkit for the size of a text is by far the most expensive part
+  of laying out the worksheet. But a worksheet typically contains thousands
+  of occurrences of the same few texts like "x", "+", "sin" or "%pi" in the
+  same few fonts. This cache therefore remembers the size of every text it
+  has measured, keyed by the font (as identified by FontVariantCache), the
+  font size, the resolution of the device and the text itself. It forgets the
+  texts that haven't been needed for the longest time as soon as it holds
+  more than the maximum number of texts.
+
+  Fonts with the same id always look the same => The cache never needs to be
+  cleared if the fonts change or the worksheet is zoomed.
+*/
+class TextExtentCache final
+{
+public:
+  //! What the cache knows about how well it works
+  struct Statistics
+  {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+  };
+
+  //! Creates a cache that holds up to maxEntries texts
+  explicit TextExtentCache(std::size_t maxEntries = 32768);
+  TextExtentCache(const TextExtentCache &) = delete;
+  TextExtentCache &operator=(const TextExtentCache &) = delete;
+
+  //! The cache all cells share
+  static TextExtentCache &Get();
+
+  /*! Returns the size of a text
+
+    \param dc The dc to measure the text with, if it isn't cached
+    \param fontId The id FontVariantCache::GetFontId() returned for the font
+    \param fontSize The size of the font
+    \param text The text
+    \param setFont Sets the font on the dc. Only called if the text has
+    to be measured.
+  */
+  template <typename SetFont>
+  wxSize GetTextExtent(wxDC *dc, std::uint32_t fontId, AFontSize fontSize,
+                       const wxString &text, SetFont &&setFont)
+    {
+      wxSize size;
+      const int ppi = dc->GetPPI().y;
+      if (Lookup(fontId, fontSize, ppi, text, size))
+        return size;
+      setFont();
+      size = dc->GetTextExtent(text);
+      Store(fontId, fontSize, ppi, text, size);
+      return size;
+    }
+
+  //! Looks up the size of a text. Returns false if it isn't cached.
+  bool Lookup(std::uint32_t fontId, AFontSize fontSize, int ppi, const wxString &text,
+              wxSize &size);
+  //! Remembers the size of a text
+  void Store(std::uint32_t fontId, AFontSize fontSize, int ppi, const wxString &text,
+             wxSize size);
+  //! Forgets all texts
+  void Clear();
+  //! How well does the cache work?
+  Statistics GetStatistics() const;
+
+private:
+  struct Key
+  {
+    std::uint32_t fontId;
+    AFontSize fontSize;
+    int ppi;
+    wxString text;
+    bool operator==(const Key &o) const
+      {
+        return (fontId == o.fontId) && (fontSize == o.fontSize) && (ppi == o.ppi) &&
+          (text == o.text);
+      }
+  };
+  struct KeyHash
+  {
+    std::size_t operator()(const Key &key) const;
+  };
+  //! The texts, the one that has been used last first
+  using Entries = std::list<std::pair<Key, wxSize>>;
+
+  //! Protects everything below
+  mutable std::mutex m_mutex;
+  Entries m_entries;
+  std::unordered_map<Key, Entries::iterator, KeyHash> m_index;
+  const std::size_t m_maxEntries;
+  std::uint64_t m_hits = 0;
+  std::uint64_t m_misses = 0;
+  std::uint64_t m_evictions = 0;
+};
+
+#endif // TEXTEXTENTCACHE_H
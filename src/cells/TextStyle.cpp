@@ -346,11 +346,16 @@ void Style::Write(wxConfigBase *config, const wxString &where) const {
   config->Write(where + k_fontname, GetFontName());
 }
 
-const wxFont &Style::GetFont(AFontSize fontSize) const {
+wxFont Style::GetFont(AFontSize fontSize) const {
   return *(m.fontCache->GetFont(fontSize.Get(), IsItalic(), IsBold(), IsUnderlined(),
                                 IsSlant(), IsStrikethrough()));
 }
 
+std::uint32_t Style::GetFontId() const {
+  return m.fontCache->GetFontId(IsItalic(), IsBold(), IsUnderlined(), IsSlant(),
+                                IsStrikethrough());
+}
+
 Style Style::FromStockFont(wxStockGDI::Item font) {
   Style retval;
   switch (font) {
@@ -152,12 +152,18 @@ public:
 
 
   bool IsFontOk() const;
-  //! Returns the font associated with this style, but with the size fontSize
-  const wxFont &GetFont(AFontSize fontSize) const;
+  /*! Returns the font associated with this style, but with the size fontSize
+
+    Returned by value as the font cache may drop the font at any time; copying
+    a wxFont only increments a reference count.
+  */
+  wxFont GetFont(AFontSize fontSize) const;
   //! Returns the font associated with this style
-  const wxFont &GetFont() const {
+  wxFont GetFont() const {
     return GetFont(GetFontSize());
   }
+  //! Returns the FontVariantCache::GetFontId() of the font associated with this style
+  std::uint32_t GetFontId() const;
 
   //! Sets all font-related properties based on another font
   did_change SetFromFont(const wxFont&);
@@ -507,6 +507,7 @@ void ConfigDialogue::SetCheckboxValues() {
   m_numpadEnterEvaluates->SetValue(configuration->NumpadEnterEvaluates());
   m_saveImgFileName->SetValue(configuration->SaveImgFileName());
   m_saveUntitled->SetValue(configuration->SaveUntitled());
+  m_compressWxmx->SetValue(configuration->CompressWxmx());
   m_openHCaret->SetValue(configuration->GetOpenHCaret());
   m_insertAns->SetValue(configuration->GetInsertAns());
   m_autoIndent->SetValue(configuration->GetAutoIndent());
@@ -1304,6 +1305,17 @@ wxWindow *ConfigDialogue::CreateOptionsPanel() {
   stdOpts_sizer->Add(m_saveUntitled,
                      wxSizerFlags().Border(wxALL, 5 * GetContentScaleFactor()));
 
+  m_compressWxmx =
+    new wxCheckBox(stdOpts_sizer->GetStaticBox(), wxID_ANY,
+                   _("Compress the text in .wxmx files"));
+  m_compressWxmx->SetToolTip(
+                             _("Makes .wxmx files with lots of text smaller. But version control "
+                               "systems can no more tell which lines of a compressed file have "
+                               "changed and a text editor no more can rescue the contents of a "
+                               "broken file."));
+  stdOpts_sizer->Add(m_compressWxmx,
+                     wxSizerFlags().Border(wxALL, 5 * GetContentScaleFactor()));
+
   m_fixReorderedIndices =
     new wxCheckBox(
                    stdOpts_sizer->GetStaticBox(), wxID_ANY,
@@ -2142,6 +2154,7 @@ void ConfigDialogue::WriteSettings() {
   configuration->NumpadEnterEvaluates(m_numpadEnterEvaluates->GetValue());
   configuration->SaveImgFileName(m_saveImgFileName->GetValue());
   configuration->SaveUntitled(m_saveUntitled->GetValue());
+  configuration->CompressWxmx(m_compressWxmx->GetValue());
   configuration->SetOpenHCaret(m_openHCaret->GetValue());
   configuration->SetInsertAns(m_insertAns->GetValue());
   configuration->SetAutoIndent(m_autoIndent->GetValue());
@@ -309,6 +309,7 @@ protected:
   wxCheckBox *m_numpadEnterEvaluates;
   wxCheckBox *m_saveImgFileName;
   wxCheckBox *m_saveUntitled;
+  wxCheckBox *m_compressWxmx;
   wxCheckBox *m_openHCaret;
   wxCheckBox *m_insertAns;
   wxCheckBox *m_autoIndent;
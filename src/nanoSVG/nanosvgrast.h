@@ -67,6 +67,13 @@ void nsvgRasterize(NSVGrasterizer* r,
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
+// The instruction set the rasterizer uses for filling spans:
+// 0 = plain C, 1 = SSE2, 2 = AVX2. nsvgGetSimdLevel() returns the best level
+// the CPU supports, limited by what nsvgSetSimdLevel() has set.
+// nsvgSetSimdLevel() is meant for benchmarks and tests and isn't thread-safe.
+int nsvgGetSimdLevel(void);
+void nsvgSetSimdLevel(int level);
+
 
 #ifndef NANOSVGRAST_CPLUSPLUS
 #ifdef __cplusplus
@@ -891,6 +898,200 @@ static void nsvg__freeActive(NSVGrasterizer* r, NSVGactiveEdge* z)
 	r->freelist = z;
 }
 
+static inline int nsvg__div255(int x)
+{
+    return ((x+1) * 257) >> 16;
+}
+
+// SIMD versions of the innermost loops. The results are bit-identical to the
+// scalar code: nsvg__div255(x) = ((x+1)*257)>>16 is the high half of the
+// 16-bit product (x+1)*257, since x+1 never exceeds 255*255+1.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NSVG__SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NSVG__AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+static int nsvg__simdLimit = 2;
+
+void nsvgSetSimdLevel(int level)
+{
+	nsvg__simdLimit = level;
+}
+
+int nsvgGetSimdLevel(void)
+{
+	int level = 0;
+#ifdef NSVG__SSE2
+	level = 1;
+#ifdef NSVG__AVX2
+	if (__builtin_cpu_supports("avx2"))
+		level = 2;
+#endif
+#endif
+	return level < nsvg__simdLimit ? level : nsvg__simdLimit;
+}
+
+static void nsvg__fillSpan(unsigned char* scanline, int i, int j, int maxWeight)
+{
+#ifdef NSVG__SSE2
+	if (nsvg__simdLimit > 0) {
+		__m128i weight = _mm_set1_epi8((char)maxWeight);
+		for (; i + 16 <= j; i += 16) {
+			__m128i s = _mm_loadu_si128((__m128i*)(scanline + i));
+			_mm_storeu_si128((__m128i*)(scanline + i), _mm_add_epi8(s, weight));
+		}
+	}
+#endif
+	for (; i < j; ++i)
+		scanline[i] = (unsigned char)(scanline[i] + maxWeight);
+}
+
+static void nsvg__blendColorScalar(unsigned char* dst, int count, const unsigned char* cover, unsigned int color)
+{
+	int i, cr, cg, cb, ca;
+	cr = color & 0xff;
+	cg = (color >> 8) & 0xff;
+	cb = (color >> 16) & 0xff;
+	ca = (color >> 24) & 0xff;
+
+	for (i = 0; i < count; i++) {
+		int r,g,b;
+		int a = nsvg__div255((int)cover[0] * ca);
+		int ia = 255 - a;
+		// Premultiply
+		r = nsvg__div255(cr * a);
+		g = nsvg__div255(cg * a);
+		b = nsvg__div255(cb * a);
+
+		// Blend over
+		r += nsvg__div255(ia * (int)dst[0]);
+		g += nsvg__div255(ia * (int)dst[1]);
+		b += nsvg__div255(ia * (int)dst[2]);
+		a += nsvg__div255(ia * (int)dst[3]);
+
+		dst[0] = (unsigned char)r;
+		dst[1] = (unsigned char)g;
+		dst[2] = (unsigned char)b;
+		dst[3] = (unsigned char)a;
+
+		cover++;
+		dst += 4;
+	}
+}
+
+#ifdef NSVG__SSE2
+// Blends two pixels whose 16-bit channels are in d. a2 holds the coverage
+// alpha of both pixels, once per channel.
+static inline __m128i nsvg__blend2SSE2(__m128i d, __m128i a2, __m128i col, __m128i one, __m128i m257, __m128i c255)
+{
+	__m128i ia2 = _mm_sub_epi16(c255, a2);
+	// The alpha channel of col is 255, and div255(255*a) == a.
+	__m128i s = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(col, a2), one), m257);
+	__m128i o = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(d, ia2), one), m257);
+	return _mm_add_epi16(s, o);
+}
+
+static void nsvg__blendColorSSE2(unsigned char* dst, int count, const unsigned char* cover, unsigned int color)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i m257 = _mm_set1_epi16(257);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i ca = _mm_set1_epi16((short)((color >> 24) & 0xff));
+	const __m128i col = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)(color | 0xff000000u)), zero);
+	const __m128i col2 = _mm_unpacklo_epi64(col, col);
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		int cov4;
+		__m128i cov, a, alo, ahi, d, dlo, dhi;
+		memcpy(&cov4, cover + i, 4);
+		// a = div255(cover * ca) for 4 pixels, in lanes 0...3
+		cov = _mm_unpacklo_epi8(_mm_cvtsi32_si128(cov4), zero);
+		a = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(cov, ca), one), m257);
+		// Replicate every pixel's alpha to its four channels
+		a = _mm_unpacklo_epi16(a, a);
+		alo = _mm_unpacklo_epi32(a, a);
+		ahi = _mm_unpackhi_epi32(a, a);
+
+		d = _mm_loadu_si128((__m128i*)(dst + i*4));
+		dlo = nsvg__blend2SSE2(_mm_unpacklo_epi8(d, zero), alo, col2, one, m257, c255);
+		dhi = nsvg__blend2SSE2(_mm_unpackhi_epi8(d, zero), ahi, col2, one, m257, c255);
+		_mm_storeu_si128((__m128i*)(dst + i*4), _mm_packus_epi16(dlo, dhi));
+	}
+	nsvg__blendColorScalar(dst + i*4, count - i, cover + i, color);
+}
+#endif
+
+#ifdef NSVG__AVX2
+__attribute__((target("avx2")))
+static void nsvg__blendColorAVX2(unsigned char* dst, int count, const unsigned char* cover, unsigned int color)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i m257 = _mm256_set1_epi16(257);
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i ca = _mm256_set1_epi16((short)((color >> 24) & 0xff));
+	const __m256i col = _mm256_cvtepu8_epi16(_mm_set1_epi32((int)(color | 0xff000000u)));
+	// Selects the alpha of pixel n (n = 0...7) of a __m128i of 16-bit alphas
+	// for all four channels of two adjacent pixels
+	const __m256i spread = _mm256_setr_epi8(0,1,0,1,0,1,0,1, 2,3,2,3,2,3,2,3,
+											 0,1,0,1,0,1,0,1, 2,3,2,3,2,3,2,3);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i a, a01, a23, d, dlo, dhi, s, o, ia;
+		__m128i a16 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(cover + i)));
+		a16 = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(a16, _mm256_castsi256_si128(ca)),
+											_mm256_castsi256_si128(one)),
+							  _mm256_castsi256_si128(m257));
+		// Pixels 0,1 | 4,5 and 2,3 | 6,7: this matches the lane split of
+		// _mm256_unpack*_epi8 below.
+		a = _mm256_set_m128i(_mm_srli_si128(a16, 8), a16);
+		a01 = _mm256_shuffle_epi8(a, spread);
+		a23 = _mm256_shuffle_epi8(_mm256_srli_si256(a, 4), spread);
+
+		d = _mm256_loadu_si256((__m256i*)(dst + i*4));
+		dlo = _mm256_unpacklo_epi8(d, _mm256_setzero_si256());
+		dhi = _mm256_unpackhi_epi8(d, _mm256_setzero_si256());
+
+		ia = _mm256_sub_epi16(c255, a01);
+		s = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(col, a01), one), m257);
+		o = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(dlo, ia), one), m257);
+		dlo = _mm256_add_epi16(s, o);
+
+		ia = _mm256_sub_epi16(c255, a23);
+		s = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(col, a23), one), m257);
+		o = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(dhi, ia), one), m257);
+		dhi = _mm256_add_epi16(s, o);
+
+		_mm256_storeu_si256((__m256i*)(dst + i*4), _mm256_packus_epi16(dlo, dhi));
+	}
+	nsvg__blendColorSSE2(dst + i*4, count - i, cover + i, color);
+}
+#endif
+
+static void nsvg__blendColor(unsigned char* dst, int count, const unsigned char* cover, unsigned int color)
+{
+	switch (nsvgGetSimdLevel()) {
+#ifdef NSVG__AVX2
+	case 2:
+		nsvg__blendColorAVX2(dst, count, cover, color);
+		return;
+#endif
+#ifdef NSVG__SSE2
+	case 1:
+		nsvg__blendColorSSE2(dst, count, cover, color);
+		return;
+#endif
+	default:
+		nsvg__blendColorScalar(dst, count, cover, color);
+	}
+}
+
 static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax)
 {
 	int i = x0 >> NSVG__FIXSHIFT;
@@ -912,8 +1113,7 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
 			else
 				j = len; // clip
 
-			for (++i; i < j; ++i) // fill pixels between x0 and x1
-				scanline[i] = (unsigned char)(scanline[i] + maxWeight);
+			nsvg__fillSpan(scanline, i + 1, j, maxWeight); // fill pixels between x0 and x1
 		}
 	}
 }
@@ -982,45 +1182,12 @@ static unsigned int nsvg__applyOpacity(unsigned int c, float u)
 	return nsvg__RGBA((unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a);
 }
 
-static inline int nsvg__div255(int x)
-{
-    return ((x+1) * 257) >> 16;
-}
-
 static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* cover, int x, int y,
 								float tx, float ty, float scale, NSVGcachedPaint* cache)
 {
 
 	if (cache->type == NSVG_PAINT_COLOR) {
-		int i, cr, cg, cb, ca;
-		cr = cache->colors[0] & 0xff;
-		cg = (cache->colors[0] >> 8) & 0xff;
-		cb = (cache->colors[0] >> 16) & 0xff;
-		ca = (cache->colors[0] >> 24) & 0xff;
-
-		for (i = 0; i < count; i++) {
-			int r,g,b;
-			int a = nsvg__div255((int)cover[0] * ca);
-			int ia = 255 - a;
-			// Premultiply
-			r = nsvg__div255(cr * a);
-			g = nsvg__div255(cg * a);
-			b = nsvg__div255(cb * a);
-
-			// Blend over
-			r += nsvg__div255(ia * (int)dst[0]);
-			g += nsvg__div255(ia * (int)dst[1]);
-			b += nsvg__div255(ia * (int)dst[2]);
-			a += nsvg__div255(ia * (int)dst[3]);
-
-			dst[0] = (unsigned char)r;
-			dst[1] = (unsigned char)g;
-			dst[2] = (unsigned char)b;
-			dst[3] = (unsigned char)a;
-
-			cover++;
-			dst += 4;
-		}
+		nsvg__blendColor(dst, count, cover, cache->colors[0]);
 	} else if (cache->type == NSVG_PAINT_LINEAR_GRADIENT) {
 		// TODO: spread modes.
 		// TODO: plenty of opportunities to optimize.
@@ -23,17 +23,21 @@
 /*! \file
   This C++ project instantiates nanoSVG. If it is linked with wxWidgets
   and wxWidgets provides nanoSVG it fails to build with a linker error.
-  CMake tests for that before deciding if to include nanoSVG.cpp in the
-  wxMaxima sources.
-*/
 
-/*
+  It also is a benchmark for the rasterizer: It rasterizes the SVG files given
+  on the command line (or test.svg) at several scales, once with every
+  instruction set the CPU supports, prints how long that took and fails if the
+  results differ from the plain C version.
 
-  27.8.2023:
-  Local Ubuntu:
-  Appveyor
+  With --quick every file is rasterized only once per instruction set, at its
+  original size: That is enough for checking that the results are the same.
 */
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
 #define NANOSVG_IMPLEMENTATION
 #define NANOSVGRAST_IMPLEMENTATION
 #define NANOSVG_ALL_COLOR_KEYWORDS
@@ -41,9 +45,67 @@
 #include "nanoSVG/nanosvgrast.h"
 
 int main(int argc, char* argv[]) {
-  struct NSVGimage* image;
-  image = nsvgParseFromFile("test.svg", "px", 96);
-  WXUNUSED(image);
-  return 0;
-}
+  std::vector<const char *> files;
+  bool quick = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0)
+      quick = true;
+    else
+      files.push_back(argv[i]);
+  }
+  if (files.empty())
+    files.push_back("test.svg");
 
+  std::vector<float> scales = {1, 2, 4, 8};
+  if (quick)
+    scales.resize(1);
+  const int repetitions = quick ? 1 : 10;
+  const int maxLevel = nsvgGetSimdLevel();
+  const char *levelNames[] = {"C", "SSE2", "AVX2"};
+  NSVGrasterizer *rast = nsvgCreateRasterizer();
+  int retval = 0;
+  for (const char *file : files) {
+    NSVGimage *image = nsvgParseFromFile(file, "px", 96);
+    if (image == NULL) {
+      fprintf(stderr, "%s: Cannot parse\n", file);
+      retval = 1;
+      continue;
+    }
+    for (float scale : scales) {
+      const int width = static_cast<int>(image->width * scale);
+      const int height = static_cast<int>(image->height * scale);
+      if ((width <= 0) || (height <= 0))
+        continue;
+      std::vector<unsigned char> reference;
+      for (int level = 0; level <= maxLevel; level++) {
+        nsvgSetSimdLevel(level);
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+        auto start = std::chrono::steady_clock::now();
+        // Big images are rasterized fewer times, so the benchmark doesn't
+        // take forever
+        int i = 0;
+        double ms;
+        do {
+          nsvgRasterize(rast, image, 0, 0, scale, pixels.data(), width, height,
+                        width * 4);
+          i++;
+          ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        } while ((i < repetitions) && (ms < 500));
+        ms /= i;
+        printf("%s %dx%d %s: %.3f ms\n", file, width, height,
+               levelNames[level], ms);
+        if (level == 0)
+          reference = pixels;
+        else if (pixels != reference) {
+          fprintf(stderr, "%s %dx%d %s: Result differs from plain C\n",
+                  file, width, height, levelNames[level]);
+          retval = 1;
+        }
+      }
+    }
+    nsvgDelete(image);
+  }
+  nsvgDeleteRasterizer(rast);
+  return retval;
+}
@@ -63,6 +63,7 @@
 #include "wizards/Gen5Wiz.h"
 #include "wizards/GenWiz.h"
 #include "cells/ImgCell.h"
+#include "ImageCache.h"
 #include "wizards/IntegrateWiz.h"
 #include "cells/LabelCell.h"
 #include "dialogs/LicenseDialog.h"
@@ -98,6 +99,7 @@
 #include <wx/colordlg.h>
 #include <wx/dir.h>
 #include <wx/dynlib.h>
+#include <wx/file.h>
 #include <wx/filedlg.h>
 #include <wx/filefn.h>
 #include <wx/filename.h>
@@ -2021,6 +2023,17 @@ void wxMaxima::ConsoleAppend(wxXmlDocument xml, CellType type,
   if(!GetWorksheet())
     return;
 
+  m_parser.SetUserLabel(userLabel);
+  m_parser.SetGroup(GetWorksheet()->GetInsertGroup());
+  std::unique_ptr<Cell> cell(m_parser.ParseLine(xml, type));
+  m_parser.SetGroup(nullptr);
+  ConsoleAppend(std::move(cell));
+}
+
+void wxMaxima::ConsoleAppend(std::unique_ptr<Cell> &&cell) {
+  if(!GetWorksheet())
+    return;
+
   // If we want to append an error message to the worksheet and there is no cell
   // that can contain it we need to create such a cell.
   if (GetWorksheet()->GetTree() == NULL)
@@ -2033,12 +2046,11 @@ void wxMaxima::ConsoleAppend(wxXmlDocument xml, CellType type,
     if (GetWorksheet()->GetActiveCell())
       tmp = GetWorksheet()->GetActiveCell()->GetGroup();
   }
-  if(tmp != NULL)
+  if((tmp != NULL) && cell)
     {
-      m_parser.SetUserLabel(userLabel);
-      m_parser.SetGroup(GetWorksheet()->GetInsertGroup());
-      std::unique_ptr<Cell> cell(m_parser.ParseLine(xml, type));
-      m_parser.SetGroup(nullptr);
+      // Cells that have been created by the parser thread don't know their
+      // group, yet. Setting it again for all other cells doesn't hurt.
+      cell->SetGroupList(GetWorksheet()->GetInsertGroup());
       // TODO: Does using || make any sense here?
       GetWorksheet()->InsertLine(std::move(cell),
                                  (AppendOpt::DefaultOpt & AppendOpt::NewLine) ||
@@ -2378,6 +2390,17 @@ void wxMaxima::SendMaxima(wxString s, bool addToHistory) {
       else
         StatusMaximaBusy(StatusBar::MaximaStatus::waiting);
 
+      // The parser thread applies the user-defined label of this command to
+      // the output labels that don't contain one. Only commands from the
+      // worksheet can have one: All other commands are sent as :lisp-quiet and
+      // therefore don't produce a prompt or output of their own.
+      if (addToHistory) {
+        if (m_configuration.UseUserLabels() && GetWorksheet())
+          m_client->SetUserLabel(GetWorksheet()->m_evaluationQueue.GetUserLabel(),
+                                 m_lastPromptNumber);
+        else
+          m_client->SetUserLabel(wxEmptyString, m_lastPromptNumber);
+      }
       wxScopedCharBuffer const data_raw = s.utf8_str();
       m_client->Write(data_raw.data(), data_raw.length());
       m_statusBar->NetworkStatus(StatusBar::transmit);
@@ -2427,6 +2450,7 @@ void wxMaxima::MaximaEvent(wxThreadEvent &event) {
   case Maxima::XML_PROMPT:
     ReadStdErr();
     m_statusBar->NetworkStatus(StatusBar::receive);
+    m_lastPromptNumber = event.GetExtraLong();
     ReadPrompt(event.GetString());
     break;
   case Maxima::XML_SUPPRESSOUTPUT:
@@ -2458,10 +2482,9 @@ void wxMaxima::MaximaEvent(wxThreadEvent &event) {
     m_statusBar->NetworkStatus(StatusBar::receive);
     ReadMath(event.GetPayload<wxXmlDocument>());
     break;
-  case Maxima::XML_TOOLONGMATHS:
+  case Maxima::XML_MATHS_PARSED:
     m_statusBar->NetworkStatus(StatusBar::receive);
-    DoRawConsoleAppend(_("(Config tells to suppress the output of long cells)"),
-                       MC_TYPE_WARNING);
+    ReadMath(event.GetPayload<Maxima::ParsedCells>());
     break;
   case Maxima::XML_WXXML_KEY: // TODO: Should the key be outside the SuppressOutput?
     break;
@@ -3311,6 +3334,17 @@ void wxMaxima::ReadMath(const wxXmlDocument &xml) {
   }
 }
 
+void wxMaxima::ReadMath(Maxima::ParsedCells cells) {
+  if(!GetWorksheet() || !cells)
+    return;
+
+  GetWorksheet()->SetCurrentTextCell(nullptr);
+
+  // The cells have been built by the parser thread => all we need to do is
+  // to splice them into the worksheet.
+  ConsoleAppend(std::move(*cells));
+}
+
 void wxMaxima::ReadSuppressedOutput(const wxString &data) {
   if(!m_maximaAuthenticated)
     {
@@ -3901,11 +3935,9 @@ void wxMaxima::VariableActionOperators(const wxString &value) {
             wxXmlNode *innernode = contents->GetChildren();
             if (innernode) {
               wxString content = innernode->GetContent();
-              if ((!content.IsEmpty()) &&
-                  (m_configuration.m_maximaOperators.find(content) ==
-                   m_configuration.m_maximaOperators.end())) {
-                if ((content.at(0) > '9') || (content.at(0) < '0')) {
-                  m_configuration.m_maximaOperators[content] = 1;
+              if (!content.IsEmpty()) {
+                if (((content.at(0) > '9') || (content.at(0) < '0')) &&
+                    m_configuration.AddMaximaOperator(content)) {
                   if (!newOperators.IsEmpty())
                     newOperators += wxS(", ");
                   newOperators += content;
@@ -4333,6 +4365,18 @@ bool wxMaxima::OpenWXMXFile(const wxString &file, Worksheet *document,
 
   StatusText(_("Opening file"));
 
+  // An autosave file that comes with a journal hasn't received the changes
+  // the last autosaves have made yet, probably as wxMaxima has crashed.
+  wxString journal = Format::AutosaveJournalFile(file);
+  if (wxFileExists(journal)) {
+    SuppressErrorDialogs blocker;
+    if (Format::ReplayAutosaveJournal(journal, file)) {
+      wxLogMessage(_("Recovered the changes from the autosave journal %s"), journal.utf8_str());
+      wxRemoveFile(journal);
+    } else
+      wxLogMessage(_("Could not apply the autosave journal %s"), journal.utf8_str());
+  }
+
   //  wxWindowUpdateLocker noUpdates(document);
 
   // If the file is empty we don't want to generate an error, but just
@@ -5137,6 +5181,16 @@ void wxMaxima::OnIdle(wxIdleEvent &event) {
       event.RequestMore();
       return;
     }
+    // Images that have been scaled in the background are shown on the next redraw
+    if (ImageCache::Get().GetGeneration() != m_imageCacheGeneration) {
+      m_imageCacheGeneration = ImageCache::Get().GetGeneration();
+      GetWorksheet()->RequestRedraw();
+    }
+    // So are the lookalike char warnings GroupCells have searched for
+    if (GroupCell::GetConfusablesGeneration() != m_confusablesGeneration) {
+      m_confusablesGeneration = GroupCell::GetConfusablesGeneration();
+      GetWorksheet()->RequestRedraw();
+    }
     if (GetWorksheet()->RedrawIfRequested())
       {
         event.RequestMore();
@@ -5221,6 +5275,12 @@ void wxMaxima::OnIdle(wxIdleEvent &event) {
     event.RequestMore();
     return;
   }
+
+  // Create the fonts we will need if the user zooms before they are needed
+  if (m_configuration.PrewarmFonts()) {
+    event.RequestMore();
+    return;
+  }
   if(m_configuration.UpdateNeeded())
     {
       m_configuration.ReadConfig();
@@ -6025,6 +6085,13 @@ bool wxMaxima::AutoSave() {
     return true;
 
   bool savedWas = GetWorksheet()->IsSaved();
+
+  // Most of the time only a few cells have changed since the last autosave
+  // to a temp file => append only these to the journal.
+  if ((m_configuration.AutoSaveAsTempFile() || GetWorksheet()->m_currentFile.IsEmpty()) &&
+      AppendToAutosaveJournal())
+    return savedWas;
+
   wxString oldTempFile = m_tempfileName;
   wxString oldFilename = GetWorksheet()->m_currentFile;
   m_tempfileName = wxFileName::CreateTempFileName("untitled_");
@@ -6033,6 +6100,7 @@ bool wxMaxima::AutoSave() {
 
   /* if the current filename is empty - the file was not saved under a given name - save it using a temporary file name */
   if (m_configuration.AutoSaveAsTempFile() || GetWorksheet()->m_currentFile.IsEmpty()) {
+    StopAutosaveJournal();
     bool saved = Format::ExportToWXMX(GetWorksheet()->GetTree(), m_tempfileName,
                                       &m_configuration,
                                       &GetWorksheet()->GetCellPointers(),
@@ -6050,8 +6118,15 @@ bool wxMaxima::AutoSave() {
           wxLogMessage(_("Trying to remove the old temp file %s"), oldTempFile.utf8_str());
           wxRemoveFile(oldTempFile);
         }
+        wxString oldJournal = Format::AutosaveJournalFile(oldTempFile);
+        if (wxFileExists(oldJournal)) {
+          SuppressErrorDialogs blocker;
+          wxRemoveFile(oldJournal);
+        }
       }
     }
+    if (saved)
+      StartAutosaveJournal();
     RegisterAutoSaveFile();
   } else {
     wxLogMessage(_("Autosaving the .wxmx file as %s"), GetWorksheet()->m_currentFile.utf8_str());
@@ -6066,6 +6141,196 @@ bool wxMaxima::AutoSave() {
   return savedWas;
 }
 
+//! The size of a file, or 0 if it cannot be determined
+static std::size_t FileSize(const wxString &file) {
+  wxULongLong size = wxFileName::GetSize(file);
+  if (size == wxInvalidSize)
+    return 0;
+  return static_cast<std::size_t>(size.GetValue());
+}
+
+void wxMaxima::StartAutosaveJournal() {
+  auto state = std::make_unique<AutosaveJournalState>();
+  for (const GroupCell &cell : OnList(GetWorksheet()->GetTree())) {
+    state->cells.push_back(cell.GetAutosaveId());
+    state->cellStates[cell.GetAutosaveId()] = cell.GetContentsState();
+  }
+  state->header = Format::DocumentHeader(GetWorksheet()->GetTree(), &m_configuration,
+                                         m_variablesPane->GetVarnames(),
+                                         GetWorksheet()->GetHCaret()).utf8_str();
+  state->imageCounter = GetWorksheet()->GetCellPointers().WXMXImageCount();
+  const wxScopedCharBuffer snapshot = wxFileName(m_tempfileName).GetFullName().utf8_str();
+  const std::string journalStart =
+    AutosaveJournal::Begin(std::string(snapshot.data(), snapshot.length()), state->cells);
+  wxFile journal(Format::AutosaveJournalFile(m_tempfileName), wxFile::write);
+  if (!journal.IsOpened() ||
+      (journal.Write(journalStart.data(), journalStart.size()) != journalStart.size()) ||
+      !journal.Close())
+    return;
+  state->size = journalStart.size();
+  state->snapshotSize = FileSize(m_tempfileName);
+  m_autosaveJournal = std::move(state);
+}
+
+bool wxMaxima::AppendToAutosaveJournal() {
+  if (!m_autosaveJournal || m_tempfileName.IsEmpty() || !wxFileExists(m_tempfileName))
+    return false;
+  FinishAutosaveCompaction();
+  AutosaveJournalState &state = *m_autosaveJournal;
+
+  // Convert all cells that have changed to XML. The images they contain are
+  // numbered after all images the snapshot and the journal already contain.
+  CellPointers &cellPointers = GetWorksheet()->GetCellPointers();
+  m_configuration.ClearFilesToSave();
+  cellPointers.WXMXSetCounter(state.imageCounter);
+  std::unordered_map<AutosaveJournal::CellId, GroupCell::ContentsState> cellStates;
+  std::vector<AutosaveJournal::CellId> cells;
+  bool valid = true;
+  for (const GroupCell &cell : OnList(GetWorksheet()->GetTree())) {
+    const AutosaveJournal::CellId id = cell.GetAutosaveId();
+    GroupCell::ContentsState contents = cell.GetContentsState();
+    cells.push_back(id);
+    auto known = state.cellStates.find(id);
+    const bool unchanged = (known != state.cellStates.end()) && (known->second == contents);
+    cellStates[id] = std::move(contents);
+    if (unchanged)
+      continue;
+    std::string xml;
+    if (!(valid = Format::CellToJournalXml(cell, xml)))
+      break;
+    state.journal.AddCell(id, xml);
+  }
+  std::size_t imageCounter = cellPointers.WXMXImageCount();
+  for (const auto &fil : m_configuration.GetFilesToSave()) {
+    const wxScopedCharBuffer name = fil.FileName().utf8_str();
+    state.journal.AddFile(std::string(name.data(), name.length()),
+                          static_cast<const char *>(fil.Data().GetData()),
+                          fil.Data().GetDataLen());
+  }
+  m_configuration.ClearFilesToSave();
+  if (!valid) {
+    // A full save will tell the user about the invalid XML.
+    wxLogMessage(_("A cell produced invalid XML => not appending to the autosave journal"));
+    StopAutosaveJournal();
+    return false;
+  }
+
+  const wxScopedCharBuffer header =
+    Format::DocumentHeader(GetWorksheet()->GetTree(), &m_configuration,
+                           m_variablesPane->GetVarnames(),
+                           GetWorksheet()->GetHCaret()).utf8_str();
+  std::string headerXml(header.data(), header.length());
+  if (!state.journal.HasPendingRecords() && (cells == state.cells) &&
+      (headerXml == state.header))
+    return true;
+
+  const std::string records = state.journal.Commit(cells, headerXml);
+  {
+    wxFile journal;
+    if (!journal.Open(Format::AutosaveJournalFile(m_tempfileName), wxFile::write_append) ||
+        (journal.Write(records.data(), records.size()) != records.size()) ||
+        !journal.Flush() ||
+        !journal.Close()) {
+      wxLogMessage(_("Could not append to the autosave journal"));
+      StopAutosaveJournal();
+      return false;
+    }
+  }
+  state.size += records.size();
+  state.cellStates = std::move(cellStates);
+  state.cells = std::move(cells);
+  state.header = std::move(headerXml);
+  state.imageCounter = imageCounter;
+
+  // If the journal has grown too big it is merged with the snapshot into a
+  // new snapshot.
+  if (state.size > std::max(state.snapshotSize / 2, static_cast<std::size_t>(1024 * 1024)))
+    StartAutosaveCompaction();
+  return true;
+}
+
+void wxMaxima::StartAutosaveCompaction() {
+  AutosaveJournalState &state = *m_autosaveJournal;
+  if (!state.compactionTarget.IsEmpty())
+    return;
+
+  state.compactionTarget = wxFileName::CreateTempFileName("untitled_");
+  wxRenameFile(state.compactionTarget, state.compactionTarget + ".wxmx");
+  state.compactionTarget += ".wxmx";
+  state.compactionBytes = state.size;
+  state.compactionCells = state.cells;
+  state.compactionSucceeded = std::make_shared<std::atomic<bool>>(false);
+
+  const wxString journal = Format::AutosaveJournalFile(m_tempfileName);
+  const wxString target = state.compactionTarget;
+  const std::size_t bytes = state.compactionBytes;
+  const std::shared_ptr<std::atomic<bool>> succeeded = state.compactionSucceeded;
+  auto compact = [journal, target, bytes, succeeded]() {
+    succeeded->store(Format::ReplayAutosaveJournal(journal, target, bytes));
+  };
+  if (m_configuration.UseThreads())
+    state.compaction =
+      TaskPool::Get().Submit(TaskPool::OTHER, TaskPool::LOW, std::move(compact));
+  else
+    compact();
+}
+
+void wxMaxima::FinishAutosaveCompaction() {
+  AutosaveJournalState &state = *m_autosaveJournal;
+  if (state.compactionTarget.IsEmpty() || !state.compaction.IsDone())
+    return;
+  state.compaction = {};
+  wxString target = state.compactionTarget;
+  state.compactionTarget.Clear();
+  SuppressErrorDialogs blocker;
+  if (!state.compactionSucceeded->load()) {
+    wxLogMessage(_("Could not merge the autosave journal into %s"), target.utf8_str());
+    wxRemoveFile(target);
+    return;
+  }
+
+  // The new journal starts with the records that have been appended to the
+  // old one while the compaction was running.
+  const wxString oldJournal = Format::AutosaveJournalFile(m_tempfileName);
+  std::string records;
+  {
+    wxFile journal(oldJournal);
+    const wxFileOffset length = journal.IsOpened() ? journal.Length() : -1;
+    if (length < static_cast<wxFileOffset>(state.compactionBytes)) {
+      wxRemoveFile(target);
+      return;
+    }
+    records.resize(static_cast<std::size_t>(length) - state.compactionBytes);
+    journal.Seek(static_cast<wxFileOffset>(state.compactionBytes));
+    if (!records.empty() &&
+        (journal.Read(&records[0], records.size()) != static_cast<ssize_t>(records.size()))) {
+      wxRemoveFile(target);
+      return;
+    }
+  }
+  const wxScopedCharBuffer snapshot = wxFileName(target).GetFullName().utf8_str();
+  const std::string journalData =
+    AutosaveJournal::Begin(std::string(snapshot.data(), snapshot.length()),
+                           state.compactionCells) + records;
+  {
+    wxFile journal(Format::AutosaveJournalFile(target), wxFile::write);
+    if (!journal.IsOpened() ||
+        (journal.Write(journalData.data(), journalData.size()) != journalData.size()) ||
+        !journal.Close()) {
+      wxRemoveFile(Format::AutosaveJournalFile(target));
+      wxRemoveFile(target);
+      return;
+    }
+  }
+  wxLogMessage(_("Merged the autosave journal into %s"), target.utf8_str());
+  wxRemoveFile(oldJournal);
+  wxRemoveFile(m_tempfileName);
+  m_tempfileName = target;
+  state.size = journalData.size();
+  state.snapshotSize = FileSize(target);
+  RegisterAutoSaveFile();
+}
+
 void wxMaxima::FileMenu(wxCommandEvent &event) {
   if(!GetWorksheet())
     return;
@@ -10273,6 +10538,7 @@ void wxMaxima::OnUnsavedDocument(wxCommandEvent &event) {
   }
 
   if (wxFileExists(file)) {
+    StopAutosaveJournal();
     OpenWXMXFile(file, GetWorksheet(), true);
     m_tempfileName = file;
     GetWorksheet()->m_currentFile.Clear();
@@ -10409,7 +10675,7 @@ wxString wxMaxima::GetUnmatchedParenthesisState(wxString text, std::size_t &inde
   std::list<wxChar> delimiters;
 
   for (auto const &tok : MaximaTokenizer(text, &m_configuration).PopTokens()) {
-    auto &itemText = tok.GetText();
+    const wxString itemText = tok.GetText();
     const TextStyle itemStyle = tok.GetTextStyle();
     index += itemText.Length();
 
@@ -47,6 +47,7 @@
 #include <wx/buffer.h>
 #include <wx/power.h>
 #include <wx/debugrpt.h>
+#include <cstdint>
 #include <memory>
 #ifdef __WXMSW__
 #include <windows.h>
@@ -403,6 +404,8 @@ protected:
   */
   TextCell *ConsoleAppend(wxString s, CellType type);        //!< append maxima output to console
   void ConsoleAppend(wxXmlDocument xml, CellType type, const wxString &userLabel = {});        //!< append maxima output to console
+  //! Append cells that already have been parsed to the console
+  void ConsoleAppend(std::unique_ptr<Cell> &&cell);
 
   enum AppendOpt { NewLine = 1, BigSkip = 2, PromptToolTip = 4, DefaultOpt = NewLine|BigSkip };
   void DoConsoleAppend(wxString s, CellType type, AppendOpt opts = AppendOpt::DefaultOpt,
@@ -521,6 +524,8 @@ protected:
     After processing the status bar marker is removed from data.
   */
   void ReadMath(const wxXmlDocument &xml);
+  //! Reads maths the parser thread already has converted to cells
+  void ReadMath(Maxima::ParsedCells cells);
 
   /*! Reads autocompletion templates we get on definition of a function or variable
 
@@ -688,6 +693,18 @@ protected:
     Returns false if a save was necessary, but not possible.
   */
   bool AutoSave();
+  /*! Appends the cells that have changed since the last autosave to the journal
+
+    \return false, if there is no journal or appending to it failed. In that
+    case a full autosave is needed.
+  */
+  bool AppendToAutosaveJournal();
+  //! Starts a new autosave journal for the snapshot m_tempfileName
+  void StartAutosaveJournal();
+  //! Merges the autosave journal and its snapshot into a new snapshot in the background
+  void StartAutosaveCompaction();
+  //! Switches to the new snapshot, if the merge has finished
+  void FinishAutosaveCompaction();
 
   /*! Tries or offers to save the document
 
@@ -748,6 +765,10 @@ protected:
     used by UpdateTableOfContents() and the idle task.
   */
   bool m_scheduleUpdateToc = false;
+  //! The ImageCache::GetGeneration() the worksheet has last been redrawn for
+  std::uint32_t m_imageCacheGeneration = 0;
+  //! The GroupCell::GetConfusablesGeneration() the worksheet has last been redrawn for
+  std::uint32_t m_confusablesGeneration = 0;
   void QuestionAnswered(){if(GetWorksheet()) GetWorksheet()->QuestionAnswered();}
     //! Is called when we get a new list of demo files
   //! Is called when we get a new list of demo files
@@ -770,6 +791,8 @@ protected:
   wxWindowIDRef m_gnuplot_process_id;
   wxWindowIDRef m_maxima_process_id;
   wxString m_lastPrompt;
+  //! The number the Maxima object has assigned to m_lastPrompt
+  long m_lastPromptNumber = 0;
   wxString m_lastPath;
   std::unique_ptr<wxPrintData> m_printData;
   /*! Did we tell maxima to close?
@@ -33,6 +33,7 @@
 #include "wxMaximaFrame.h"
 #include "ArtProvider.h"
 #include "Dirstructure.h"
+#include "WXMXformat.h"
 #include <string>
 #include <memory>
 #include <algorithm>
@@ -2178,7 +2179,20 @@ void wxMaximaFrame::RegisterAutoSaveFile() {
   ReReadConfig();
 }
 
+void wxMaximaFrame::StopAutosaveJournal() {
+  if (!m_autosaveJournal)
+    return;
+  m_autosaveJournal->compaction.Wait();
+  if (!m_autosaveJournal->compactionTarget.IsEmpty() &&
+      wxFileExists(m_autosaveJournal->compactionTarget)) {
+    SuppressErrorDialogs logNull;
+    wxRemoveFile(m_autosaveJournal->compactionTarget);
+  }
+  m_autosaveJournal.reset();
+}
+
 void wxMaximaFrame::RemoveTempAutosavefile() {
+  StopAutosaveJournal();
   if (m_tempfileName != wxEmptyString) {
     // Don't delete the file if we have opened it and haven't saved it under a
     // different name yet.
@@ -2186,6 +2200,9 @@ void wxMaximaFrame::RemoveTempAutosavefile() {
         (m_tempfileName != GetWorksheet()->m_currentFile)) {
       SuppressErrorDialogs logNull;
       wxRemoveFile(m_tempfileName);
+      wxString journal = Format::AutosaveJournalFile(m_tempfileName);
+      if (wxFileExists(journal))
+        wxRemoveFile(journal);
     }
   }
   m_tempfileName.Clear();
@@ -32,6 +32,11 @@
 
 #include "precomp.h"
 #include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <wx/wx.h>
 #include "EventIDs.h"
 #include <wx/dirctrl.h>
@@ -50,6 +55,8 @@
 #include "sidebars/SymbolsSidebar.h"
 #include "sidebars/HelpBrowser.h"
 #include "RecentDocuments.h"
+#include "AutosaveJournal.h"
+#include "TaskPool.h"
 #include "Version.h"
 #include "MainMenuBar.h"
 #include "sidebars/History.h"
@@ -163,6 +170,38 @@ protected:
   long m_pid = -1;
   //! The last name GetTempAutosavefileName() has returned.
   wxString m_tempfileName;
+  //! What we know about the journal the autosaves append the changed cells to
+  struct AutosaveJournalState
+  {
+    //! Collects the records of the next autosave
+    AutosaveJournal journal;
+    //! The contents of the cells at the last autosave, by their id
+    std::unordered_map<AutosaveJournal::CellId, GroupCell::ContentsState> cellStates;
+    //! The ids of the cells at the last autosave, in order
+    std::vector<AutosaveJournal::CellId> cells;
+    //! The XML header of the document at the last autosave
+    std::string header;
+    //! The number of the last image that has been autosaved
+    std::size_t imageCounter = 0;
+    //! The size of the snapshot the journal belongs to
+    std::size_t snapshotSize = 0;
+    //! The size of the journal
+    std::size_t size = 0;
+    //! Merges the journal into a new snapshot in the background
+    TaskPool::Task compaction;
+    //! The file the compaction writes to
+    wxString compactionTarget;
+    //! The number of bytes of the journal the compaction merges
+    std::size_t compactionBytes = 0;
+    //! The ids of the cells in the file the compaction writes
+    std::vector<AutosaveJournal::CellId> compactionCells;
+    //! Set by the compaction if it succeeded
+    std::shared_ptr<std::atomic<bool>> compactionSucceeded;
+  };
+  //! The autosave journal of m_tempfileName. NULL = we don't have one.
+  std::unique_ptr<AutosaveJournalState> m_autosaveJournal;
+  //! Stops writing to the autosave journal and removes an unfinished compaction
+  void StopAutosaveJournal();
   //! Issued if a notification is closed.
   void OnNotificationClose(wxCommandEvent WXUNUSED(&event));
   //! The status bar
@@ -218,7 +257,7 @@ protected:
   wxMenu *m_NumericMenu = NULL;
   //! The help menu
   wxMenu *m_HelpMenu = NULL;
-  //! Remove an eventual temporary autosave file.
+  //! Remove an eventual temporary autosave file and its journal.
   void RemoveTempAutosavefile();
   //! Re-read the configuration.
   void ReReadConfig();
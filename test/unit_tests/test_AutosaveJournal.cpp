@@ -0,0 +1,118 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "AutosaveJournal.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+SCENARIO("AutosaveJournal records the changes to a snapshot") {
+  GIVEN("A journal for a snapshot with three cells") {
+    std::string journalData = AutosaveJournal::Begin("untitled_1.wxmx", {1, 2, 3});
+    AutosaveJournal journal;
+    WHEN("Nothing has been committed") {
+      AutosaveJournal::Contents contents;
+      REQUIRE(AutosaveJournal::Read(journalData.data(), journalData.size(), contents));
+      THEN("The journal describes the snapshot") {
+        REQUIRE(contents.snapshot == "untitled_1.wxmx");
+        REQUIRE(contents.baseCells == std::vector<AutosaveJournal::CellId>{1, 2, 3});
+        REQUIRE(contents.cells == contents.baseCells);
+        REQUIRE(contents.header.empty());
+        REQUIRE(contents.changedCells.empty());
+        REQUIRE(contents.committedBytes == journalData.size());
+      }
+    }
+    WHEN("A cell has been changed, one has been deleted and one has been added") {
+      const std::string image("\x89PNG\r\n\0\n", 8);
+      journal.AddCell(2, "<cell type=\"code\">\n<input>x</input></cell>");
+      journal.AddCell(7, "<cell type=\"text\"/>");
+      journal.AddFile("4.png", image.data(), image.size());
+      REQUIRE(journal.HasPendingRecords());
+      journalData += journal.Commit({7, 2, 3}, "<wxMaximaDocument version=\"1.5\">\n");
+      REQUIRE(!journal.HasPendingRecords());
+      AutosaveJournal::Contents contents;
+      REQUIRE(AutosaveJournal::Read(journalData.data(), journalData.size(), contents));
+      THEN("Reading the journal results in the new worksheet") {
+        REQUIRE(contents.cells == std::vector<AutosaveJournal::CellId>{7, 2, 3});
+        REQUIRE(contents.baseCells == std::vector<AutosaveJournal::CellId>{1, 2, 3});
+        REQUIRE(contents.header == "<wxMaximaDocument version=\"1.5\">\n");
+        REQUIRE(contents.changedCells.size() == 2);
+        REQUIRE(contents.changedCells[2] == "<cell type=\"code\">\n<input>x</input></cell>");
+        REQUIRE(contents.changedCells[7] == "<cell type=\"text\"/>");
+        REQUIRE(contents.files["4.png"] == image);
+        REQUIRE(contents.committedBytes == journalData.size());
+      }
+      AND_WHEN("The cell is changed again") {
+        journal.AddCell(2, "<cell type=\"code\">\n<input>y</input></cell>");
+        journalData += journal.Commit({7, 2, 3}, "<wxMaximaDocument version=\"1.5\">\n");
+        REQUIRE(AutosaveJournal::Read(journalData.data(), journalData.size(), contents));
+        THEN("The newest version of the cell wins") {
+          REQUIRE(contents.changedCells[2] == "<cell type=\"code\">\n<input>y</input></cell>");
+        }
+      }
+      AND_WHEN("The next autosave has only partially been written") {
+        const std::size_t committed = journalData.size();
+        journal.AddCell(3, "<cell type=\"text\">new</cell>");
+        const std::string records = journal.Commit({7, 2}, "<wxMaximaDocument>\n");
+        for(std::size_t length = 0; length < records.size(); length++)
+          {
+            std::string torn = journalData + records.substr(0, length);
+            REQUIRE(AutosaveJournal::Read(torn.data(), torn.size(), contents));
+            REQUIRE(contents.cells == std::vector<AutosaveJournal::CellId>{7, 2, 3});
+            REQUIRE(contents.changedCells.count(3) == 0);
+            REQUIRE(contents.committedBytes == committed);
+          }
+        THEN("Only the complete autosaves are replayed") {
+          journalData += records;
+          REQUIRE(AutosaveJournal::Read(journalData.data(), journalData.size(), contents));
+          REQUIRE(contents.cells == std::vector<AutosaveJournal::CellId>{7, 2});
+          REQUIRE(contents.changedCells[3] == "<cell type=\"text\">new</cell>");
+        }
+      }
+      AND_WHEN("A byte of the journal has been corrupted") {
+        const std::size_t corrupted = journalData.find("<input>x");
+        journalData[corrupted + 7] = 'z';
+        THEN("Only the records before the damage are replayed") {
+          REQUIRE(AutosaveJournal::Read(journalData.data(), journalData.size(), contents));
+          REQUIRE(contents.cells == std::vector<AutosaveJournal::CellId>{1, 2, 3});
+          REQUIRE(contents.changedCells.empty());
+          REQUIRE(contents.files.empty());
+        }
+      }
+    }
+  }
+  GIVEN("Data that isn't a journal") {
+    AutosaveJournal::Contents contents;
+    const std::string data("PK\x03\x04");
+    THEN("It cannot be read") {
+      REQUIRE(!AutosaveJournal::Read(data.data(), data.size(), contents));
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
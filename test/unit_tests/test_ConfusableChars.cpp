@@ -0,0 +1,88 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "ConfusableChars.cpp"
+#include <catch2/catch.hpp>
+
+SCENARIO("Skeletons map lookalikes to the same word") {
+  GIVEN("A latin word") {
+    THEN("Its skeleton is the word itself") {
+      REQUIRE(ConfusableChars::Skeleton(L"Area") == L"Area");
+    }
+  }
+  GIVEN("The same word with a cyrillic A and a greek alpha") {
+    THEN("All three have the same skeleton") {
+      REQUIRE(ConfusableChars::Skeleton(L"Аrea") == L"Area");
+      REQUIRE(ConfusableChars::Skeleton(L"Αrea") == L"Area");
+    }
+  }
+  GIVEN("Lookalikes of lookalikes") {
+    THEN("They have the same skeleton, too") {
+      REQUIRE(ConfusableChars::Skeleton(L"Κelvin") ==
+              ConfusableChars::Skeleton(L"Kelvin"));
+    }
+  }
+  GIVEN("Chars that are no lookalikes of each other") {
+    THEN("They keep different skeletons") {
+      REQUIRE(ConfusableChars::Skeleton(L"M") != ConfusableChars::Skeleton(L"B"));
+      REQUIRE(ConfusableChars::Skeleton(L"Y") != ConfusableChars::Skeleton(L"y"));
+    }
+  }
+}
+
+SCENARIO("Finding words that look alike") {
+  GIVEN("Words without lookalikes") {
+    THEN("Nothing is found") {
+      REQUIRE(ConfusableChars::Find({L"a", L"b", L"sin", L"x"}).empty());
+    }
+  }
+  GIVEN("A word that occurs twice") {
+    THEN("It doesn't look like another word") {
+      REQUIRE(ConfusableChars::Find({L"x", L"x"}).empty());
+    }
+  }
+  GIVEN("A latin and a greek mu among other words") {
+    auto pairs = ConfusableChars::Find({L"y", L"μm", L"z", L"µm"});
+    THEN("Exactly these are found, the smaller one first") {
+      REQUIRE(pairs.size() == 1);
+      REQUIRE(pairs[0] == ConfusableChars::Pair(L"µm", L"μm"));
+    }
+  }
+  GIVEN("Three words that look alike") {
+    auto pairs = ConfusableChars::Find({L"сos", L"cos", L"соs"});
+    THEN("Both lookalikes are paired with the first of them") {
+      REQUIRE(pairs.size() == 2);
+      REQUIRE(pairs[0].first == L"cos");
+      REQUIRE(pairs[1].first == L"cos");
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,146 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "GroupCellIndex.cpp"
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <vector>
+
+//! The index only stores pointers to the cells => a dummy is enough.
+class GroupCell
+{
+public:
+  int extent = 0;
+  int width = 0;
+};
+
+//! The offset of a cell and the cell at an offset, the slow way
+static std::size_t FindLinear(const std::vector<GroupCell> &cells, int offset)
+{
+  std::size_t index = 0;
+  for(; index < cells.size(); index++)
+    {
+      if(offset < cells[index].extent)
+        break;
+      offset -= cells[index].extent;
+    }
+  return index;
+}
+
+SCENARIO("GroupCellIndex finds cells by their position") {
+  GIVEN("An index of cells of different heights") {
+    std::vector<GroupCell> cells(37);
+    GroupCellIndex index;
+    index.Clear();
+    for(std::size_t i = 0; i < cells.size(); i++)
+      {
+        cells[i].extent = static_cast<int>((i * 7) % 11);
+        cells[i].width = static_cast<int>((i * 3) % 17);
+        index.Append(&cells[i], cells[i].extent, cells[i].width);
+      }
+    index.SetUpToDate(&cells[0]);
+    THEN("It is up to date") {
+      REQUIRE(index.IsUpToDate(&cells[0]));
+      REQUIRE(!index.IsUpToDate(&cells[1]));
+    }
+    THEN("The offsets are the sums of the extents before the cell") {
+      int offset = 0;
+      for(std::size_t i = 0; i < cells.size(); i++)
+        {
+          REQUIRE(index.GetOffset(i) == offset);
+          offset += cells[i].extent;
+        }
+      REQUIRE(index.GetTotalExtent() == offset);
+    }
+    THEN("Every offset is found in the right cell") {
+      for(int offset = -3; offset <= index.GetTotalExtent() + 3; offset++)
+        REQUIRE(index.Find(offset) == FindLinear(cells, offset));
+    }
+    WHEN("The heights of cells change") {
+      for(std::size_t i = 0; i < cells.size(); i += 3)
+        {
+          cells[i].extent = static_cast<int>((i * 5) % 13);
+          index.SetSize(&cells[i], cells[i].extent, cells[i].width);
+        }
+      THEN("The offsets follow") {
+        for(int offset = -3; offset <= index.GetTotalExtent() + 3; offset++)
+          REQUIRE(index.Find(offset) == FindLinear(cells, offset));
+        REQUIRE(index.GetExtent(3) == cells[3].extent);
+      }
+    }
+    WHEN("A cell that isn't in the index changes its height") {
+      GroupCell other;
+      int total = index.GetTotalExtent();
+      index.SetSize(&other, 100, 100);
+      THEN("Nothing happens") {
+        REQUIRE(index.GetTotalExtent() == total);
+        REQUIRE(index.IndexOf(&other) == index.Size());
+        REQUIRE(index.GetMaxWidth() == 16);
+      }
+    }
+    WHEN("The widest cells become narrower") {
+      REQUIRE(index.GetMaxWidth() == 16);
+      for(std::size_t i = 0; i < cells.size(); i++)
+        if(cells[i].width == 16)
+          index.SetSize(&cells[i], cells[i].extent, 2);
+      THEN("The next-widest cell determines the width") {
+        REQUIRE(index.GetMaxWidth() == 15);
+      }
+    }
+    WHEN("A cell becomes wider") {
+      index.SetSize(&cells[5], cells[5].extent, 40);
+      THEN("It determines the width") {
+        REQUIRE(index.GetMaxWidth() == 40);
+      }
+    }
+    WHEN("The list it describes is changed") {
+      GroupCellIndex other;
+      other.Clear();
+      other.Append(&cells[0], cells[0].extent, cells[0].width);
+      other.SetUpToDate(&cells[0]);
+      index.ListChanged();
+      THEN("The index needs to be rebuilt") {
+        REQUIRE(!index.IsUpToDate(&cells[0]));
+      }
+      THEN("Other indices stay up to date") {
+        REQUIRE(other.IsUpToDate(&cells[0]));
+      }
+    }
+  }
+  GIVEN("An empty index") {
+    GroupCellIndex index;
+    index.Clear();
+    THEN("Nothing is found") {
+      REQUIRE(index.Find(0) == 0);
+      REQUIRE(index.Size() == 0);
+      REQUIRE(index.GetTotalExtent() == 0);
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
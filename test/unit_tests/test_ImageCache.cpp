@@ -0,0 +1,141 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "ImageCache.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+//! An image of the given size whose pixels all have the same value
+static std::shared_ptr<const ImageCache::Pixels> Image(int width, int height, unsigned char value)
+{
+  auto pixels = std::make_shared<ImageCache::Pixels>();
+  pixels->width = width;
+  pixels->height = height;
+  pixels->rgba.assign(static_cast<std::size_t>(width) * height * 4, value);
+  return pixels;
+}
+
+SCENARIO("ImageCache builds mipmaps") {
+  GIVEN("A 2x2 image") {
+    ImageCache::Pixels pixels;
+    pixels.width = pixels.height = 2;
+    pixels.rgba = {0, 0, 0, 255,   100, 0, 0, 255,
+                   0, 200, 0, 255, 0, 0, 255, 255};
+    THEN("Half its size is the average of the pixels") {
+      auto half = ImageCache::HalfSize(pixels);
+      REQUIRE(half->width == 1);
+      REQUIRE(half->height == 1);
+      REQUIRE(half->rgba == std::vector<unsigned char>({25, 50, 64, 255}));
+    }
+  }
+  GIVEN("An image with an odd size") {
+    auto pixels = Image(5, 3, 10);
+    THEN("Half its size is rounded up") {
+      auto half = ImageCache::HalfSize(*pixels);
+      REQUIRE(half->width == 3);
+      REQUIRE(half->height == 2);
+      REQUIRE(half->rgba == std::vector<unsigned char>(3 * 2 * 4, 10));
+    }
+  }
+  GIVEN("A mipmap that only contains the full-size image") {
+    ImageCache::Mipmap mipmap{Image(1000, 800, 0)};
+    THEN("A big size is scaled from the full-size image") {
+      REQUIRE(ImageCache::GetLevel(mipmap, 900, 700) == mipmap[0]);
+      REQUIRE(mipmap.size() == 1);
+    }
+    THEN("Smaller sizes are scaled from the smallest level that is big enough") {
+      auto level = ImageCache::GetLevel(mipmap, 200, 100);
+      REQUIRE(level->width == 250);
+      REQUIRE(level->height == 200);
+      REQUIRE(mipmap.size() == 3);
+      REQUIRE(ImageCache::GetBytes(mipmap) == (1000 * 800 + 500 * 400 + 250 * 200) * 4);
+    }
+    THEN("Levels that already exist are reused") {
+      auto level = ImageCache::GetLevel(mipmap, 300, 300);
+      REQUIRE(ImageCache::GetLevel(mipmap, 400, 300) == level);
+    }
+    THEN("Tiny sizes don't cause the mipmap to grow forever") {
+      REQUIRE(ImageCache::GetLevel(mipmap, 0, 0)->width == 1);
+    }
+  }
+}
+
+SCENARIO("ImageCache keeps the images within the budget") {
+  ImageCache cache(1000);
+  std::vector<std::string> dropped;
+  auto drop = [&dropped](const std::string &name) {
+    return [&dropped, name]() { dropped.push_back(name); };
+  };
+  int a, b, c;
+  GIVEN("Images that fit into the budget") {
+    cache.Use(&a, 300, drop("a"));
+    cache.Use(&b, 300, drop("b"));
+    cache.Use(&c, 300, drop("c"));
+    THEN("No image is dropped") {
+      REQUIRE(dropped.empty());
+      REQUIRE(cache.GetStatistics().bytes == 900);
+      REQUIRE(cache.GetStatistics().images == 3);
+    }
+    WHEN("An image needs more memory") {
+      cache.Use(&a, 300, drop("a"));
+      cache.Use(&c, 500, drop("c"));
+      THEN("The image that has been drawn the longest time ago is dropped") {
+        REQUIRE(dropped == std::vector<std::string>({"b"}));
+        REQUIRE(cache.GetStatistics().bytes == 800);
+        REQUIRE(cache.GetStatistics().evictions == 1);
+      }
+    }
+    WHEN("The budget is reduced") {
+      cache.SetBudget(100);
+      THEN("All images are dropped") {
+        REQUIRE(dropped == std::vector<std::string>({"a", "b", "c"}));
+        REQUIRE(cache.GetStatistics().bytes == 0);
+      }
+    }
+    WHEN("An image forgets its pixels") {
+      cache.Forget(&b);
+      cache.Use(&a, 400, drop("a"));
+      THEN("Its memory is free again") {
+        REQUIRE(dropped.empty());
+        REQUIRE(cache.GetStatistics().bytes == 700);
+      }
+    }
+  }
+  GIVEN("An image that alone is bigger than the budget") {
+    cache.Use(&a, 300, drop("a"));
+    cache.Use(&b, 2000, drop("b"));
+    THEN("Only the other images are dropped") {
+      REQUIRE(dropped == std::vector<std::string>({"a"}));
+      REQUIRE(cache.GetStatistics().bytes == 2000);
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,162 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "ImageHeader.cpp"
+#include "XmlPullParser.cpp"
+#define NANOSVG_IMPLEMENTATION
+#include "nanoSVG/nanosvg.h"
+#include <catch2/catch.hpp>
+#include <string>
+
+//! The first bytes of a .png file: signature, IHDR and optionally pHYs
+static std::string PngHeader(unsigned long width, unsigned long height,
+                             unsigned long pixelsPerMeter = 0)
+{
+  auto u32 = [](unsigned long value) {
+    std::string data;
+    for(int shift = 24; shift >= 0; shift -= 8)
+      data += static_cast<char>((value >> shift) & 0xFF);
+    return data;
+  };
+  std::string png("\x89PNG\r\n\x1A\n", 8);
+  png += u32(13) + "IHDR" + u32(width) + u32(height) + std::string("\x08\x06\0\0\0", 5) + u32(0);
+  png += u32(0) + "tEXt" + u32(0);
+  if(pixelsPerMeter > 0)
+    png += u32(9) + "pHYs" + u32(pixelsPerMeter) + u32(pixelsPerMeter) + "\x01" + u32(0);
+  png += u32(100) + "IDAT";
+  return png;
+}
+
+//! Reads the size of an svg image using ImageHeader and nanoSVG
+static void CompareToNanoSVG(std::string svg, float ppi)
+{
+  ImageHeader header;
+  REQUIRE(header.ReadSvg(svg.data(), svg.size(), ppi));
+  NSVGimage *image = nsvgParse(&svg[0], "px", ppi);
+  REQUIRE(image != NULL);
+  CHECK(header.GetWidth() == static_cast<std::size_t>(image->width));
+  CHECK(header.GetHeight() == static_cast<std::size_t>(image->height));
+  nsvgDelete(image);
+}
+
+SCENARIO("ImageHeader reads the size of bitmaps") {
+  ImageHeader header;
+  GIVEN("A .png file") {
+    std::string png = PngHeader(640, 480);
+    THEN("Its size is known") {
+      REQUIRE(header.ReadBitmap(reinterpret_cast<const unsigned char *>(png.data()), png.size()));
+      REQUIRE(header.GetWidth() == 640);
+      REQUIRE(header.GetHeight() == 480);
+      REQUIRE(header.GetResolution() == 0);
+    }
+  }
+  GIVEN("A .png file with a resolution") {
+    std::string png = PngHeader(1200, 900, 11811);
+    THEN("The resolution is converted to pixels per inch") {
+      REQUIRE(header.ReadBitmap(reinterpret_cast<const unsigned char *>(png.data()), png.size()));
+      REQUIRE(header.GetWidth() == 1200);
+      REQUIRE(header.GetResolution() == Approx(300).epsilon(0.001));
+    }
+  }
+  GIVEN("A .jpeg file") {
+    std::string jpeg("\xFF\xD8"
+                     "\xFF\xE0\x00\x10JFIF\0\x01\x01\x01\x00\x60\x00\x60\x00\x00"
+                     "\xFF\xFE\x00\x05xyz"
+                     "\xFF\xC2\x00\x11\x08\x01\xE0\x02\x80\x03\x01\x22\x00\x02\x11\x01\x03\x11\x01"
+                     "\xFF\xDA", 49);
+    THEN("Its size and resolution are read from the SOF and JFIF segments") {
+      REQUIRE(header.ReadBitmap(reinterpret_cast<const unsigned char *>(jpeg.data()), jpeg.size()));
+      REQUIRE(header.GetWidth() == 640);
+      REQUIRE(header.GetHeight() == 480);
+      REQUIRE(header.GetResolution() == 96);
+    }
+  }
+  GIVEN("Data in other formats or broken headers") {
+    std::string gif("GIF89a\x80\x02\xE0\x01", 10);
+    std::string png = PngHeader(640, 480).substr(0, 20);
+    std::string jpeg("\xFF\xD8\xFF\xDA\x00\x02", 6);
+    THEN("They are rejected") {
+      REQUIRE(!header.ReadBitmap(reinterpret_cast<const unsigned char *>(gif.data()), gif.size()));
+      REQUIRE(!header.ReadBitmap(reinterpret_cast<const unsigned char *>(png.data()), png.size()));
+      REQUIRE(!header.ReadBitmap(reinterpret_cast<const unsigned char *>(jpeg.data()), jpeg.size()));
+    }
+  }
+}
+
+SCENARIO("ImageHeader reads the size of svg images the same way nanoSVG does") {
+  GIVEN("A plot from gnuplot") {
+    std::string svg(
+      "<?xml version=\"1.0\" encoding=\"utf-8\"  standalone=\"no\"?>\n"
+      "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" "
+      "\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n"
+      "<svg \n width=\"600\" height=\"500\"\n viewBox=\"0 0 600 500\"\n"
+      " xmlns=\"http://www.w3.org/2000/svg\">\n"
+      "<title>Gnuplot</title>\n<path d=\"M0,0 L10,10\" stroke=\"black\"/>\n</svg>\n");
+    THEN("The sizes match") {
+      CompareToNanoSVG(svg, 96);
+      CompareToNanoSVG(svg, 144);
+    }
+    THEN("Only the root tag needs to be known") {
+      ImageHeader header;
+      std::string start = svg.substr(0, svg.find("<title>"));
+      REQUIRE(header.ReadSvg(start.data(), start.size(), 96));
+      REQUIRE(header.GetWidth() == 600);
+      REQUIRE(header.GetHeight() == 500);
+    }
+  }
+  GIVEN("Sizes in physical units") {
+    THEN("They are converted using the resolution") {
+      CompareToNanoSVG("<svg width=\"10cm\" height=\"3.5in\"><rect width=\"1\" height=\"1\"/></svg>", 96);
+      CompareToNanoSVG("<svg width=\"200pt\" height=\"1.5e2mm\"><rect width=\"1\" height=\"1\"/></svg>", 110);
+      CompareToNanoSVG("<svg width=\"12pc\" height=\"100px\"><rect width=\"1\" height=\"1\"/></svg>", 72);
+    }
+  }
+  GIVEN("Only a viewBox, or a size in percent") {
+    THEN("The viewBox tells the size") {
+      CompareToNanoSVG("<svg viewBox=\"0,0,320.5,200\"><rect width=\"1\" height=\"1\"/></svg>", 96);
+      CompareToNanoSVG("<svg width=\"100%\" height=\"50%\" viewBox=\"10 10 300 150\">"
+                       "<rect width=\"1\" height=\"1\"/></svg>", 96);
+    }
+  }
+  GIVEN("Images whose size only parsing them can tell") {
+    ImageHeader header;
+    std::string noSize("<svg><rect width=\"10\" height=\"10\"/></svg>");
+    std::string fontSize("<svg width=\"10em\" height=\"10em\"/>");
+    std::string notSvg("<html><svg width=\"10\" height=\"10\"/></html>");
+    std::string truncated("<svg width=\"10\" hei");
+    THEN("They are rejected") {
+      REQUIRE(!header.ReadSvg(noSize.data(), noSize.size(), 96));
+      REQUIRE(!header.ReadSvg(fontSize.data(), fontSize.size(), 96));
+      REQUIRE(!header.ReadSvg(notSvg.data(), notSvg.size(), 96));
+      REQUIRE(!header.ReadSvg(truncated.data(), truncated.size(), 96));
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
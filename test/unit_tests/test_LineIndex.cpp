@@ -0,0 +1,159 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "LineIndex.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+
+//! Indexes text and checks that the index knows where each of its chars is
+static void CheckIndex(const LineIndex &index, const std::wstring &text) {
+  REQUIRE(index.GetTextLength() == text.length());
+  std::size_t line = 0;
+  std::size_t lineStart = 0;
+  for (std::size_t pos = 0; pos < text.length(); pos++) {
+    REQUIRE(index.GetLine(pos) == line);
+    REQUIRE(index.GetLineStart(line) == lineStart);
+    if ((text[pos] == '\n') || (text[pos] == '\r')) {
+      REQUIRE(index.GetLineEnd(line) == pos);
+      line++;
+      lineStart = pos + 1;
+    }
+  }
+  REQUIRE(index.GetLine(text.length()) == line);
+  REQUIRE(index.GetLines() == line + 1);
+  REQUIRE(index.GetLineEnd(line) == text.length());
+}
+
+//! Replaces the chars [start, end) of text and updates its index
+static void Replace(LineIndex &index, std::wstring &text, std::size_t start,
+                    std::size_t end, const std::wstring &replacement) {
+  index.Replace(start, end, replacement.begin(), replacement.end());
+  text.replace(start, end - start, replacement);
+}
+
+SCENARIO("Indexing the lines of a text") {
+  GIVEN("An empty text") {
+    std::wstring text;
+    LineIndex index;
+    index.Build(text.begin(), text.end());
+    THEN("It consists of one empty line") {
+      REQUIRE(index.GetLines() == 1);
+      REQUIRE(index.GetLine(0) == 0);
+      REQUIRE(index.GetLineStart(0) == 0);
+      REQUIRE(index.GetLineEnd(0) == 0);
+    }
+  }
+  GIVEN("A text with hard and soft line breaks") {
+    std::wstring text = L"a:1;\nb:2;\rc:a+b;\n";
+    LineIndex index;
+    index.Build(text.begin(), text.end());
+    THEN("Both break lines") {
+      REQUIRE(index.GetLines() == 4);
+      REQUIRE(index.GetLineStart(1) == 5);
+      REQUIRE(index.GetLineStart(2) == 10);
+      REQUIRE(index.GetLineStart(3) == text.length());
+      CheckIndex(index, text);
+    }
+    THEN("Lines behind the end begin at the end of the text") {
+      REQUIRE(index.GetLineStart(17) == text.length());
+    }
+  }
+}
+
+SCENARIO("Updating the index while editing") {
+  std::wstring text = L"f(x):=x^2;\ng(x):=x^3;\nh(x):=x^4;";
+  LineIndex index;
+  index.Build(text.begin(), text.end());
+  GIVEN("Typing within the first line") {
+    for (std::size_t i = 0; i < 20; i++)
+      Replace(index, text, 7, 7, L"1");
+    THEN("The lines behind it move") {
+      REQUIRE(index.GetLineStart(1) == 31);
+      CheckIndex(index, text);
+    }
+    AND_WHEN("Deleting chars in another line") {
+      Replace(index, text, 35, 37, L"");
+      Replace(index, text, 34, 35, L"");
+      THEN("The index still matches the text") { CheckIndex(index, text); }
+    }
+  }
+  GIVEN("Inserting line breaks") {
+    Replace(index, text, 11, 11, L"\n\n");
+    Replace(index, text, 3, 3, L"\r");
+    THEN("The index knows the new lines") {
+      REQUIRE(index.GetLines() == 6);
+      CheckIndex(index, text);
+    }
+  }
+  GIVEN("Deleting line breaks") {
+    Replace(index, text, 9, 12, L"");
+    THEN("The lines are joined") {
+      REQUIRE(index.GetLines() == 2);
+      CheckIndex(index, text);
+    }
+  }
+  GIVEN("Replacing everything") {
+    Replace(index, text, 0, text.length(), L"x\ny");
+    THEN("The index describes the new text") { CheckIndex(index, text); }
+  }
+}
+
+SCENARIO("Updates match rebuilding the index") {
+  GIVEN("Many random edits") {
+    std::wstring text;
+    LineIndex index;
+    index.Build(text.begin(), text.end());
+    const std::wstring chars = L"ab\n\r";
+    unsigned int seed = 1;
+    auto random = [&seed](std::size_t max) {
+      seed = seed * 1103515245 + 12345;
+      return static_cast<std::size_t>((seed >> 16) % (max + 1));
+    };
+    for (int i = 0; i < 2000; i++) {
+      std::size_t start = random(text.length());
+      std::size_t end = start + random(std::min<std::size_t>(3, text.length() - start));
+      std::wstring replacement;
+      for (std::size_t j = random(3); j > 0; j--)
+        replacement += chars[random(chars.length() - 1)];
+      Replace(index, text, start, end, replacement);
+    }
+    THEN("The index is the same as a fresh one") {
+      LineIndex fresh;
+      fresh.Build(text.begin(), text.end());
+      REQUIRE(index.GetLines() == fresh.GetLines());
+      for (std::size_t line = 0; line < fresh.GetLines(); line++)
+        REQUIRE(index.GetLineStart(line) == fresh.GetLineStart(line));
+      CheckIndex(index, text);
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,88 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "MaximaTagScanner.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+enum { PROMPT = 1, MATHS = 2 };
+
+//! Feeds data to a scanner in blocks and returns the items it finds as strings
+static std::vector<std::string> Scan(const std::string &data, std::size_t blockSize)
+{
+  MaximaTagScanner scanner;
+  scanner.AddTag("PROMPT", PROMPT);
+  scanner.AddTag("mth", MATHS);
+  scanner.AddTag("math", MATHS);
+
+  std::vector<std::string> items;
+  std::string buffer;
+  for(std::size_t i = 0; i < data.size(); i += blockSize)
+    {
+      buffer += data.substr(i, blockSize);
+      for(;;)
+        {
+          MaximaTagScanner::Item item = scanner.Next(buffer.data(), buffer.size());
+          if(item.type == MaximaTagScanner::NONE)
+            break;
+          if(item.type == MaximaTagScanner::TAG)
+            items.push_back(std::to_string(item.tag) + ":" + buffer.substr(0, item.length));
+          if(item.type == MaximaTagScanner::TEXT)
+            items.push_back(buffer.substr(0, item.length));
+          buffer.erase(0, item.length);
+          scanner.Consumed(item.length);
+        }
+    }
+  return items;
+}
+
+SCENARIO("MaximaTagScanner splits the data into text and tags") {
+  GIVEN("Data that is received in one go") {
+    auto items = Scan("line 1\n<mth><mi>x</mi></mth>\nabc<PROMPT>(%i1) </PROMPT>", 1000);
+    REQUIRE(items.size() == 4);
+    REQUIRE(items[0] == "line 1\n");
+    REQUIRE(items[1] == "2:<mth><mi>x</mi></mth>");
+    REQUIRE(items[2] == "abc");
+    REQUIRE(items[3] == "1:<PROMPT>(%i1) </PROMPT>");
+  }
+  GIVEN("Data that contains unknown tags") {
+    auto items = Scan("<mi>x</mi>\n<math><t>&lt;</t></math>", 1000);
+    REQUIRE(items.size() == 2);
+    REQUIRE(items[0] == "<mi>x</mi>\n");
+    REQUIRE(items[1] == "2:<math><t>&lt;</t></math>");
+  }
+  GIVEN("Data that arrives one byte at a time") {
+    auto items = Scan("<mth><mi>x</mi></mth>\n<PROMPT>(%i2) </PROMPT>", 1);
+    REQUIRE(items.size() == 2);
+    REQUIRE(items[0] == "2:<mth><mi>x</mi></mth>");
+    REQUIRE(items[1] == "1:<PROMPT>(%i2) </PROMPT>");
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
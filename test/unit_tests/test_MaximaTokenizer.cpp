@@ -0,0 +1,148 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "MaximaTokenizer.cpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+
+//! The texts of the tokens the tokenizer divides commands into
+static std::vector<wxString> Texts(const MaximaTokenizer::TokenList &tokens)
+{
+  std::vector<wxString> texts;
+  for(auto const &token : tokens)
+    texts.push_back(token.GetText());
+  return texts;
+}
+
+SCENARIO("Tokens point into the text they have been created from") {
+  GIVEN("A maxima command") {
+    wxString commands = wxS("f(x):=x^2; /* comment */\n\"str\"");
+    auto tokens = MaximaTokenizer(commands, NULL).PopTokens();
+    THEN("The tokens are split as maxima would do it") {
+      REQUIRE(Texts(tokens) ==
+              std::vector<wxString>({wxS("f"), wxS("("), wxS("x"), wxS(")"), wxS(":"),
+                                     wxS("="), wxS("x"), wxS("^"), wxS("2"), wxS(";"),
+                                     wxS(" "), wxS("/* comment */"), wxS("\n"),
+                                     wxS("\"str\"")}));
+      REQUIRE(tokens[0].GetTextStyle() == TS_CODE_FUNCTION);
+      REQUIRE(tokens[2].GetTextStyle() == TS_CODE_VARIABLE);
+      REQUIRE(tokens[8].GetTextStyle() == TS_CODE_NUMBER);
+      REQUIRE(tokens[9].GetTextStyle() == TS_CODE_ENDOFLINE);
+      REQUIRE(tokens[11].GetTextStyle() == TS_CODE_COMMENT);
+      REQUIRE(tokens[13].GetTextStyle() == TS_CODE_STRING);
+    }
+    THEN("The tokens cover the text without gaps") {
+      std::size_t pos = 0;
+      for(auto const &token : tokens)
+        {
+          REQUIRE(token.GetOffset() == pos);
+          pos += token.GetLength();
+        }
+      REQUIRE(pos == commands.Length());
+    }
+    THEN("The tokens stay valid after the text has changed") {
+      commands = wxS("y");
+      REQUIRE(tokens[0].GetText() == wxS("f"));
+    }
+  }
+  GIVEN("Unicode variants of spaces, plus and minus signs") {
+    auto tokens = MaximaTokenizer(wxS("1e\uFE622\u00A0\uFF0B"), NULL).PopTokens();
+    THEN("Their text is the ASCII version, but they span the original chars") {
+      REQUIRE(Texts(tokens) == std::vector<wxString>({wxS("1e+2"), wxS(" "), wxS("+")}));
+      REQUIRE(tokens[0].GetLength() == 4);
+      REQUIRE(tokens[1].StartsWith(wxS(' ')));
+      REQUIRE(tokens[2].GetOffset() == 5);
+    }
+  }
+}
+
+SCENARIO("Tokenizing only the lines that have changed") {
+  GIVEN("A text with three lines") {
+    wxString commands = wxS("a:1;\nb:2;\nc:3;");
+    auto tokens = MaximaTokenizer(commands, NULL).PopTokens();
+    WHEN("The second line is changed and tokenized until its end") {
+      wxString changed = wxS("a:1;\nlonger:2;\nc:3;");
+      std::size_t lineStart = 5;
+      auto newTokens =
+        MaximaTokenizer(changed, NULL, lineStart,
+                        [](std::size_t pos) { return pos > 5; }).PopTokens();
+      THEN("Only the tokens of that line are created") {
+        REQUIRE(Texts(newTokens) ==
+                std::vector<wxString>({wxS("longer"), wxS(":"), wxS("2"), wxS(";"), wxS("\n")}));
+        REQUIRE(newTokens[0].GetOffset() == lineStart);
+      }
+      THEN("Replacing the old tokens of that line gives the tokens of the new text") {
+        tokens.Replace(5, 10, std::move(newTokens));
+        auto expected = MaximaTokenizer(changed, NULL).PopTokens();
+        REQUIRE(Texts(tokens) == Texts(expected));
+        REQUIRE(tokens.size() == expected.size());
+        for(std::size_t i = 0; i < tokens.size(); i++)
+          REQUIRE(tokens[i].GetOffset() == expected[i].GetOffset());
+      }
+    }
+  }
+}
+
+TEST_CASE("Tokenizing the .wxm files of the automatic tests", "[benchmark]") {
+  std::vector<wxString> documents;
+  wxArrayString files;
+  wxDir::GetAllFiles(wxS("."), &files, wxS("*.wxm"), wxDIR_FILES);
+  for(const auto &file : files)
+    {
+      wxFFile input(file);
+      wxString contents;
+      if(input.IsOpened() && input.ReadAll(&contents, wxConvUTF8))
+        documents.push_back(contents);
+    }
+  if(documents.empty())
+    WARN("No .wxm files found in the current directory");
+
+  const int repetitions = 20;
+  std::size_t chars = 0;
+  std::size_t tokens = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < repetitions; i++)
+    for(const auto &doc : documents)
+      {
+        chars += doc.Length();
+        tokens += MaximaTokenizer(doc, NULL).PopTokens().size();
+      }
+  double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "MaximaTokenizer: " << static_cast<double>(tokens) / std::max(seconds, 1e-9)
+            << " tokens/s, " << static_cast<double>(chars) / 1e6 / std::max(seconds, 1e-9)
+            << " million chars/s\n";
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
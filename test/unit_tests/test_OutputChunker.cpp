@@ -0,0 +1,185 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "OutputChunker.cpp"
+#include "XmlPullParser.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+static const std::string label = "<lbl altCopy=\"(%o1)\">(%o1) </lbl>";
+
+//! A matrix with the given number of rows, as maxima would send it
+static std::string Matrix(int rows) {
+  std::string xml = "<tb roundedParens=\"true\">";
+  for (int row = 0; row < rows; row++) {
+    xml += "<mtr>";
+    for (int col = 0; col < 3; col++)
+      xml += "<mtd><mn>" + std::to_string(row * 3 + col) + "</mn></mtd>";
+    xml += "</mtr>";
+  }
+  return xml + "</tb>";
+}
+
+//! A list with the given number of elements, as maxima would send it
+static std::string List(int elements) {
+  std::string xml = "<r><t listdelim=\"true\">[</t>";
+  for (int i = 0; i < elements; i++) {
+    if (i > 0)
+      xml += "<t listdelim=\"true\">,</t>";
+    xml += "<v>x</v><h>*</h><mn>" + std::to_string(i) + "</mn>";
+  }
+  return xml + "<t listdelim=\"true\">]</t></r>";
+}
+
+/*! The XML the chunks write if the output is saved
+
+  That's what ListToXML() of the labels and the OutputChunkCells generates.
+*/
+static std::string SavedXml(const std::string &xml, OutputChunker &chunker) {
+  std::string retval;
+  for (const auto &range : chunker.GetLabels())
+    retval += xml.substr(range.start, range.end - range.start);
+  const auto &chunks = chunker.GetChunks();
+  for (std::size_t i = 0; i < chunks.size(); i++)
+    retval += OutputChunker::ChunkXml(chunks[i].xml, chunker.GetContainer().get(),
+                                      i == 0, i + 1 == chunks.size());
+  return retval;
+}
+
+//! The XML of all chunks
+static std::vector<std::string> ChunkXml(OutputChunker &chunker) {
+  std::vector<std::string> retval;
+  for (const auto &chunk : chunker.GetChunks())
+    retval.push_back(chunk.xml);
+  return retval;
+}
+
+SCENARIO("Saving a very long output that has been split into chunks") {
+  GIVEN("A long matrix") {
+    const std::string output = label + Matrix(300);
+    const std::string xml = "<mth>" + output + "</mth>";
+    OutputChunker chunker;
+    REQUIRE(chunker.Split(xml.data(), xml.size()));
+    THEN("Its rows are split into several chunks") {
+      REQUIRE(chunker.GetChunks().size() > 1);
+      REQUIRE(chunker.GetLabels().size() == 1);
+    }
+    THEN("The tags of the matrix are stored only once") {
+      REQUIRE(chunker.GetContainer());
+      REQUIRE(chunker.GetContainer()->start == "<tb roundedParens=\"true\">");
+      REQUIRE(chunker.GetContainer()->end == "</tb>");
+      for (const auto &chunk : chunker.GetChunks())
+        REQUIRE(chunk.xml.find("<tb") == std::string::npos);
+    }
+    THEN("Each chunk is displayed as a matrix") {
+      for (const auto &chunk : chunker.GetChunks()) {
+        std::string display =
+          OutputChunker::DisplayXml(chunk.xml, chunker.GetContainer().get());
+        REQUIRE(display == "<tb roundedParens=\"true\">" + chunk.xml + "</tb>");
+      }
+    }
+    THEN("Saving it writes the matrix maxima has sent") {
+      REQUIRE(SavedXml(xml, chunker) == output);
+    }
+    WHEN("The saved XML is loaded again") {
+      const std::string saved = "<mth>" + SavedXml(xml, chunker) + "</mth>";
+      OutputChunker reloaded;
+      REQUIRE(reloaded.Split(saved.data(), saved.size()));
+      THEN("The chunks are the same") {
+        REQUIRE(ChunkXml(reloaded) == ChunkXml(chunker));
+        REQUIRE(reloaded.GetContainer()->start == chunker.GetContainer()->start);
+        REQUIRE(reloaded.GetContainer()->end == chunker.GetContainer()->end);
+      }
+    }
+  }
+  GIVEN("A long list within a mrow") {
+    const std::string output = "<mrow>" + List(500) + "</mrow>";
+    const std::string xml = "<mth>" + label + output + "</mth>";
+    OutputChunker chunker;
+    REQUIRE(chunker.Split(xml.data(), xml.size()));
+    THEN("The chunks share the tags of both elements") {
+      REQUIRE(chunker.GetChunks().size() > 1);
+      REQUIRE(chunker.GetContainer()->start == "<mrow><r>");
+      REQUIRE(chunker.GetContainer()->end == "</r></mrow>");
+    }
+    THEN("The list delimiters are displayed as ordinary text") {
+      std::string display =
+        OutputChunker::DisplayXml(chunker.GetChunks()[0].xml,
+                                  chunker.GetContainer().get());
+      REQUIRE(display.find("listdelim") == std::string::npos);
+      REQUIRE(display.compare(0, 8, "<t>[</t>") == 0);
+    }
+    THEN("Saving it writes the list maxima has sent") {
+      REQUIRE(SavedXml(xml, chunker) == label + output);
+    }
+    WHEN("The saved XML is loaded again") {
+      const std::string saved = "<mth>" + SavedXml(xml, chunker) + "</mth>";
+      OutputChunker reloaded;
+      REQUIRE(reloaded.Split(saved.data(), saved.size()));
+      THEN("The chunks are the same") {
+        REQUIRE(ChunkXml(reloaded) == ChunkXml(chunker));
+      }
+    }
+  }
+  GIVEN("A long output that isn't a single list") {
+    const std::string output = List(200) + "<t>+</t>" + List(200);
+    const std::string xml = "<mth>" + output + "</mth>";
+    OutputChunker chunker;
+    REQUIRE(chunker.Split(xml.data(), xml.size()));
+    THEN("Its elements are chunked without a container") {
+      REQUIRE(!chunker.GetContainer());
+      REQUIRE(SavedXml(xml, chunker) == output);
+    }
+  }
+  GIVEN("A long output with text between its elements") {
+    const std::string output = List(200) + "text" + List(200) + "<![CDATA[<>]]>";
+    const std::string xml = "<mth>" + output + "</mth>";
+    OutputChunker chunker;
+    REQUIRE(chunker.Split(xml.data(), xml.size()));
+    THEN("The text is part of the chunks") {
+      REQUIRE(SavedXml(xml, chunker) == output);
+    }
+    THEN("The text is displayed") {
+      std::string display;
+      for (const auto &chunk : chunker.GetChunks())
+        display += OutputChunker::DisplayXml(chunk.xml, nullptr);
+      REQUIRE(display.find("</r>text<r>") != std::string::npos);
+      REQUIRE(display.find("<![CDATA[<>]]>") != std::string::npos);
+    }
+  }
+  GIVEN("XML that isn't well-formed") {
+    const std::string xml = "<mth>" + Matrix(300) + "</mt>";
+    OutputChunker chunker;
+    THEN("It isn't split") {
+      REQUIRE(!chunker.Split(xml.data(), xml.size()));
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
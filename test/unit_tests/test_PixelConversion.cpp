@@ -0,0 +1,102 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "PixelConversion.cpp"
+#include <catch2/catch.hpp>
+#include <vector>
+
+//! Every combination of a color and an alpha value, with some pixels more
+//! than a multiple of 4, so the SIMD versions need to handle a remainder.
+static std::vector<unsigned char> AllPixels()
+{
+  std::vector<unsigned char> pixels;
+  for(int alpha = 0; alpha < 256; alpha++)
+    for(int color = 0; color < 256; color++)
+      {
+        pixels.push_back(static_cast<unsigned char>(color));
+        pixels.push_back(static_cast<unsigned char>(255 - color));
+        pixels.push_back(static_cast<unsigned char>(color ^ 0x55));
+        pixels.push_back(static_cast<unsigned char>(alpha));
+      }
+  pixels.insert(pixels.end(), {1, 2, 3, 200, 40, 50, 60, 70, 255, 255, 255, 128});
+  return pixels;
+}
+
+static void CheckPremultiplied(const std::vector<unsigned char> &rgba,
+                               const std::vector<unsigned char> &result,
+                               int red, int green, int blue, int alpha)
+{
+  REQUIRE(rgba.size() == result.size());
+  std::size_t errors = 0;
+  for(std::size_t i = 0; i < rgba.size(); i += 4)
+    {
+      const unsigned int a = rgba[i + 3];
+      if((result[i + red] != rgba[i] * a / 255) ||
+         (result[i + green] != rgba[i + 1] * a / 255) ||
+         (result[i + blue] != rgba[i + 2] * a / 255) ||
+         (result[i + alpha] != a))
+        errors++;
+    }
+  REQUIRE(errors == 0);
+}
+
+SCENARIO("PremultiplyRGBA premultiplies and reorders the channels") {
+  const std::vector<unsigned char> rgba = AllPixels();
+  const std::size_t pixels = rgba.size() / 4;
+  GIVEN("A bitmap that wants RGBA") {
+    std::vector<unsigned char> result(rgba.size());
+    PremultiplyRGBA(rgba.data(), result.data(), pixels, 0, 1, 2, 3);
+    THEN("Every pixel is premultiplied") {
+      CheckPremultiplied(rgba, result, 0, 1, 2, 3);
+    }
+  }
+  GIVEN("A bitmap that wants BGRA") {
+    std::vector<unsigned char> result(rgba.size());
+    PremultiplyRGBA(rgba.data(), result.data(), pixels, 2, 1, 0, 3);
+    THEN("Every pixel is premultiplied and red and blue are swapped") {
+      CheckPremultiplied(rgba, result, 2, 1, 0, 3);
+    }
+  }
+  GIVEN("A bitmap that wants ARGB") {
+    std::vector<unsigned char> result(rgba.size());
+    PremultiplyRGBA(rgba.data(), result.data(), pixels, 1, 2, 3, 0);
+    THEN("The generic version is used") {
+      CheckPremultiplied(rgba, result, 1, 2, 3, 0);
+    }
+  }
+  GIVEN("Source and destination are the same buffer") {
+    std::vector<unsigned char> result(rgba);
+    PremultiplyRGBA(result.data(), result.data(), pixels, 2, 1, 0, 3);
+    THEN("The result is the same as with separate buffers") {
+      CheckPremultiplied(rgba, result, 2, 1, 0, 3);
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
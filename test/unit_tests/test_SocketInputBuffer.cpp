@@ -0,0 +1,120 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "SocketInputBuffer.cpp"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static std::string Contents(const SocketInputBuffer &buffer)
+{
+  return std::string(buffer.Data(), buffer.Length());
+}
+
+//! Feeds data to the buffer in blocks of the given size
+static void Feed(SocketInputBuffer &buffer, const std::string &data, std::size_t blockSize)
+{
+  for(std::size_t i = 0; i < data.size(); i += blockSize)
+    buffer.Append(data.data() + i, std::min(blockSize, data.size() - i));
+}
+
+SCENARIO("SocketInputBuffer normalizes line endings") {
+  GIVEN("Data with all kinds of line endings") {
+    const std::string data("a\r\nb\rc\nd\r\r\ne");
+    for(std::size_t blockSize = 1; blockSize <= data.size(); blockSize++)
+      {
+        SocketInputBuffer buffer;
+        Feed(buffer, data, blockSize);
+        REQUIRE(Contents(buffer) == "a\nb\nc\nd\n\ne");
+      }
+  }
+  GIVEN("Data that contains NUL bytes") {
+    SocketInputBuffer buffer;
+    const std::string data("a\0b\0\0c", 6);
+    buffer.Append(data.data(), data.size());
+    REQUIRE(Contents(buffer) == "abc");
+  }
+}
+
+SCENARIO("SocketInputBuffer doesn't split UTF-8 sequences") {
+  // "x=" followed by U+00E4 (2 bytes), U+20AC (3 bytes) and U+1D400 (4 bytes)
+  const std::string data("x=\xC3\xA4\xE2\x82\xAC\xF0\x9D\x90\x80");
+  GIVEN("Every possible prefix of the data") {
+    for(std::size_t len = 0; len <= data.size(); len++)
+      {
+        std::size_t complete = SocketInputBuffer::CompleteUTF8Length(data.data(), len);
+        REQUIRE(complete <= len);
+        // All positions a character boundary can be at
+        REQUIRE((complete == 0 || complete == 1 || complete == 2 ||
+                 complete == 4 || complete == 7 || complete == 11));
+        REQUIRE(len - complete < 4);
+      }
+  }
+  WHEN("Consuming the complete part of a buffer") {
+    SocketInputBuffer buffer;
+    buffer.Append(data.data(), 5);
+    REQUIRE(buffer.CompleteLength() == 4);
+    buffer.Consume(buffer.CompleteLength());
+    THEN("The incomplete rest stays in the buffer") {
+      REQUIRE(Contents(buffer) == "\xE2");
+      buffer.Append(data.data() + 5, data.size() - 5);
+      REQUIRE(buffer.CompleteLength() == buffer.Length());
+      REQUIRE(Contents(buffer) == data.substr(4));
+    }
+  }
+}
+
+//! Measures how many MB/s of typical maxima output the buffer can handle
+TEST_CASE("SocketInputBuffer throughput", "[benchmark]") {
+  // Something that looks like the output of makelist(i,i,1,100000)
+  std::string data("<mth><lbl altCopy=\"%o1\">(%o1) </lbl><t>[</t>");
+  for(int i = 1; i <= 100000; i++)
+    data += "<mn>" + std::to_string(i) + "</mn><t>,</t>\r\n";
+  data += "<t>]</t></mth>\r\n";
+
+  const int repetitions = 20;
+  SocketInputBuffer buffer;
+  std::size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < repetitions; i++)
+    {
+      Feed(buffer, data, SocketInputBuffer::BlockSize);
+      bytes += buffer.CompleteLength();
+      buffer.Consume(buffer.CompleteLength());
+    }
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  REQUIRE(bytes > 0);
+  std::cout << "SocketInputBuffer: "
+            << static_cast<double>(bytes) / 1e6 / std::max(seconds, 1e-9)
+            << " MB/s\n";
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
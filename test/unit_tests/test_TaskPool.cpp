@@ -0,0 +1,147 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "TaskPool.cpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+SCENARIO("TaskPool runs tasks in the background") {
+  GIVEN("A pool with a few workers") {
+    TaskPool pool(4);
+    REQUIRE(pool.GetWorkerCount() == 4);
+    WHEN("Many tasks are submitted") {
+      std::atomic<int> sum{0};
+      std::vector<TaskPool::Task> tasks;
+      for(int i = 1; i <= 1000; i++)
+        tasks.push_back(pool.Submit(TaskPool::IMAGES, TaskPool::NORMAL,
+                                    [&sum, i]() { sum += i; }));
+      for(auto &task : tasks)
+        task.Wait();
+      THEN("All of them are run exactly once") {
+        REQUIRE(sum == 500500);
+        for(auto &task : tasks)
+          REQUIRE(task.IsDone());
+        TaskPool::Statistics statistics = pool.GetStatistics(TaskPool::IMAGES);
+        REQUIRE(statistics.completed == 1000);
+        REQUIRE(statistics.cancelled == 0);
+        REQUIRE(statistics.queueDepth == 0);
+        REQUIRE(statistics.maxLatency * 1000 >= statistics.totalLatency);
+        REQUIRE(pool.GetStatistics(TaskPool::MANUAL).completed == 0);
+      }
+    }
+    WHEN("Tasks submit and wait for other tasks") {
+      std::atomic<int> count{0};
+      std::vector<TaskPool::Task> tasks;
+      for(int i = 0; i < 50; i++)
+        tasks.push_back(pool.Submit(TaskPool::OTHER, TaskPool::NORMAL,
+                                    [&pool, &count]() {
+                                      std::vector<TaskPool::Task> children;
+                                      for(int j = 0; j < 10; j++)
+                                        children.push_back(
+                                          pool.Submit(TaskPool::OTHER, TaskPool::HIGH,
+                                                      [&count]() { count++; }));
+                                      for(auto &child : children)
+                                        child.Wait();
+                                    }));
+      for(auto &task : tasks)
+        task.Wait();
+      THEN("They don't dead-lock") {
+        REQUIRE(count == 500);
+      }
+    }
+  }
+  GIVEN("A pool whose only worker is busy") {
+    TaskPool pool(1);
+    std::atomic<bool> release{false};
+    std::atomic<bool> started{false};
+    TaskPool::Task blocker = pool.Submit(TaskPool::OTHER, TaskPool::NORMAL,
+                                         [&release, &started]() {
+                                           started = true;
+                                           while(!release)
+                                             std::this_thread::yield();
+                                         });
+    while(!started)
+      std::this_thread::yield();
+    THEN("Waiting for a queued task runs it on the waiting thread") {
+      std::thread::id ranOn;
+      TaskPool::Task task = pool.Submit(TaskPool::OTHER, TaskPool::NORMAL,
+                                        [&ranOn]() { ranOn = std::this_thread::get_id(); });
+      task.Wait();
+      REQUIRE(ranOn == std::this_thread::get_id());
+      release = true;
+      blocker.Wait();
+    }
+    THEN("Cancelled tasks aren't run") {
+      bool ran = false;
+      TaskPool::CancellationToken token;
+      TaskPool::Task task = pool.Submit(TaskPool::GNUPLOT_SOURCES, TaskPool::LOW,
+                                        [&ran]() { ran = true; }, token);
+      REQUIRE(pool.GetStatistics(TaskPool::GNUPLOT_SOURCES).queueDepth == 1);
+      token.Cancel();
+      release = true;
+      task.Wait();
+      REQUIRE(!ran);
+      REQUIRE(task.IsDone());
+      REQUIRE(pool.GetStatistics(TaskPool::GNUPLOT_SOURCES).cancelled == 1);
+      REQUIRE(pool.GetStatistics(TaskPool::GNUPLOT_SOURCES).queueDepth == 0);
+    }
+    THEN("Tasks with a higher priority are started first") {
+      std::vector<int> order;
+      std::vector<TaskPool::Task> tasks;
+      tasks.push_back(pool.Submit(TaskPool::OTHER, TaskPool::LOW,
+                                  [&order]() { order.push_back(TaskPool::LOW); }));
+      tasks.push_back(pool.Submit(TaskPool::OTHER, TaskPool::NORMAL,
+                                  [&order]() { order.push_back(TaskPool::NORMAL); }));
+      tasks.push_back(pool.Submit(TaskPool::OTHER, TaskPool::HIGH,
+                                  [&order]() { order.push_back(TaskPool::HIGH); }));
+      release = true;
+      blocker.Wait();
+      // Waiting for the tasks in the order they were submitted might run
+      // them in that order => wait until the worker has run all of them.
+      while(pool.GetStatistics(TaskPool::OTHER).completed < 4)
+        std::this_thread::yield();
+      for(auto &task : tasks)
+        task.Wait();
+      REQUIRE(order == std::vector<int>({TaskPool::HIGH, TaskPool::NORMAL, TaskPool::LOW}));
+    }
+  }
+  GIVEN("A handle that doesn't refer to a task") {
+    TaskPool::Task task;
+    THEN("Waiting for it and cancelling it does nothing") {
+      REQUIRE(!task.IsValid());
+      REQUIRE(task.IsDone());
+      task.Cancel();
+      task.Wait();
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,75 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "TextExtentCache.cpp"
+#include <catch2/catch.hpp>
+
+SCENARIO("TextExtentCache remembers the sizes of texts") {
+  GIVEN("A cache for three texts") {
+    TextExtentCache cache(3);
+    wxSize size;
+    const AFontSize fontSize(12.0f);
+    THEN("Texts that haven't been stored aren't found") {
+      REQUIRE(!cache.Lookup(1, fontSize, 96, wxS("x"), size));
+      REQUIRE(cache.GetStatistics().misses == 1);
+    }
+    WHEN("A few texts have been stored") {
+      cache.Store(1, fontSize, 96, wxS("x"), wxSize(8, 16));
+      cache.Store(1, fontSize, 96, wxS("sin"), wxSize(24, 16));
+      cache.Store(2, fontSize, 96, wxS("x"), wxSize(9, 17));
+      THEN("They are found again") {
+        REQUIRE(cache.Lookup(1, fontSize, 96, wxS("x"), size));
+        REQUIRE(size == wxSize(8, 16));
+        REQUIRE(cache.Lookup(2, fontSize, 96, wxS("x"), size));
+        REQUIRE(size == wxSize(9, 17));
+        REQUIRE(cache.GetStatistics().hits == 2);
+      }
+      THEN("A different font size, resolution or font is a different text") {
+        REQUIRE(!cache.Lookup(1, AFontSize(14.0f), 96, wxS("x"), size));
+        REQUIRE(!cache.Lookup(1, fontSize, 192, wxS("x"), size));
+        REQUIRE(!cache.Lookup(3, fontSize, 96, wxS("x"), size));
+      }
+      THEN("Storing another text forgets the one that has been used least recently") {
+        REQUIRE(cache.Lookup(1, fontSize, 96, wxS("x"), size));
+        cache.Store(1, fontSize, 96, wxS("%pi"), wxSize(16, 16));
+        REQUIRE(cache.Lookup(1, fontSize, 96, wxS("x"), size));
+        REQUIRE(!cache.Lookup(1, fontSize, 96, wxS("sin"), size));
+        REQUIRE(cache.Lookup(1, fontSize, 96, wxS("%pi"), size));
+        REQUIRE(cache.GetStatistics().evictions == 1);
+        REQUIRE(cache.GetStatistics().entries == 3);
+      }
+      THEN("Clear() forgets everything") {
+        cache.Clear();
+        REQUIRE(cache.GetStatistics().entries == 0);
+        REQUIRE(!cache.Lookup(1, fontSize, 96, wxS("x"), size));
+      }
+    }
+  }
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,235 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+#define CATCH_CONFIG_RUNNER
+#include "XmlPullParser.cpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wx/dir.h>
+#include <wx/init.h>
+#include <wx/mstream.h>
+#include <wx/wfstream.h>
+#include <wx/xml/xml.h>
+#include <wx/zipstrm.h>
+
+//! Returns the tokens the parser finds in data, in a readable form
+static std::vector<std::string> Tokens(const std::string &data, bool scrub = false)
+{
+  XmlPullParser parser(data.data(), data.size(), scrub);
+  std::vector<std::string> tokens;
+  for(;;)
+    {
+      XmlPullParser::TokenType token = parser.Next();
+      switch(token)
+        {
+        case XmlPullParser::START_TAG:
+          {
+            std::string tag = "<" + parser.Name();
+            for(const auto &attr : parser.Attributes())
+              tag += " " + attr.first + "=" + attr.second;
+            tokens.push_back(tag + ">");
+            break;
+          }
+        case XmlPullParser::END_TAG:
+          tokens.push_back("</" + parser.Name() + ">");
+          break;
+        case XmlPullParser::TEXT:
+          tokens.push_back(parser.Text());
+          break;
+        case XmlPullParser::CDATA:
+          tokens.push_back("CDATA:" + parser.Text());
+          break;
+        case XmlPullParser::ERROR:
+          tokens.push_back("ERROR");
+          return tokens;
+        case XmlPullParser::END_OF_DATA:
+          return tokens;
+        }
+    }
+}
+
+SCENARIO("XmlPullParser reads maxima's XML") {
+  GIVEN("A typical line of maths") {
+    std::string data("<mth><lbl altCopy=\"%o1\">(%o1) </lbl><mn>1</mn><v>x</v></mth>");
+    THEN("All tags and texts are found in order") {
+      std::vector<std::string> expected{
+        "<mth>", "<lbl altCopy=%o1>", "(%o1) ", "</lbl>", "<mn>", "1", "</mn>",
+        "<v>", "x", "</v>", "</mth>"};
+      REQUIRE(Tokens(data) == expected);
+    }
+  }
+  GIVEN("Whitespace, entities and empty elements") {
+    std::string data("<?xml version=\"1.0\"?>\n<!-- comment -->\n"
+                     "<r a='&lt;&amp;&gt;'>\n <t>&quot;&#65;&#x20AC;</t><s/></r>\n");
+    THEN("Whitespace nodes are kept and entities are resolved") {
+      std::vector<std::string> expected{
+        "<r a=<&>>", "\n ", "<t>", "\"A\xE2\x82\xAC", "</t>", "<s>", "</s>", "</r>"};
+      REQUIRE(Tokens(data) == expected);
+    }
+  }
+  GIVEN("A CDATA section") {
+    std::string data("<r><![CDATA[<a>&amp;]]></r>");
+    THEN("Its contents are returned as they are") {
+      std::vector<std::string> expected{"<r>", "CDATA:<a>&amp;", "</r>"};
+      REQUIRE(Tokens(data) == expected);
+    }
+  }
+  GIVEN("Control characters") {
+    std::string data("<r a=\"\x01\">x\ty&#7;\xC2\x85</r>");
+    THEN("They are kept if we don't ask for them to be scrubbed") {
+      std::vector<std::string> expected{"<r a=\x01>", "x\ty\x07\xC2\x85", "</r>"};
+      REQUIRE(Tokens(data) == expected);
+    }
+    THEN("They are replaced by U+FFFD if we ask for that") {
+      std::vector<std::string> expected{
+        "<r a=\xEF\xBF\xBD>",
+        "x\xEF\xBF\xBDy\xEF\xBF\xBD\xEF\xBF\xBD", "</r>"};
+      REQUIRE(Tokens(data, true) == expected);
+    }
+  }
+  GIVEN("A document we want to split into its elements") {
+    std::string data("<mth><a x=\"1\">y</a><b/></mth>");
+    XmlPullParser parser(data.data(), data.size());
+    THEN("The tokens know where in the data they are") {
+      REQUIRE(parser.Next() == XmlPullParser::START_TAG);
+      REQUIRE(parser.Next() == XmlPullParser::START_TAG);
+      REQUIRE(data.substr(parser.TokenStart(), parser.TokenEnd() - parser.TokenStart()) == "<a x=\"1\">");
+      REQUIRE(parser.Next() == XmlPullParser::TEXT);
+      REQUIRE(parser.Next() == XmlPullParser::END_TAG);
+      REQUIRE(data.substr(parser.TokenStart(), parser.TokenEnd() - parser.TokenStart()) == "</a>");
+      REQUIRE(parser.Next() == XmlPullParser::START_TAG);
+      REQUIRE(data.substr(parser.TokenStart(), parser.TokenEnd() - parser.TokenStart()) == "<b/>");
+      REQUIRE(parser.Next() == XmlPullParser::END_TAG);
+      REQUIRE(parser.TokenStart() == parser.TokenEnd());
+    }
+  }
+  GIVEN("Data that isn't well-formed") {
+    THEN("Mismatched tags are an error") {
+      REQUIRE(Tokens("<a><b></a></b>").back() == "ERROR");
+    }
+    THEN("Unclosed tags are an error") {
+      REQUIRE(Tokens("<a><b></b>").back() == "ERROR");
+    }
+    THEN("Unknown entities are an error") {
+      REQUIRE(Tokens("<a>&nbsp;</a>").back() == "ERROR");
+    }
+    THEN("A second root element is an error") {
+      REQUIRE(Tokens("<a/><b/>").back() == "ERROR");
+    }
+    THEN("Unquoted attributes are an error") {
+      REQUIRE(Tokens("<a b=c/>").back() == "ERROR");
+    }
+    THEN("Text outside the root element is an error") {
+      REQUIRE(Tokens("<a/>x").back() == "ERROR");
+    }
+  }
+}
+
+//! Reads content.xml from all .wxmx files in the current directory
+static std::vector<std::string> ReadTestDocuments()
+{
+  std::vector<std::string> documents;
+  wxArrayString files;
+  wxDir::GetAllFiles(wxS("."), &files, wxS("*.wxmx"), wxDIR_FILES);
+  for(const auto &file : files)
+    {
+      wxFFileInputStream fileStream(file);
+      wxZipInputStream zip(fileStream);
+      std::unique_ptr<wxZipEntry> entry;
+      while(entry.reset(zip.GetNextEntry()), entry)
+        if(entry->GetName() == wxS("content.xml"))
+          {
+            std::string contents;
+            char buf[65536];
+            while(zip.Read(buf, sizeof(buf)).LastRead() > 0)
+              contents.append(buf, zip.LastRead());
+            documents.push_back(contents);
+          }
+    }
+  return documents;
+}
+
+TEST_CASE("XmlPullParser compared to wxXmlDocument", "[benchmark]") {
+  wxInitializer initializer;
+  std::vector<std::string> documents = ReadTestDocuments();
+  if(documents.empty())
+    WARN("No .wxmx files found in the current directory");
+
+  std::size_t bytes = 0;
+  for(const auto &doc : documents)
+    bytes += doc.size();
+
+  const int repetitions = 20;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < repetitions; i++)
+    for(const auto &doc : documents)
+      {
+        wxMemoryInputStream stream(doc.data(), doc.size());
+        wxXmlDocument xml;
+        wxLogNull suppressErrorMessages;
+#if wxCHECK_VERSION(3, 3, 0)
+        REQUIRE(xml.Load(stream, wxXMLDOC_KEEP_WHITESPACE_NODES));
+#else
+        REQUIRE(xml.Load(stream, wxS("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES));
+#endif
+      }
+  double domSeconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < repetitions; i++)
+    for(const auto &doc : documents)
+      {
+        // Convert everything to wxStrings, as wxXmlDocument does
+        XmlPullParser parser(doc.data(), doc.size(), true);
+        XmlPullParser::TokenType token;
+        while((token = parser.Next()) != XmlPullParser::END_OF_DATA)
+          {
+            REQUIRE(token != XmlPullParser::ERROR);
+            if(token == XmlPullParser::START_TAG)
+              {
+                wxString name = wxString::FromUTF8(parser.Name().data(), parser.Name().size());
+                for(const auto &attr : parser.Attributes())
+                  wxString value = wxString::FromUTF8(attr.second.data(), attr.second.size());
+              }
+            else if((token == XmlPullParser::TEXT) || (token == XmlPullParser::CDATA))
+              wxString text = wxString::FromUTF8(parser.Text().data(), parser.Text().size());
+          }
+      }
+  double pullSeconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const double megabytes = static_cast<double>(bytes) * repetitions / 1e6;
+  std::cout << "wxXmlDocument: " << megabytes / std::max(domSeconds, 1e-9) << " MB/s\n";
+  std::cout << "XmlPullParser: " << megabytes / std::max(pullSeconds, 1e-9) << " MB/s\n";
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}
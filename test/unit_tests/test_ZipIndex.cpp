@@ -0,0 +1,146 @@
+// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2024 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+//  SPDX-License-Identifier: GPL-2.0+
+
+
+#define CATCH_CONFIG_RUNNER
+#include "ZipIndex.cpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <wx/filename.h>
+#include <wx/init.h>
+#include <wx/log.h>
+#include <wx/wfstream.h>
+#include <wx/zipstrm.h>
+
+//! Writes a .zip archive with a few stored and a few deflated files
+static void WriteTestArchive(const wxString &name, int files)
+{
+  wxFFileOutputStream out(name);
+  wxZipOutputStream zip(out);
+  for(int i = 0; i < files; i++)
+    {
+      wxZipEntry *entry = new wxZipEntry(wxString::Format(wxS("image%i.png"), i));
+      if(i % 2 == 0)
+        entry->SetMethod(wxZIP_METHOD_STORE);
+      zip.PutNextEntry(entry);
+      std::string data = std::string(100 * i, 'a' + (i % 26)) + std::to_string(i);
+      zip.Write(data.data(), data.size());
+      zip.CloseEntry();
+    }
+  zip.Close();
+  out.Close();
+}
+
+//! The contents of a file in the archive, as a string
+static std::string ReadString(const ZipIndex &index, const wxString &name)
+{
+  wxMemoryBuffer data;
+  if(!index.Read(name, data))
+    return "<not found>";
+  return std::string(static_cast<const char *>(data.GetData()), data.GetDataLen());
+}
+
+SCENARIO("ZipIndex finds the files in an archive") {
+  wxInitializer initializer;
+  wxLogNull suppressErrorMessages;
+  const wxString archive = wxFileName::CreateTempFileName(wxS("test_ZipIndex"));
+  WriteTestArchive(archive, 50);
+
+  GIVEN("An archive with stored and deflated files") {
+    ZipIndex index(archive);
+    THEN("All files are found") {
+      REQUIRE(index.IsOk());
+      REQUIRE(index.GetEntryCount() == 50);
+    }
+    THEN("They contain what was written to them") {
+      for(int i = 0; i < 50; i++)
+        REQUIRE(ReadString(index, wxString::Format(wxS("image%i.png"), i)) ==
+                std::string(100 * i, 'a' + (i % 26)) + std::to_string(i));
+    }
+    THEN("Files that don't exist aren't found") {
+      REQUIRE(index.Find(wxS("image50.png")) == NULL);
+      REQUIRE(ReadString(index, wxS("image50.png")) == "<not found>");
+    }
+  }
+  GIVEN("Several requests for the index of the same archive") {
+    std::shared_ptr<const ZipIndex> first = ZipIndex::Get(archive);
+    std::shared_ptr<const ZipIndex> second = ZipIndex::Get(archive);
+    THEN("They share the index") {
+      REQUIRE(first == second);
+    }
+    WHEN("The archive is re-written") {
+      WriteTestArchive(archive, 10);
+      ZipIndex::Forget(archive);
+      THEN("The index is read again") {
+        std::shared_ptr<const ZipIndex> third = ZipIndex::Get(archive);
+        REQUIRE(third != first);
+        REQUIRE(third->GetEntryCount() == 10);
+        REQUIRE(first->GetEntryCount() == 50);
+      }
+    }
+  }
+  GIVEN("An archive whose central directory claims a file is huge") {
+    {
+      wxFile file(archive, wxFile::read_write);
+      REQUIRE(file.IsOpened());
+      const std::size_t length = static_cast<std::size_t>(file.Length());
+      std::string data(length, '\0');
+      REQUIRE(file.Read(&data[0], length) == static_cast<ssize_t>(length));
+      // The uncompressed size of the deflated image1.png
+      const std::size_t centralHeader = data.find(std::string("PK\x01\x02", 4));
+      REQUIRE(centralHeader != std::string::npos);
+      const std::size_t name = data.find("image1.png", centralHeader);
+      REQUIRE(name != std::string::npos);
+      const unsigned char hugeSize[4] = {0xff, 0xff, 0xff, 0x7f};
+      REQUIRE(file.Seek(static_cast<wxFileOffset>(name - 46 + 24)) != wxInvalidOffset);
+      REQUIRE(file.Write(hugeSize, sizeof(hugeSize)) == sizeof(hugeSize));
+    }
+    THEN("The archive isn't trusted") {
+      ZipIndex index(archive);
+      REQUIRE(!index.IsOk());
+      REQUIRE(ReadString(index, wxS("image1.png")) == "<not found>");
+    }
+  }
+  GIVEN("An archive whose end is missing") {
+    {
+      wxMemoryBuffer data;
+      wxFile in(archive);
+      REQUIRE(in.IsOpened());
+      const std::size_t length = static_cast<std::size_t>(in.Length());
+      REQUIRE(in.Read(data.GetWriteBuf(length), length) == static_cast<ssize_t>(length));
+      in.Close();
+      wxFile out(archive, wxFile::write);
+      REQUIRE(out.Write(data.GetData(), length - 100) == length - 100);
+    }
+    THEN("No index can be read") {
+      REQUIRE(!ZipIndex(archive).IsOk());
+    }
+  }
+  wxRemoveFile(archive);
+}
+
+// If we don't provide our own main when compiling on MinGW
+// we currently get an error message that WinMain@16 is missing
+// (https://github.com/catchorg/Catch2/issues/1287)
+int main(int argc, const char* argv[])
+{
+    return Catch::Session().run(argc, argv);
+}